@@ -0,0 +1,30 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaActorChannel.h"
+#include "GameFramework/Actor.h"
+#include "Net/DataBunch.h"
+
+TMap<FName, FFutureNinjaClassTraffic> UFutureNinjaActorChannel::Traffic;
+
+UFutureNinjaActorChannel::UFutureNinjaActorChannel(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+void UFutureNinjaActorChannel::ConsumeTraffic(TMap<FName, FFutureNinjaClassTraffic>& OutTraffic)
+{
+	OutTraffic = MoveTemp(Traffic);
+	Traffic.Reset();
+}
+
+FPacketIdRange UFutureNinjaActorChannel::SendBunch(FOutBunch* Bunch, bool Merge)
+{
+	if (Actor != nullptr && Bunch != nullptr)
+	{
+		FFutureNinjaClassTraffic& ClassTraffic = Traffic.FindOrAdd(Actor->GetClass()->GetFName());
+		ClassTraffic.Bytes += Bunch->GetNumBytes();
+		++ClassTraffic.Bunches;
+	}
+
+	return Super::SendBunch(Bunch, Merge);
+}
@@ -0,0 +1,42 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/ActorChannel.h"
+#include "FutureNinjaActorChannel.generated.h"
+
+/** Bytes and bunches sent for the actors of one class. */
+struct FFutureNinjaClassTraffic
+{
+	int64 Bytes;
+	int32 Bunches;
+
+	FFutureNinjaClassTraffic()
+		: Bytes(0), Bunches(0)
+	{}
+};
+
+/**
+ * Actor channel that counts what it sends per actor class, so the replication budgeter can report bytes
+ * per class and estimate what one update of an actor costs. Installed on the server's net driver by
+ * AFutureNinjaReplicationBudgeter; channels opened before that keep the engine class and are not counted.
+ */
+UCLASS(transient, customConstructor)
+class UFutureNinjaActorChannel : public UActorChannel
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaActorChannel(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** Moves the traffic counted since the last call into OutTraffic. Game thread only. */
+	static void ConsumeTraffic(TMap<FName, FFutureNinjaClassTraffic>& OutTraffic);
+
+	// UChannel interface
+	virtual FPacketIdRange SendBunch(FOutBunch* Bunch, bool Merge) override;
+	// End of UChannel interface
+
+private:
+	static TMap<FName, FFutureNinjaClassTraffic> Traffic;
+};
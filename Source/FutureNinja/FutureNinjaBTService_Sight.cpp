@@ -0,0 +1,75 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaBTService_Sight.h"
+#include "FutureNinja.h"
+#include "FutureNinjaPerceptionService.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTree.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/BlackboardData.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+
+UFutureNinjaBTService_Sight::UFutureNinjaBTService_Sight()
+{
+	NodeName = TEXT("Player Sight");
+
+	// Reading the shared result is cheap; the traces run at the perception service's rate
+	Interval = 0.1f;
+	RandomDeviation = 0.f;
+	MaxAge = 0.f;
+
+	CanSeePlayerKey.AddBoolFilter(this, GET_MEMBER_NAME_CHECKED(UFutureNinjaBTService_Sight, CanSeePlayerKey));
+	PlayerLocationKey.AddVectorFilter(this, GET_MEMBER_NAME_CHECKED(UFutureNinjaBTService_Sight, PlayerLocationKey));
+}
+
+void UFutureNinjaBTService_Sight::InitializeFromAsset(UBehaviorTree& Asset)
+{
+	Super::InitializeFromAsset(Asset);
+
+	if (const UBlackboardData* Blackboard = GetBlackboardAsset())
+	{
+		CanSeePlayerKey.ResolveSelectedKey(*Blackboard);
+		PlayerLocationKey.ResolveSelectedKey(*Blackboard);
+	}
+}
+
+FString UFutureNinjaBTService_Sight::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: %s, %s"), *Super::GetStaticDescription(), *CanSeePlayerKey.SelectedKeyName.ToString(), *PlayerLocationKey.SelectedKeyName.ToString());
+}
+
+void UFutureNinjaBTService_Sight::TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	Super::TickNode(OwnerComp, NodeMemory, DeltaSeconds);
+
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	APawn* Enemy = Controller != nullptr ? Controller->GetPawn() : nullptr;
+	AFutureNinjaPerceptionService* Service = Enemy != nullptr ? AFutureNinjaPerceptionService::Get(Enemy->GetWorld()) : nullptr;
+	UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	if (Service == nullptr || Blackboard == nullptr)
+	{
+		return;
+	}
+
+	FFutureNinjaSightResult Result;
+	if (!Service->GetSight(Enemy, Result))
+	{
+		// Spawned before the service existed; answered from the next tick on
+		Service->Register(Enemy);
+		return;
+	}
+
+	if (MaxAge > 0.f && Result.Age > MaxAge)
+	{
+		Service->RequestUpdate(Enemy);
+	}
+
+	if (CanSeePlayerKey.IsSet())
+	{
+		Blackboard->SetValueAsBool(CanSeePlayerKey.SelectedKeyName, Result.bCanSeePlayer);
+	}
+	if (PlayerLocationKey.IsSet() && Result.TimeSinceSeen >= 0.f)
+	{
+		Blackboard->SetValueAsVector(PlayerLocationKey.SelectedKeyName, Result.LastSeenLocation);
+	}
+}
@@ -0,0 +1,45 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTService.h"
+#include "FutureNinjaBTService_Sight.generated.h"
+
+/**
+ * Copies the controlled enemy's sight of the player from AFutureNinjaPerceptionService into blackboard keys,
+ * in place of a Blueprint service tracing its own line to the player.
+ *
+ * No trace is made here: the service only reads the shared result, so running it at the tree's rate costs
+ * a map lookup. A result older than MaxAge asks the perception service for an early check.
+ */
+UCLASS(meta = (DisplayName = "Player Sight"))
+class UFutureNinjaBTService_Sight : public UBTService
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaBTService_Sight();
+
+	/** Bool key set while the player is in sight. */
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector CanSeePlayerKey;
+
+	/** Vector key set to where the player was last seen. */
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector PlayerLocationKey;
+
+	/** Results older than this ask for an early check; 0 leaves the update rate to the perception service's tiers. */
+	UPROPERTY(EditAnywhere, Category = Perception, meta = (ClampMin = "0"))
+	float MaxAge;
+
+	// UBTNode interface
+	virtual void InitializeFromAsset(UBehaviorTree& Asset) override;
+	virtual FString GetStaticDescription() const override;
+	// End of UBTNode interface
+
+protected:
+	// UBTService interface
+	virtual void TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+	// End of UBTService interface
+};
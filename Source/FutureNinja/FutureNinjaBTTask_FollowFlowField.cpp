@@ -0,0 +1,62 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaBTTask_FollowFlowField.h"
+#include "FutureNinja.h"
+#include "FutureNinjaFlowField.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "GameFramework/Pawn.h"
+
+UFutureNinjaBTTask_FollowFlowField::UFutureNinjaBTTask_FollowFlowField()
+{
+	NodeName = TEXT("Follow Flow Field");
+	bNotifyTick = true;
+
+	AcceptableRadius = 150.f;
+}
+
+EBTNodeResult::Type UFutureNinjaBTTask_FollowFlowField::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	return Step(OwnerComp);
+}
+
+void UFutureNinjaBTTask_FollowFlowField::TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	const EBTNodeResult::Type Result = Step(OwnerComp);
+	if (Result != EBTNodeResult::InProgress)
+	{
+		FinishLatentTask(OwnerComp, Result);
+	}
+}
+
+EBTNodeResult::Type UFutureNinjaBTTask_FollowFlowField::Step(UBehaviorTreeComponent& OwnerComp) const
+{
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	APawn* Pawn = Controller != nullptr ? Controller->GetPawn() : nullptr;
+	const AFutureNinjaFlowField* Field = Pawn != nullptr ? AFutureNinjaFlowField::Get(Pawn->GetWorld()) : nullptr;
+	if (Field == nullptr)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	// Fails too before the first field is built, when there is no goal to compare with
+	const FVector Location = Pawn->GetNavAgentLocation();
+	FVector Direction;
+	if (!Field->GetFlowDirection(Location, Direction))
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	if (FVector::DistSquared2D(Location, Field->GetGoal()) <= FMath::Square(AcceptableRadius))
+	{
+		return EBTNodeResult::Succeeded;
+	}
+
+	Pawn->AddMovementInput(Direction);
+	return EBTNodeResult::InProgress;
+}
+
+FString UFutureNinjaBTTask_FollowFlowField::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: within %.0f of the player"), *Super::GetStaticDescription(), AcceptableRadius);
+}
@@ -0,0 +1,42 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "FutureNinjaBTTask_FollowFlowField.generated.h"
+
+/**
+ * Walks the controlled pawn toward the player along AFutureNinjaFlowField, in place of a Move To with its
+ * own navmesh path.
+ *
+ * Every tick the pawn's cell is looked up in the shared field and the direction found is fed to its
+ * movement component as input. Succeeds within AcceptableRadius of the player, fails where the field has
+ * no way to the player so the tree can fall back to a Move To.
+ */
+UCLASS(meta = (DisplayName = "Follow Flow Field"))
+class UFutureNinjaBTTask_FollowFlowField : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaBTTask_FollowFlowField();
+
+	/** Distance to the player at which the task succeeds. */
+	UPROPERTY(EditAnywhere, Category = Movement, meta = (ClampMin = "0"))
+	float AcceptableRadius;
+
+	// UBTTaskNode interface
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual FString GetStaticDescription() const override;
+	// End of UBTTaskNode interface
+
+protected:
+	// UBTTaskNode interface
+	virtual void TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+	// End of UBTTaskNode interface
+
+private:
+	/** Feeds the pawn one tick of movement input, or says how the task ended. */
+	EBTNodeResult::Type Step(UBehaviorTreeComponent& OwnerComp) const;
+};
@@ -1,23 +1,44 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
 #include "FutureNinjaCharacter.h"
+#include "FutureNinjaCharacterInputComponent.h"
+#include "FutureNinjaControllerPoseTracker.h"
+#include "FutureNinjaFireFeedbackComponent.h"
+#include "FutureNinjaHitchDetector.h"
 #include "FutureNinjaProjectile.h"
+#include "FutureNinjaProjectileManager.h"
+#include "FutureNinjaProjectilePool.h"
+#include "FutureNinjaTelemetry.h"
+#include "FutureNinjaThrowGestureComponent.h"
+#include "FutureNinjaTrajectoryPreviewComponent.h"
 #include "Animation/AnimInstance.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameStateBase.h"
 #include "GameFramework/InputSettings.h"
-#include "HeadMountedDisplayFunctionLibrary.h"
-#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
 #include "MotionControllerComponent.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogFPChar, Warning, All);
+DEFINE_LOG_CATEGORY_STATIC(LogCharacterSpawn, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Character Fire"), STAT_CharacterFire, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Character Spawn Projectile"), STAT_CharacterSpawnProjectile, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Character Fire Sound"), STAT_CharacterFireSound, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Character Fire Montage"), STAT_CharacterFireMontage, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Character Register Rig"), STAT_CharacterRegisterRig, STATGROUP_FutureNinja);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Character Spawn Ms"), STAT_CharacterSpawnMs, STATGROUP_FutureNinja);
 
 //////////////////////////////////////////////////////////////////////////
 // AFutureNinjaCharacter
 
 AFutureNinjaCharacter::AFutureNinjaCharacter()
 {
+	ConstructCycles = FPlatformTime::Cycles();
+	RegisteredCycles = ConstructCycles;
+
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(55.f, 96.0f);
 
@@ -55,6 +76,8 @@ AFutureNinjaCharacter::AFutureNinjaCharacter()
 	// Default offset from the character location for projectiles to spawn
 	GunOffset = FVector(100.0f, 0.0f, 10.0f);
 
+	ProjectilePrewarmCount = 0;
+
 	// Note: The ProjectileClass and the skeletal mesh/anim blueprints for Mesh1P, FP_Gun, and VR_Gun 
 	// are set in the derived blueprint asset named MyCharacter to avoid direct content references in C++.
 
@@ -65,6 +88,16 @@ AFutureNinjaCharacter::AFutureNinjaCharacter()
 	L_MotionController = CreateDefaultSubobject<UMotionControllerComponent>(TEXT("L_MotionController"));
 	L_MotionController->SetupAttachment(RootComponent);
 
+	ControllerPoseTracker = CreateDefaultSubobject<UFutureNinjaControllerPoseTracker>(TEXT("ControllerPoseTracker"));
+	HandVelocityScale = 1.f;
+
+	ThrowGesture = CreateDefaultSubobject<UFutureNinjaThrowGestureComponent>(TEXT("ThrowGesture"));
+	FireFeedback = CreateDefaultSubobject<UFutureNinjaFireFeedbackComponent>(TEXT("FireFeedback"));
+	CharacterInput = CreateDefaultSubobject<UFutureNinjaCharacterInputComponent>(TEXT("CharacterInput"));
+	TrajectoryPreview = CreateDefaultSubobject<UFutureNinjaTrajectoryPreviewComponent>(TEXT("TrajectoryPreview"));
+	TrajectoryPreview->SetupAttachment(RootComponent);
+	bShowTrajectoryPreview = true;
+
 	// Create a gun and attach it to the right-hand VR controller.
 	// Create a gun mesh component
 	VR_Gun = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("VR_Gun"));
@@ -81,29 +114,190 @@ AFutureNinjaCharacter::AFutureNinjaCharacter()
 
 	// Uncomment the following line to turn motion controllers on by default:
 	//bUsingMotionControllers = true;
+
+	// Registered by RegisterRig for the active mode only
+	for (USceneComponent* RigComponent : { static_cast<USceneComponent*>(Mesh1P), static_cast<USceneComponent*>(FP_Gun), FP_MuzzleLocation,
+		static_cast<USceneComponent*>(R_MotionController), static_cast<USceneComponent*>(L_MotionController), static_cast<USceneComponent*>(VR_Gun), VR_MuzzleLocation })
+	{
+		RigComponent->bAutoRegister = false;
+	}
+
+	MaxShotOriginDistance = 400.f;
+	MinShotInterval = 0.05f;
+	ShotIntervalTolerance = 0.01f;
+	MinShotArrivalInterval = 0.025f;
+	MaxShotCatchUpSeconds = 0.25f;
+	LastShotId = 0;
+	LastServerShotTime = -MAX_FLT;
+	LastServerShotArrivalTime = -MAX_FLT;
+
+	InputStepSeconds = 0.f;
+	bHasAppliedFrame = false;
+	InputSessionMode = EInputSessionMode::None;
+	InputSessionStartFrame = 0;
+	ReplayFrame = 0;
+	FirstDivergentFrame = INDEX_NONE;
 }
 
-void AFutureNinjaCharacter::BeginPlay()
+void AFutureNinjaCharacter::PostRegisterAllComponents()
 {
-	// Call the base class  
-	Super::BeginPlay();
+	Super::PostRegisterAllComponents();
 
-	//Attach gun mesh component to Skeleton, doing it here because the skeleton is not yet created in the constructor
-	FP_Gun->AttachToComponent(Mesh1P, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, true), TEXT("GripPoint"));
+	// Components are registered again after every change in the editor, which shows both rigs so either can be edited
+	RigSpawnTimes.Reset();
 
-	// Show or hide the two versions of the gun based on whether or not we're using motion controllers.
-	if (bUsingMotionControllers)
+	const UWorld* World = GetWorld();
+	if (World == nullptr || !World->IsGameWorld())
 	{
-		VR_Gun->SetHiddenInGame(false, true);
-		Mesh1P->SetHiddenInGame(true, true);
+		RegisterRig(false);
+		RegisterRig(true);
+	}
+	else if (IsActorInitialized())
+	{
+		// Registered again, e.g. when its streaming level is shown again
+		RegisterRig(bUsingMotionControllers);
+	}
+
+	RegisteredCycles = FPlatformTime::Cycles();
+}
+
+void AFutureNinjaCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Components are registered before the construction script runs and before a deferred spawn is finished,
+	// so the mode is only final here
+	const UWorld* World = GetWorld();
+	if (World != nullptr && World->IsGameWorld())
+	{
+		RegisterRig(bUsingMotionControllers);
+		RegisteredCycles = FPlatformTime::Cycles();
+	}
+}
+
+void AFutureNinjaCharacter::GetRigComponents(bool bMotionControllerRig, TArray<USceneComponent*>& OutComponents) const
+{
+	if (bMotionControllerRig)
+	{
+		OutComponents.Append({ R_MotionController, L_MotionController, VR_Gun, VR_MuzzleLocation });
 	}
 	else
 	{
-		VR_Gun->SetHiddenInGame(true, true);
-		Mesh1P->SetHiddenInGame(false, true);
+		OutComponents.Append({ Mesh1P, FP_Gun, FP_MuzzleLocation });
 	}
 }
 
+void AFutureNinjaCharacter::RegisterRig(bool bMotionControllerRig)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterRegisterRig);
+
+	TArray<USceneComponent*> Components;
+	GetRigComponents(bMotionControllerRig, Components);
+
+	for (USceneComponent* Component : Components)
+	{
+		if (Component == nullptr || Component->IsRegistered())
+		{
+			continue;
+		}
+
+		const uint32 StartCycles = FPlatformTime::Cycles();
+		Component->RegisterComponent();
+
+		FComponentSpawnTime& SpawnTime = RigSpawnTimes[RigSpawnTimes.AddUninitialized()];
+		SpawnTime.Name = Component->GetFName();
+		SpawnTime.Ms = FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles);
+	}
+
+	if (!bMotionControllerRig && FP_Gun->IsRegistered() && Mesh1P->IsRegistered())
+	{
+		// Attach gun mesh component to Skeleton, doing it here because the skeleton is not yet created in the constructor
+		FP_Gun->AttachToComponent(Mesh1P, FAttachmentTransformRules(EAttachmentRule::SnapToTarget, true), TEXT("GripPoint"));
+	}
+}
+
+void AFutureNinjaCharacter::UnregisterRig(bool bMotionControllerRig)
+{
+	TArray<USceneComponent*> Components;
+	GetRigComponents(bMotionControllerRig, Components);
+
+	// Children first, so no component is left attached to an unregistered parent
+	for (int32 Index = Components.Num() - 1; Index >= 0; --Index)
+	{
+		if (Components[Index] != nullptr && Components[Index]->IsRegistered())
+		{
+			Components[Index]->UnregisterComponent();
+		}
+	}
+}
+
+void AFutureNinjaCharacter::SetUsingMotionControllers(bool bEnable)
+{
+	if (bEnable == !!bUsingMotionControllers)
+	{
+		return;
+	}
+
+	bUsingMotionControllers = bEnable;
+	if (!IsActorInitialized())
+	{
+		// PostInitializeComponents registers the rig of whichever mode is set by then
+		return;
+	}
+
+	UnregisterRig(!bEnable);
+	RegisterRig(bEnable);
+
+	ControllerPoseTracker->SetComponentTickEnabled(bEnable);
+	ThrowGesture->SetComponentTickEnabled(bEnable);
+}
+
+void AFutureNinjaCharacter::ReportSpawnTime() const
+{
+	FString Components;
+	for (const FComponentSpawnTime& SpawnTime : RigSpawnTimes)
+	{
+		Components += FString::Printf(TEXT(" %s %.3fms"), *SpawnTime.Name.ToString(), SpawnTime.Ms);
+	}
+
+	// A character loaded with its level was constructed during the load, so only the rig is worth reporting
+	if (HasAnyFlags(RF_WasLoaded))
+	{
+		UE_LOG(LogCharacterSpawn, Log, TEXT("%s registered its %s rig:%s"), *GetName(), bUsingMotionControllers ? TEXT("VR") : TEXT("flat"), *Components);
+		return;
+	}
+
+	const uint32 NowCycles = FPlatformTime::Cycles();
+	const float TotalMs = FPlatformTime::ToMilliseconds(NowCycles - ConstructCycles);
+	SET_FLOAT_STAT(STAT_CharacterSpawnMs, TotalMs);
+
+	UE_LOG(LogCharacterSpawn, Log, TEXT("%s spawned in %.3fms: %.3fms construction and registration, %.3fms until BeginPlay finished; %s rig:%s"),
+		*GetName(), TotalMs, FPlatformTime::ToMilliseconds(RegisteredCycles - ConstructCycles), FPlatformTime::ToMilliseconds(NowCycles - RegisteredCycles),
+		bUsingMotionControllers ? TEXT("VR") : TEXT("flat"), *Components);
+}
+
+void AFutureNinjaCharacter::BeginPlay()
+{
+	// Call the base class  
+	Super::BeginPlay();
+
+	// Only worth polling the controller devices when we aim with them
+	ControllerPoseTracker->SetControllers(R_MotionController, L_MotionController);
+	ControllerPoseTracker->SetComponentTickEnabled(bUsingMotionControllers);
+	ThrowGesture->SetPoseTracker(ControllerPoseTracker);
+	ThrowGesture->SetComponentTickEnabled(bUsingMotionControllers);
+	ThrowGesture->OnThrow.AddDynamic(this, &AFutureNinjaCharacter::OnThrowGesture);
+
+	// Pre-spawn projectiles now so the first throws don't pay for actor construction
+	ProjectilePool = AFutureNinjaProjectilePool::Get(GetWorld());
+	if (ProjectilePool.IsValid() && ProjectileClass != NULL)
+	{
+		ProjectilePool->Prewarm(ProjectileClass, ProjectilePrewarmCount);
+	}
+
+	ReportSpawnTime();
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Input
 
@@ -112,80 +306,524 @@ void AFutureNinjaCharacter::SetupPlayerInputComponent(class UInputComponent* Pla
 	// set up gameplay key bindings
 	check(PlayerInputComponent);
 
-	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
-	PlayerInputComponent->BindAction("Jump", IE_Released, this, &ACharacter::StopJumping);
-
 	//InputComponent->BindTouch(EInputEvent::IE_Pressed, this, &AFutureNinjaCharacter::TouchStarted);
-	if (EnableTouchscreenMovement(PlayerInputComponent) == false)
+	const bool bTouchscreen = EnableTouchscreenMovement(PlayerInputComponent);
+	CharacterInput->BindInput(PlayerInputComponent, !bTouchscreen);
+	CharacterInput->OnInputPass.BindUObject(this, &AFutureNinjaCharacter::OnInputPass);
+
+	StartInputSession();
+}
+
+void AFutureNinjaCharacter::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (bHasAppliedFrame)
+	{
+		bHasAppliedFrame = false;
+		FinishInputFrame(DeltaSeconds);
+	}
+
+	// An AI controller is local too, but no one looks through it
+	if (bShowTrajectoryPreview && IsPlayerControlled() && IsLocallyControlled())
+	{
+		FVector LaunchLocation;
+		FRotator LaunchRotation;
+		FVector InheritedVelocity;
+		GetLaunch(LaunchLocation, LaunchRotation, InheritedVelocity);
+		TrajectoryPreview->UpdatePreview(ProjectileClass, LaunchLocation, LaunchRotation, InheritedVelocity);
+	}
+	else
+	{
+		TrajectoryPreview->HidePreview();
+	}
+
+	FFutureNinjaNetStats::Get(GetWorld()).MaybeReport(GetWorld());
+}
+
+void AFutureNinjaCharacter::OnInputPass(float DeltaSeconds)
+{
+	// Sessions start with the next engine frame, the first one whose delta a replay can pin
+	const bool bInSession = InputSessionMode != EInputSessionMode::None && GFrameCounter > InputSessionStartFrame;
+
+	// The controller just processed this frame's input, so the gathered frame is complete
+	FFutureNinjaInputFrame Frame;
+	CharacterInput->ConsumeFrame(Frame);
+
+	if (bInSession && InputSessionMode == EInputSessionMode::Replay)
+	{
+		if (ReplayFrame >= InputRecording.Frames.Num())
+		{
+			return;
+		}
+		AppliedFrame = InputRecording.Frames[ReplayFrame];
+	}
+	else
+	{
+		Frame.DeltaSeconds = DeltaSeconds;
+		AppliedFrame = Frame;
+	}
+	bHasAppliedFrame = true;
+
+	const float StepSeconds = FFutureNinjaFixedStep::GetStepSeconds();
+	InputStepSeconds = StepSeconds > 0.f ? InputFixedStep.Advance(DeltaSeconds, StepSeconds) * StepSeconds : DeltaSeconds;
+
+	UFutureNinjaCharacterInputComponent::ApplyFrame(this, AppliedFrame, EFutureNinjaMoveBasis::Actor, BaseTurnRate, BaseLookUpRate, InputStepSeconds);
+}
+
+void AFutureNinjaCharacter::FinishInputFrame(float DeltaSeconds)
+{
+	// After the controller turned the view, so the kunai leaves along this frame's aim
+	if (EnumHasAnyFlags(AppliedFrame.Actions, EFutureNinjaInputAction::Fire))
+	{
+		OnFire();
+	}
+
+	const bool bInSession = InputSessionMode != EInputSessionMode::None && GFrameCounter > InputSessionStartFrame;
+	if (!bInSession)
+	{
+		return;
+	}
+
+	if (InputSessionMode == EInputSessionMode::Replay)
+	{
+		if (FirstDivergentFrame == INDEX_NONE && (AppliedFrame.DeltaSeconds != DeltaSeconds || AppliedFrame.StateCrc != ComputeStateCrc()))
+		{
+			FirstDivergentFrame = ReplayFrame;
+			UE_LOG(LogFPChar, Warning, TEXT("Replay diverged from the recording at frame %d"), ReplayFrame);
+		}
+
+		++ReplayFrame;
+		if (ReplayFrame < InputRecording.Frames.Num())
+		{
+			// Pin the next frame's delta to the recorded one
+			FApp::SetFixedDeltaTime(InputRecording.Frames[ReplayFrame].DeltaSeconds);
+		}
+		else
+		{
+			FinishReplay();
+		}
+	}
+	else if (InputSessionMode == EInputSessionMode::Record)
+	{
+		AppliedFrame.StateCrc = ComputeStateCrc();
+		InputRecording.Frames.Add(AppliedFrame);
+	}
+}
+
+void AFutureNinjaCharacter::StartInputSession()
+{
+	if (InputSessionMode != EInputSessionMode::None)
+	{
+		return;
+	}
+
+	FString Name;
+	if (FParse::Value(FCommandLine::Get(), TEXT("ReplayInput="), Name))
+	{
+		InputRecordingPath = FFutureNinjaInputRecording::GetPath(Name);
+		if (!InputRecording.Load(InputRecordingPath) || InputRecording.Frames.Num() == 0)
+		{
+			UE_LOG(LogFPChar, Error, TEXT("No input to replay in %s"), *InputRecordingPath);
+			return;
+		}
+
+		// Start from the state the recording started from, and run every frame at its recorded delta
+		FFutureNinjaFixedStep::SetStepHz(InputRecording.FixedStepHz);
+		FMath::RandInit(InputRecording.RandomSeed);
+		FMath::SRandInit(InputRecording.RandomSeed);
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(InputRecording.Frames[0].DeltaSeconds);
+
+		InputSessionMode = EInputSessionMode::Replay;
+		InputSessionStartFrame = GFrameCounter;
+		ReplayFrame = 0;
+		FirstDivergentFrame = INDEX_NONE;
+		UE_LOG(LogFPChar, Log, TEXT("Replaying %d input frames from %s"), InputRecording.Frames.Num(), *InputRecordingPath);
+	}
+	else if (FParse::Value(FCommandLine::Get(), TEXT("RecordInput="), Name))
+	{
+		InputRecordingPath = FFutureNinjaInputRecording::GetPath(Name);
+		InputRecording.RandomSeed = (int32)FPlatformTime::Cycles();
+		InputRecording.FixedStepHz = FFutureNinjaFixedStep::GetStepHz();
+		InputRecording.Frames.Reset();
+		FMath::RandInit(InputRecording.RandomSeed);
+		FMath::SRandInit(InputRecording.RandomSeed);
+
+		InputSessionMode = EInputSessionMode::Record;
+		InputSessionStartFrame = GFrameCounter;
+		UE_LOG(LogFPChar, Log, TEXT("Recording input to %s"), *InputRecordingPath);
+	}
+}
+
+void AFutureNinjaCharacter::FinishReplay()
+{
+	FApp::SetUseFixedTimeStep(false);
+
+	const bool bIdentical = FirstDivergentFrame == INDEX_NONE;
+	if (bIdentical)
+	{
+		UE_LOG(LogFPChar, Display, TEXT("Replayed %d input frames bit-identically"), InputRecording.Frames.Num());
+	}
+	else
 	{
-		PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &AFutureNinjaCharacter::OnFire);
+		UE_LOG(LogFPChar, Error, TEXT("Replay of %d input frames diverged at frame %d"), InputRecording.Frames.Num(), FirstDivergentFrame);
 	}
 
-	PlayerInputComponent->BindAction("ResetVR", IE_Pressed, this, &AFutureNinjaCharacter::OnResetVR);
+	if (FApp::IsUnattended())
+	{
+		FPlatformMisc::RequestExitWithStatus(false, bIdentical ? 0 : 1);
+	}
+}
+
+uint32 AFutureNinjaCharacter::ComputeStateCrc() const
+{
+	struct FState
+	{
+		FVector Location;
+		FVector Velocity;
+		FRotator ControlRotation;
+	};
+
+	FState State;
+	FMemory::Memzero(State);
+	State.Location = GetActorLocation();
+	State.Velocity = GetVelocity();
+	State.ControlRotation = GetControlRotation();
+	uint32 Crc = FCrc::MemCrc32(&State, sizeof(State));
+
+	// Every enemy and kunai actor in play, in the world's actor order, which a faithful replay reproduces
+	struct FActorState
+	{
+		FVector Location;
+		FVector Velocity;
+	};
+
+	UWorld* const World = GetWorld();
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		const AActor* Actor = *It;
+		const bool bEnemy = Actor->IsA<APawn>() && !Actor->IsA<AFutureNinjaCharacter>() && !static_cast<const APawn*>(Actor)->IsPlayerControlled();
+		if (Actor->bHidden || !(bEnemy || Actor->IsA<AFutureNinjaProjectile>()))
+		{
+			continue;
+		}
+
+		FActorState ActorState;
+		FMemory::Memzero(ActorState);
+		ActorState.Location = Actor->GetActorLocation();
+		ActorState.Velocity = Actor->GetVelocity();
+		Crc = FCrc::MemCrc32(&ActorState, sizeof(ActorState), Crc);
+	}
 
-	PlayerInputComponent->BindAxis("MoveForward", this, &AFutureNinjaCharacter::MoveForward);
-	PlayerInputComponent->BindAxis("MoveRight", this, &AFutureNinjaCharacter::MoveRight);
+	// Batched kunai are not actors
+	for (TActorIterator<AFutureNinjaProjectileManager> It(World); It; ++It)
+	{
+		Crc = It->ComputeStateCrc(Crc);
+	}
 
-	// We have 2 versions of the rotation bindings to handle different kinds of devices differently
-	// "turn" handles devices that provide an absolute delta, such as a mouse.
-	// "turnrate" is for devices that we choose to treat as a rate of change, such as an analog joystick
-	PlayerInputComponent->BindAxis("Turn", this, &APawn::AddControllerYawInput);
-	PlayerInputComponent->BindAxis("TurnRate", this, &AFutureNinjaCharacter::TurnAtRate);
-	PlayerInputComponent->BindAxis("LookUp", this, &APawn::AddControllerPitchInput);
-	PlayerInputComponent->BindAxis("LookUpRate", this, &AFutureNinjaCharacter::LookUpAtRate);
+	return Crc;
+}
+
+void AFutureNinjaCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (InputSessionMode == EInputSessionMode::Record)
+	{
+		InputRecording.Save(InputRecordingPath);
+	}
+	else if (InputSessionMode == EInputSessionMode::Replay && ReplayFrame < InputRecording.Frames.Num())
+	{
+		UE_LOG(LogFPChar, Warning, TEXT("Replay stopped after %d of %d input frames"), ReplayFrame, InputRecording.Frames.Num());
+		FApp::SetUseFixedTimeStep(false);
+	}
+	InputSessionMode = EInputSessionMode::None;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFutureNinjaCharacter::Fire()
+{
+	OnFire();
 }
 
 void AFutureNinjaCharacter::OnFire()
 {
+	// With throws made by gesture, the button only labels pose traces being recorded for the detector
+	if (bUsingMotionControllers && bThrowByGesture)
+	{
+		ThrowGesture->MarkRelease(EControllerHand::Right);
+		return;
+	}
+
+	FUTURENINJA_SCOPE_STEP(EFutureNinjaStep::Fire, STAT_CharacterFire);
+
 	// try and fire a projectile
 	if (ProjectileClass != NULL)
 	{
 		UWorld* const World = GetWorld();
 		if (World != NULL)
 		{
-			if (bUsingMotionControllers)
-			{
-				const FRotator SpawnRotation = VR_MuzzleLocation->GetComponentRotation();
-				const FVector SpawnLocation = VR_MuzzleLocation->GetComponentLocation();
-				World->SpawnActor<AFutureNinjaProjectile>(ProjectileClass, SpawnLocation, SpawnRotation);
-			}
-			else
-			{
-				const FRotator SpawnRotation = GetControlRotation();
-				// MuzzleOffset is in camera space, so transform it to world space before offsetting from the character location to find the final muzzle position
-				const FVector SpawnLocation = ((FP_MuzzleLocation != nullptr) ? FP_MuzzleLocation->GetComponentLocation() : GetActorLocation()) + SpawnRotation.RotateVector(GunOffset);
-
-				//Set Spawn Collision Handling Override
-				FActorSpawnParameters ActorSpawnParams;
-				ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
-
-				// spawn the projectile at the muzzle
-				World->SpawnActor<AFutureNinjaProjectile>(ProjectileClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
-			}
+			FVector SpawnLocation;
+			FRotator SpawnRotation;
+			FVector InheritedVelocity;
+			GetLaunch(SpawnLocation, SpawnRotation, InheritedVelocity);
+
+			// launch the projectile from the muzzle
+			LaunchProjectile(SpawnLocation, SpawnRotation, bUsingMotionControllers ? ESpawnActorCollisionHandlingMethod::AlwaysSpawn : ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding, InheritedVelocity);
 		}
 	}
 
 	// try and play the sound if specified
 	if (FireSound != NULL)
 	{
-		UGameplayStatics::PlaySoundAtLocation(this, FireSound, GetActorLocation());
+		SCOPE_CYCLE_COUNTER(STAT_CharacterFireSound);
+		FireFeedback->PlaySound(FireSound, GetActorLocation());
 	}
 
 	// try and play a firing animation if specified
 	if (FireAnimation != NULL)
 	{
+		SCOPE_CYCLE_COUNTER(STAT_CharacterFireMontage);
+
 		// Get the animation object for the arms mesh
-		UAnimInstance* AnimInstance = Mesh1P->GetAnimInstance();
-		if (AnimInstance != NULL)
+		FireFeedback->PlayMontage(Mesh1P->GetAnimInstance(), FireAnimation);
+	}
+}
+
+void AFutureNinjaCharacter::GetLaunch(FVector& OutLocation, FRotator& OutRotation, FVector& OutInheritedVelocity) const
+{
+	// An unregistered muzzle keeps the transform it had when its rig was last in use
+	if (bUsingMotionControllers && VR_MuzzleLocation->IsRegistered())
+	{
+		FTransform MuzzleTransform = VR_MuzzleLocation->GetComponentTransform();
+		FVector HandVelocity = FVector::ZeroVector;
+
+		// The controller component was last updated a frame ago; re-derive the muzzle from where the hand is now
+		FTransform HandPose;
+		if (ControllerPoseTracker->GetPredictedPose(EControllerHand::Right, FPlatformTime::Seconds(), HandPose, HandVelocity))
 		{
-			AnimInstance->Montage_Play(FireAnimation, 1.f);
+			const FTransform MuzzleToController = MuzzleTransform.GetRelativeTransform(R_MotionController->GetComponentTransform());
+			MuzzleTransform = MuzzleToController * HandPose;
 		}
+
+		OutLocation = MuzzleTransform.GetLocation();
+		OutRotation = MuzzleTransform.Rotator();
+		OutInheritedVelocity = bInheritHandVelocity ? HandVelocity * HandVelocityScale : FVector::ZeroVector;
+	}
+	else
+	{
+		OutRotation = GetControlRotation();
+		// MuzzleOffset is in camera space, so transform it to world space before offsetting from the character location to find the final muzzle position
+		OutLocation = ((FP_MuzzleLocation != nullptr && FP_MuzzleLocation->IsRegistered()) ? FP_MuzzleLocation->GetComponentLocation() : GetActorLocation()) + OutRotation.RotateVector(GunOffset);
+		OutInheritedVelocity = FVector::ZeroVector;
+	}
+}
+
+void AFutureNinjaCharacter::OnThrowGesture(EControllerHand Hand, FVector Location, FVector Direction, float Speed)
+{
+	if (!bThrowByGesture || ProjectileClass == NULL)
+	{
+		return;
+	}
+
+	FUTURENINJA_SCOPE_STEP(EFutureNinjaStep::Fire, STAT_CharacterFire);
+
+	// The right hand holds the gun, so its kunai leaves from the muzzle; the empty left hand throws from the palm
+	FVector SpawnLocation = Location;
+	if (Hand == EControllerHand::Right)
+	{
+		FRotator MuzzleRotation;
+		FVector MuzzleVelocity;
+		GetLaunch(SpawnLocation, MuzzleRotation, MuzzleVelocity);
+	}
+
+	// The kunai flies along the gesture, carrying the hand's peak speed on top of its own if asked to
+	const FVector InheritedVelocity = bInheritHandVelocity ? Direction * Speed * HandVelocityScale : FVector::ZeroVector;
+	LaunchProjectile(SpawnLocation, Direction.Rotation(), ESpawnActorCollisionHandlingMethod::AlwaysSpawn, InheritedVelocity);
+
+	if (FireSound != NULL)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CharacterFireSound);
+		FireFeedback->PlaySound(FireSound, SpawnLocation);
 	}
 }
 
-void AFutureNinjaCharacter::OnResetVR()
+void AFutureNinjaCharacter::LaunchProjectile(const FVector& SpawnLocation, const FRotator& SpawnRotation, ESpawnActorCollisionHandlingMethod CollisionHandling, const FVector& InheritedVelocity)
 {
-	UHeadMountedDisplayFunctionLibrary::ResetOrientationAndPosition();
+	FFutureNinjaTelemetry::Record(EFutureNinjaTelemetryEvent::Throw, SpawnLocation);
+
+	if (GetNetMode() == NM_Standalone)
+	{
+		SpawnProjectile(SpawnLocation, SpawnRotation, CollisionHandling, InheritedVelocity);
+		return;
+	}
+
+	FFutureNinjaShot Shot;
+	Shot.Origin = SpawnLocation;
+	Shot.Direction = SpawnRotation.Vector();
+	Shot.InheritedVelocity = InheritedVelocity;
+	Shot.Timestamp = GetServerWorldTime();
+	Shot.ShotId = ++LastShotId;
+	Shot.bRejectIfBlocked = CollisionHandling != ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// Everyone flies the shot as received, so the shooter flies the rounded version too
+	const int32 ShotBits = Shot.Quantize();
+	FFutureNinjaNetStats::Get(GetWorld()).AddShotSent(ShotBits);
+
+	AFutureNinjaProjectile* Projectile = SpawnProjectile(Shot.Origin, Shot.Direction.Rotation(), CollisionHandling, Shot.InheritedVelocity);
+	if (HasAuthority())
+	{
+		LastServerShotTime = Shot.Timestamp;
+		LastServerShotArrivalTime = Shot.Timestamp;
+		MulticastShot(Shot);
+		return;
+	}
+
+	if (Projectile != nullptr)
+	{
+		Projectile->NetShotId = Shot.ShotId;
+	}
+
+	// Answers arrive in order, so anything this old was lost with its connection
+	const double Now = FPlatformTime::Seconds();
+	PredictedShots.RemoveAll([Now](const FPredictedShot& Predicted) { return Now - Predicted.SendTime > 5.0; });
+
+	FPredictedShot Predicted;
+	Predicted.ShotId = Shot.ShotId;
+	Predicted.Projectile = Projectile;
+	Predicted.SendTime = Now;
+	PredictedShots.Add(Predicted);
+
+	ServerFire(Shot);
+}
+
+AFutureNinjaProjectile* AFutureNinjaCharacter::SpawnProjectile(const FVector& SpawnLocation, const FRotator& SpawnRotation, ESpawnActorCollisionHandlingMethod CollisionHandling, const FVector& InheritedVelocity)
+{
+	FUTURENINJA_SCOPE_STEP(EFutureNinjaStep::Spawn, STAT_CharacterSpawnProjectile);
+
+	UWorld* const World = GetWorld();
+
+	if (bUseBatchedProjectiles)
+	{
+		if (!ProjectileManager.IsValid())
+		{
+			ProjectileManager = AFutureNinjaProjectileManager::Get(World);
+		}
+		ProjectileManager->Launch(ProjectileClass, SpawnLocation, SpawnRotation, CollisionHandling != ESpawnActorCollisionHandlingMethod::AlwaysSpawn, InheritedVelocity);
+		return nullptr;
+	}
+
+	if (!ProjectilePool.IsValid())
+	{
+		ProjectilePool = AFutureNinjaProjectilePool::Get(World);
+	}
+	return ProjectilePool->Acquire(ProjectileClass, SpawnLocation, SpawnRotation, CollisionHandling, InheritedVelocity);
+}
+
+AFutureNinjaProjectile* AFutureNinjaCharacter::SpawnShot(const FFutureNinjaShot& Shot)
+{
+	if (ProjectileClass == NULL)
+	{
+		return nullptr;
+	}
+
+	const ESpawnActorCollisionHandlingMethod CollisionHandling = Shot.bRejectIfBlocked
+		? ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding
+		: ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AFutureNinjaProjectile* Projectile = SpawnProjectile(Shot.Origin, Shot.Direction.Rotation(), CollisionHandling, Shot.InheritedVelocity);
+	if (Projectile != nullptr)
+	{
+		// Batched kunai are not caught up; they start at the origin a little late
+		Projectile->NetShotId = Shot.ShotId;
+		Projectile->FastForward(FMath::Clamp(GetServerWorldTime() - Shot.Timestamp, 0.f, MaxShotCatchUpSeconds));
+	}
+	return Projectile;
+}
+
+float AFutureNinjaCharacter::GetServerWorldTime() const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState != nullptr ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+}
+
+bool AFutureNinjaCharacter::ServerFire_Validate(const FFutureNinjaShot& Shot)
+{
+	return !Shot.Origin.ContainsNaN() && !Shot.Direction.ContainsNaN() && !Shot.InheritedVelocity.ContainsNaN();
+}
+
+void AFutureNinjaCharacter::ServerFire_Implementation(const FFutureNinjaShot& Shot)
+{
+	FFutureNinjaNetStats::Get(GetWorld()).AddShotReceived(FFutureNinjaShot(Shot).Quantize());
+
+	// The client aims; the server only checks that the shot is one this character could have fired.
+	// Shots are spaced by when the client fired them, as jitter bunches them up on arrival. Timestamps must
+	// be recent and arrivals keep a smaller gap of their own, so a burst of backdated shots is refused too.
+	const float Now = GetServerWorldTime();
+	bool bAccepted = ProjectileClass != NULL
+		&& FMath::Abs(Shot.Timestamp - Now) <= MaxShotCatchUpSeconds
+		&& Shot.Timestamp - LastServerShotTime >= MinShotInterval - ShotIntervalTolerance
+		&& Now - LastServerShotArrivalTime >= MinShotArrivalInterval
+		&& FVector::DistSquared(Shot.Origin, GetActorLocation()) <= FMath::Square(MaxShotOriginDistance);
+
+	if (bAccepted)
+	{
+		AFutureNinjaProjectile* Projectile = SpawnShot(Shot);
+		bAccepted = Projectile != nullptr || bUseBatchedProjectiles;
+	}
+
+	if (bAccepted)
+	{
+		LastServerShotTime = Shot.Timestamp;
+		LastServerShotArrivalTime = Now;
+		MulticastShot(Shot);
+	}
+	else
+	{
+		FFutureNinjaNetStats::Get(GetWorld()).AddShotRejected();
+	}
+	ClientConfirmShot(Shot.ShotId, bAccepted);
+}
+
+void AFutureNinjaCharacter::ClientConfirmShot_Implementation(uint16 ShotId, bool bAccepted)
+{
+	const int32 Index = PredictedShots.IndexOfByPredicate([ShotId](const FPredictedShot& Predicted) { return Predicted.ShotId == ShotId; });
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	const FPredictedShot Predicted = PredictedShots[Index];
+	PredictedShots.RemoveAt(Index, 1, false);
+	FFutureNinjaNetStats::Get(GetWorld()).AddRoundTrip(FPlatformTime::Seconds() - Predicted.SendTime);
+
+	// The pool may have recycled the kunai for a later shot already
+	AFutureNinjaProjectile* Projectile = Predicted.Projectile.Get();
+	if (!bAccepted)
+	{
+		FFutureNinjaNetStats::Get(GetWorld()).AddShotRejected();
+		if (Projectile != nullptr && Projectile->NetShotId == ShotId && !Projectile->bHidden)
+		{
+			Projectile->Release();
+		}
+	}
+}
+
+void AFutureNinjaCharacter::MulticastShot_Implementation(const FFutureNinjaShot& Shot)
+{
+	// The server already flies it and the shooter predicted it
+	if (HasAuthority() || IsLocallyControlled())
+	{
+		return;
+	}
+
+	FFutureNinjaNetStats::Get(GetWorld()).AddShotReceived(FFutureNinjaShot(Shot).Quantize());
+	SpawnShot(Shot);
+
+	if (FireSound != NULL)
+	{
+		FireFeedback->PlaySound(FireSound, Shot.Origin);
+	}
 }
 
 void AFutureNinjaCharacter::BeginTouch(const ETouchIndex::Type FingerIndex, const FVector Location)
@@ -208,7 +846,7 @@ void AFutureNinjaCharacter::EndTouch(const ETouchIndex::Type FingerIndex, const
 	}
 	if ((FingerIndex == TouchItem.FingerIndex) && (TouchItem.bMoved == false))
 	{
-		OnFire();
+		CharacterInput->AddAction(EFutureNinjaInputAction::Fire);
 	}
 	TouchItem.bIsPressed = false;
 }
@@ -251,36 +889,6 @@ void AFutureNinjaCharacter::EndTouch(const ETouchIndex::Type FingerIndex, const
 //	}
 //}
 
-void AFutureNinjaCharacter::MoveForward(float Value)
-{
-	if (Value != 0.0f)
-	{
-		// add movement in that direction
-		AddMovementInput(GetActorForwardVector(), Value);
-	}
-}
-
-void AFutureNinjaCharacter::MoveRight(float Value)
-{
-	if (Value != 0.0f)
-	{
-		// add movement in that direction
-		AddMovementInput(GetActorRightVector(), Value);
-	}
-}
-
-void AFutureNinjaCharacter::TurnAtRate(float Rate)
-{
-	// calculate delta for this frame from the rate information
-	AddControllerYawInput(Rate * BaseTurnRate * GetWorld()->GetDeltaSeconds());
-}
-
-void AFutureNinjaCharacter::LookUpAtRate(float Rate)
-{
-	// calculate delta for this frame from the rate information
-	AddControllerPitchInput(Rate * BaseLookUpRate * GetWorld()->GetDeltaSeconds());
-}
-
 bool AFutureNinjaCharacter::EnableTouchscreenMovement(class UInputComponent* PlayerInputComponent)
 {
 	bool bResult = false;
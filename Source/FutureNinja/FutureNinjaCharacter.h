@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "FutureNinjaFixedStep.h"
+#include "FutureNinjaInputRecording.h"
+#include "FutureNinjaNetShot.h"
 #include "FutureNinjaCharacter.generated.h"
 
 class UInputComponent;
@@ -45,11 +48,49 @@ class AFutureNinjaCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	class UMotionControllerComponent* L_MotionController;
 
+	/** Pose history of both motion controllers, used to launch VR throws from where the hand is now */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class UFutureNinjaControllerPoseTracker* ControllerPoseTracker;
+
+	/** Recognizes throw gestures in the motion controller poses */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class UFutureNinjaThrowGestureComponent* ThrowGesture;
+
+	/** Plays the fire sound and animation on pooled, rate-limited voices */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class UFutureNinjaFireFeedbackComponent* FireFeedback;
+
+	/** Gathers the frame's axis and action input and applies it in one pass */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class UFutureNinjaCharacterInputComponent* CharacterInput;
+
+	/** Shows where a kunai thrown now would fly */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class UFutureNinjaTrajectoryPreviewComponent* TrajectoryPreview;
+
 public:
 	AFutureNinjaCharacter();
 
+	/** Fires a projectile exactly as the "Fire" input action does. */
+	UFUNCTION(BlueprintCallable, Category=Gameplay)
+	void Fire();
+
+	/**
+	 * Switches between aiming with the motion controllers and with the camera, registering the rig of the
+	 * new mode the first time it is needed and unregistering the other one. Before the character finished
+	 * spawning, e.g. on a deferred spawn, only the mode is set and its rig is registered once spawned.
+	 */
+	UFUNCTION(BlueprintCallable, Category=Gameplay)
+	void SetUsingMotionControllers(bool bEnable);
+
 protected:
+	virtual void PostRegisterAllComponents() override;
+	virtual void PostInitializeComponents() override;
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void Tick(float DeltaSeconds) override;
 
 public:
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
@@ -76,35 +117,186 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay)
 	class UAnimMontage* FireAnimation;
 
-	/** Whether to use motion controller location for aiming. */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Gameplay)
+	/** Whether to use motion controller location for aiming. Only the rig of this mode is registered; change it with SetUsingMotionControllers. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Gameplay)
 	uint32 bUsingMotionControllers : 1;
 
+	/** Number of projectiles to pre-spawn into the projectile pool at BeginPlay (0 uses the pool's default). */
+	UPROPERTY(EditDefaultsOnly, Category=Projectile)
+	int32 ProjectilePrewarmCount;
+
+	/** Simulate thrown kunai in the batched projectile manager instead of as individual projectile actors. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Projectile)
+	uint32 bUseBatchedProjectiles : 1;
+
+	/** In VR, throw a kunai whenever a throw gesture is recognized; the "Fire" action then only labels recorded pose traces. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Projectile)
+	uint32 bThrowByGesture : 1;
+
+	/** In VR, add the throwing hand's velocity to the kunai's launch velocity. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Projectile)
+	uint32 bInheritHandVelocity : 1;
+
+	/** Fraction of the hand velocity the kunai inherits when bInheritHandVelocity is set. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Projectile)
+	float HandVelocityScale;
+
+	/** Show the flight of the next kunai while this character is controlled by a local player. */
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category=Projectile)
+	uint32 bShowTrajectoryPreview : 1;
+
+	/** The server refuses shots launched further than this from the character. */
+	UPROPERTY(Config, EditAnywhere, Category=Network)
+	float MaxShotOriginDistance;
+
+	/** The server refuses shots fired sooner than this after the previous one, by the client's timestamps. */
+	UPROPERTY(Config, EditAnywhere, Category=Network)
+	float MinShotInterval;
+
+	/** Slack on MinShotInterval for timestamp rounding and the client's server clock estimate being corrected. */
+	UPROPERTY(Config, EditAnywhere, Category=Network)
+	float ShotIntervalTolerance;
+
+	/** The server also refuses shots arriving sooner than this after the previous one; below MinShotInterval, as jitter bunches shots up. */
+	UPROPERTY(Config, EditAnywhere, Category=Network)
+	float MinShotArrivalInterval;
+
+	/** Longest a received shot is fast-forwarded to make up for latency; shots stamped further in the past or future are refused. */
+	UPROPERTY(Config, EditAnywhere, Category=Network)
+	float MaxShotCatchUpSeconds;
+
 protected:
+
+	/** Pool projectiles are taken from instead of being spawned per shot. */
+	TWeakObjectPtr<class AFutureNinjaProjectilePool> ProjectilePool;
+
+	/** Batched simulation kunai are handed to when bUseBatchedProjectiles is set. */
+	TWeakObjectPtr<class AFutureNinjaProjectileManager> ProjectileManager;
 	
 	/** Fires a projectile. */
 	void OnFire();
 
-	/** Resets HMD orientation and position in VR. */
-	void OnResetVR();
-
-	/** Handles moving forward/backward */
-	void MoveForward(float Val);
+	/** Where a kunai fired now leaves the gun, along which rotation, and the hand velocity it inherits. */
+	void GetLaunch(FVector& OutLocation, FRotator& OutRotation, FVector& OutInheritedVelocity) const;
 
-	/** Handles stafing movement, left and right */
-	void MoveRight(float Val);
+	/** Throws a kunai along a recognized throw gesture of Hand: from the muzzle for the gun hand, from the palm for the other. */
+	UFUNCTION()
+	void OnThrowGesture(EControllerHand Hand, FVector Location, FVector Direction, float Speed);
 
 	/**
-	 * Called via input to turn at a given rate.
-	 * @param Rate	This is a normalized rate, i.e. 1.0 means 100% of desired turn rate
+	 * Fires a ProjectileClass kunai. In networked games the shot goes through the server: a client flies a
+	 * predicted kunai right away and the server confirms or refuses it, while everyone else receives the shot.
 	 */
-	void TurnAtRate(float Rate);
+	void LaunchProjectile(const FVector& SpawnLocation, const FRotator& SpawnRotation, ESpawnActorCollisionHandlingMethod CollisionHandling, const FVector& InheritedVelocity = FVector::ZeroVector);
+
+	/** Puts a ProjectileClass kunai into flight on this machine, either as a pooled actor or in the batched projectile manager. */
+	class AFutureNinjaProjectile* SpawnProjectile(const FVector& SpawnLocation, const FRotator& SpawnRotation, ESpawnActorCollisionHandlingMethod CollisionHandling, const FVector& InheritedVelocity);
+
+	/** Flies a shot fired on another machine, caught up by the time since it was fired. */
+	class AFutureNinjaProjectile* SpawnShot(const FFutureNinjaShot& Shot);
+
+	/** Server world time, as estimated on clients. */
+	float GetServerWorldTime() const;
+
+	/** Asks the server to fire Shot, which this client already flies as a predicted kunai. */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFire(const FFutureNinjaShot& Shot);
+
+	/** Tells the shooting client whether the server fired its shot; refused shots lose their predicted kunai. */
+	UFUNCTION(Client, Reliable)
+	void ClientConfirmShot(uint16 ShotId, bool bAccepted);
+
+	/** Hands a fired shot to every machine other than the server and the shooter. */
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastShot(const FFutureNinjaShot& Shot);
+
+	/** A shot this client flies ahead of the server's answer */
+	struct FPredictedShot
+	{
+		uint16 ShotId;
+		TWeakObjectPtr<class AFutureNinjaProjectile> Projectile;
+		double SendTime;
+	};
+
+	TArray<FPredictedShot> PredictedShots;
+
+	/** Id of the last shot this character fired */
+	uint16 LastShotId;
+
+	/** Timestamp of the last shot the server accepted from this character */
+	float LastServerShotTime;
+	/** Server time the last accepted shot arrived at */
+	float LastServerShotArrivalTime;
+
+	/** Applies the movement and look of one frame of input, live or replayed, in the controller's input pass. */
+	void OnInputPass(float DeltaSeconds);
+
+	/** Fires, and records or checks the frame applied by the last input pass, once the view has turned. */
+	void FinishInputFrame(float DeltaSeconds);
+
+	/** Frame applied by the last input pass, and whether Tick still has to finish it */
+	FFutureNinjaInputFrame AppliedFrame;
+	bool bHasAppliedFrame;
+
+	/** Starts recording or replaying input if -RecordInput=Name or -ReplayInput=Name was given. */
+	void StartInputSession();
+
+	/** Ends replay, reporting whether it matched the recording, and exits unattended runs. */
+	void FinishReplay();
+
+	/** Hash of the state a replay must reproduce bit-identically: this character, the enemies and every kunai. */
+	uint32 ComputeStateCrc() const;
+
+	/** Seconds of rate-based turning applied this tick; the fixed steps taken when FutureNinja.FixedStepHz is set */
+	float InputStepSeconds;
+
+	/** Frame time not yet turned into rate-based input when FutureNinja.FixedStepHz is set */
+	FFutureNinjaFixedStep InputFixedStep;
+
+	enum class EInputSessionMode : uint8
+	{
+		None,
+		Record,
+		Replay
+	};
+
+	EInputSessionMode InputSessionMode;
+	FFutureNinjaInputRecording InputRecording;
+	FString InputRecordingPath;
+	/** GFrameCounter when the session started; its first frame is the one after */
+	uint64 InputSessionStartFrame;
+	int32 ReplayFrame;
+	int32 FirstDivergentFrame;
 
 	/**
-	 * Called via input to turn look up/down at a given rate.
-	 * @param Rate	This is a normalized rate, i.e. 1.0 means 100% of desired turn rate
+	 * Registers the components of one rig: the arms, gun and muzzle of the flat screen view, or the motion
+	 * controllers, gun and muzzle of VR. The constructor leaves both unregistered, so the rig of the other
+	 * mode never pays for its render state, anim instance or tick. Times each registration for the spawn report.
 	 */
-	void LookUpAtRate(float Rate);
+	void RegisterRig(bool bMotionControllerRig);
+
+	/** Unregisters the components of one rig. */
+	void UnregisterRig(bool bMotionControllerRig);
+
+	/** Components of one rig, parents first. */
+	void GetRigComponents(bool bMotionControllerRig, TArray<USceneComponent*>& OutComponents) const;
+
+	/** Logs how long this character took from construction to the end of BeginPlay, and each rig component's registration. */
+	void ReportSpawnTime() const;
+
+	/** Registration time of one rig component */
+	struct FComponentSpawnTime
+	{
+		FName Name;
+		float Ms;
+	};
+
+	TArray<FComponentSpawnTime> RigSpawnTimes;
+
+	/** Cycles when the constructor started; the spawn report measures from here */
+	uint32 ConstructCycles;
+	/** Cycles when every component, including the rig, had been registered */
+	uint32 RegisteredCycles;
 
 	struct TouchData
 	{
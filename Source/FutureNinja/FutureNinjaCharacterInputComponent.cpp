@@ -0,0 +1,389 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaCharacterInputComponent.h"
+#include "FutureNinja.h"
+#include "FutureNinjaPlayerController.h"
+#include "Components/InputComponent.h"
+#include "Engine/LocalPlayer.h"
+#include "Framework/Application/IInputProcessor.h"
+#include "Framework/Application/SlateApplication.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/InputSettings.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerInput.h"
+#include "HeadMountedDisplayFunctionLibrary.h"
+
+DECLARE_CYCLE_STAT(TEXT("Character Input Apply"), STAT_CharacterInputApply, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Character Input Analog Samples"), STAT_CharacterInputAnalogSamples, STATGROUP_FutureNinja);
+
+/** Mapping names of EFutureNinjaInputAxis, in order */
+static const FName InputAxisNames[] =
+{
+	TEXT("MoveForward"),
+	TEXT("MoveRight"),
+	TEXT("Turn"),
+	TEXT("TurnRate"),
+	TEXT("LookUp"),
+	TEXT("LookUpRate")
+};
+static_assert(ARRAY_COUNT(InputAxisNames) == (int32)EFutureNinjaInputAxis::Num, "Every input axis needs a mapping name");
+
+/**
+ * Integrates the analog stick samples of one local player over the frame. Runs as a Slate input
+ * preprocessor, so it sees samples on the game thread as they arrive, before the viewport turns them into
+ * key state; it never consumes them.
+ */
+class FFutureNinjaAnalogSampler : public IInputProcessor
+{
+public:
+	explicit FFutureNinjaAnalogSampler(int32 InControllerId)
+		: ControllerId(InControllerId), WindowStart(FPlatformTime::Seconds()), NumSamples(0)
+	{
+		// Every analog gamepad key mapped to one of the character's axes
+		const UInputSettings* InputSettings = GetDefault<UInputSettings>();
+		for (const FInputAxisKeyMapping& KeyMapping : InputSettings->AxisMappings)
+		{
+			const int32 AxisIndex = FindAxis(KeyMapping.AxisName);
+			if (AxisIndex == INDEX_NONE || !KeyMapping.Key.IsGamepadKey() || !KeyMapping.Key.IsFloatAxis())
+			{
+				continue;
+			}
+
+			int32 KeyIndex = Keys.IndexOfByPredicate([&KeyMapping](const FKeySample& Sample) { return Sample.Key == KeyMapping.Key; });
+			if (KeyIndex == INDEX_NONE)
+			{
+				FKeySample Sample;
+				Sample.Key = KeyMapping.Key;
+				Sample.bHasProperties = false;
+				for (const FInputAxisConfigEntry& ConfigEntry : InputSettings->AxisConfig)
+				{
+					if (ConfigEntry.AxisKeyName == KeyMapping.Key.GetFName())
+					{
+						Sample.Properties = ConfigEntry.AxisProperties;
+						Sample.bHasProperties = true;
+					}
+				}
+				Sample.Value = 0.f;
+				Sample.Average = 0.f;
+				Sample.Integral = 0.0;
+				Sample.LastTime = WindowStart;
+				KeyIndex = Keys.Add(Sample);
+			}
+
+			FAxisMapping AxisMapping;
+			AxisMapping.AxisIndex = AxisIndex;
+			AxisMapping.KeyIndex = KeyIndex;
+			AxisMapping.Scale = KeyMapping.Scale;
+			Mappings.Add(AxisMapping);
+		}
+	}
+
+	/** Replaces the last stick value in every axis of Frame with the stick's average over the frame. */
+	void CorrectFrame(FFutureNinjaInputFrame& Frame)
+	{
+		const double Now = FPlatformTime::Seconds();
+		const double Window = Now - WindowStart;
+
+		for (FKeySample& Sample : Keys)
+		{
+			Sample.Integral += Sample.Value * (Now - Sample.LastTime);
+			Sample.Average = Window > 0.0 ? (float)(Sample.Integral / Window) : Sample.Value;
+			Sample.Integral = 0.0;
+			Sample.LastTime = Now;
+		}
+
+		// A stick that did not move during the frame contributes nothing here
+		for (const FAxisMapping& Mapping : Mappings)
+		{
+			const FKeySample& Sample = Keys[Mapping.KeyIndex];
+			Frame.Axes[Mapping.AxisIndex] += Mapping.Scale * (Sample.Average - Sample.Value);
+		}
+
+		SET_DWORD_STAT(STAT_CharacterInputAnalogSamples, NumSamples);
+		NumSamples = 0;
+		WindowStart = Now;
+	}
+
+	// IInputProcessor interface
+	virtual void Tick(const float DeltaTime, FSlateApplication& SlateApp, TSharedRef<ICursor> Cursor) override
+	{
+	}
+
+	virtual bool HandleAnalogInputEvent(FSlateApplication& SlateApp, const FAnalogInputEvent& InAnalogInputEvent) override
+	{
+		if (InAnalogInputEvent.GetUserIndex() != (uint32)ControllerId)
+		{
+			return false;
+		}
+
+		const FKey Key = InAnalogInputEvent.GetKey();
+		for (FKeySample& Sample : Keys)
+		{
+			if (Sample.Key == Key)
+			{
+				const double Now = FPlatformTime::Seconds();
+				Sample.Integral += Sample.Value * (Now - Sample.LastTime);
+				Sample.LastTime = Now;
+				Sample.Value = Sample.bHasProperties ? MassageAxis(InAnalogInputEvent.GetAnalogValue(), Sample.Properties) : InAnalogInputEvent.GetAnalogValue();
+				++NumSamples;
+				break;
+			}
+		}
+		return false;
+	}
+	// End of IInputProcessor interface
+
+private:
+	struct FKeySample
+	{
+		FKey Key;
+		FInputAxisProperties Properties;
+		bool bHasProperties;
+		/** Latest sample, with dead zone and sensitivity applied as the engine does */
+		float Value;
+		/** Time weighted average over the last frame */
+		float Average;
+		double Integral;
+		double LastTime;
+	};
+
+	struct FAxisMapping
+	{
+		int32 AxisIndex;
+		int32 KeyIndex;
+		float Scale;
+	};
+
+	static int32 FindAxis(FName AxisName)
+	{
+		for (int32 Index = 0; Index < ARRAY_COUNT(InputAxisNames); ++Index)
+		{
+			if (InputAxisNames[Index] == AxisName)
+			{
+				return Index;
+			}
+		}
+		return INDEX_NONE;
+	}
+
+	/** Same shaping UPlayerInput applies to axis keys with configured properties. */
+	static float MassageAxis(float RawValue, const FInputAxisProperties& Properties)
+	{
+		float Value = RawValue;
+		if (Properties.DeadZone > 0.f)
+		{
+			Value = Value > 0.f
+				? FMath::Max(0.f, Value - Properties.DeadZone) / (1.f - Properties.DeadZone)
+				: -FMath::Max(0.f, -Value - Properties.DeadZone) / (1.f - Properties.DeadZone);
+		}
+		if (Properties.Exponent != 1.f)
+		{
+			Value = FMath::Sign(Value) * FMath::Pow(FMath::Abs(Value), Properties.Exponent);
+		}
+		Value *= Properties.Sensitivity;
+		return Properties.bInvert ? -Value : Value;
+	}
+
+	int32 ControllerId;
+	double WindowStart;
+	int32 NumSamples;
+	TArray<FKeySample> Keys;
+	TArray<FAxisMapping> Mappings;
+};
+
+UFutureNinjaCharacterInputComponent::UFutureNinjaCharacterInputComponent()
+{
+	// Only ticks when the controller does not run the input pass itself
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+
+	bIntegrateAnalogInput = false;
+
+	LastInputPassFrame = 0;
+}
+
+void UFutureNinjaCharacterInputComponent::BindInput(UInputComponent* InputComponent, bool bBindFire)
+{
+	check(InputComponent);
+
+	const APawn* Pawn = Cast<APawn>(GetOwner());
+	SetComponentTickEnabled(Pawn == nullptr || Cast<AFutureNinjaPlayerController>(Pawn->GetController()) == nullptr);
+
+	InputComponent->BindAction("Jump", IE_Pressed, this, &UFutureNinjaCharacterInputComponent::OnJumpPressed);
+	InputComponent->BindAction("Jump", IE_Released, this, &UFutureNinjaCharacterInputComponent::OnJumpReleased);
+	InputComponent->BindAction("ResetVR", IE_Pressed, this, &UFutureNinjaCharacterInputComponent::OnResetVR);
+	if (bBindFire)
+	{
+		InputComponent->BindAction("Fire", IE_Pressed, this, &UFutureNinjaCharacterInputComponent::OnFire);
+	}
+
+	InputComponent->BindAxis("MoveForward", this, &UFutureNinjaCharacterInputComponent::OnMoveForward);
+	InputComponent->BindAxis("MoveRight", this, &UFutureNinjaCharacterInputComponent::OnMoveRight);
+
+	// We have 2 versions of the rotation bindings to handle different kinds of devices differently
+	// "turn" handles devices that provide an absolute delta, such as a mouse.
+	// "turnrate" is for devices that we choose to treat as a rate of change, such as an analog joystick
+	InputComponent->BindAxis("Turn", this, &UFutureNinjaCharacterInputComponent::OnTurn);
+	InputComponent->BindAxis("TurnRate", this, &UFutureNinjaCharacterInputComponent::OnTurnRate);
+	InputComponent->BindAxis("LookUp", this, &UFutureNinjaCharacterInputComponent::OnLookUp);
+	InputComponent->BindAxis("LookUpRate", this, &UFutureNinjaCharacterInputComponent::OnLookUpRate);
+
+	StartAnalogSampling();
+}
+
+void UFutureNinjaCharacterInputComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopAnalogSampling();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UFutureNinjaCharacterInputComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	RunInputPass(DeltaTime);
+}
+
+void UFutureNinjaCharacterInputComponent::RunInputPass(float DeltaSeconds)
+{
+	if (HasRunInputPass())
+	{
+		return;
+	}
+
+	LastInputPassFrame = GFrameCounter;
+	OnInputPass.ExecuteIfBound(DeltaSeconds);
+}
+
+void UFutureNinjaCharacterInputComponent::StartAnalogSampling()
+{
+	StopAnalogSampling();
+
+	const APawn* Pawn = Cast<APawn>(GetOwner());
+	const APlayerController* PlayerController = Pawn != nullptr ? Cast<APlayerController>(Pawn->GetController()) : nullptr;
+	const ULocalPlayer* LocalPlayer = PlayerController != nullptr ? PlayerController->GetLocalPlayer() : nullptr;
+	if (!bIntegrateAnalogInput || LocalPlayer == nullptr || !FSlateApplication::IsInitialized())
+	{
+		return;
+	}
+
+	AnalogSampler = MakeShareable(new FFutureNinjaAnalogSampler(LocalPlayer->GetControllerId()));
+	FSlateApplication::Get().RegisterInputPreProcessor(AnalogSampler);
+}
+
+void UFutureNinjaCharacterInputComponent::StopAnalogSampling()
+{
+	if (AnalogSampler.IsValid() && FSlateApplication::IsInitialized())
+	{
+		FSlateApplication::Get().UnregisterInputPreProcessor(AnalogSampler);
+	}
+	AnalogSampler.Reset();
+}
+
+void UFutureNinjaCharacterInputComponent::AddAction(EFutureNinjaInputAction Action)
+{
+	PendingFrame.Actions |= Action;
+}
+
+void UFutureNinjaCharacterInputComponent::ConsumeFrame(FFutureNinjaInputFrame& OutFrame)
+{
+	OutFrame = PendingFrame;
+	if (AnalogSampler.IsValid())
+	{
+		AnalogSampler->CorrectFrame(OutFrame);
+	}
+	PendingFrame.Reset();
+}
+
+void UFutureNinjaCharacterInputComponent::ApplyFrame(ACharacter* Character, const FFutureNinjaInputFrame& Frame, EFutureNinjaMoveBasis MoveBasis, float TurnRate, float LookUpRate, float RateSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterInputApply);
+
+	if (EnumHasAnyFlags(Frame.Actions, EFutureNinjaInputAction::JumpPressed))
+	{
+		Character->Jump();
+	}
+	if (EnumHasAnyFlags(Frame.Actions, EFutureNinjaInputAction::JumpReleased))
+	{
+		Character->StopJumping();
+	}
+	if (EnumHasAnyFlags(Frame.Actions, EFutureNinjaInputAction::ResetVR))
+	{
+		UHeadMountedDisplayFunctionLibrary::ResetOrientationAndPosition();
+	}
+
+	// Both movement axes become one input along a basis looked up once
+	const float Forward = Frame.Axes[(int32)EFutureNinjaInputAxis::MoveForward];
+	const float Right = Frame.Axes[(int32)EFutureNinjaInputAxis::MoveRight];
+	if (Forward != 0.f || Right != 0.f)
+	{
+		if (MoveBasis == EFutureNinjaMoveBasis::Actor)
+		{
+			const FQuat Rotation = Character->GetActorQuat();
+			Character->AddMovementInput(Rotation.GetForwardVector() * Forward + Rotation.GetRightVector() * Right);
+		}
+		else if (Character->Controller != nullptr)
+		{
+			const FRotationMatrix YawMatrix(FRotator(0.f, Character->Controller->GetControlRotation().Yaw, 0.f));
+			Character->AddMovementInput(YawMatrix.GetUnitAxis(EAxis::X) * Forward + YawMatrix.GetUnitAxis(EAxis::Y) * Right);
+		}
+	}
+
+	// Absolute deltas and rates add up to one yaw and one pitch input
+	const float Yaw = Frame.Axes[(int32)EFutureNinjaInputAxis::Turn] + Frame.Axes[(int32)EFutureNinjaInputAxis::TurnRate] * TurnRate * RateSeconds;
+	const float Pitch = Frame.Axes[(int32)EFutureNinjaInputAxis::LookUp] + Frame.Axes[(int32)EFutureNinjaInputAxis::LookUpRate] * LookUpRate * RateSeconds;
+	Character->AddControllerYawInput(Yaw);
+	Character->AddControllerPitchInput(Pitch);
+}
+
+void UFutureNinjaCharacterInputComponent::OnMoveForward(float Value)
+{
+	PendingFrame.Axes[(int32)EFutureNinjaInputAxis::MoveForward] = Value;
+}
+
+void UFutureNinjaCharacterInputComponent::OnMoveRight(float Value)
+{
+	PendingFrame.Axes[(int32)EFutureNinjaInputAxis::MoveRight] = Value;
+}
+
+void UFutureNinjaCharacterInputComponent::OnTurn(float Value)
+{
+	PendingFrame.Axes[(int32)EFutureNinjaInputAxis::Turn] = Value;
+}
+
+void UFutureNinjaCharacterInputComponent::OnTurnRate(float Value)
+{
+	PendingFrame.Axes[(int32)EFutureNinjaInputAxis::TurnRate] = Value;
+}
+
+void UFutureNinjaCharacterInputComponent::OnLookUp(float Value)
+{
+	PendingFrame.Axes[(int32)EFutureNinjaInputAxis::LookUp] = Value;
+}
+
+void UFutureNinjaCharacterInputComponent::OnLookUpRate(float Value)
+{
+	PendingFrame.Axes[(int32)EFutureNinjaInputAxis::LookUpRate] = Value;
+}
+
+void UFutureNinjaCharacterInputComponent::OnJumpPressed()
+{
+	PendingFrame.Actions |= EFutureNinjaInputAction::JumpPressed;
+}
+
+void UFutureNinjaCharacterInputComponent::OnJumpReleased()
+{
+	PendingFrame.Actions |= EFutureNinjaInputAction::JumpReleased;
+}
+
+void UFutureNinjaCharacterInputComponent::OnFire()
+{
+	PendingFrame.Actions |= EFutureNinjaInputAction::Fire;
+}
+
+void UFutureNinjaCharacterInputComponent::OnResetVR()
+{
+	PendingFrame.Actions |= EFutureNinjaInputAction::ResetVR;
+}
@@ -0,0 +1,109 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "FutureNinjaInputRecording.h"
+#include "FutureNinjaCharacterInputComponent.generated.h"
+
+class ACharacter;
+class UInputComponent;
+
+/** Applies a character's gathered input frame; see UFutureNinjaCharacterInputComponent::OnInputPass. */
+DECLARE_DELEGATE_OneParam(FFutureNinjaInputPassDelegate, float /*DeltaSeconds*/);
+
+/** What the MoveForward and MoveRight axes move along. */
+enum class EFutureNinjaMoveBasis : uint8
+{
+	/** The character's own facing, for first person */
+	Actor,
+	/** The controller's yaw, for a third person camera that turns independently of the character */
+	ControlYaw
+};
+
+/**
+ * Gathers everything the player's axis and action mappings deliver in a frame into one FFutureNinjaInputFrame
+ * and applies it to the character in a single pass: one movement input, one yaw and one pitch input, and
+ * one look at the frame time. Shared by the first and third person characters.
+ *
+ * The bindings only store values. AFutureNinjaPlayerController runs the input pass right after it processed
+ * the input stack, before it turns the view and before the character and its movement tick, so look and
+ * movement take effect in the frame the input arrived in. The owner binds OnInputPass to consume the frame
+ * and decide what to do with it, which is also where a replay substitutes a recorded one. Under any other
+ * controller the component runs the pass from its own tick instead, a frame late.
+ *
+ * The engine hands axis bindings the mouse movement summed over the frame but only the last position of an
+ * analog stick, which is what is used by default. With bIntegrateAnalogInput, every stick sample Slate
+ * receives during the frame is weighted by how long it was held, and the stick's part of each axis becomes
+ * that average, so a flick between two frames still turns the view. The average trails the stick by about
+ * half a frame, so it is off by default.
+ */
+UCLASS(ClassGroup=(FutureNinja), config=Game, meta=(BlueprintSpawnableComponent))
+class UFutureNinjaCharacterInputComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaCharacterInputComponent();
+
+	/** Average analog stick axes over every sample of the frame instead of using the newest one. Adds look latency. */
+	UPROPERTY(Config, EditAnywhere, Category = Input)
+	uint32 bIntegrateAnalogInput : 1;
+
+	/** Binds the movement, look, Jump and ResetVR mappings, and Fire if bBindFire, to this component. */
+	void BindInput(UInputComponent* InputComponent, bool bBindFire);
+
+	/** Called once a frame with the frame's input complete; the owner consumes and applies the frame here. */
+	FFutureNinjaInputPassDelegate OnInputPass;
+
+	/** Runs OnInputPass for this frame, unless it already ran. Called by the player controller after input processing. */
+	void RunInputPass(float DeltaSeconds);
+
+	/** Whether the input pass already ran this frame. */
+	bool HasRunInputPass() const { return LastInputPassFrame == GFrameCounter; }
+
+	/** Adds Action to the frame being gathered, for input that does not come through a mapping. */
+	void AddAction(EFutureNinjaInputAction Action);
+
+	/** Hands out the frame gathered since the last call and starts the next one. */
+	void ConsumeFrame(FFutureNinjaInputFrame& OutFrame);
+
+	/**
+	 * Applies the jump, ResetVR, movement and look input of Frame to Character. Fire is left to the caller.
+	 * @param TurnRate		Yaw in deg/sec at a TurnRate axis of 1
+	 * @param LookUpRate	Pitch in deg/sec at a LookUpRate axis of 1
+	 * @param RateSeconds	Time the rate axes are applied for
+	 */
+	static void ApplyFrame(ACharacter* Character, const FFutureNinjaInputFrame& Frame, EFutureNinjaMoveBasis MoveBasis, float TurnRate, float LookUpRate, float RateSeconds);
+
+	// UActorComponent interface
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End of UActorComponent interface
+
+private:
+	void OnMoveForward(float Value);
+	void OnMoveRight(float Value);
+	void OnTurn(float Value);
+	void OnTurnRate(float Value);
+	void OnLookUp(float Value);
+	void OnLookUpRate(float Value);
+	void OnJumpPressed();
+	void OnJumpReleased();
+	void OnFire();
+	void OnResetVR();
+
+	/** Starts averaging stick samples for the local player that owns this component. */
+	void StartAnalogSampling();
+	void StopAnalogSampling();
+
+	/** Input received by the bindings since the last ConsumeFrame */
+	FFutureNinjaInputFrame PendingFrame;
+
+	/** GFrameCounter of the last input pass */
+	uint64 LastInputPassFrame;
+
+	/** Sees every analog sample before the viewport does, while bIntegrateAnalogInput is set */
+	TSharedPtr<class FFutureNinjaAnalogSampler> AnalogSampler;
+};
@@ -0,0 +1,110 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaControllerPoseTracker.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+#include "Features/IModularFeatures.h"
+#include "IMotionController.h"
+#include "MotionControllerComponent.h"
+#include "RenderingThread.h"
+
+UFutureNinjaControllerPoseTracker::UFutureNinjaControllerPoseTracker()
+	: RightHistory(MakeShareable(new FFutureNinjaPoseHistory()))
+	, LeftHistory(MakeShareable(new FFutureNinjaPoseHistory()))
+{
+	// Sample after movement, so a late launch pairs the newest pose with this frame's pawn transform
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+
+	MaxPredictionSeconds = 0.03f;
+	VelocityWindowSeconds = 0.05f;
+
+	RightController = nullptr;
+	LeftController = nullptr;
+}
+
+void UFutureNinjaControllerPoseTracker::SetControllers(UMotionControllerComponent* InRightController, UMotionControllerComponent* InLeftController)
+{
+	RightController = InRightController;
+	LeftController = InLeftController;
+}
+
+bool UFutureNinjaControllerPoseTracker::GetPredictedPose(EControllerHand Hand, double Time, FTransform& OutPose, FVector& OutVelocity) const
+{
+	const FFutureNinjaPoseHistory& History = GetHistory(Hand);
+
+	FFutureNinjaPoseSample Pose;
+	if (!History.GetPoseAtTime(Time, MaxPredictionSeconds, VelocityWindowSeconds, Pose))
+	{
+		return false;
+	}
+
+	// Hand motion is measured relative to the pawn; only the result is moved to where the pawn is now
+	const FTransform TrackingToWorld = GetTrackingToWorld(Hand);
+	OutPose = FTransform(Pose.Orientation, Pose.Position) * TrackingToWorld;
+	if (History.EstimateVelocity(VelocityWindowSeconds, OutVelocity))
+	{
+		OutVelocity = TrackingToWorld.TransformVector(OutVelocity);
+	}
+	else
+	{
+		OutVelocity = FVector::ZeroVector;
+	}
+	return true;
+}
+
+const FFutureNinjaPoseHistory& UFutureNinjaControllerPoseTracker::GetHistory(EControllerHand Hand) const
+{
+	return Hand == EControllerHand::Left ? *LeftHistory : *RightHistory;
+}
+
+FTransform UFutureNinjaControllerPoseTracker::GetTrackingToWorld(EControllerHand Hand) const
+{
+	const UMotionControllerComponent* Controller = Hand == EControllerHand::Left ? LeftController : RightController;
+	const USceneComponent* Parent = Controller != nullptr ? Controller->GetAttachParent() : nullptr;
+	return Parent != nullptr ? Parent->GetComponentTransform() : FTransform::Identity;
+}
+
+void UFutureNinjaControllerPoseTracker::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (RightController != nullptr)
+	{
+		QueueSample(RightController, RightHistory);
+	}
+	if (LeftController != nullptr)
+	{
+		QueueSample(LeftController, LeftHistory);
+	}
+}
+
+void UFutureNinjaControllerPoseTracker::QueueSample(const UMotionControllerComponent* Controller, const TSharedRef<FFutureNinjaPoseHistory, ESPMode::ThreadSafe>& History) const
+{
+	const int32 PlayerIndex = Controller->PlayerIndex;
+	const EControllerHand Hand = Controller->Hand;
+	const float WorldToMeters = GetWorld()->GetWorldSettings()->WorldToMeters;
+	TSharedRef<FFutureNinjaPoseHistory, ESPMode::ThreadSafe> HistoryRef = History;
+
+	// Poll on the render thread, as late as the motion controller late update does
+	ENQUEUE_RENDER_COMMAND(FutureNinjaSampleControllerPose)(
+		[HistoryRef, PlayerIndex, Hand, WorldToMeters](FRHICommandListImmediate& RHICmdList)
+		{
+			TArray<IMotionController*> MotionControllers = IModularFeatures::Get().GetModularFeatureImplementations<IMotionController>(IMotionController::GetModularFeatureName());
+			for (IMotionController* MotionController : MotionControllers)
+			{
+				FRotator Orientation;
+				FVector Position;
+				if (MotionController != nullptr && MotionController->GetControllerOrientationAndPosition(PlayerIndex, Hand, Orientation, Position, WorldToMeters))
+				{
+					// Kept in tracking space; moving the pawn is not moving the hand
+					FFutureNinjaPoseSample Sample;
+					Sample.Time = FPlatformTime::Seconds();
+					Sample.Position = Position;
+					Sample.Orientation = Orientation.Quaternion();
+					HistoryRef->Push(Sample);
+					break;
+				}
+			}
+		});
+}
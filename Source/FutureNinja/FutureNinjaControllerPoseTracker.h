@@ -0,0 +1,72 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "InputCoreTypes.h"
+#include "FutureNinjaPoseHistory.h"
+#include "FutureNinjaControllerPoseTracker.generated.h"
+
+class UMotionControllerComponent;
+
+/**
+ * Records a pose history for the two motion controllers of a pawn.
+ *
+ * Every frame the tracker queues a render command that polls the controller devices, the same way the
+ * motion controller late update does. The result is pushed into a lock-free FFutureNinjaPoseHistory. The
+ * render thread is the only writer, and game thread code can query the pose for any recent timestamp.
+ *
+ * The history holds tracking-space poses, relative to the pawn, so walking or turning the pawn does not
+ * show up as hand motion. GetTrackingToWorld() converts them once a world-space result is needed.
+ */
+UCLASS(ClassGroup=(FutureNinja), config=Game, meta=(BlueprintSpawnableComponent))
+class UFutureNinjaControllerPoseTracker : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaControllerPoseTracker();
+
+	/** Sets the controller components whose devices are sampled. */
+	void SetControllers(UMotionControllerComponent* InRightController, UMotionControllerComponent* InLeftController);
+
+	/**
+	 * Returns the world-space pose of Hand at Time, extrapolated up to MaxPredictionSeconds past the newest sample.
+	 * @param OutVelocity	Linear hand velocity relative to the pawn, fitted over the last VelocityWindowSeconds and rotated to world space
+	 * @returns false if there is no history for Hand yet
+	 */
+	bool GetPredictedPose(EControllerHand Hand, double Time, FTransform& OutPose, FVector& OutVelocity) const;
+
+	/** Returns the raw, tracking-space history of Hand. */
+	const FFutureNinjaPoseHistory& GetHistory(EControllerHand Hand) const;
+
+	/** Returns the current transform from the tracking space of Hand's history to world space. */
+	FTransform GetTrackingToWorld(EControllerHand Hand) const;
+
+	/** Furthest a queried pose is extrapolated past the newest sample. */
+	UPROPERTY(Config, EditAnywhere, Category = Tracking)
+	float MaxPredictionSeconds;
+
+	/** Window over which the hand velocity is fitted. */
+	UPROPERTY(Config, EditAnywhere, Category = Tracking)
+	float VelocityWindowSeconds;
+
+	// UActorComponent interface
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End of UActorComponent interface
+
+private:
+	/** Queues a render thread poll of Controller's device into History. */
+	void QueueSample(const UMotionControllerComponent* Controller, const TSharedRef<FFutureNinjaPoseHistory, ESPMode::ThreadSafe>& History) const;
+
+	UPROPERTY(Transient)
+	UMotionControllerComponent* RightController;
+
+	UPROPERTY(Transient)
+	UMotionControllerComponent* LeftController;
+
+	/** Shared with in-flight render commands so they stay valid if the component goes away first */
+	TSharedRef<FFutureNinjaPoseHistory, ESPMode::ThreadSafe> RightHistory;
+	TSharedRef<FFutureNinjaPoseHistory, ESPMode::ThreadSafe> LeftHistory;
+};
@@ -0,0 +1,163 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaFireFeedbackComponent.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+#include "Components/AudioComponent.h"
+#include "GameFramework/Actor.h"
+#include "Sound/SoundBase.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogFireFeedback, Log, All);
+
+UFutureNinjaFireFeedbackComponent::UFutureNinjaFireFeedbackComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	AudioPoolSize = 4;
+	MaxVoicesPerSound = 2;
+
+	LastSoundFrame = 0;
+	LastMontageFrame = 0;
+}
+
+void UFutureNinjaFireFeedbackComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Created once; every later shot only moves and restarts one of these
+	AudioPool.Reset(AudioPoolSize);
+	VoiceStartTimes.Init(0.0, AudioPoolSize);
+	for (int32 Index = 0; Index < AudioPoolSize; ++Index)
+	{
+		UAudioComponent* AudioComponent = NewObject<UAudioComponent>(GetOwner());
+		AudioComponent->bAutoActivate = false;
+		AudioComponent->bAutoDestroy = false;
+		AudioComponent->bAllowSpatialization = true;
+		AudioComponent->RegisterComponent();
+		AudioPool.Add(AudioComponent);
+	}
+}
+
+void UFutureNinjaFireFeedbackComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UE_LOG(LogFireFeedback, Log, TEXT("Fire feedback: %d sounds played, %d coalesced, %d voices stolen, %d montages skipped"),
+		Stats.SoundsPlayed, Stats.SoundsCoalesced, Stats.VoicesStolen, Stats.MontagesSkipped);
+
+	for (UAudioComponent* AudioComponent : AudioPool)
+	{
+		if (AudioComponent != nullptr)
+		{
+			AudioComponent->DestroyComponent();
+		}
+	}
+	AudioPool.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UFutureNinjaFireFeedbackComponent::PlaySound(USoundBase* Sound, const FVector& Location)
+{
+	if (Sound == nullptr || AudioPool.Num() == 0)
+	{
+		return;
+	}
+
+	// Two throws in one frame sound the same as one
+	if (LastSound.Get() == Sound && LastSoundFrame == GFrameCounter)
+	{
+		++Stats.SoundsCoalesced;
+		return;
+	}
+	LastSound = Sound;
+	LastSoundFrame = GFrameCounter;
+
+	UAudioComponent* AudioComponent = PickVoice(Sound);
+	if (AudioComponent == nullptr)
+	{
+		return;
+	}
+
+	AudioComponent->SetWorldLocation(Location);
+	if (AudioComponent->Sound != Sound)
+	{
+		AudioComponent->SetSound(Sound);
+	}
+	AudioComponent->Play();
+	++Stats.SoundsPlayed;
+}
+
+UAudioComponent* UFutureNinjaFireFeedbackComponent::PickVoice(USoundBase* Sound)
+{
+	int32 FreeIndex = INDEX_NONE;
+	int32 OldestIndex = INDEX_NONE;
+	int32 OldestSameSoundIndex = INDEX_NONE;
+	int32 SameSoundVoices = 0;
+
+	for (int32 Index = 0; Index < AudioPool.Num(); ++Index)
+	{
+		UAudioComponent* AudioComponent = AudioPool[Index];
+		if (AudioComponent == nullptr)
+		{
+			continue;
+		}
+
+		if (!AudioComponent->IsPlaying())
+		{
+			FreeIndex = FreeIndex == INDEX_NONE ? Index : FreeIndex;
+			continue;
+		}
+
+		if (OldestIndex == INDEX_NONE || VoiceStartTimes[Index] < VoiceStartTimes[OldestIndex])
+		{
+			OldestIndex = Index;
+		}
+		if (AudioComponent->Sound == Sound)
+		{
+			++SameSoundVoices;
+			if (OldestSameSoundIndex == INDEX_NONE || VoiceStartTimes[Index] < VoiceStartTimes[OldestSameSoundIndex])
+			{
+				OldestSameSoundIndex = Index;
+			}
+		}
+	}
+
+	int32 PickedIndex = FreeIndex;
+	if (SameSoundVoices >= MaxVoicesPerSound)
+	{
+		PickedIndex = OldestSameSoundIndex;
+		++Stats.VoicesStolen;
+	}
+	else if (PickedIndex == INDEX_NONE)
+	{
+		PickedIndex = OldestIndex;
+		++Stats.VoicesStolen;
+	}
+
+	if (PickedIndex == INDEX_NONE)
+	{
+		return nullptr;
+	}
+
+	VoiceStartTimes[PickedIndex] = GetWorld()->GetTimeSeconds();
+	return AudioPool[PickedIndex];
+}
+
+void UFutureNinjaFireFeedbackComponent::PlayMontage(UAnimInstance* AnimInstance, UAnimMontage* Montage, float PlayRate)
+{
+	if (AnimInstance == nullptr || Montage == nullptr)
+	{
+		return;
+	}
+
+	// Restarting a montage that is mid-blend costs a new montage instance and looks like a stutter
+	const bool bStartedThisFrame = LastMontage.Get() == Montage && LastMontageFrame == GFrameCounter;
+	if (bStartedThisFrame || AnimInstance->Montage_IsPlaying(Montage))
+	{
+		++Stats.MontagesSkipped;
+		return;
+	}
+
+	LastMontage = Montage;
+	LastMontageFrame = GFrameCounter;
+	AnimInstance->Montage_Play(Montage, PlayRate);
+}
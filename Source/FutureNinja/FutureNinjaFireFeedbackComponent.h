@@ -0,0 +1,100 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "FutureNinjaFireFeedbackComponent.generated.h"
+
+class UAnimInstance;
+class UAnimMontage;
+class UAudioComponent;
+class USoundBase;
+
+/** Running counters of the fire feedback scheduler. */
+USTRUCT(BlueprintType)
+struct FFireFeedbackStats
+{
+	GENERATED_BODY()
+
+	/** Sounds started on a pooled audio component. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Feedback)
+	int32 SoundsPlayed;
+
+	/** Sound requests dropped because the same sound was already started this frame. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Feedback)
+	int32 SoundsCoalesced;
+
+	/** Sounds that cut off an older voice because of the voice limit or a full pool. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Feedback)
+	int32 VoicesStolen;
+
+	/** Montage requests skipped because the montage was already playing or already started this frame. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Feedback)
+	int32 MontagesSkipped;
+
+	FFireFeedbackStats()
+		: SoundsPlayed(0), SoundsCoalesced(0), VoicesStolen(0), MontagesSkipped(0)
+	{}
+};
+
+/**
+ * Plays the sound and animation that go with a throw without letting their cost grow with the rate of fire.
+ *
+ * Sounds play on a fixed pool of audio components created at BeginPlay instead of a new one-shot component
+ * per shot. Repeated requests for the same sound within a frame are merged, and each sound has a voice limit
+ * past which its oldest voice is restarted. Montages are not restarted while they are still playing.
+ */
+UCLASS(ClassGroup=(FutureNinja), config=Game, meta=(BlueprintSpawnableComponent))
+class UFutureNinjaFireFeedbackComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaFireFeedbackComponent();
+
+	/** Plays Sound at Location on a pooled audio component, subject to coalescing and the voice limit. */
+	UFUNCTION(BlueprintCallable, Category = Feedback)
+	void PlaySound(USoundBase* Sound, const FVector& Location);
+
+	/** Plays Montage on AnimInstance unless it is already playing. */
+	UFUNCTION(BlueprintCallable, Category = Feedback)
+	void PlayMontage(UAnimInstance* AnimInstance, UAnimMontage* Montage, float PlayRate = 1.f);
+
+	/** Returns the scheduler counters. */
+	const FFireFeedbackStats& GetStats() const { return Stats; }
+
+	/** Audio components created for fire sounds. */
+	UPROPERTY(Config, EditAnywhere, Category = Feedback, meta = (ClampMin = "1"))
+	int32 AudioPoolSize;
+
+	/** Most voices of the same sound playing at once. */
+	UPROPERTY(Config, EditAnywhere, Category = Feedback, meta = (ClampMin = "1"))
+	int32 MaxVoicesPerSound;
+
+	// UActorComponent interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// End of UActorComponent interface
+
+private:
+	/** Returns the pooled component to start Sound on, stealing a voice if needed. */
+	UAudioComponent* PickVoice(USoundBase* Sound);
+
+	UPROPERTY(Transient)
+	TArray<UAudioComponent*> AudioPool;
+
+	/** Time each pooled component was last started, parallel to AudioPool */
+	TArray<double> VoiceStartTimes;
+
+	/** Last sound started and the frame it started on, for same-frame coalescing */
+	TWeakObjectPtr<USoundBase> LastSound;
+	uint64 LastSoundFrame;
+
+	/** Last montage started and the frame it started on */
+	TWeakObjectPtr<UAnimMontage> LastMontage;
+	uint64 LastMontageFrame;
+
+	UPROPERTY(Transient)
+	FFireFeedbackStats Stats;
+};
@@ -0,0 +1,44 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaFixedStep.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarFixedStepHz(
+	TEXT("FutureNinja.FixedStepHz"),
+	0.f,
+	TEXT("Rate at which kunai flight and rate-based character input are simulated, independent of the frame rate. 0 simulates on the frame delta."));
+
+float FFutureNinjaFixedStep::GetStepSeconds()
+{
+	const float StepHz = CVarFixedStepHz.GetValueOnGameThread();
+	return StepHz > 0.f ? 1.f / StepHz : 0.f;
+}
+
+void FFutureNinjaFixedStep::SetStepHz(float StepHz)
+{
+	CVarFixedStepHz->Set(StepHz, ECVF_SetByCode);
+}
+
+float FFutureNinjaFixedStep::GetStepHz()
+{
+	return CVarFixedStepHz.GetValueOnGameThread();
+}
+
+int32 FFutureNinjaFixedStep::Advance(float DeltaSeconds, float StepSeconds)
+{
+	if (StepSeconds <= 0.f)
+	{
+		Accumulator = 0.0;
+		return 1;
+	}
+
+	Accumulator += DeltaSeconds;
+	int32 NumSteps = FMath::FloorToInt(Accumulator / StepSeconds);
+	if (NumSteps > MaxStepsPerFrame)
+	{
+		NumSteps = MaxStepsPerFrame;
+		Accumulator = StepSeconds * MaxStepsPerFrame;
+	}
+	Accumulator -= NumSteps * (double)StepSeconds;
+	return NumSteps;
+}
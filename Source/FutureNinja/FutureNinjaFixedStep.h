@@ -0,0 +1,36 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Accumulates frame time and hands it out as whole steps of a fixed length, so simulation that runs
+ * through it advances identically at 72, 90 or 120 Hz.
+ *
+ * The step length comes from FutureNinja.FixedStepHz, shared by everything that steps through this;
+ * at 0 fixed stepping is off and callers simulate on the frame delta as before. Time left over after
+ * the last whole step is carried into the next frame.
+ */
+struct FFutureNinjaFixedStep
+{
+	/** Most steps taken in one frame; time beyond that is dropped rather than spiralling into longer frames */
+	static const int32 MaxStepsPerFrame = 8;
+
+	/** Seconds of frame time not yet simulated */
+	double Accumulator;
+
+	FFutureNinjaFixedStep()
+		: Accumulator(0.0)
+	{}
+
+	/** Length of one step, or 0 if fixed stepping is off. */
+	static float GetStepSeconds();
+
+	/** Sets FutureNinja.FixedStepHz, e.g. from a replay recorded with a different setting. */
+	static void SetStepHz(float StepHz);
+	static float GetStepHz();
+
+	/** Adds DeltaSeconds and returns the number of StepSeconds steps to simulate now; 1 step of DeltaSeconds if StepSeconds is 0. */
+	int32 Advance(float DeltaSeconds, float StepSeconds);
+};
@@ -0,0 +1,446 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaFlowField.h"
+#include "FutureNinja.h"
+#include "AI/Navigation/NavigationSystem.h"
+#include "AI/Navigation/NavMeshBoundsVolume.h"
+#include "Async/Async.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "Kismet/GameplayStatics.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogFlowField, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Flow Field Integrate"), STAT_FlowFieldIntegrate, STATGROUP_FutureNinja);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Flow Field Build Ms"), STAT_FlowFieldBuildMs, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Flow Field Walkable Cells"), STAT_FlowFieldWalkableCells, STATGROUP_FutureNinja);
+
+/** Neighbour offsets, counter-clockwise from +X; odd directions are diagonal and opposite ones are 4 apart */
+static const int32 DirectionX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const int32 DirectionY[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const float DiagonalCost = 1.41421356f;
+
+/** Marks cells whose center is off the nav mesh */
+static const float NotWalkable = MAX_flt;
+
+AFutureNinjaFlowField::AFutureNinjaFlowField()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	CellSize = 100.f;
+	MaxCells = 65536;
+	MaxStepHeight = 50.f;
+	bTraceEdges = true;
+	RecomputeDistance = 200.f;
+
+	GridOrigin = FVector::ZeroVector;
+	GridSize = FIntPoint::ZeroValue;
+	GridCellSize = CellSize;
+	Goal = FVector::ZeroVector;
+	BuildingGoal = FVector::ZeroVector;
+	BuildStartSeconds = 0.0;
+}
+
+AFutureNinjaFlowField* AFutureNinjaFlowField::Get(UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AFutureNinjaFlowField> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<AFutureNinjaFlowField>(SpawnParams);
+}
+
+void AFutureNinjaFlowField::BeginPlay()
+{
+	Super::BeginPlay();
+
+	BuildGrid();
+}
+
+void AFutureNinjaFlowField::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The worker reads the grid through this actor
+	FinishBuild();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFutureNinjaFlowField::BuildGrid()
+{
+	FinishBuild();
+
+	Current.Reset();
+	CellHeights.Reset();
+	CellLinks.Reset();
+	WalkableCells.Reset();
+	GridSize = FIntPoint::ZeroValue;
+
+	UNavigationSystem* NavSys = UNavigationSystem::GetCurrent<UNavigationSystem>(GetWorld());
+	FBox Bounds(ForceInit);
+	for (TActorIterator<ANavMeshBoundsVolume> It(GetWorld()); It; ++It)
+	{
+		Bounds += It->GetComponentsBoundingBox();
+	}
+
+	if (NavSys == nullptr || !Bounds.IsValid)
+	{
+		UE_LOG(LogFlowField, Warning, TEXT("No navigation in %s; enemies cannot follow the flow field"), *GetWorld()->GetMapName());
+		SET_DWORD_STAT(STAT_FlowFieldWalkableCells, 0);
+		return;
+	}
+
+	const double StartSeconds = FPlatformTime::Seconds();
+	const FVector Size = Bounds.GetSize();
+
+	// Coarser cells for levels that would not fit in MaxCells
+	GridCellSize = FMath::Max(CellSize, FMath::Sqrt(Size.X * Size.Y / FMath::Max(MaxCells, 1)));
+	GridSize = FIntPoint(FMath::Max(FMath::CeilToInt(Size.X / GridCellSize), 1), FMath::Max(FMath::CeilToInt(Size.Y / GridCellSize), 1));
+	while (GridSize.X * GridSize.Y > MaxCells && GridSize.X * GridSize.Y > 1)
+	{
+		GridCellSize *= 1.05f;
+		GridSize = FIntPoint(FMath::Max(FMath::CeilToInt(Size.X / GridCellSize), 1), FMath::Max(FMath::CeilToInt(Size.Y / GridCellSize), 1));
+	}
+	GridOrigin = Bounds.Min;
+
+	const int32 NumCells = GridSize.X * GridSize.Y;
+	CellHeights.Init(NotWalkable, NumCells);
+	CellLinks.Init(0, NumCells);
+
+	const FVector ProjectExtent(GridCellSize * 0.5f, GridCellSize * 0.5f, Size.Z * 0.5f);
+	FNavLocation NavLocation;
+	for (int32 Cell = 0; Cell < NumCells; ++Cell)
+	{
+		const FVector Center(GridOrigin.X + (Cell % GridSize.X + 0.5f) * GridCellSize, GridOrigin.Y + (Cell / GridSize.X + 0.5f) * GridCellSize, Bounds.GetCenter().Z);
+		if (NavSys->ProjectPointToNavigation(Center, NavLocation, ProjectExtent))
+		{
+			CellHeights[Cell] = NavLocation.Location.Z;
+			WalkableCells.Add(Cell);
+		}
+	}
+
+	// Half of the directions are enough, the links are set from both ends
+	FVector HitLocation;
+	for (const int32 Cell : WalkableCells)
+	{
+		const FVector From = GetCellLocation(Cell);
+		for (int32 Direction = 0; Direction < 4; ++Direction)
+		{
+			const int32 Neighbour = GetNeighbour(Cell, Direction);
+			if (Neighbour == INDEX_NONE || CellHeights[Neighbour] == NotWalkable || FMath::Abs(CellHeights[Neighbour] - CellHeights[Cell]) > MaxStepHeight)
+			{
+				continue;
+			}
+
+			if (bTraceEdges && UNavigationSystem::NavigationRaycast(this, From, GetCellLocation(Neighbour), HitLocation))
+			{
+				continue;
+			}
+
+			CellLinks[Cell] |= 1 << Direction;
+			CellLinks[Neighbour] |= 1 << (Direction + 4);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_FlowFieldWalkableCells, WalkableCells.Num());
+	UE_LOG(LogFlowField, Log, TEXT("Flow field grid of %dx%d cells of %.0f, %d walkable, built in %.1fms"),
+		GridSize.X, GridSize.Y, GridCellSize, WalkableCells.Num(), (FPlatformTime::Seconds() - StartSeconds) * 1000.0);
+}
+
+void AFutureNinjaFlowField::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (PendingBuild.IsValid() && PendingBuild.IsReady())
+	{
+		FinishBuild();
+	}
+
+	// One flood at a time; a move made meanwhile is picked up once it is swapped in
+	const APawn* Player = UGameplayStatics::GetPlayerPawn(this, 0);
+	if (WalkableCells.Num() == 0 || Player == nullptr || PendingBuild.IsValid())
+	{
+		return;
+	}
+
+	const FVector PlayerLocation = Player->GetActorLocation();
+	if (Current.IsValid() && FVector::DistSquared2D(PlayerLocation, Goal) <= FMath::Square(RecomputeDistance))
+	{
+		return;
+	}
+
+	StartBuild(PlayerLocation);
+}
+
+void AFutureNinjaFlowField::StartBuild(const FVector& GoalLocation)
+{
+	FVector SnappedGoal;
+	const int32 GoalCell = FindGoalCell(GoalLocation, SnappedGoal);
+	if (GoalCell == INDEX_NONE)
+	{
+		// Off the nav mesh, e.g. mid jump; the current field stands until the player lands
+		return;
+	}
+
+	Building = MakeShareable(new FFlowFieldBuffer());
+	Building->GoalCell = GoalCell;
+	BuildingGoal = SnappedGoal;
+	BuildStartSeconds = FPlatformTime::Seconds();
+
+	// The grid is not touched until FinishBuild has waited for this
+	TSharedPtr<FFlowFieldBuffer, ESPMode::ThreadSafe> Buffer = Building;
+	const AFutureNinjaFlowField* Field = this;
+	PendingBuild = Async<void>(EAsyncExecution::TaskGraph, [Field, Buffer]()
+	{
+		Field->Integrate(*Buffer);
+	});
+}
+
+void AFutureNinjaFlowField::FinishBuild()
+{
+	if (!PendingBuild.IsValid())
+	{
+		return;
+	}
+
+	PendingBuild.Wait();
+	PendingBuild = TFuture<void>();
+
+	Current = Building;
+	Building.Reset();
+	Goal = BuildingGoal;
+
+	SET_FLOAT_STAT(STAT_FlowFieldBuildMs, (FPlatformTime::Seconds() - BuildStartSeconds) * 1000.0);
+}
+
+bool AFutureNinjaFlowField::BuildFieldNow(const FVector& GoalLocation)
+{
+	FinishBuild();
+
+	FVector SnappedGoal;
+	const int32 GoalCell = FindGoalCell(GoalLocation, SnappedGoal);
+	if (GoalCell == INDEX_NONE)
+	{
+		return false;
+	}
+
+	TSharedPtr<FFlowFieldBuffer, ESPMode::ThreadSafe> Buffer = MakeShareable(new FFlowFieldBuffer());
+	Buffer->GoalCell = GoalCell;
+	Integrate(*Buffer);
+
+	Current = Buffer;
+	Goal = SnappedGoal;
+	return true;
+}
+
+void AFutureNinjaFlowField::Integrate(FFlowFieldBuffer& Buffer) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_FlowFieldIntegrate);
+
+	struct FOpenCell
+	{
+		float Cost;
+		int32 Cell;
+
+		bool operator<(const FOpenCell& Other) const { return Cost < Other.Cost; }
+	};
+
+	const int32 NumCells = GridSize.X * GridSize.Y;
+	Buffer.Costs.Init(MAX_flt, NumCells);
+	Buffer.Directions.Init(NoDirection, NumCells);
+
+	TArray<FOpenCell> Open;
+	Open.Reserve(FMath::Max(GridSize.X, GridSize.Y) * 8);
+	Buffer.Costs[Buffer.GoalCell] = 0.f;
+	Open.HeapPush({ 0.f, Buffer.GoalCell });
+
+	FOpenCell Top;
+	while (Open.Num() > 0)
+	{
+		Open.HeapPop(Top, false);
+		if (Top.Cost > Buffer.Costs[Top.Cell])
+		{
+			// Reached through a shorter way since it was pushed
+			continue;
+		}
+
+		const uint8 Links = CellLinks[Top.Cell];
+		for (int32 Direction = 0; Direction < 8; ++Direction)
+		{
+			if ((Links & (1 << Direction)) == 0)
+			{
+				continue;
+			}
+
+			// No cutting corners: a diagonal needs both straight ways around it
+			const bool bDiagonal = (Direction & 1) != 0;
+			if (bDiagonal && ((Links & (1 << ((Direction + 7) & 7))) == 0 || (Links & (1 << ((Direction + 1) & 7))) == 0))
+			{
+				continue;
+			}
+
+			const int32 Neighbour = GetNeighbour(Top.Cell, Direction);
+			const float Cost = Top.Cost + (bDiagonal ? DiagonalCost : 1.f);
+			if (Cost < Buffer.Costs[Neighbour])
+			{
+				Buffer.Costs[Neighbour] = Cost;
+				Buffer.Directions[Neighbour] = (uint8)((Direction + 4) & 7);
+				Open.HeapPush({ Cost, Neighbour });
+			}
+		}
+	}
+}
+
+bool AFutureNinjaFlowField::GetFlowDirection(const FVector& Location, FVector& OutDirection) const
+{
+	const FFlowFieldBuffer* Field = Current.Get();
+	int32 Cell = ToCell(Location);
+	if (Field == nullptr || Cell == INDEX_NONE)
+	{
+		return false;
+	}
+
+	if (Cell == Field->GoalCell)
+	{
+		OutDirection = (Goal - Location).GetSafeNormal2D();
+		return true;
+	}
+
+	FVector Next;
+	if (Field->Directions[Cell] != NoDirection)
+	{
+		Next = GetCellLocation(GetNeighbour(Cell, Field->Directions[Cell]));
+	}
+	else if (CellHeights[Cell] == NotWalkable)
+	{
+		// Standing on the edge of a cell whose center is off the nav mesh: head for the best neighbour that
+		// would be linked to where we stand, so the fallback never steps up a wall or through one
+		FVector HitLocation;
+		int32 Best = INDEX_NONE;
+		for (int32 Direction = 0; Direction < 8; ++Direction)
+		{
+			const int32 Neighbour = GetNeighbour(Cell, Direction);
+			if (Neighbour == INDEX_NONE || Field->Costs[Neighbour] == MAX_flt || FMath::Abs(CellHeights[Neighbour] - Location.Z) > MaxStepHeight
+				|| (Best != INDEX_NONE && Field->Costs[Neighbour] >= Field->Costs[Best]))
+			{
+				continue;
+			}
+
+			if (bTraceEdges && UNavigationSystem::NavigationRaycast(GetWorld(), Location, GetCellLocation(Neighbour), HitLocation))
+			{
+				continue;
+			}
+
+			Best = Neighbour;
+		}
+		if (Best == INDEX_NONE)
+		{
+			return false;
+		}
+		Next = GetCellLocation(Best);
+	}
+	else
+	{
+		// Walkable, but cut off from the player
+		return false;
+	}
+
+	OutDirection = (Next - Location).GetSafeNormal2D();
+	return !OutDirection.IsZero();
+}
+
+float AFutureNinjaFlowField::GetDistanceToGoal(const FVector& Location) const
+{
+	const FFlowFieldBuffer* Field = Current.Get();
+	const int32 Cell = ToCell(Location);
+	if (Field == nullptr || Cell == INDEX_NONE || Field->Costs[Cell] == MAX_flt)
+	{
+		return -1.f;
+	}
+	return Field->Costs[Cell] * GridCellSize;
+}
+
+bool AFutureNinjaFlowField::GetRandomWalkableLocation(FRandomStream& Random, FVector& OutLocation) const
+{
+	if (WalkableCells.Num() == 0)
+	{
+		return false;
+	}
+	OutLocation = GetCellLocation(WalkableCells[Random.RandHelper(WalkableCells.Num())]);
+	return true;
+}
+
+int32 AFutureNinjaFlowField::FindGoalCell(const FVector& GoalLocation, FVector& OutGoal) const
+{
+	UNavigationSystem* NavSys = UNavigationSystem::GetCurrent<UNavigationSystem>(GetWorld());
+	FNavLocation NavLocation;
+	if (NavSys == nullptr || !NavSys->ProjectPointToNavigation(GoalLocation, NavLocation))
+	{
+		return INDEX_NONE;
+	}
+
+	OutGoal = NavLocation.Location;
+	const int32 Cell = ToCell(OutGoal);
+	if (Cell == INDEX_NONE || CellHeights[Cell] != NotWalkable)
+	{
+		return Cell;
+	}
+
+	// On the nav mesh, but where the cell's center is not: use the nearest walkable neighbour
+	int32 Best = INDEX_NONE;
+	float BestDistanceSquared = MAX_flt;
+	for (int32 Direction = 0; Direction < 8; ++Direction)
+	{
+		const int32 Neighbour = GetNeighbour(Cell, Direction);
+		if (Neighbour != INDEX_NONE && CellHeights[Neighbour] != NotWalkable)
+		{
+			const float DistanceSquared = FVector::DistSquared(GetCellLocation(Neighbour), OutGoal);
+			if (DistanceSquared < BestDistanceSquared)
+			{
+				Best = Neighbour;
+				BestDistanceSquared = DistanceSquared;
+			}
+		}
+	}
+	return Best;
+}
+
+int32 AFutureNinjaFlowField::ToCell(const FVector& Location) const
+{
+	const int32 X = FMath::FloorToInt((Location.X - GridOrigin.X) / GridCellSize);
+	const int32 Y = FMath::FloorToInt((Location.Y - GridOrigin.Y) / GridCellSize);
+	if (X < 0 || Y < 0 || X >= GridSize.X || Y >= GridSize.Y)
+	{
+		return INDEX_NONE;
+	}
+	return Y * GridSize.X + X;
+}
+
+FVector AFutureNinjaFlowField::GetCellLocation(int32 Cell) const
+{
+	return FVector(GridOrigin.X + (Cell % GridSize.X + 0.5f) * GridCellSize, GridOrigin.Y + (Cell / GridSize.X + 0.5f) * GridCellSize, CellHeights[Cell]);
+}
+
+int32 AFutureNinjaFlowField::GetNeighbour(int32 Cell, int32 Direction) const
+{
+	const int32 X = Cell % GridSize.X + DirectionX[Direction];
+	const int32 Y = Cell / GridSize.X + DirectionY[Direction];
+	if (X < 0 || Y < 0 || X >= GridSize.X || Y >= GridSize.Y)
+	{
+		return INDEX_NONE;
+	}
+	return Y * GridSize.X + X;
+}
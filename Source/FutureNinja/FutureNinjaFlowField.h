@@ -0,0 +1,146 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Async/Future.h"
+#include "FutureNinjaFlowField.generated.h"
+
+/**
+ * One shared path to the player for every enemy, instead of one navmesh path query per enemy.
+ *
+ * At BeginPlay the navigable area inside the level's nav mesh bounds volumes is sampled into a grid of
+ * CellSize cells: a cell is walkable where its center projects onto the nav mesh, and two neighbouring
+ * cells are linked when their heights differ by no more than MaxStepHeight and, with bTraceEdges, a nav
+ * mesh raycast between them is clear. This grid is built once.
+ *
+ * From the player's cell, a Dijkstra flood over the links gives every reachable cell the direction of its
+ * next cell on the shortest way to the player. The flood is redone only once the player has moved more
+ * than RecomputeDistance from where the last one started, on a task graph worker thread into a second
+ * buffer; the previous field keeps answering until the new one is swapped in on a later tick.
+ *
+ * GetFlowDirection() reads the cell under a location and steers toward its next cell, in constant time
+ * whatever the number of enemies. UFutureNinjaBTTask_FollowFlowField moves a behavior tree's pawn along it.
+ *
+ * One field exists per world; use Get() to find or create it. FFutureNinjaFlowFieldBenchmark compares it
+ * with per-agent pathfinding.
+ */
+UCLASS(config=Game, notplaceable)
+class AFutureNinjaFlowField : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFutureNinjaFlowField();
+
+	/** Returns the field for World, spawning it on first use. */
+	static AFutureNinjaFlowField* Get(UWorld* World);
+
+	/**
+	 * Finds the way to the player from Location.
+	 * @param OutDirection	Receives the horizontal direction to move along
+	 * Off the nav mesh at a cell's center, it heads for the best neighbour within MaxStepHeight of Location.
+	 * @returns false if Location is off the grid, cut off from the player, or no field was built yet
+	 */
+	bool GetFlowDirection(const FVector& Location, FVector& OutDirection) const;
+
+	/** Length of the way from Location to the player along the field, or a negative value if there is none. */
+	float GetDistanceToGoal(const FVector& Location) const;
+
+	/** Where the current field leads. */
+	const FVector& GetGoal() const { return Goal; }
+
+	/** Samples the walkable grid from the nav mesh again, e.g. after the navigation was rebuilt. */
+	void BuildGrid();
+
+	/**
+	 * Floods a field toward GoalLocation on the calling thread and makes it current.
+	 * @returns false if GoalLocation is off the walkable grid
+	 */
+	bool BuildFieldNow(const FVector& GoalLocation);
+
+	/** Number of walkable cells in the grid. */
+	int32 GetNumWalkableCells() const { return WalkableCells.Num(); }
+
+	/** Picks the center of a random walkable cell. @returns false if there is none */
+	bool GetRandomWalkableLocation(FRandomStream& Random, FVector& OutLocation) const;
+
+	/** Edge length of a grid cell. */
+	UPROPERTY(Config, EditAnywhere, Category = FlowField, meta = (ClampMin = "10"))
+	float CellSize;
+
+	/** Most cells in the grid; larger levels get larger cells. */
+	UPROPERTY(Config, EditAnywhere, Category = FlowField, meta = (ClampMin = "1"))
+	int32 MaxCells;
+
+	/** Highest step between two neighbouring cells that still links them. */
+	UPROPERTY(Config, EditAnywhere, Category = FlowField)
+	float MaxStepHeight;
+
+	/** Also raycast the nav mesh between neighbouring cells, so thin walls are not walked through. */
+	UPROPERTY(Config, EditAnywhere, Category = FlowField)
+	uint32 bTraceEdges : 1;
+
+	/** How far the player moves before the field is flooded again. */
+	UPROPERTY(Config, EditAnywhere, Category = FlowField)
+	float RecomputeDistance;
+
+	// AActor interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+	// End of AActor interface
+
+private:
+	/** A flooded field: for every cell, the way to the goal */
+	struct FFlowFieldBuffer
+	{
+		/** Length of the way to the goal in cells, MAX_flt where there is none */
+		TArray<float> Costs;
+		/** Neighbour to move to, 0 to 7, or NoDirection at the goal and where there is no way */
+		TArray<uint8> Directions;
+		int32 GoalCell;
+	};
+
+	static const uint8 NoDirection = 0xff;
+
+	/** Cell under Location, or INDEX_NONE if it is off the grid. */
+	int32 ToCell(const FVector& Location) const;
+	FVector GetCellLocation(int32 Cell) const;
+	/** Neighbour of Cell in Direction, or INDEX_NONE past the edge of the grid. */
+	int32 GetNeighbour(int32 Cell, int32 Direction) const;
+
+	/** Snaps GoalLocation onto the nav mesh and finds its cell, or INDEX_NONE. */
+	int32 FindGoalCell(const FVector& GoalLocation, FVector& OutGoal) const;
+
+	/** Floods Buffer from its GoalCell. Only reads the grid, so it runs on any thread. */
+	void Integrate(FFlowFieldBuffer& Buffer) const;
+
+	/** Starts a flood toward GoalLocation on a worker thread. */
+	void StartBuild(const FVector& GoalLocation);
+
+	/** Blocks until the running flood, if any, is done and swaps it in. */
+	void FinishBuild();
+
+	/** Minimum corner of the grid */
+	FVector GridOrigin;
+	FIntPoint GridSize;
+	float GridCellSize;
+
+	/** Nav mesh height of every cell's center */
+	TArray<float> CellHeights;
+	/** Bit N set where the cell is linked to its neighbour in direction N, 0 for cells off the nav mesh */
+	TArray<uint8> CellLinks;
+	TArray<int32> WalkableCells;
+
+	/** Field answering queries, and the one being flooded on a worker thread */
+	TSharedPtr<FFlowFieldBuffer, ESPMode::ThreadSafe> Current;
+	TSharedPtr<FFlowFieldBuffer, ESPMode::ThreadSafe> Building;
+	TFuture<void> PendingBuild;
+
+	/** Goal of the current field, and of the one being built */
+	FVector Goal;
+	FVector BuildingGoal;
+	double BuildStartSeconds;
+};
@@ -0,0 +1,132 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaFlowFieldBenchmark.h"
+#include "FutureNinja.h"
+#include "FutureNinjaFlowField.h"
+#include "AI/Navigation/NavigationData.h"
+#include "AI/Navigation/NavigationSystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogFlowFieldBenchmark, Log, All);
+
+static void RunFlowFieldBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	FFutureNinjaFlowFieldBenchmark::Run(World, *FString::Join(Args, TEXT(" ")));
+}
+
+static FAutoConsoleCommandWithWorldAndArgs RunFlowFieldBenchmarkCommand(
+	TEXT("FutureNinja.FlowFieldBenchmark"),
+	TEXT("Times the flow field against per-agent pathfinding at 50, 200 and 1000 agents. Accepts Repaths= and Steps= overrides."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunFlowFieldBenchmark));
+
+bool FFutureNinjaFlowFieldBenchmark::Run(UWorld* World, const TCHAR* Params)
+{
+	UNavigationSystem* NavSys = World != nullptr ? UNavigationSystem::GetCurrent<UNavigationSystem>(World) : nullptr;
+	ANavigationData* NavData = NavSys != nullptr ? NavSys->GetMainNavData() : nullptr;
+	AFutureNinjaFlowField* Field = AFutureNinjaFlowField::Get(World);
+	if (NavData == nullptr || Field == nullptr || Field->GetNumWalkableCells() == 0)
+	{
+		UE_LOG(LogFlowFieldBenchmark, Error, TEXT("No navigation to run the flow field benchmark on"));
+		return false;
+	}
+
+	int32 NumRepaths = 10;
+	int32 NumSteps = 100;
+	FParse::Value(Params, TEXT("Repaths="), NumRepaths);
+	FParse::Value(Params, TEXT("Steps="), NumSteps);
+	NumRepaths = FMath::Max(NumRepaths, 1);
+	NumSteps = FMath::Max(NumSteps, 1);
+
+	// Every agent moves this far per step when following the field, about a frame of walking
+	const float StepLength = 10.f;
+	const int32 AgentCounts[] = { 50, 200, 1000 };
+
+	FString Csv = TEXT("Agents,Repaths,PathfindMsPerRepath,FieldBuildMsPerRepath,FieldSampleMsPerRepath,FieldSampleUsPerAgentStep,PathsFound,FieldWaysFound\n");
+
+	for (const int32 NumAgents : AgentCounts)
+	{
+		FRandomStream Random(1337);
+
+		TArray<FVector> Agents;
+		Agents.SetNumUninitialized(NumAgents);
+		for (FVector& Agent : Agents)
+		{
+			Field->GetRandomWalkableLocation(Random, Agent);
+		}
+
+		double PathfindSeconds = 0.0;
+		double BuildSeconds = 0.0;
+		double SampleSeconds = 0.0;
+		int64 PathsFound = 0;
+		int64 WaysFound = 0;
+		FVector Direction;
+
+		for (int32 Repath = 0; Repath < NumRepaths; ++Repath)
+		{
+			FVector Goal;
+			Field->GetRandomWalkableLocation(Random, Goal);
+
+			const double PathfindStart = FPlatformTime::Seconds();
+			for (const FVector& Agent : Agents)
+			{
+				const FPathFindingQuery Query(Field, *NavData, Agent, Goal);
+				PathsFound += NavSys->FindPathSync(Query).IsSuccessful() ? 1 : 0;
+			}
+			PathfindSeconds += FPlatformTime::Seconds() - PathfindStart;
+
+			const double BuildStart = FPlatformTime::Seconds();
+			Field->BuildFieldNow(Goal);
+			const double SampleStart = FPlatformTime::Seconds();
+			for (const FVector& Agent : Agents)
+			{
+				WaysFound += Field->GetFlowDirection(Agent, Direction) ? 1 : 0;
+			}
+			const double SampleEnd = FPlatformTime::Seconds();
+			BuildSeconds += SampleStart - BuildStart;
+			SampleSeconds += SampleEnd - SampleStart;
+		}
+
+		// Frames of walking along the last field, which is all the field costs between repaths
+		const double FollowStart = FPlatformTime::Seconds();
+		for (int32 Step = 0; Step < NumSteps; ++Step)
+		{
+			for (FVector& Agent : Agents)
+			{
+				if (Field->GetFlowDirection(Agent, Direction))
+				{
+					Agent += Direction * StepLength;
+				}
+			}
+		}
+		const double FollowSeconds = FPlatformTime::Seconds() - FollowStart;
+
+		const double PathfindMs = PathfindSeconds * 1000.0 / NumRepaths;
+		const double BuildMs = BuildSeconds * 1000.0 / NumRepaths;
+		const double SampleMs = SampleSeconds * 1000.0 / NumRepaths;
+		const double FollowUs = FollowSeconds * 1000000.0 / ((double)NumSteps * NumAgents);
+		UE_LOG(LogFlowFieldBenchmark, Display, TEXT("%4d agents: per-agent pathfinding %.3fms/repath, flow field %.3fms build + %.3fms sample (%.1fx), %.3fus/agent/step following; ways found %lld vs %lld"),
+			NumAgents, PathfindMs, BuildMs, SampleMs, BuildMs + SampleMs > 0.0 ? PathfindMs / (BuildMs + SampleMs) : 0.0, FollowUs, PathsFound, WaysFound);
+		if (PathsFound != WaysFound)
+		{
+			UE_LOG(LogFlowFieldBenchmark, Warning, TEXT("Pathfinding and the field disagree on reachability; the field only knows the links between cell centers"));
+		}
+
+		Csv += FString::Printf(TEXT("%d,%d,%.4f,%.4f,%.4f,%.4f,%lld,%lld\n"), NumAgents, NumRepaths, PathfindMs, BuildMs, SampleMs, FollowUs, PathsFound, WaysFound);
+	}
+
+	const FString Directory = FPaths::ProfilingDir();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*Directory);
+
+	const FString FileName = Directory / FString::Printf(TEXT("FlowFieldBenchmark-%s.csv"), *FDateTime::Now().ToString());
+	if (!FFileHelper::SaveStringToFile(Csv, *FileName))
+	{
+		UE_LOG(LogFlowFieldBenchmark, Error, TEXT("Failed to write %s"), *FileName);
+		return false;
+	}
+	return true;
+}
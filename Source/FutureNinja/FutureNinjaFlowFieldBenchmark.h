@@ -0,0 +1,28 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+/**
+ * Benchmark of AFutureNinjaFlowField against one navmesh path query per agent.
+ *
+ * For 50, 200 and 1,000 agents placed on random walkable cells of the current level, the goal is moved
+ * to a random walkable cell a number of times, as the player would, and each time every agent repaths:
+ * once through FindPathSync per agent, once by flooding the field and sampling it at every agent. Then
+ * every agent follows the field for a number of steps, timing the per frame sampling. Results, including
+ * how many agents found a way either way, are logged and written to a CSV in the profiling directory.
+ * Runs synchronously on the game thread.
+ *
+ * Needs a map with built navigation. Run with: FutureNinja.FlowFieldBenchmark [Repaths=N] [Steps=N], or
+ * -FlowFieldBenchmark on the command line (with -nullrhi for headless runs) to run it once the game starts
+ * and exit.
+ */
+class FFutureNinjaFlowFieldBenchmark
+{
+public:
+	/** Runs every agent count in World. @returns false if there is no navigation or the report could not be written */
+	static bool Run(UWorld* World, const TCHAR* Params);
+};
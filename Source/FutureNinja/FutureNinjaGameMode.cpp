@@ -3,6 +3,20 @@
 #include "FutureNinjaGameMode.h"
 #include "FutureNinjaHUD.h"
 #include "FutureNinjaCharacter.h"
+#include "FutureNinjaFlowField.h"
+#include "FutureNinjaFlowFieldBenchmark.h"
+#include "FutureNinjaMapTransition.h"
+#include "FutureNinjaPlayerController.h"
+#include "FutureNinjaPerceptionService.h"
+#include "FutureNinjaProjectileBenchmark.h"
+#include "FutureNinjaReplicationBudgeter.h"
+#include "FutureNinjaSignificanceManager.h"
+#include "FutureNinjaSpatialGrid.h"
+#include "FutureNinjaSpatialGridBenchmark.h"
+#include "FutureNinjaStatsService.h"
+#include "FutureNinjaTelemetry.h"
+#include "FutureNinjaWaveDirector.h"
+#include "Engine/DataTable.h"
 #include "UObject/ConstructorHelpers.h"
 
 AFutureNinjaGameMode::AFutureNinjaGameMode()
@@ -13,4 +27,96 @@ AFutureNinjaGameMode::AFutureNinjaGameMode()
 
 	// use our custom HUD class
 	HUDClass = AFutureNinjaHUD::StaticClass();
+
+	// Applies the character's input in the frame it arrives in
+	PlayerControllerClass = AFutureNinjaPlayerController::StaticClass();
+
+	bUseWaveDirector = false;
+	bUseSignificanceManager = true;
+	bUseSpatialGrid = false;
+	bUseReplicationBudget = true;
+	bUseStatsService = true;
+	bUsePerceptionService = false;
+	bUseFlowField = false;
+
+	// Travel through the transition map instead of blocking on the next map's load
+	bUseSeamlessTravel = true;
+}
+
+void AFutureNinjaGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	// -Telemetry[=Name] records the session from the first map on
+	FString TelemetryName;
+	if (!FFutureNinjaTelemetry::IsRecording() && (FParse::Value(FCommandLine::Get(), TEXT("Telemetry="), TelemetryName) || FParse::Param(FCommandLine::Get(), TEXT("Telemetry"))))
+	{
+		FFutureNinjaTelemetry::Get().Start(TelemetryName);
+	}
+	FFutureNinjaTelemetry::Record(EFutureNinjaTelemetryEvent::GameStart);
+
+	if (bUseSignificanceManager)
+	{
+		AFutureNinjaSignificanceManager::Get(GetWorld());
+	}
+	if (bUseSpatialGrid)
+	{
+		AFutureNinjaSpatialGrid::Get(GetWorld());
+	}
+	if (bUseReplicationBudget && GetNetMode() != NM_Standalone)
+	{
+		AFutureNinjaReplicationBudgeter::Get(GetWorld());
+	}
+	if (bUseStatsService)
+	{
+		AFutureNinjaStatsService::Get(GetWorld());
+	}
+	if (bUsePerceptionService)
+	{
+		AFutureNinjaPerceptionService::Get(GetWorld());
+	}
+	if (bUseFlowField)
+	{
+		AFutureNinjaFlowField::Get(GetWorld());
+	}
+
+	// Headless stress runs: -ProjectileBenchmark [-BenchShotsPerSecond=N] [-BenchSeconds=N] [-BenchBodies=N]
+	if (FParse::Param(FCommandLine::Get(), TEXT("ProjectileBenchmark")))
+	{
+		AFutureNinjaProjectileBenchmark::Start(GetWorld(), FCommandLine::Get(), true);
+	}
+	else if (FParse::Param(FCommandLine::Get(), TEXT("SpatialGridBenchmark")))
+	{
+		// -SpatialGridBenchmark [-Queries=N] [-Radius=N] [-Extent=N]
+		const bool bWritten = FFutureNinjaSpatialGridBenchmark::Run(GetWorld(), FCommandLine::Get());
+		FPlatformMisc::RequestExitWithStatus(false, bWritten ? 0 : 1);
+	}
+	else if (FParse::Param(FCommandLine::Get(), TEXT("FlowFieldBenchmark")))
+	{
+		// -FlowFieldBenchmark [-Repaths=N] [-Steps=N]
+		const bool bWritten = FFutureNinjaFlowFieldBenchmark::Run(GetWorld(), FCommandLine::Get());
+		FPlatformMisc::RequestExitWithStatus(false, bWritten ? 0 : 1);
+	}
+	else if (bUseWaveDirector)
+	{
+		AFutureNinjaWaveDirector::Get(GetWorld())->StartWaves(WaveTable.LoadSynchronous());
+	}
+
+	// Headless load time measurement: -TravelTo=<Map> [-ExitAfterTravel], once per run
+	static bool bTravelledFromCommandLine = false;
+	FString TravelMap;
+	if (!bTravelledFromCommandLine && FParse::Value(FCommandLine::Get(), TEXT("TravelTo="), TravelMap))
+	{
+		bTravelledFromCommandLine = true;
+
+		// Travelling from inside StartPlay would tear the world down under the caller
+		TWeakObjectPtr<UWorld> World = GetWorld();
+		GetWorldTimerManager().SetTimerForNextTick([World, TravelMap]()
+		{
+			if (World.IsValid())
+			{
+				UFutureNinjaMapTransition::Get().TravelTo(World.Get(), TravelMap);
+			}
+		});
+	}
 }
@@ -6,13 +6,51 @@
 #include "GameFramework/GameModeBase.h"
 #include "FutureNinjaGameMode.generated.h"
 
-UCLASS(minimalapi)
+class UDataTable;
+
+UCLASS(minimalapi, config=Game)
 class AFutureNinjaGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
 
 public:
 	AFutureNinjaGameMode();
+
+	/** Spawn the enemy waves from C++ with AFutureNinjaWaveDirector instead of level Blueprint logic. */
+	UPROPERTY(Config, EditAnywhere, Category = Waves)
+	uint32 bUseWaveDirector : 1;
+
+	/** FFutureNinjaWaveRow table the wave director runs; the director's FallbackWaves are used when unset. */
+	UPROPERTY(Config, EditAnywhere, Category = Waves)
+	TAssetPtr<UDataTable> WaveTable;
+
+	/** Scale how much enemies simulate by their significance to the player with AFutureNinjaSignificanceManager. */
+	UPROPERTY(Config, EditAnywhere, Category = Waves)
+	uint32 bUseSignificanceManager : 1;
+
+	/** Track enemies and kunai in AFutureNinjaSpatialGrid for proximity queries. Off until gameplay code queries it. */
+	UPROPERTY(Config, EditAnywhere, Category = Waves)
+	uint32 bUseSpatialGrid : 1;
+
+	/** Rank enemy replication and fit it into a per-connection byte budget with AFutureNinjaReplicationBudgeter. Servers only. */
+	UPROPERTY(Config, EditAnywhere, Category = Waves)
+	uint32 bUseReplicationBudget : 1;
+
+	/** Count score, kill streaks and damage from gameplay events with AFutureNinjaStatsService. */
+	UPROPERTY(Config, EditAnywhere, Category = Waves)
+	uint32 bUseStatsService : 1;
+
+	/** Answer the enemies' sight of the player in batched async traces with AFutureNinjaPerceptionService. Off by default; a sight query starts the service on first use anyway. */
+	UPROPERTY(Config, EditAnywhere, Category = Waves)
+	uint32 bUsePerceptionService : 1;
+
+	/** Build a shared flow field to the player with AFutureNinjaFlowField for enemies to follow. Off by default; following the field starts it on first use anyway. */
+	UPROPERTY(Config, EditAnywhere, Category = Waves)
+	uint32 bUseFlowField : 1;
+
+	// AGameModeBase interface
+	virtual void StartPlay() override;
+	// End of AGameModeBase interface
 };
 
 
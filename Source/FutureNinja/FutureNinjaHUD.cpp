@@ -1,32 +1,318 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
 #include "FutureNinjaHUD.h"
+#include "FutureNinja.h"
+#include "FutureNinjaCharacter.h"
+#include "Camera/CameraComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Components/MaterialBillboardComponent.h"
 #include "Engine/Canvas.h"
+#include "Engine/CanvasRenderTarget2D.h"
+#include "Engine/Engine.h"
 #include "Engine/Texture2D.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Materials/MaterialInstanceDynamic.h"
 #include "TextureResource.h"
-#include "CanvasItem.h"
-#include "UObject/ConstructorHelpers.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogFutureNinjaHUD, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("HUD Draw"), STAT_HUDDraw, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("HUD Canvas Items"), STAT_HUDCanvasItems, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("HUD Element Repaints"), STAT_HUDElementRepaints, STATGROUP_FutureNinja);
+
+static TAutoConsoleVariable<int32> CVarRetainedHUD(
+	TEXT("FutureNinja.RetainedHUD"),
+	1,
+	TEXT("1 draws HUD elements from render targets repainted only when their value changes; 0 draws them as canvas text every frame."));
 
 AFutureNinjaHUD::AFutureNinjaHUD()
 {
+	PrimaryActorTick.bCanEverTick = true;
+
+	ElementLayouts.SetNum((int32)EFutureNinjaHUDElement::Num);
+	ElementLayouts[(int32)EFutureNinjaHUDElement::Score].Label = TEXT("Score");
+	ElementLayouts[(int32)EFutureNinjaHUDElement::Score].Anchor = FVector2D(0.03f, 0.04f);
+	ElementLayouts[(int32)EFutureNinjaHUDElement::KillStreak].Label = TEXT("Streak");
+	ElementLayouts[(int32)EFutureNinjaHUDElement::KillStreak].Anchor = FVector2D(0.03f, 0.08f);
+	ElementLayouts[(int32)EFutureNinjaHUDElement::Damage].Label = TEXT("Damage");
+	ElementLayouts[(int32)EFutureNinjaHUDElement::Damage].Anchor = FVector2D(0.03f, 0.12f);
+	ElementLayouts[(int32)EFutureNinjaHUDElement::Damage].Color = FLinearColor(1.f, 0.3f, 0.2f);
+
+	ElementSize = FIntPoint(256, 32);
+	CrosshairDistance = 300.f;
+	CrosshairWorldSize = 4.f;
+	// Engine material UWidgetComponent draws with: unlit, translucent, texture in SlateUI
+	CrosshairMaterial = FStringAssetReference(TEXT("/Engine/EngineMaterials/Widget3DPassThrough_Translucent.Widget3DPassThrough_Translucent"));
+	CrosshairTextureParameter = TEXT("SlateUI");
+
+	CrosshairTex = nullptr;
+	CrosshairSprite = nullptr;
+	CachedCanvasSize = FIntPoint::ZeroValue;
+	PaintingElement = INDEX_NONE;
+
+	FramesDrawn = 0;
+	CanvasItemsDrawn = 0;
+	ElementRepaints = 0;
+	DrawSeconds = 0.0;
 }
 
+void AFutureNinjaHUD::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Elements.SetNumZeroed((int32)EFutureNinjaHUDElement::Num);
+
+	ElementTargets.Reset();
+	for (int32 Index = 0; Index < (int32)EFutureNinjaHUDElement::Num; ++Index)
+	{
+		UCanvasRenderTarget2D* Target = UCanvasRenderTarget2D::CreateCanvasRenderTarget2D(this, UCanvasRenderTarget2D::StaticClass(), ElementSize.X, ElementSize.Y);
+		if (Target != nullptr)
+		{
+			Target->ClearColor = FLinearColor::Transparent;
+			Target->OnCanvasRenderTargetUpdate.AddDynamic(this, &AFutureNinjaHUD::PaintElement);
+		}
+		ElementTargets.Add(Target);
+	}
+
+	if (CrosshairTex == nullptr)
+	{
+		UE_LOG(LogFutureNinjaHUD, Warning, TEXT("%s has no CrosshairTex; no crosshair is drawn. Set it in a Blueprint subclass."), *GetClass()->GetName());
+		return;
+	}
+
+	UMaterialInterface* Material = Cast<UMaterialInterface>(CrosshairMaterial.TryLoad());
+	if (Material == nullptr)
+	{
+		UE_LOG(LogFutureNinjaHUD, Warning, TEXT("Could not load the crosshair material %s; there is no crosshair in VR"), *CrosshairMaterial.ToString());
+		return;
+	}
+
+	UMaterialInstanceDynamic* CrosshairMID = UMaterialInstanceDynamic::Create(Material, this);
+	CrosshairMID->SetTextureParameterValue(CrosshairTextureParameter, CrosshairTex);
+
+	// Sizes extend to either side of the billboard's center
+	const float HalfWidth = CrosshairWorldSize * 0.5f;
+	const float HalfHeight = HalfWidth * CrosshairTex->GetSizeY() / FMath::Max(CrosshairTex->GetSizeX(), 1);
+
+	CrosshairSprite = NewObject<UMaterialBillboardComponent>(this, TEXT("CrosshairSprite"));
+	CrosshairSprite->AddElement(CrosshairMID, nullptr, false, HalfWidth, HalfHeight, nullptr);
+	CrosshairSprite->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	CrosshairSprite->SetVisibility(false);
+	CrosshairSprite->RegisterComponent();
+}
+
+void AFutureNinjaHUD::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (FramesDrawn > 0)
+	{
+		UE_LOG(LogFutureNinjaHUD, Log, TEXT("HUD (%s): %lld frames, %.2f canvas items and %.3f element repaints per frame, %.1fus per DrawHUD"),
+			CVarRetainedHUD.GetValueOnGameThread() != 0 ? TEXT("retained") : TEXT("immediate"),
+			FramesDrawn, (double)CanvasItemsDrawn / FramesDrawn, (double)ElementRepaints / FramesDrawn, DrawSeconds / FramesDrawn * 1000000.0);
+	}
+
+	if (CrosshairSprite != nullptr)
+	{
+		CrosshairSprite->DestroyComponent();
+		CrosshairSprite = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFutureNinjaHUD::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	UpdateWorldCrosshair();
+}
+
+void AFutureNinjaHUD::SetElementValue(EFutureNinjaHUDElement Element, int32 Value)
+{
+	const int32 Index = (int32)Element;
+	if (!Elements.IsValidIndex(Index))
+	{
+		return;
+	}
+
+	FElementState& State = Elements[Index];
+	if (!State.bHasValue || State.Value != Value)
+	{
+		State.Value = Value;
+		State.bHasValue = true;
+		State.bDirty = true;
+	}
+}
+
+FString AFutureNinjaHUD::GetElementText(int32 Index) const
+{
+	const FString& Label = ElementLayouts.IsValidIndex(Index) ? ElementLayouts[Index].Label : FString();
+	return FString::Printf(TEXT("%s %d"), *Label, Elements[Index].Value);
+}
 
 void AFutureNinjaHUD::DrawHUD()
 {
 	Super::DrawHUD();
 
-	// Draw very simple crosshair
+	SCOPE_CYCLE_COUNTER(STAT_HUDDraw);
+	const double StartTime = FPlatformTime::Seconds();
+	const int64 ItemsBefore = CanvasItemsDrawn;
+	const int64 RepaintsBefore = ElementRepaints;
+
+	const FIntPoint CanvasSize(Canvas->ClipX, Canvas->ClipY);
+	if (CanvasSize != CachedCanvasSize)
+	{
+		BuildItems();
+	}
+
+	if (CVarRetainedHUD.GetValueOnGameThread() != 0)
+	{
+		RepaintDirtyElements();
+
+		for (int32 Index = 0; Index < ElementItems.Num(); ++Index)
+		{
+			if (Elements[Index].bHasValue && ElementTargets[Index] != nullptr)
+			{
+				// The target's resource is recreated on every repaint
+				ElementItems[Index].Texture = ElementTargets[Index]->Resource;
+				Canvas->DrawItem(ElementItems[Index]);
+				++CanvasItemsDrawn;
+			}
+		}
+	}
+	else
+	{
+		DrawElementsImmediate();
+	}
+
+	// Draw very simple crosshair; in VR it is the world space sprite
+	if (CrosshairItem.IsSet() && !GEngine->IsStereoscopic3D())
+	{
+		Canvas->DrawItem(CrosshairItem.GetValue());
+		++CanvasItemsDrawn;
+	}
+
+	++FramesDrawn;
+	DrawSeconds += FPlatformTime::Seconds() - StartTime;
+	SET_DWORD_STAT(STAT_HUDCanvasItems, CanvasItemsDrawn - ItemsBefore);
+	SET_DWORD_STAT(STAT_HUDElementRepaints, ElementRepaints - RepaintsBefore);
+}
+
+void AFutureNinjaHUD::BuildItems()
+{
+	CachedCanvasSize = FIntPoint(Canvas->ClipX, Canvas->ClipY);
+
+	ElementItems.Reset();
+	for (int32 Index = 0; Index < ElementTargets.Num(); ++Index)
+	{
+		const FVector2D Anchor = ElementLayouts.IsValidIndex(Index) ? ElementLayouts[Index].Anchor : FVector2D::ZeroVector;
+		const FVector2D Position(Anchor.X * Canvas->ClipX, Anchor.Y * Canvas->ClipY);
+
+		FCanvasTileItem TileItem(Position, nullptr, FVector2D(ElementSize), FLinearColor::White);
+		TileItem.BlendMode = SE_BLEND_Translucent;
+		ElementItems.Add(TileItem);
+	}
+
+	CrosshairItem.Reset();
+	if (CrosshairTex != nullptr)
+	{
+		// find center of the Canvas
+		const FVector2D Center(Canvas->ClipX * 0.5f, Canvas->ClipY * 0.5f);
+
+		// offset by half the texture's dimensions so that the center of the texture aligns with the center of the Canvas
+		const FVector2D CrosshairDrawPosition( (Center.X),
+											   (Center.Y + 20.0f));
+
+		FCanvasTileItem TileItem( CrosshairDrawPosition, CrosshairTex->Resource, FLinearColor::White);
+		TileItem.BlendMode = SE_BLEND_Translucent;
+		CrosshairItem = TileItem;
+	}
+}
+
+void AFutureNinjaHUD::RepaintDirtyElements()
+{
+	for (int32 Index = 0; Index < Elements.Num(); ++Index)
+	{
+		if (Elements[Index].bDirty && ElementTargets.IsValidIndex(Index) && ElementTargets[Index] != nullptr)
+		{
+			// UpdateResource clears the target and calls PaintElement right away
+			PaintingElement = Index;
+			ElementTargets[Index]->UpdateResource();
+			PaintingElement = INDEX_NONE;
+
+			Elements[Index].bDirty = false;
+			++ElementRepaints;
+		}
+	}
+}
+
+void AFutureNinjaHUD::PaintElement(UCanvas* TargetCanvas, int32 Width, int32 Height)
+{
+	if (!Elements.IsValidIndex(PaintingElement) || TargetCanvas == nullptr)
+	{
+		return;
+	}
+
+	const FLinearColor Color = ElementLayouts.IsValidIndex(PaintingElement) ? ElementLayouts[PaintingElement].Color : FLinearColor::White;
+	FCanvasTextItem TextItem(FVector2D::ZeroVector, FText::FromString(GetElementText(PaintingElement)), GEngine->GetMediumFont(), Color);
+	TextItem.EnableShadow(FLinearColor::Black);
+	TargetCanvas->DrawItem(TextItem);
+}
+
+void AFutureNinjaHUD::DrawElementsImmediate()
+{
+	for (int32 Index = 0; Index < Elements.Num(); ++Index)
+	{
+		if (!Elements[Index].bHasValue)
+		{
+			continue;
+		}
+
+		const FFutureNinjaHUDElementLayout* Layout = ElementLayouts.IsValidIndex(Index) ? &ElementLayouts[Index] : nullptr;
+		const FVector2D Anchor = Layout != nullptr ? Layout->Anchor : FVector2D::ZeroVector;
+		FCanvasTextItem TextItem(FVector2D(Anchor.X * Canvas->ClipX, Anchor.Y * Canvas->ClipY), FText::FromString(GetElementText(Index)),
+			GEngine->GetMediumFont(), Layout != nullptr ? Layout->Color : FLinearColor::White);
+		TextItem.EnableShadow(FLinearColor::Black);
+		Canvas->DrawItem(TextItem);
+		++CanvasItemsDrawn;
+
+		// Nothing is retained, so there is nothing to repaint later
+		Elements[Index].bDirty = false;
+	}
+}
+
+void AFutureNinjaHUD::UpdateWorldCrosshair()
+{
+	if (CrosshairSprite == nullptr)
+	{
+		return;
+	}
 
-	// find center of the Canvas
-	const FVector2D Center(Canvas->ClipX * 0.5f, Canvas->ClipY * 0.5f);
+	const bool bStereo = GEngine->IsStereoscopic3D();
+	if (CrosshairSprite->IsVisible() != bStereo)
+	{
+		CrosshairSprite->SetVisibility(bStereo);
+	}
+	if (!bStereo || PlayerOwner == nullptr)
+	{
+		return;
+	}
 
-	// offset by half the texture's dimensions so that the center of the texture aligns with the center of the Canvas
-	const FVector2D CrosshairDrawPosition( (Center.X),
-										   (Center.Y + 20.0f));
+	// Follow the first person camera, or the camera manager for any other pawn
+	USceneComponent* Parent = nullptr;
+	const AFutureNinjaCharacter* Character = Cast<AFutureNinjaCharacter>(PlayerOwner->GetPawn());
+	if (Character != nullptr)
+	{
+		Parent = Character->GetFirstPersonCameraComponent();
+	}
+	else if (PlayerOwner->PlayerCameraManager != nullptr)
+	{
+		Parent = PlayerOwner->PlayerCameraManager->GetRootComponent();
+	}
 
-	// draw the crosshair
-	FCanvasTileItem TileItem( CrosshairDrawPosition, CrosshairTex->Resource, FLinearColor::White);
-	TileItem.BlendMode = SE_BLEND_Translucent;
-	Canvas->DrawItem( TileItem );
+	if (Parent != nullptr && CrosshairSprite->GetAttachParent() != Parent)
+	{
+		CrosshairSprite->AttachToComponent(Parent, FAttachmentTransformRules::SnapToTargetNotIncludingScale);
+		CrosshairSprite->SetRelativeLocation(FVector(CrosshairDistance, 0.f, 0.f));
+	}
 }
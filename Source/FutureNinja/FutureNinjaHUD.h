@@ -1,12 +1,65 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
-#pragma once 
+#pragma once
 
 #include "CoreMinimal.h"
 #include "GameFramework/HUD.h"
+#include "CanvasItem.h"
 #include "FutureNinjaHUD.generated.h"
 
-UCLASS()
+class UMaterialBillboardComponent;
+class UCanvas;
+class UCanvasRenderTarget2D;
+
+/** Values the HUD shows next to the crosshair. */
+UENUM(BlueprintType)
+enum class EFutureNinjaHUDElement : uint8
+{
+	Score,
+	KillStreak,
+	Damage,
+	Num UMETA(Hidden)
+};
+
+/** Where and how one HUD element is shown. */
+USTRUCT()
+struct FFutureNinjaHUDElementLayout
+{
+	GENERATED_BODY()
+
+	/** Text in front of the value. */
+	UPROPERTY(EditAnywhere, Category = HUD)
+	FString Label;
+
+	/** Top left corner, as a fraction of the screen. */
+	UPROPERTY(EditAnywhere, Category = HUD)
+	FVector2D Anchor;
+
+	UPROPERTY(EditAnywhere, Category = HUD)
+	FLinearColor Color;
+
+	FFutureNinjaHUDElementLayout()
+		: Anchor(FVector2D::ZeroVector), Color(FLinearColor::White)
+	{}
+};
+
+/**
+ * Retained mode HUD.
+ *
+ * Each element is painted into its own small render target when its value changes, and every frame only
+ * draws the finished targets with tile items built once per viewport size. Text layout and glyph drawing
+ * therefore happen once per change instead of once per frame. Values are pushed in with SetElementValue,
+ * which marks the element dirty only if the value differs.
+ *
+ * In VR the crosshair is a world space billboard held CrosshairDistance in front of the camera, since a screen
+ * space canvas item does not converge in a headset. It is drawn with CrosshairMaterial, an unlit translucent
+ * material whose CrosshairTextureParameter is set to CrosshairTex, as plain sprites are not rendered in
+ * shipping builds. Without a CrosshairTex, which a Blueprint subclass sets, no crosshair is drawn at all.
+ *
+ * FutureNinja.RetainedHUD 0 draws every element as canvas text each frame instead, to compare the
+ * "HUD Draw" cycle stat and the item counters against. Totals are logged at EndPlay.
+ */
+UCLASS(config=Game)
 class AFutureNinjaHUD : public AHUD
 {
 	GENERATED_BODY()
@@ -17,9 +70,88 @@ public:
 	/** Primary draw call for the HUD */
 	virtual void DrawHUD() override;
 
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Shows Value in Element. The element is repainted on the next frame if Value changed. */
+	UFUNCTION(BlueprintCallable, Category = HUD)
+	void SetElementValue(EFutureNinjaHUDElement Element, int32 Value);
+
+	/** Layout of each EFutureNinjaHUDElement, in order. */
+	UPROPERTY(Config, EditAnywhere, Category = HUD)
+	TArray<FFutureNinjaHUDElementLayout> ElementLayouts;
+
+	/** Size in pixels of the render target each element is painted into. */
+	UPROPERTY(Config, EditAnywhere, Category = HUD)
+	FIntPoint ElementSize;
+
+	/** Distance in front of the camera of the VR crosshair. */
+	UPROPERTY(Config, EditAnywhere, Category = HUD)
+	float CrosshairDistance;
+
+	/** Width of the VR crosshair in world units. */
+	UPROPERTY(Config, EditAnywhere, Category = HUD)
+	float CrosshairWorldSize;
+
+	/** Unlit translucent material of the VR crosshair. */
+	UPROPERTY(Config, EditAnywhere, Category = HUD)
+	FStringAssetReference CrosshairMaterial;
+
+	/** Texture parameter of CrosshairMaterial that receives CrosshairTex. */
+	UPROPERTY(Config, EditAnywhere, Category = HUD)
+	FName CrosshairTextureParameter;
+
 private:
 	/** Crosshair asset pointer */
+	UPROPERTY(EditDefaultsOnly, Category = HUD, meta = (AllowPrivateAccess = "true"))
 	class UTexture2D* CrosshairTex;
 
-};
+	/** Paints the element being repainted into its render target. */
+	UFUNCTION()
+	void PaintElement(UCanvas* TargetCanvas, int32 Width, int32 Height);
+
+	/** Repaints every dirty element into its render target. */
+	void RepaintDirtyElements();
+
+	/** Rebuilds the cached tile items for the current canvas size. */
+	void BuildItems();
+
+	/** Draws every element as text, the way a non-retained HUD would. */
+	void DrawElementsImmediate();
+
+	/** Keeps the VR crosshair on the current camera and shows it only in stereo. */
+	void UpdateWorldCrosshair();
 
+	FString GetElementText(int32 Index) const;
+
+	/** One render target per element */
+	UPROPERTY(Transient)
+	TArray<UCanvasRenderTarget2D*> ElementTargets;
+
+	UPROPERTY(Transient)
+	UMaterialBillboardComponent* CrosshairSprite;
+
+	struct FElementState
+	{
+		int32 Value;
+		bool bHasValue;
+		bool bDirty;
+	};
+
+	TArray<FElementState> Elements;
+
+	/** Tile items drawing the element targets and the crosshair, built for CachedCanvasSize */
+	TArray<FCanvasTileItem> ElementItems;
+	TOptional<FCanvasTileItem> CrosshairItem;
+	FIntPoint CachedCanvasSize;
+
+	/** Element PaintElement draws */
+	int32 PaintingElement;
+
+	/** Totals for the EndPlay report */
+	int64 FramesDrawn;
+	int64 CanvasItemsDrawn;
+	int64 ElementRepaints;
+	double DrawSeconds;
+};
@@ -0,0 +1,140 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaHitchDetector.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogHitchDetector, Log, All);
+
+static TAutoConsoleVariable<int32> CVarHitchCapture(
+	TEXT("FutureNinja.HitchCapture"),
+	1,
+	TEXT("Dump the recent fire/hit timings to Saved/Profiling/Hitches when a frame exceeds FutureNinja.HitchBudgetMs."));
+
+static TAutoConsoleVariable<float> CVarHitchBudgetMs(
+	TEXT("FutureNinja.HitchBudgetMs"),
+	1000.f / 90.f,
+	TEXT("Frame time, in milliseconds, above which a frame counts as a hitch. Defaults to a 90 Hz HMD frame."));
+
+static TAutoConsoleVariable<float> CVarHitchHistorySeconds(
+	TEXT("FutureNinja.HitchHistorySeconds"),
+	5.f,
+	TEXT("Seconds of frame history written for each hitch."));
+
+static TAutoConsoleVariable<float> CVarHitchCooldownSeconds(
+	TEXT("FutureNinja.HitchCooldownSeconds"),
+	2.f,
+	TEXT("Minimum time between two hitch dumps, so a slow stretch does not write a file every frame."));
+
+static FAutoConsoleCommand DumpHitchHistoryCommand(
+	TEXT("FutureNinja.DumpHitchHistory"),
+	TEXT("Writes the current fire/hit timing history to Saved/Profiling/Hitches."),
+	FConsoleCommandDelegate::CreateLambda([]() { FFutureNinjaHitchDetector::Get().DumpNow(TEXT("Manual")); }));
+
+static const TCHAR* StepNames[(int32)EFutureNinjaStep::Num] =
+{
+	TEXT("Fire"),
+	TEXT("Spawn"),
+	TEXT("Hit"),
+	TEXT("Impulse"),
+	TEXT("Destroy"),
+};
+
+FFutureNinjaHitchDetector& FFutureNinjaHitchDetector::Get()
+{
+	static FFutureNinjaHitchDetector Detector;
+	return Detector;
+}
+
+FFutureNinjaHitchDetector::FFutureNinjaHitchDetector()
+	: RingHead(0)
+	, RingCount(0)
+	, LastFrameCycles(FPlatformTime::Cycles64())
+	, LastDumpTime(0.0)
+{
+	FMemory::Memzero(CurrentFrame);
+	FCoreDelegates::OnEndFrame.AddRaw(this, &FFutureNinjaHitchDetector::OnEndFrame);
+}
+
+void FFutureNinjaHitchDetector::OnEndFrame()
+{
+	const uint64 NowCycles = FPlatformTime::Cycles64();
+	CurrentFrame.FrameNumber = GFrameCounter;
+	CurrentFrame.EndTime = FPlatformTime::Seconds();
+	CurrentFrame.FrameMs = (float)FPlatformTime::ToMilliseconds64(NowCycles - LastFrameCycles);
+	LastFrameCycles = NowCycles;
+
+	Ring[RingHead] = CurrentFrame;
+	RingHead = (RingHead + 1) % RingSize;
+	RingCount = FMath::Min(RingCount + 1, RingSize);
+
+	const bool bHitch = CurrentFrame.FrameMs > CVarHitchBudgetMs.GetValueOnGameThread();
+	const double EndTime = CurrentFrame.EndTime;
+	FMemory::Memzero(CurrentFrame);
+
+	if (bHitch && CVarHitchCapture.GetValueOnGameThread() != 0 && EndTime - LastDumpTime >= CVarHitchCooldownSeconds.GetValueOnGameThread())
+	{
+		Dump(TEXT("Hitch"));
+	}
+}
+
+void FFutureNinjaHitchDetector::DumpNow(const TCHAR* Reason)
+{
+	Dump(Reason);
+}
+
+void FFutureNinjaHitchDetector::Dump(const TCHAR* Reason)
+{
+	const double Now = FPlatformTime::Seconds();
+	LastDumpTime = Now;
+
+	// Copy only the requested window, oldest first; formatting and file IO happen off the game thread
+	const double OldestTime = Now - CVarHitchHistorySeconds.GetValueOnGameThread();
+	TArray<FFrameRecord> Frames;
+	Frames.Reserve(RingCount);
+	for (int32 Offset = RingCount; Offset > 0; --Offset)
+	{
+		const FFrameRecord& Record = Ring[(RingHead - Offset + RingSize) % RingSize];
+		if (Record.EndTime >= OldestTime)
+		{
+			Frames.Add(Record);
+		}
+	}
+
+	if (Frames.Num() == 0)
+	{
+		return;
+	}
+
+	const FString Directory = FPaths::ProfilingDir() / TEXT("Hitches");
+	const FString FileName = Directory / FString::Printf(TEXT("%s-%s-%llu.csv"), Reason, *FDateTime::Now().ToString(), Frames.Last().FrameNumber);
+
+	UE_LOG(LogHitchDetector, Log, TEXT("%s: frame %llu took %.2fms, writing %d frames to %s"), Reason, Frames.Last().FrameNumber, Frames.Last().FrameMs, Frames.Num(), *FileName);
+
+	Async<void>(EAsyncExecution::ThreadPool, [Frames, Directory, FileName]()
+	{
+		FString Csv = TEXT("Frame,FrameMs");
+		for (const TCHAR* StepName : StepNames)
+		{
+			Csv += FString::Printf(TEXT(",%sMs,%sCount"), StepName, StepName);
+		}
+		Csv += TEXT("\n");
+
+		for (const FFrameRecord& Record : Frames)
+		{
+			Csv += FString::Printf(TEXT("%llu,%.3f"), Record.FrameNumber, Record.FrameMs);
+			for (const FStepTotals& Totals : Record.Steps)
+			{
+				Csv += FString::Printf(TEXT(",%.4f,%u"), FPlatformTime::ToMilliseconds(Totals.Cycles), Totals.Count);
+			}
+			Csv += TEXT("\n");
+		}
+
+		FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*Directory);
+		FFileHelper::SaveStringToFile(Csv, *FileName);
+	});
+}
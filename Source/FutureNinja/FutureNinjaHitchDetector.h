@@ -0,0 +1,98 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FutureNinja.h"
+
+/** Gameplay steps timed by the hitch detector. */
+enum class EFutureNinjaStep : uint8
+{
+	Fire,
+	Spawn,
+	Hit,
+	Impulse,
+	Destroy,
+
+	Num
+};
+
+/**
+ * Always-on timing of the fire/hit path that is cheap enough for shipping builds.
+ *
+ * Every timed step adds its cycles to the current frame. At the end of each frame the totals are pushed
+ * into a fixed ring buffer. When a frame takes longer than the HMD frame budget, the last few seconds of
+ * that ring are written to Saved/Profiling/Hitches on a worker thread. Frames without a hitch only pay
+ * for two FPlatformTime::Cycles() calls per timed step and one ring write per frame.
+ *
+ * Game thread only.
+ */
+class FFutureNinjaHitchDetector
+{
+public:
+	/** Returns the detector, hooking it to the end of the frame on first use. */
+	static FFutureNinjaHitchDetector& Get();
+
+	/** Adds Cycles spent in Step to the current frame. */
+	FORCEINLINE void AddStepTime(EFutureNinjaStep Step, uint32 Cycles)
+	{
+		FStepTotals& Totals = CurrentFrame.Steps[(int32)Step];
+		Totals.Cycles += Cycles;
+		++Totals.Count;
+	}
+
+	/** Times the enclosing scope as Step. */
+	struct FScopedStep
+	{
+		FORCEINLINE explicit FScopedStep(EFutureNinjaStep InStep)
+			: Step(InStep), StartCycles(FPlatformTime::Cycles())
+		{}
+
+		FORCEINLINE ~FScopedStep()
+		{
+			FFutureNinjaHitchDetector::Get().AddStepTime(Step, FPlatformTime::Cycles() - StartCycles);
+		}
+
+		EFutureNinjaStep Step;
+		uint32 StartCycles;
+	};
+
+	/** Writes the current ring to disk now, as if a hitch had happened. */
+	void DumpNow(const TCHAR* Reason);
+
+private:
+	FFutureNinjaHitchDetector();
+
+	struct FStepTotals
+	{
+		uint32 Cycles;
+		uint32 Count;
+	};
+
+	struct FFrameRecord
+	{
+		uint64 FrameNumber;
+		double EndTime;
+		float FrameMs;
+		FStepTotals Steps[(int32)EFutureNinjaStep::Num];
+	};
+
+	/** Frames kept in the ring; enough for several seconds at VR frame rates */
+	static const int32 RingSize = 1024;
+
+	void OnEndFrame();
+	void Dump(const TCHAR* Reason);
+
+	FFrameRecord Ring[RingSize];
+	int32 RingHead;
+	int32 RingCount;
+
+	FFrameRecord CurrentFrame;
+	uint64 LastFrameCycles;
+	double LastDumpTime;
+};
+
+/** Times the enclosing scope both for "stat FutureNinja" (StatId) and for the hitch detector (Step). */
+#define FUTURENINJA_SCOPE_STEP(Step, StatId) \
+	SCOPE_CYCLE_COUNTER(StatId); \
+	FFutureNinjaHitchDetector::FScopedStep ANONYMOUS_VARIABLE(FutureNinjaStep)(Step)
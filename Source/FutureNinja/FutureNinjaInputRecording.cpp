@@ -0,0 +1,76 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaInputRecording.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Serialization/Archive.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogInputRecording, Log, All);
+
+static const uint32 InputRecordingMagic = 0x464E4952; // 'FNIR'
+static const int32 InputRecordingVersion = 1;
+
+FArchive& operator<<(FArchive& Ar, FFutureNinjaInputFrame& Frame)
+{
+	Ar << Frame.DeltaSeconds;
+	for (float& Axis : Frame.Axes)
+	{
+		Ar << Axis;
+	}
+
+	uint8 Actions = (uint8)Frame.Actions;
+	Ar << Actions;
+	Frame.Actions = (EFutureNinjaInputAction)Actions;
+
+	Ar << Frame.StateCrc;
+	return Ar;
+}
+
+FString FFutureNinjaInputRecording::GetPath(const FString& Name)
+{
+	return FPaths::ProfilingDir() / TEXT("InputRecordings") / FPaths::SetExtension(Name, TEXT(".fnrec"));
+}
+
+bool FFutureNinjaInputRecording::Save(const FString& Path) const
+{
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Path));
+	if (!Writer)
+	{
+		UE_LOG(LogInputRecording, Error, TEXT("Failed to open %s for writing"), *Path);
+		return false;
+	}
+
+	uint32 Magic = InputRecordingMagic;
+	int32 Version = InputRecordingVersion;
+	int32 Seed = RandomSeed;
+	float StepHz = FixedStepHz;
+	*Writer << Magic << Version << Seed << StepHz;
+	*Writer << const_cast<TArray<FFutureNinjaInputFrame>&>(Frames);
+
+	const bool bOk = Writer->Close();
+	UE_LOG(LogInputRecording, Log, TEXT("Wrote %d input frames to %s"), Frames.Num(), *Path);
+	return bOk;
+}
+
+bool FFutureNinjaInputRecording::Load(const FString& Path)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Path));
+	if (!Reader)
+	{
+		UE_LOG(LogInputRecording, Error, TEXT("Failed to open %s"), *Path);
+		return false;
+	}
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	*Reader << Magic << Version;
+	if (Magic != InputRecordingMagic || Version != InputRecordingVersion)
+	{
+		UE_LOG(LogInputRecording, Error, TEXT("%s is not a version %d input recording"), *Path, InputRecordingVersion);
+		return false;
+	}
+
+	*Reader << RandomSeed << FixedStepHz;
+	*Reader << Frames;
+	return Reader->Close() && !Reader->IsError();
+}
@@ -0,0 +1,85 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Axis bindings of AFutureNinjaCharacter, in recorded order. */
+enum class EFutureNinjaInputAxis : uint8
+{
+	MoveForward,
+	MoveRight,
+	Turn,
+	TurnRate,
+	LookUp,
+	LookUpRate,
+
+	Num
+};
+
+/** Action bindings of AFutureNinjaCharacter, as bits of FFutureNinjaInputFrame::Actions. */
+enum class EFutureNinjaInputAction : uint8
+{
+	None = 0,
+	JumpPressed = 1 << 0,
+	JumpReleased = 1 << 1,
+	Fire = 1 << 2,
+	ResetVR = 1 << 3
+};
+ENUM_CLASS_FLAGS(EFutureNinjaInputAction);
+
+/** Everything the character's input bindings received during one tick. */
+struct FFutureNinjaInputFrame
+{
+	/** World delta of the tick the input was applied in */
+	float DeltaSeconds;
+	float Axes[(int32)EFutureNinjaInputAxis::Num];
+	EFutureNinjaInputAction Actions;
+	/** Hash of the character, enemy and kunai state after the tick, to find where a replay diverges */
+	uint32 StateCrc;
+
+	FFutureNinjaInputFrame()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		DeltaSeconds = 0.f;
+		FMemory::Memzero(Axes);
+		Actions = EFutureNinjaInputAction::None;
+		StateCrc = 0;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FFutureNinjaInputFrame& Frame);
+};
+
+/**
+ * A recorded play session: the input of every tick plus what is needed to start the simulation in the
+ * same state. Stored as a small versioned binary file under Saved/Profiling/InputRecordings.
+ *
+ * Record with -RecordInput=Name; the file is written when the character leaves play. Replay headless with
+ * FutureNinja <Map> -game -nullrhi -unattended -ReplayInput=Name, which pins every frame to its recorded
+ * delta, compares the character, enemy and kunai state after each frame and exits non-zero if the replay
+ * diverged. Motion controller poses are not recorded, so VR throws do not replay.
+ */
+struct FFutureNinjaInputRecording
+{
+	/** Seed of FMath::Rand and FMath::SRand at the start of the session */
+	int32 RandomSeed;
+
+	/** FutureNinja.FixedStepHz the session ran with */
+	float FixedStepHz;
+
+	TArray<FFutureNinjaInputFrame> Frames;
+
+	FFutureNinjaInputRecording()
+		: RandomSeed(0), FixedStepHz(0.f)
+	{}
+
+	/** Full path of the recording called Name. */
+	static FString GetPath(const FString& Name);
+
+	bool Save(const FString& Path) const;
+	bool Load(const FString& Path);
+};
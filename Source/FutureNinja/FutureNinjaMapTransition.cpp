@@ -0,0 +1,220 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaMapTransition.h"
+#include "FutureNinja.h"
+#include "Async/Async.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectGlobals.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMapTransition, Log, All);
+
+static void TravelToMap(const TArray<FString>& Args, UWorld* World)
+{
+	if (Args.Num() == 0)
+	{
+		UE_LOG(LogMapTransition, Warning, TEXT("Usage: FutureNinja.TravelTo <Map>"));
+		return;
+	}
+	UFutureNinjaMapTransition::Get().TravelTo(World, Args[0]);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs TravelToCommand(
+	TEXT("FutureNinja.TravelTo"),
+	TEXT("Travels to a map behind the transition map, preloading the gameplay assets on the way."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&TravelToMap));
+
+UFutureNinjaMapTransition::UFutureNinjaMapTransition()
+{
+	bWriteReport = true;
+
+	TravelStartSeconds = 0.0;
+	TransitionMapSeconds = -1.f;
+}
+
+UFutureNinjaMapTransition& UFutureNinjaMapTransition::Get()
+{
+	static UFutureNinjaMapTransition* Transition = nullptr;
+	if (Transition == nullptr)
+	{
+		Transition = NewObject<UFutureNinjaMapTransition>(GetTransientPackage(), NAME_None, RF_Transient);
+		Transition->AddToRoot();
+		FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(Transition, &UFutureNinjaMapTransition::OnPostLoadMap);
+	}
+	return *Transition;
+}
+
+bool UFutureNinjaMapTransition::TravelTo(UWorld* World, const FString& MapName)
+{
+	if (IsTravelling())
+	{
+		UE_LOG(LogMapTransition, Warning, TEXT("Already travelling to %s, not travelling to %s"), *DestinationMap, *MapName);
+		return false;
+	}
+
+	// Only the authority travels; clients follow the server
+	AGameModeBase* GameMode = World != nullptr ? World->GetAuthGameMode() : nullptr;
+	if (GameMode == nullptr)
+	{
+		UE_LOG(LogMapTransition, Warning, TEXT("Cannot travel to %s from a world without a game mode"), *MapName);
+		return false;
+	}
+
+	DestinationMap = MapName;
+	SourceMap = World->GetMapName();
+	TravelStartSeconds = FPlatformTime::Seconds();
+	TransitionMapSeconds = -1.f;
+
+	StartPreload();
+
+	// A hard travel would load the destination synchronously, whatever the current map's game mode says
+	const bool bWasSeamless = GameMode->bUseSeamlessTravel;
+	GameMode->bUseSeamlessTravel = true;
+	if (!World->ServerTravel(MapName, true))
+	{
+		// No map will load to end the transition, so do not keep travelling or hold on to the preloads
+		UE_LOG(LogMapTransition, Error, TEXT("Could not travel from %s to %s"), *SourceMap, *MapName);
+		GameMode->bUseSeamlessTravel = bWasSeamless;
+		for (TSharedPtr<FStreamableHandle>& Handle : Handles)
+		{
+			if (Handle.IsValid())
+			{
+				// Cancelling also drops the completion callbacks, whose indices into LoadTimes are about to go
+				Handle->CancelHandle();
+			}
+		}
+		Handles.Reset();
+		LoadTimes.Reset();
+		DestinationMap.Empty();
+		return false;
+	}
+
+	UE_LOG(LogMapTransition, Log, TEXT("Travelling from %s to %s, preloading %d assets"), *SourceMap, *DestinationMap, LoadTimes.Num());
+	return true;
+}
+
+void UFutureNinjaMapTransition::StartPreload()
+{
+	// The assets of the previous transition may go once these have been requested
+	TArray<TSharedPtr<FStreamableHandle>> PreviousHandles = MoveTemp(Handles);
+	Handles.Reset();
+	LoadTimes.Reset();
+
+	for (const FStringAssetReference& Asset : PreloadAssets)
+	{
+		if (!Asset.IsValid())
+		{
+			continue;
+		}
+
+		const int32 Index = LoadTimes.AddDefaulted();
+		LoadTimes[Index].Asset = Asset;
+		LoadTimes[Index].LoadMs = -1.f;
+		LoadTimes[Index].bWasLoaded = Asset.ResolveObject() != nullptr;
+		LoadTimes[Index].RequestSeconds = FPlatformTime::Seconds();
+
+		Handles.Add(StreamableManager.RequestAsyncLoad(Asset, FStreamableDelegate::CreateUObject(this, &UFutureNinjaMapTransition::OnAssetLoaded, Index)));
+	}
+
+	for (TSharedPtr<FStreamableHandle>& Handle : PreviousHandles)
+	{
+		if (Handle.IsValid())
+		{
+			Handle->ReleaseHandle();
+		}
+	}
+}
+
+void UFutureNinjaMapTransition::OnAssetLoaded(int32 Index)
+{
+	if (LoadTimes.IsValidIndex(Index))
+	{
+		LoadTimes[Index].LoadMs = (float)((FPlatformTime::Seconds() - LoadTimes[Index].RequestSeconds) * 1000.0);
+	}
+}
+
+void UFutureNinjaMapTransition::OnPostLoadMap(UWorld* World)
+{
+	if (!IsTravelling() || World == nullptr)
+	{
+		return;
+	}
+
+	// PIE worlds are named UEDPIE_<N>_<Map>, and the destination may carry URL options such as ?listen
+	const FString LoadedMap = UWorld::RemovePIEPrefix(World->GetMapName());
+	const FString Destination = FPackageName::GetShortName(FURL(nullptr, *DestinationMap, TRAVEL_Absolute).Map);
+
+	const float Seconds = (float)(FPlatformTime::Seconds() - TravelStartSeconds);
+	if (LoadedMap != Destination)
+	{
+		// The transition map comes up first
+		if (TransitionMapSeconds < 0.f)
+		{
+			TransitionMapSeconds = Seconds;
+		}
+		return;
+	}
+
+	// A headless measurement ends here, so its report is written before the exit instead of in the background
+	const bool bExit = FParse::Param(FCommandLine::Get(), TEXT("ExitAfterTravel"));
+	Report(World, !bExit);
+	DestinationMap.Empty();
+
+	if (bExit)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, 0);
+	}
+}
+
+void UFutureNinjaMapTransition::Report(UWorld* World, bool bAsync)
+{
+	const float TotalSeconds = (float)(FPlatformTime::Seconds() - TravelStartSeconds);
+	UE_LOG(LogMapTransition, Log, TEXT("%s -> %s: transition map after %.3fs, destination after %.3fs"),
+		*SourceMap, *World->GetMapName(), TransitionMapSeconds, TotalSeconds);
+
+	FString Csv = TEXT("Asset,LoadMs,AlreadyLoaded\n");
+	Csv += FString::Printf(TEXT("TransitionMap,%.2f,0\n"), TransitionMapSeconds * 1000.f);
+	Csv += FString::Printf(TEXT("%s,%.2f,0\n"), *DestinationMap, TotalSeconds * 1000.f);
+
+	for (const FAssetLoadTime& LoadTime : LoadTimes)
+	{
+		// An asset still loading after the map is up did not hold the transition up, but it is not ready either
+		if (LoadTime.LoadMs < 0.f)
+		{
+			UE_LOG(LogMapTransition, Warning, TEXT("  %s: still loading"), *LoadTime.Asset.ToString());
+		}
+		else
+		{
+			UE_LOG(LogMapTransition, Log, TEXT("  %s: %.2fms%s"), *LoadTime.Asset.ToString(), LoadTime.LoadMs, LoadTime.bWasLoaded ? TEXT(" (already loaded)") : TEXT(""));
+		}
+		Csv += FString::Printf(TEXT("%s,%.2f,%d\n"), *LoadTime.Asset.ToString(), LoadTime.LoadMs, LoadTime.bWasLoaded ? 1 : 0);
+	}
+
+	if (bWriteReport)
+	{
+		const FString Directory = FPaths::ProfilingDir() / TEXT("MapTransitions");
+		const FString FileName = Directory / FString::Printf(TEXT("%s-%s-%s.csv"), *SourceMap, *World->GetMapName(), *FDateTime::Now().ToString());
+
+		auto WriteReport = [Csv, Directory, FileName]()
+		{
+			FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*Directory);
+			FFileHelper::SaveStringToFile(Csv, *FileName);
+		};
+
+		if (bAsync)
+		{
+			Async<void>(EAsyncExecution::ThreadPool, WriteReport);
+		}
+		else
+		{
+			WriteReport();
+		}
+	}
+}
@@ -0,0 +1,82 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Engine/StreamableManager.h"
+#include "FutureNinjaMapTransition.generated.h"
+
+/**
+ * Moves between maps without blocking on a synchronous load, which in VR freezes the headset.
+ *
+ * TravelTo() starts an async load of every PreloadAssets entry through a streamable manager, one request
+ * per asset so each gets its own load time, then seamless travels to the map: the engine switches to the
+ * small TransitionMap of the project settings right away and loads the destination in the background
+ * while the transition map keeps rendering. The preload handles are held until the next transition so the
+ * assets survive the garbage collection at the map switch.
+ *
+ * When the destination is up, the time to the transition map, the time to the destination and each
+ * asset's load time are logged and, with bWriteReport, written to Saved/Profiling/MapTransitions. For a
+ * headless measurement of a cooked build, run
+ *   FutureNinja -game -nullrhi -unattended -TravelTo=/Game/Programming/Shawn/ShawnVRMap -ExitAfterTravel
+ * The destination and the transition map must be in the packaging settings' maps to cook.
+ */
+UCLASS(config=Game)
+class UFutureNinjaMapTransition : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaMapTransition();
+
+	/** Returns the transition manager, creating it on first use. It lives as long as the engine. */
+	static UFutureNinjaMapTransition& Get();
+
+	/**
+	 * Preloads PreloadAssets and seamless travels World to MapName.
+	 * @returns false if a transition is already running, World may not travel or the travel could not start
+	 */
+	bool TravelTo(UWorld* World, const FString& MapName);
+
+	/** Whether a transition has started and its destination is not up yet. */
+	bool IsTravelling() const { return !DestinationMap.IsEmpty(); }
+
+	/** Assets loaded in the background during every transition: the character, its projectile, fire sound and montage, the enemies. */
+	UPROPERTY(Config, EditAnywhere, Category = Travel)
+	TArray<FStringAssetReference> PreloadAssets;
+
+	/** Write every transition's load times to Saved/Profiling/MapTransitions. */
+	UPROPERTY(Config, EditAnywhere, Category = Travel)
+	uint32 bWriteReport : 1;
+
+private:
+	/** Load time of one preloaded asset. */
+	struct FAssetLoadTime
+	{
+		FStringAssetReference Asset;
+		double RequestSeconds;
+		/** Milliseconds from the request to the callback, negative while loading */
+		float LoadMs;
+		/** Already in memory when requested */
+		bool bWasLoaded;
+	};
+
+	void StartPreload();
+	void OnAssetLoaded(int32 Index);
+	void OnPostLoadMap(UWorld* World);
+
+	/** Logs and writes the load times of the finished transition, on a worker thread if bAsync. */
+	void Report(UWorld* World, bool bAsync);
+
+	FStreamableManager StreamableManager;
+	TArray<TSharedPtr<FStreamableHandle>> Handles;
+	TArray<FAssetLoadTime> LoadTimes;
+
+	/** Map being travelled to, empty when no transition is running */
+	FString DestinationMap;
+	FString SourceMap;
+	double TravelStartSeconds;
+	/** Seconds from TravelTo until the transition map was up, negative until then */
+	float TransitionMapSeconds;
+};
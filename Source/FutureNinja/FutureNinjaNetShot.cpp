@@ -0,0 +1,182 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaNetShot.h"
+#include "FutureNinja.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/CoreNet.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogFutureNinjaNet, Log, All);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net Shots Sent"), STAT_NetShotsSent, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net Shots Received"), STAT_NetShotsReceived, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net Shots Rejected"), STAT_NetShotsRejected, STATGROUP_FutureNinja);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Net Shot Round Trip Ms"), STAT_NetShotRoundTripMs, STATGROUP_FutureNinja);
+
+static TAutoConsoleVariable<float> CVarNetStatsInterval(
+	TEXT("FutureNinja.NetStatsInterval"),
+	5.f,
+	TEXT("Seconds between two logs of shot traffic, connection bandwidth and latency in networked games. 0 disables the log."));
+
+bool FFutureNinjaShot::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	bool bOriginOk = Origin.NetSerialize(Ar, Map, bOutSuccess);
+	bool bDirectionOk = Direction.NetSerialize(Ar, Map, bOutSuccess);
+
+	// Most shots are thrown without hand velocity, so it costs a single bit then
+	uint8 bHasInheritedVelocity = !InheritedVelocity.IsZero();
+	Ar.SerializeBits(&bHasInheritedVelocity, 1);
+	bool bVelocityOk = true;
+	if (bHasInheritedVelocity)
+	{
+		bVelocityOk = InheritedVelocity.NetSerialize(Ar, Map, bOutSuccess);
+	}
+	else if (Ar.IsLoading())
+	{
+		InheritedVelocity = FVector::ZeroVector;
+	}
+
+	uint32 TimestampMs = Ar.IsSaving() ? (uint32)FMath::RoundToInt(FMath::Max(Timestamp, 0.f) * 1000.f) : 0;
+	Ar.SerializeIntPacked(TimestampMs);
+	if (Ar.IsLoading())
+	{
+		Timestamp = TimestampMs / 1000.f;
+	}
+
+	Ar << ShotId;
+
+	uint8 bReject = bRejectIfBlocked;
+	Ar.SerializeBits(&bReject, 1);
+	bRejectIfBlocked = bReject != 0;
+
+	bOutSuccess = bOriginOk && bDirectionOk && bVelocityOk && !Ar.IsError();
+	return true;
+}
+
+int32 FFutureNinjaShot::Quantize()
+{
+	bool bSuccess = false;
+
+	FNetBitWriter Writer(nullptr, 512);
+	NetSerialize(Writer, nullptr, bSuccess);
+
+	FNetBitReader Reader(nullptr, Writer.GetData(), Writer.GetNumBits());
+	NetSerialize(Reader, nullptr, bSuccess);
+
+	return (int32)Writer.GetNumBits();
+}
+
+FFutureNinjaNetStats& FFutureNinjaNetStats::Get(const UWorld* World)
+{
+	static TMap<TWeakObjectPtr<const UWorld>, TUniquePtr<FFutureNinjaNetStats>> WorldStats;
+
+	TUniquePtr<FFutureNinjaNetStats>* Stats = WorldStats.Find(World);
+	if (Stats == nullptr)
+	{
+		// Worlds come and go with map travel and play in editor; drop the counters of the ones gone
+		for (auto It = WorldStats.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().IsValid())
+			{
+				It.RemoveCurrent();
+			}
+		}
+		Stats = &WorldStats.Add(World, TUniquePtr<FFutureNinjaNetStats>(new FFutureNinjaNetStats()));
+	}
+	return **Stats;
+}
+
+FFutureNinjaNetStats::FFutureNinjaNetStats()
+	: ShotsSent(0), ShotsReceived(0), ShotsRejected(0), ShotBits(0), RoundTripSum(0.0), RoundTripMax(0.f), RoundTripCount(0), LastReportTime(0.0)
+{
+}
+
+void FFutureNinjaNetStats::AddShotSent(int32 Bits)
+{
+	++ShotsSent;
+	ShotBits += Bits;
+	INC_DWORD_STAT(STAT_NetShotsSent);
+}
+
+void FFutureNinjaNetStats::AddShotReceived(int32 Bits)
+{
+	++ShotsReceived;
+	ShotBits += Bits;
+	INC_DWORD_STAT(STAT_NetShotsReceived);
+}
+
+void FFutureNinjaNetStats::AddShotRejected()
+{
+	++ShotsRejected;
+	INC_DWORD_STAT(STAT_NetShotsRejected);
+}
+
+void FFutureNinjaNetStats::AddRoundTrip(float Seconds)
+{
+	RoundTripSum += Seconds;
+	RoundTripMax = FMath::Max(RoundTripMax, Seconds);
+	++RoundTripCount;
+	SET_FLOAT_STAT(STAT_NetShotRoundTripMs, Seconds * 1000.f);
+}
+
+void FFutureNinjaNetStats::MaybeReport(UWorld* World)
+{
+	const float Interval = CVarNetStatsInterval.GetValueOnGameThread();
+	if (World == nullptr || Interval <= 0.f || World->GetNetMode() == NM_Standalone || World->GetNetDriver() == nullptr)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (LastReportTime == 0.0)
+	{
+		LastReportTime = Now;
+		return;
+	}
+	const double Elapsed = Now - LastReportTime;
+	if (Elapsed < Interval)
+	{
+		return;
+	}
+
+	// A client has one connection to the server; a server sums over its clients
+	UNetDriver* NetDriver = World->GetNetDriver();
+	int32 InBytesPerSecond = 0;
+	int32 OutBytesPerSecond = 0;
+	double LagSum = 0.0;
+	int32 NumConnections = 0;
+	auto AddConnection = [&](const UNetConnection* Connection)
+	{
+		if (Connection != nullptr)
+		{
+			InBytesPerSecond += Connection->InBytesPerSecond;
+			OutBytesPerSecond += Connection->OutBytesPerSecond;
+			LagSum += Connection->AvgLag;
+			++NumConnections;
+		}
+	};
+	AddConnection(NetDriver->ServerConnection);
+	for (const UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		AddConnection(Connection);
+	}
+
+	UE_LOG(LogFutureNinjaNet, Log, TEXT("%s: %.1f shots/s sent, %.1f received, %d rejected, %.0f shot bytes/s; connections %d in %d B/s out %d B/s, avg lag %.1fms; shot round trip %.1fms avg %.1fms max"),
+		World->GetNetMode() == NM_Client ? TEXT("Client") : TEXT("Server"),
+		ShotsSent / Elapsed, ShotsReceived / Elapsed, ShotsRejected, ShotBits / 8.0 / Elapsed,
+		NumConnections, InBytesPerSecond, OutBytesPerSecond, NumConnections > 0 ? LagSum / NumConnections * 1000.0 : 0.0,
+		RoundTripCount > 0 ? RoundTripSum / RoundTripCount * 1000.0 : 0.0, RoundTripMax * 1000.f);
+
+	ShotsSent = 0;
+	ShotsReceived = 0;
+	ShotsRejected = 0;
+	ShotBits = 0;
+	RoundTripSum = 0.0;
+	RoundTripMax = 0.f;
+	RoundTripCount = 0;
+	LastReportTime = Now;
+}
@@ -0,0 +1,105 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "FutureNinjaNetShot.generated.h"
+
+class UWorld;
+
+/**
+ * Everything another machine needs to fly a kunai: where and when it left the hand, not where it is now.
+ *
+ * Kunai are never replicated as actors. A shot is sent once and every machine simulates its own pooled
+ * projectile from it, so bandwidth grows with the fire rate and not with the number of kunai in flight.
+ */
+USTRUCT()
+struct FFutureNinjaShot
+{
+	GENERATED_BODY()
+
+	/** Launch location, to a tenth of a unit */
+	UPROPERTY()
+	FVector_NetQuantize10 Origin;
+
+	/** Launch direction, 16 bits per component */
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	/** Velocity of the throwing hand added to the launch velocity, to a tenth of a unit per second */
+	UPROPERTY()
+	FVector_NetQuantize10 InheritedVelocity;
+
+	/** Server world time of the launch, sent in whole milliseconds */
+	UPROPERTY()
+	float Timestamp;
+
+	/** Per-character sequence number, to match the server's answer to the predicted kunai */
+	UPROPERTY()
+	uint16 ShotId;
+
+	/** Drop the shot if the origin is inside blocking geometry */
+	UPROPERTY()
+	bool bRejectIfBlocked;
+
+	FFutureNinjaShot()
+		: Origin(FVector::ZeroVector), Direction(FVector::ForwardVector), InheritedVelocity(FVector::ZeroVector), Timestamp(0.f), ShotId(0), bRejectIfBlocked(false)
+	{}
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	/**
+	 * Rounds every field the way sending it would, so the shooter flies exactly what everyone else receives.
+	 * @returns the size of the shot on the wire, in bits
+	 */
+	int32 Quantize();
+};
+
+template<>
+struct TStructOpsTypeTraits<FFutureNinjaShot> : public TStructOpsTypeTraitsBase2<FFutureNinjaShot>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/**
+ * Running shot and connection counters for co-op sessions, logged every FutureNinja.NetStatsInterval
+ * seconds and exposed as stats. There is one set of counters per world, so a listen server, its clients
+ * and play-in-editor instances sharing a process each report their own traffic. Game thread only.
+ *
+ * To measure on loopback, run a server and a client as two processes:
+ *   UE4Editor FutureNinja.uproject /Game/Programming/Keil/KeilMap -server -log
+ *   UE4Editor FutureNinja.uproject 127.0.0.1 -game -log -ExecCmds="NetEmulation.PktLag 100"
+ * or play in editor with two players and a dedicated server.
+ */
+class FFutureNinjaNetStats
+{
+public:
+	/** Returns the counters of World, creating them on first use. */
+	static FFutureNinjaNetStats& Get(const UWorld* World);
+
+	void AddShotSent(int32 Bits);
+	void AddShotReceived(int32 Bits);
+	void AddShotRejected();
+
+	/** Records the time between sending a shot and the server's answer. */
+	void AddRoundTrip(float Seconds);
+
+	/** Logs and resets the counters if the report interval elapsed. Does nothing in standalone games. */
+	void MaybeReport(UWorld* World);
+
+private:
+	FFutureNinjaNetStats();
+
+	int32 ShotsSent;
+	int32 ShotsReceived;
+	int32 ShotsRejected;
+	int64 ShotBits;
+	double RoundTripSum;
+	float RoundTripMax;
+	int32 RoundTripCount;
+	double LastReportTime;
+};
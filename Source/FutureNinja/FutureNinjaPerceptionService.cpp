@@ -0,0 +1,374 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaPerceptionService.h"
+#include "FutureNinja.h"
+#include "FutureNinjaCharacter.h"
+#include "Camera/CameraComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Perception Update"), STAT_PerceptionUpdate, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Perception Traces"), STAT_PerceptionTraces, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Perception Stale"), STAT_PerceptionStale, STATGROUP_FutureNinja);
+
+AFutureNinjaPerceptionService::AFutureNinjaPerceptionService()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	// Submitted before physics so the traces run alongside the rest of the frame
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	MaxSightDistance = 5000.f;
+	SightHalfAngle = 70.f;
+	MaxTracesPerTick = 64;
+	MaxResultAge = 0.5f;
+
+	Cursor = 0;
+}
+
+AFutureNinjaPerceptionService* AFutureNinjaPerceptionService::Get(UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AFutureNinjaPerceptionService> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<AFutureNinjaPerceptionService>(SpawnParams);
+}
+
+void AFutureNinjaPerceptionService::BeginPlay()
+{
+	Super::BeginPlay();
+
+	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	{
+		OnActorSpawned(*It);
+	}
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AFutureNinjaPerceptionService::OnActorSpawned));
+}
+
+void AFutureNinjaPerceptionService::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+
+	Entries.Reset();
+	EntryIndices.Reset();
+	PendingSights.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFutureNinjaPerceptionService::OnActorSpawned(AActor* Actor)
+{
+	// Clients run no behavior trees, so have nothing to answer
+	APawn* Pawn = Cast<APawn>(Actor);
+	if (Pawn != nullptr && Pawn->HasAuthority() && !Pawn->IsA<AFutureNinjaCharacter>() && !Pawn->IsPlayerControlled())
+	{
+		Register(Pawn);
+	}
+}
+
+void AFutureNinjaPerceptionService::Register(APawn* Pawn)
+{
+	if (Pawn == nullptr || EntryIndices.Contains(Pawn))
+	{
+		return;
+	}
+
+	// Due right away; stale until the first trace comes back
+	FEntry Entry;
+	Entry.Pawn = Pawn;
+	Entry.LastSeenLocation = FVector::ZeroVector;
+	Entry.ResultTime = -1.f;
+	Entry.SeenTime = -1.f;
+	Entry.NextCheckTime = 0.f;
+	Entry.bCanSee = false;
+	EntryIndices.Add(Entry.Pawn, Entries.Add(Entry));
+}
+
+void AFutureNinjaPerceptionService::Unregister(APawn* Pawn)
+{
+	const int32* Index = EntryIndices.Find(Pawn);
+	if (Index != nullptr)
+	{
+		RemoveEntry(*Index);
+	}
+}
+
+void AFutureNinjaPerceptionService::RemoveEntry(int32 Index)
+{
+	EntryIndices.Remove(Entries[Index].Pawn);
+	Entries.RemoveAtSwap(Index, 1, false);
+
+	// The last entry moved into the slot
+	if (Index < Entries.Num())
+	{
+		EntryIndices.Add(Entries[Index].Pawn, Index);
+	}
+}
+
+bool AFutureNinjaPerceptionService::GetSight(const APawn* Enemy, FFutureNinjaSightResult& OutResult) const
+{
+	const int32* Index = EntryIndices.Find(const_cast<APawn*>(Enemy));
+	if (Index == nullptr)
+	{
+		return false;
+	}
+
+	const FEntry& Entry = Entries[*Index];
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	OutResult.bCanSeePlayer = Entry.bCanSee;
+	OutResult.LastSeenLocation = Entry.LastSeenLocation;
+	OutResult.Age = Entry.ResultTime >= 0.f ? Now - Entry.ResultTime : 0.f;
+	OutResult.TimeSinceSeen = Entry.SeenTime >= 0.f ? Now - Entry.SeenTime : -1.f;
+	OutResult.bStale = Entry.ResultTime < 0.f || OutResult.Age > MaxResultAge;
+	return true;
+}
+
+void AFutureNinjaPerceptionService::RequestUpdate(const APawn* Enemy)
+{
+	const int32* Index = EntryIndices.Find(const_cast<APawn*>(Enemy));
+	if (Index != nullptr)
+	{
+		Entries[*Index].NextCheckTime = 0.f;
+	}
+}
+
+bool AFutureNinjaPerceptionService::CanSeePlayer(APawn* Enemy, FVector& LastSeenLocation)
+{
+	AFutureNinjaPerceptionService* Service = Enemy != nullptr ? Get(Enemy->GetWorld()) : nullptr;
+	if (Service == nullptr)
+	{
+		return false;
+	}
+
+	// Pawns spawned before the service existed are picked up on first use
+	Service->Register(Enemy);
+
+	FFutureNinjaSightResult Result;
+	Service->GetSight(Enemy, Result);
+	LastSeenLocation = Result.LastSeenLocation;
+	return Result.bCanSeePlayer;
+}
+
+void AFutureNinjaPerceptionService::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_PerceptionUpdate);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	HarvestSights(Now);
+	SubmitSights(Now);
+
+	int32 NumStale = 0;
+	for (const FEntry& Entry : Entries)
+	{
+		if (Entry.ResultTime < 0.f || Now - Entry.ResultTime > MaxResultAge)
+		{
+			++NumStale;
+		}
+	}
+	SET_DWORD_STAT(STAT_PerceptionStale, NumStale);
+}
+
+void AFutureNinjaPerceptionService::HarvestSights(float Now)
+{
+	UWorld* const World = GetWorld();
+
+	FTraceDatum Datum;
+	for (const FPendingSight& Sight : PendingSights)
+	{
+		const int32* Index = EntryIndices.Find(Sight.Pawn);
+		if (Index == nullptr)
+		{
+			continue;
+		}
+
+		if (!World->QueryTraceData(Sight.Handle, Datum))
+		{
+			// Lost with the world's async work; check again this tick
+			Entries[*Index].NextCheckTime = 0.f;
+			continue;
+		}
+
+		const bool bBlocked = Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit;
+		SetResult(*Index, !bBlocked, Sight.Target, Now);
+	}
+	PendingSights.Reset();
+}
+
+void AFutureNinjaPerceptionService::SubmitSights(float Now)
+{
+	GatherPlayerViews();
+	if (Entries.Num() == 0 || PlayerViews.Num() == 0)
+	{
+		SET_DWORD_STAT(STAT_PerceptionTraces, 0);
+		return;
+	}
+
+	UWorld* const World = GetWorld();
+	const float MaxDistanceSquared = FMath::Square(MaxSightDistance);
+	const float MinConeDot = SightHalfAngle >= 180.f ? -1.f : FMath::Cos(FMath::DegreesToRadians(SightHalfAngle));
+
+	FCollisionQueryParams Params(FName(TEXT("PerceptionSight")), false);
+
+	int32 NumTraces = 0;
+	int32 NumVisited = 0;
+	while (NumVisited < Entries.Num())
+	{
+		if (Cursor >= Entries.Num())
+		{
+			Cursor = 0;
+		}
+
+		FEntry& Entry = Entries[Cursor];
+		APawn* Pawn = Entry.Pawn.Get();
+		if (Pawn == nullptr || Pawn->IsPendingKill() || Pawn->IsPlayerControlled())
+		{
+			// The swapped in entry takes this slot and is visited next
+			RemoveEntry(Cursor);
+			continue;
+		}
+
+		// Pooled by the wave director, or checked recently enough for its tier
+		if (Pawn->bHidden || Now < Entry.NextCheckTime)
+		{
+			++Cursor;
+			++NumVisited;
+			continue;
+		}
+
+		FVector Eye;
+		FRotator EyeRotation;
+		Pawn->GetActorEyesViewPoint(Eye, EyeRotation);
+		const FVector Facing = EyeRotation.Vector();
+
+		// The nearest player in range and in the cone is the one looked for; the nearest of all sets the tier
+		const FPlayerView* Nearest = nullptr;
+		const FPlayerView* Sighted = nullptr;
+		float NearestDistanceSquared = MAX_flt;
+		float SightedDistanceSquared = MAX_flt;
+		for (const FPlayerView& View : PlayerViews)
+		{
+			const FVector ToTarget = View.Location - Eye;
+			const float DistanceSquared = ToTarget.SizeSquared();
+			if (DistanceSquared < NearestDistanceSquared)
+			{
+				Nearest = &View;
+				NearestDistanceSquared = DistanceSquared;
+			}
+
+			const bool bOutOfRange = DistanceSquared > MaxDistanceSquared;
+			const bool bOutOfCone = MinConeDot > -1.f && (ToTarget.GetSafeNormal() | Facing) < MinConeDot;
+			if (!bOutOfRange && !bOutOfCone && DistanceSquared < SightedDistanceSquared)
+			{
+				Sighted = &View;
+				SightedDistanceSquared = DistanceSquared;
+			}
+		}
+
+		if (Sighted != nullptr)
+		{
+			// Out of budget: this entry goes first on the next tick
+			if (NumTraces >= MaxTracesPerTick)
+			{
+				break;
+			}
+
+			FPendingSight Sight;
+			Sight.Pawn = Entry.Pawn;
+			Sight.Target = Sighted->Location;
+			Params.ClearIgnoredActors();
+			Params.AddIgnoredActor(Sighted->Pawn);
+			Params.AddIgnoredActor(Pawn);
+			Sight.Handle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Eye, Sighted->Location, ECC_Visibility, Params);
+			PendingSights.Add(Sight);
+			++NumTraces;
+		}
+		else
+		{
+			SetResult(Cursor, false, Nearest->Location, Now);
+		}
+
+		Entry.NextCheckTime = Now + GetUpdateInterval(FMath::Sqrt(NearestDistanceSquared));
+		++Cursor;
+		++NumVisited;
+	}
+
+	SET_DWORD_STAT(STAT_PerceptionTraces, NumTraces);
+}
+
+void AFutureNinjaPerceptionService::SetResult(int32 Index, bool bCanSee, const FVector& Target, float Now)
+{
+	FEntry& Entry = Entries[Index];
+	Entry.bCanSee = bCanSee;
+	Entry.ResultTime = Now;
+	if (bCanSee)
+	{
+		Entry.LastSeenLocation = Target;
+		Entry.SeenTime = Now;
+	}
+}
+
+float AFutureNinjaPerceptionService::GetUpdateInterval(float Distance) const
+{
+	for (const FFutureNinjaPerceptionTier& Tier : Tiers)
+	{
+		if (Distance <= Tier.MaxDistance)
+		{
+			return Tier.UpdateInterval;
+		}
+	}
+	return Tiers.Num() > 0 ? Tiers.Last().UpdateInterval : 0.f;
+}
+
+void AFutureNinjaPerceptionService::GatherPlayerViews()
+{
+	PlayerViews.Reset();
+
+	// Every player's controller exists where enemies have authority, remote ones included
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		APawn* PlayerPawn = PlayerController != nullptr ? PlayerController->GetPawn() : nullptr;
+		if (PlayerPawn == nullptr)
+		{
+			continue;
+		}
+
+		FPlayerView View;
+		View.Pawn = PlayerPawn;
+
+		const AFutureNinjaCharacter* Character = Cast<AFutureNinjaCharacter>(PlayerPawn);
+		if (Character != nullptr && Character->GetFirstPersonCameraComponent() != nullptr)
+		{
+			View.Location = Character->GetFirstPersonCameraComponent()->GetComponentLocation();
+		}
+		else if (PlayerController->PlayerCameraManager != nullptr)
+		{
+			View.Location = PlayerController->PlayerCameraManager->GetCameraLocation();
+		}
+		else
+		{
+			continue;
+		}
+
+		PlayerViews.Add(View);
+	}
+}
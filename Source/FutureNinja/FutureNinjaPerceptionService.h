@@ -0,0 +1,196 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "WorldCollision.h"
+#include "FutureNinjaPerceptionService.generated.h"
+
+/** What an enemy last made out of the player. */
+USTRUCT(BlueprintType)
+struct FFutureNinjaSightResult
+{
+	GENERATED_BODY()
+
+	/** Whether the player's camera was in sight at the last check. */
+	UPROPERTY(BlueprintReadOnly, Category = Perception)
+	bool bCanSeePlayer;
+
+	/** Where the player's camera was the last time it was in sight. */
+	UPROPERTY(BlueprintReadOnly, Category = Perception)
+	FVector LastSeenLocation;
+
+	/** Seconds since the last check. */
+	UPROPERTY(BlueprintReadOnly, Category = Perception)
+	float Age;
+
+	/** Seconds since the player was last in sight, negative if never. */
+	UPROPERTY(BlueprintReadOnly, Category = Perception)
+	float TimeSinceSeen;
+
+	/** Whether the result is older than the service's MaxResultAge, or there is none yet. */
+	UPROPERTY(BlueprintReadOnly, Category = Perception)
+	bool bStale;
+
+	FFutureNinjaSightResult()
+		: bCanSeePlayer(false), LastSeenLocation(FVector::ZeroVector), Age(0.f), TimeSinceSeen(-1.f), bStale(true)
+	{}
+};
+
+/** How often enemies up to some distance from the player check their sight. */
+USTRUCT()
+struct FFutureNinjaPerceptionTier
+{
+	GENERATED_BODY()
+
+	/** Enemies up to this far from the player's camera use this tier. */
+	UPROPERTY(EditAnywhere, Category = Perception)
+	float MaxDistance;
+
+	/** Seconds between two checks. */
+	UPROPERTY(EditAnywhere, Category = Perception)
+	float UpdateInterval;
+
+	FFutureNinjaPerceptionTier()
+		: MaxDistance(0.f), UpdateInterval(0.f)
+	{}
+};
+
+/**
+ * Answers "can this enemy see the player" for every enemy at once, instead of each behavior tree tracing
+ * its own line to the player.
+ *
+ * Every tick the enemies due for a check are gathered and their sight lines from the eyes to the first
+ * person camera are submitted together through the async trace API, which runs them in parallel on task
+ * graph worker threads while the frame goes on; the results are read back on the next tick. How often an
+ * enemy is due depends on the Tiers entry its distance falls in, and no more than MaxTracesPerTick lines
+ * are submitted per tick, the enemies left over going first on the next one. Enemies beyond
+ * MaxSightDistance or facing away are answered without a trace.
+ *
+ * With several players, each enemy looks for the nearest player within range and its field of view, and
+ * its tier is set by the nearest player overall.
+ *
+ * Results are kept per enemy and read with GetSight(), CanSeePlayer() from Blueprint tasks or the
+ * UFutureNinjaBTService_Sight behavior tree service, which copies them to blackboard keys. Each result
+ * carries its age, so callers decide how stale is too stale.
+ *
+ * Every non-player pawn spawned into the world with authority is tracked. One service exists per world;
+ * use Get() to find or create it.
+ */
+UCLASS(config=Game, notplaceable)
+class AFutureNinjaPerceptionService : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFutureNinjaPerceptionService();
+
+	/** Returns the service for World, spawning it on first use. */
+	static AFutureNinjaPerceptionService* Get(UWorld* World);
+
+	/** Starts tracking Pawn. Pawns are registered automatically when spawned. */
+	void Register(APawn* Pawn);
+
+	/** Stops tracking Pawn. */
+	void Unregister(APawn* Pawn);
+
+	/**
+	 * Reads what Enemy last made out of the player.
+	 * @returns false if Enemy is not tracked
+	 */
+	bool GetSight(const APawn* Enemy, FFutureNinjaSightResult& OutResult) const;
+
+	/** Checks Enemy's sight on the next tick, whatever its tier. */
+	void RequestUpdate(const APawn* Enemy);
+
+	/** Whether Enemy could see the player at its last check, and where the player was last seen. */
+	UFUNCTION(BlueprintPure, Category = Perception, meta = (DefaultToSelf = "Enemy"))
+	static bool CanSeePlayer(APawn* Enemy, FVector& LastSeenLocation);
+
+	/** Update rate by distance, nearest first. Enemies beyond the last tier use its rate. */
+	UPROPERTY(Config, EditAnywhere, Category = Perception)
+	TArray<FFutureNinjaPerceptionTier> Tiers;
+
+	/** Enemies further than this from the player never see it. */
+	UPROPERTY(Config, EditAnywhere, Category = Perception)
+	float MaxSightDistance;
+
+	/** Half angle of the enemies' field of view, in degrees; players outside it are not seen without a trace. 180 sees all around. */
+	UPROPERTY(Config, EditAnywhere, Category = Perception)
+	float SightHalfAngle;
+
+	/** Most sight lines submitted per tick. */
+	UPROPERTY(Config, EditAnywhere, Category = Perception, meta = (ClampMin = "1"))
+	int32 MaxTracesPerTick;
+
+	/** Results older than this are reported as stale. */
+	UPROPERTY(Config, EditAnywhere, Category = Perception)
+	float MaxResultAge;
+
+	// AActor interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+	// End of AActor interface
+
+private:
+	struct FEntry
+	{
+		TWeakObjectPtr<APawn> Pawn;
+		FVector LastSeenLocation;
+		/** World time of the last result, negative before the first */
+		float ResultTime;
+		/** World time the player was last in sight, negative if never */
+		float SeenTime;
+		float NextCheckTime;
+		bool bCanSee;
+	};
+
+	/** Where a player's camera is this tick */
+	struct FPlayerView
+	{
+		FVector Location;
+		APawn* Pawn;
+	};
+
+	/** A sight line submitted last tick */
+	struct FPendingSight
+	{
+		FTraceHandle Handle;
+		TWeakObjectPtr<APawn> Pawn;
+		FVector Target;
+	};
+
+	/** Reads back last tick's sight lines into the entries. */
+	void HarvestSights(float Now);
+
+	/** Submits the sight lines of the entries that are due, up to MaxTracesPerTick. */
+	void SubmitSights(float Now);
+
+	/** Records a result for the entry at Index. */
+	void SetResult(int32 Index, bool bCanSee, const FVector& Target, float Now);
+
+	/** Finds the first person camera of every player, what the enemies look for. */
+	void GatherPlayerViews();
+
+	/** Seconds between checks for an enemy Distance away from the player. */
+	float GetUpdateInterval(float Distance) const;
+
+	void RemoveEntry(int32 Index);
+
+	void OnActorSpawned(AActor* Actor);
+
+	TArray<FEntry> Entries;
+	TMap<TWeakObjectPtr<APawn>, int32> EntryIndices;
+
+	/** Entry the next submission pass starts at, so enemies left over by the budget go first */
+	int32 Cursor;
+
+	TArray<FPendingSight> PendingSights;
+
+	/** Gathered at the start of every submission pass */
+	TArray<FPlayerView> PlayerViews;
+
+	FDelegateHandle ActorSpawnedHandle;
+};
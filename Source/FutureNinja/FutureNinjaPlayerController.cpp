@@ -0,0 +1,23 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaPlayerController.h"
+#include "FutureNinja.h"
+#include "FutureNinjaCharacterInputComponent.h"
+#include "GameFramework/Pawn.h"
+
+void AFutureNinjaPlayerController::PostProcessInput(const float DeltaTime, const bool bGamePaused)
+{
+	Super::PostProcessInput(DeltaTime, bGamePaused);
+
+	// A paused pawn does not move; its input waits for the first frame after the pause
+	APawn* ControlledPawn = GetPawn();
+	if (bGamePaused || ControlledPawn == nullptr)
+	{
+		return;
+	}
+
+	if (UFutureNinjaCharacterInputComponent* CharacterInput = ControlledPawn->FindComponentByClass<UFutureNinjaCharacterInputComponent>())
+	{
+		CharacterInput->RunInputPass(DeltaTime);
+	}
+}
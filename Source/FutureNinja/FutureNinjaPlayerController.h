@@ -0,0 +1,26 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerController.h"
+#include "FutureNinjaPlayerController.generated.h"
+
+/**
+ * Applies the possessed character's input in the pass it arrives in.
+ *
+ * Character bindings only gather input into a UFutureNinjaCharacterInputComponent. Once the input stack is
+ * processed, this runs the component's input pass, before the controller turns the view in UpdateRotation
+ * and before the pawn and its movement component tick, which depend on the controller's tick. Look input
+ * therefore turns this frame's view and movement input is consumed by this frame's movement.
+ */
+UCLASS()
+class AFutureNinjaPlayerController : public APlayerController
+{
+	GENERATED_BODY()
+
+public:
+	// APlayerController interface
+	virtual void PostProcessInput(const float DeltaTime, const bool bGamePaused) override;
+	// End of APlayerController interface
+};
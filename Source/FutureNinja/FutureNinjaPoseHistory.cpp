@@ -0,0 +1,161 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaPoseHistory.h"
+#include "HAL/PlatformAtomics.h"
+#include "HAL/PlatformMisc.h"
+
+/** Samples looked at when interpolating or fitting; a few frames of history is all a throw needs */
+static const int32 MaxQuerySamples = 32;
+
+FFutureNinjaPoseHistory::FFutureNinjaPoseHistory()
+	: WriteCount(0)
+{
+	for (FSlot& Slot : Slots)
+	{
+		Slot.Sequence = 0;
+	}
+}
+
+void FFutureNinjaPoseHistory::Push(const FFutureNinjaPoseSample& Sample)
+{
+	FSlot& Slot = Slots[WriteCount % Capacity];
+
+	// Odd while the slot is being written; the interlocked operations double as full barriers
+	FPlatformAtomics::InterlockedIncrement(&Slot.Sequence);
+	Slot.Sample = Sample;
+	FPlatformAtomics::InterlockedIncrement(&Slot.Sequence);
+
+	FPlatformAtomics::InterlockedIncrement(&WriteCount);
+}
+
+int32 FFutureNinjaPoseHistory::CopyRecent(FFutureNinjaPoseSample* OutSamples, int32 MaxSamples) const
+{
+	const int32 Written = FPlatformAtomics::InterlockedAdd(const_cast<volatile int32*>(&WriteCount), 0);
+	const int32 Available = FMath::Min3(Written, Capacity, MaxSamples);
+
+	int32 NumCopied = 0;
+	for (int32 Age = 0; Age < Available; ++Age)
+	{
+		const FSlot& Slot = Slots[(Written - 1 - Age) % Capacity];
+
+		const int32 SequenceBefore = FPlatformAtomics::InterlockedAdd(const_cast<volatile int32*>(&Slot.Sequence), 0);
+		if (SequenceBefore & 1)
+		{
+			break;
+		}
+
+		OutSamples[NumCopied] = Slot.Sample;
+		FPlatformMisc::MemoryBarrier();
+
+		// The slot was written during the copy; this slot and everything older now holds newer data
+		if (FPlatformAtomics::InterlockedAdd(const_cast<volatile int32*>(&Slot.Sequence), 0) != SequenceBefore)
+		{
+			break;
+		}
+
+		// The writer may also have rewritten the slot between reading Written and the copy, which the sequence
+		// does not show; write Written - 1 - Age + Capacity starts on this slot once WriteCount reaches it
+		const int32 WrittenSince = FPlatformAtomics::InterlockedAdd(const_cast<volatile int32*>(&WriteCount), 0) - Written;
+		if (WrittenSince >= Capacity - 1 - Age)
+		{
+			break;
+		}
+		++NumCopied;
+	}
+	return NumCopied;
+}
+
+bool FFutureNinjaPoseHistory::GetPoseAtTime(double Time, float MaxExtrapolation, float VelocityWindow, FFutureNinjaPoseSample& OutPose) const
+{
+	FFutureNinjaPoseSample Samples[MaxQuerySamples];
+	const int32 NumSamples = CopyRecent(Samples, MaxQuerySamples);
+	if (NumSamples == 0)
+	{
+		return false;
+	}
+
+	const FFutureNinjaPoseSample& Newest = Samples[0];
+	if (Time >= Newest.Time)
+	{
+		// Latency compensation: carry the newest pose forward along the recent hand motion
+		FVector Velocity;
+		const float Ahead = FMath::Min((float)(Time - Newest.Time), MaxExtrapolation);
+		OutPose = Newest;
+		OutPose.Time = Time;
+		if (FitVelocity(Samples, NumSamples, VelocityWindow, Velocity))
+		{
+			OutPose.Position += Velocity * Ahead;
+		}
+		return true;
+	}
+
+	for (int32 Index = 1; Index < NumSamples; ++Index)
+	{
+		const FFutureNinjaPoseSample& Older = Samples[Index];
+		if (Older.Time <= Time)
+		{
+			const FFutureNinjaPoseSample& Newer = Samples[Index - 1];
+			const double Span = Newer.Time - Older.Time;
+			const float Alpha = Span > 0.0 ? (float)((Time - Older.Time) / Span) : 1.f;
+
+			OutPose.Time = Time;
+			OutPose.Position = FMath::Lerp(Older.Position, Newer.Position, Alpha);
+			OutPose.Orientation = FQuat::Slerp(Older.Orientation, Newer.Orientation, Alpha);
+			return true;
+		}
+	}
+
+	// Older than anything we still have
+	OutPose = Samples[NumSamples - 1];
+	return true;
+}
+
+bool FFutureNinjaPoseHistory::EstimateVelocity(float Window, FVector& OutVelocity) const
+{
+	FFutureNinjaPoseSample Samples[MaxQuerySamples];
+	const int32 NumSamples = CopyRecent(Samples, MaxQuerySamples);
+	return FitVelocity(Samples, NumSamples, Window, OutVelocity);
+}
+
+bool FFutureNinjaPoseHistory::FitVelocity(const FFutureNinjaPoseSample* Samples, int32 NumSamples, float Window, FVector& OutVelocity)
+{
+	if (NumSamples < 2)
+	{
+		return false;
+	}
+
+	// Least-squares slope of position over time, relative to the newest sample to keep the sums small
+	const double NewestTime = Samples[0].Time;
+	const FVector NewestPosition = Samples[0].Position;
+
+	float SumT = 0.f;
+	float SumTT = 0.f;
+	FVector SumP = FVector::ZeroVector;
+	FVector SumTP = FVector::ZeroVector;
+	int32 Count = 0;
+
+	for (int32 Index = 0; Index < NumSamples; ++Index)
+	{
+		const float T = (float)(Samples[Index].Time - NewestTime);
+		if (-T > Window && Count >= 2)
+		{
+			break;
+		}
+
+		const FVector P = Samples[Index].Position - NewestPosition;
+		SumT += T;
+		SumTT += T * T;
+		SumP += P;
+		SumTP += P * T;
+		++Count;
+	}
+
+	const float Denominator = Count * SumTT - SumT * SumT;
+	if (Count < 2 || FMath::IsNearlyZero(Denominator))
+	{
+		return false;
+	}
+
+	OutVelocity = (SumTP * Count - SumP * SumT) / Denominator;
+	return true;
+}
@@ -0,0 +1,73 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** One timestamped tracking-space pose of a tracked device. */
+struct FFutureNinjaPoseSample
+{
+	/** FPlatformTime::Seconds() at which the device was polled */
+	double Time;
+	FVector Position;
+	FQuat Orientation;
+
+	FFutureNinjaPoseSample()
+		: Time(0.0), Position(FVector::ZeroVector), Orientation(FQuat::Identity)
+	{}
+};
+
+/**
+ * Fixed-size history of device poses with one writer and any number of readers, none of which lock.
+ *
+ * Every slot is guarded by a sequence counter that is odd while the writer fills it. A reader copies
+ * the slot and then checks that the counter did not move, and that the write count has not reached the
+ * write that reuses the slot; otherwise the writer lapped the reader and every older slot is stale too. This lets the render thread push late-update samples while the game
+ * thread queries the history at fire time.
+ */
+class FFutureNinjaPoseHistory
+{
+public:
+	/** Number of samples kept; at one sample per rendered frame this covers over a second at 90 Hz */
+	static const int32 Capacity = 128;
+
+	FFutureNinjaPoseHistory();
+
+	/** Appends a sample. Only one thread may write. */
+	void Push(const FFutureNinjaPoseSample& Sample);
+
+	/**
+	 * Copies up to MaxSamples of the most recent samples into OutSamples, newest first.
+	 * @returns the number of samples copied
+	 */
+	int32 CopyRecent(FFutureNinjaPoseSample* OutSamples, int32 MaxSamples) const;
+
+	/**
+	 * Returns the pose at Time, interpolated between samples or extrapolated past the newest one.
+	 * @param MaxExtrapolation	Furthest, in seconds, to extrapolate past the newest sample
+	 * @param VelocityWindow	Window, in seconds, of samples the extrapolation velocity is fitted over
+	 * @returns false if the history is empty
+	 */
+	bool GetPoseAtTime(double Time, float MaxExtrapolation, float VelocityWindow, FFutureNinjaPoseSample& OutPose) const;
+
+	/**
+	 * Fits a line through the positions of the last Window seconds of samples.
+	 * @returns false if fewer than two samples fall in the window
+	 */
+	bool EstimateVelocity(float Window, FVector& OutVelocity) const;
+
+private:
+	struct FSlot
+	{
+		volatile int32 Sequence;
+		FFutureNinjaPoseSample Sample;
+	};
+
+	/** Velocity fit over already copied samples, newest first. */
+	static bool FitVelocity(const FFutureNinjaPoseSample* Samples, int32 NumSamples, float Window, FVector& OutVelocity);
+
+	FSlot Slots[Capacity];
+
+	/** Total number of samples ever pushed */
+	volatile int32 WriteCount;
+};
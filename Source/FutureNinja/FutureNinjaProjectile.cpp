@@ -1,8 +1,19 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
 #include "FutureNinjaProjectile.h"
+#include "FutureNinjaCharacter.h"
+#include "FutureNinjaHitchDetector.h"
+#include "FutureNinjaProjectileManager.h"
+#include "FutureNinjaProjectilePool.h"
+#include "FutureNinjaStatsService.h"
+#include "FutureNinjaTelemetry.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Components/SphereComponent.h"
+#include "Engine/World.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Hit"), STAT_ProjectileHit, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Projectile Impulse"), STAT_ProjectileImpulse, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Projectile Release"), STAT_ProjectileRelease, STATGROUP_FutureNinja);
 
 AFutureNinjaProjectile::AFutureNinjaProjectile() 
 {
@@ -29,15 +40,187 @@ AFutureNinjaProjectile::AFutureNinjaProjectile()
 
 	// Die after 3 seconds by default
 	InitialLifeSpan = 3.0f;
+
+	// Only ticks to step the movement while fixed stepping is on
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	PooledCollisionEnabled = ECollisionEnabled::QueryOnly;
+	NetShotId = 0;
+}
+
+void AFutureNinjaProjectile::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Remember the collision the blueprint asked for, so leaving the pool restores it exactly
+	PooledCollisionEnabled = CollisionComp->GetCollisionEnabled();
+}
+
+void AFutureNinjaProjectile::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UpdateStepMode();
+}
+
+void AFutureNinjaProjectile::UpdateStepMode()
+{
+	const bool bFixedStep = FFutureNinjaFixedStep::GetStepSeconds() > 0.f;
+	FixedStep.Accumulator = 0.0;
+	SetActorTickEnabled(bFixedStep && ProjectileMovement->IsActive());
+	ProjectileMovement->SetComponentTickEnabled(!bFixedStep && ProjectileMovement->IsActive());
+}
+
+void AFutureNinjaProjectile::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	const float StepSeconds = FFutureNinjaFixedStep::GetStepSeconds();
+	if (StepSeconds <= 0.f)
+	{
+		UpdateStepMode();
+		ProjectileMovement->TickComponent(DeltaSeconds, LEVELTICK_All, nullptr);
+		return;
+	}
+
+	// A hit can release the projectile mid-frame, which stops the movement
+	const int32 NumSteps = FixedStep.Advance(DeltaSeconds, StepSeconds);
+	for (int32 Step = 0; Step < NumSteps && ProjectileMovement->IsActive() && !bHidden; ++Step)
+	{
+		ProjectileMovement->TickComponent(StepSeconds, LEVELTICK_All, nullptr);
+	}
+}
+
+void AFutureNinjaProjectile::FastForward(float Seconds)
+{
+	if (Seconds > 0.f && ProjectileMovement->IsActive())
+	{
+		// The movement component substeps long deltas itself, so bounces along the way still happen
+		ProjectileMovement->TickComponent(Seconds, LEVELTICK_All, nullptr);
+		SetLifeSpan(FMath::Max(GetLifeSpan() - Seconds, KINDA_SMALL_NUMBER));
+	}
+}
+
+void AFutureNinjaProjectile::LifeSpanExpired()
+{
+	Release();
 }
 
 void AFutureNinjaProjectile::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
+	FUTURENINJA_SCOPE_STEP(EFutureNinjaStep::Hit, STAT_ProjectileHit);
+
+	FFutureNinjaTelemetry::Record(EFutureNinjaTelemetryEvent::Hit, Hit.ImpactPoint);
+
+	if (AFutureNinjaProjectileManager::WantsImpactMarks() && GetNetMode() != NM_DedicatedServer)
+	{
+		AFutureNinjaProjectileManager::Get(GetWorld())->AddImpactMark(Hit);
+	}
+
+	if (OtherActor != NULL && OtherActor != this)
+	{
+		APawn* OtherPawn = Cast<APawn>(OtherActor);
+		const bool bHitEnemy = OtherPawn != NULL && !OtherPawn->IsA<AFutureNinjaCharacter>() && !OtherPawn->IsPlayerControlled();
+		if (bHitEnemy || (OtherComp != NULL && OtherComp->IsSimulatingPhysics()))
+		{
+			if (AFutureNinjaStatsService* StatsService = AFutureNinjaStatsService::Find(GetWorld()))
+			{
+				if (bHitEnemy)
+				{
+					StatsService->AddEnemyHit(OtherPawn);
+				}
+				else
+				{
+					StatsService->PushEvent(EFutureNinjaStatEvent::Hit);
+				}
+			}
+		}
+	}
+
 	// Only add impulse and destroy projectile if we hit a physics
 	if ((OtherActor != NULL) && (OtherActor != this) && (OtherComp != NULL) && OtherComp->IsSimulatingPhysics())
 	{
-		OtherComp->AddImpulseAtLocation(GetVelocity() * 100.0f, GetActorLocation());
+		{
+			FUTURENINJA_SCOPE_STEP(EFutureNinjaStep::Impulse, STAT_ProjectileImpulse);
+			OtherComp->AddImpulseAtLocation(GetVelocity() * 100.0f, GetActorLocation());
+		}
 
+		Release();
+	}
+}
+
+void AFutureNinjaProjectile::Release()
+{
+	FUTURENINJA_SCOPE_STEP(EFutureNinjaStep::Destroy, STAT_ProjectileRelease);
+
+	if (OwningPool.IsValid())
+	{
+		OwningPool->Release(this);
+	}
+	else
+	{
 		Destroy();
 	}
+}
+
+bool AFutureNinjaProjectile::ActivateFromPool(const FVector& Location, const FRotator& Rotation, ESpawnActorCollisionHandlingMethod CollisionHandling, const FVector& InheritedVelocity)
+{
+	UWorld* const World = GetWorld();
+	FVector ActivateLocation = Location;
+
+	// Resolve the spawn location the same way SpawnActor would, but against this actor's own collision
+	CollisionComp->SetCollisionEnabled(PooledCollisionEnabled);
+	switch (CollisionHandling)
+	{
+	case ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn:
+		World->FindTeleportSpot(this, ActivateLocation, Rotation);
+		break;
+	case ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding:
+		if (!World->FindTeleportSpot(this, ActivateLocation, Rotation))
+		{
+			CollisionComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			return false;
+		}
+		break;
+	case ESpawnActorCollisionHandlingMethod::DontSpawnIfColliding:
+		if (World->EncroachingBlockingGeometry(this, ActivateLocation, Rotation))
+		{
+			CollisionComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			return false;
+		}
+		break;
+	default:
+		break;
+	}
+
+	SetActorLocationAndRotation(ActivateLocation, Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+	SetActorHiddenInGame(false);
+
+	// The movement component drops its updated component when it stops simulating, so hook it back up
+	ProjectileMovement->SetUpdatedComponent(CollisionComp);
+	ProjectileMovement->SetVelocityInLocalSpace(FVector(ProjectileMovement->InitialSpeed, 0.f, 0.f));
+	if (!InheritedVelocity.IsZero())
+	{
+		ProjectileMovement->Velocity += InheritedVelocity;
+		ProjectileMovement->UpdateComponentVelocity();
+	}
+	ProjectileMovement->Activate(true);
+	UpdateStepMode();
+
+	NetShotId = 0;
+	SetLifeSpan(InitialLifeSpan);
+	return true;
+}
+
+void AFutureNinjaProjectile::DeactivateToPool()
+{
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->Deactivate();
+	SetActorTickEnabled(false);
+	CollisionComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetActorHiddenInGame(true);
+
+	// Clears the pending lifespan timer
+	SetLifeSpan(0.f);
 }
\ No newline at end of file
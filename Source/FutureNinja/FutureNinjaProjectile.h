@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "FutureNinjaFixedStep.h"
 #include "FutureNinjaProjectile.generated.h"
 
 UCLASS(config=Game)
@@ -19,13 +20,51 @@ class AFutureNinjaProjectile : public AActor
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Movement, meta = (AllowPrivateAccess = "true"))
 	class UProjectileMovementComponent* ProjectileMovement;
 
+	/** Collision setting of CollisionComp to restore when leaving the pool */
+	TEnumAsByte<ECollisionEnabled::Type> PooledCollisionEnabled;
+
+	/** Frame time not yet simulated when ProjectileMovement is stepped at FutureNinja.FixedStepHz */
+	FFutureNinjaFixedStep FixedStep;
+
+	/** Lets ProjectileMovement tick itself, or steps it from this actor's tick while FutureNinja.FixedStepHz is set. */
+	void UpdateStepMode();
+
 public:
 	AFutureNinjaProjectile();
 
+	// AActor interface
+	virtual void PostInitializeComponents() override;
+	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void LifeSpanExpired() override;
+	// End of AActor interface
+
 	/** called when projectile hits something */
 	UFUNCTION()
 	void OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
 
+	/** Returns the projectile to its pool, or destroys it if it was not pooled. */
+	void Release();
+
+	/**
+	 * Puts a pooled projectile back into flight at the given transform.
+	 * @param InheritedVelocity	Added to the launch velocity, e.g. the velocity of the throwing hand
+	 * @returns false if CollisionHandling refused the location; the projectile stays deactivated.
+	 */
+	bool ActivateFromPool(const FVector& Location, const FRotator& Rotation, ESpawnActorCollisionHandlingMethod CollisionHandling, const FVector& InheritedVelocity = FVector::ZeroVector);
+
+	/** Stops movement, collision and rendering so the projectile can sit in a pool. */
+	void DeactivateToPool();
+
+	/** Advances the flight by Seconds at once, e.g. to catch up with a shot fired that long ago on another machine. */
+	void FastForward(float Seconds);
+
+	/** Pool this projectile belongs to; unset for projectiles that were spawned directly. */
+	TWeakObjectPtr<class AFutureNinjaProjectilePool> OwningPool;
+
+	/** FFutureNinjaShot::ShotId of the networked shot this projectile flies, 0 if it is not one. */
+	uint16 NetShotId;
+
 	/** Returns CollisionComp subobject **/
 	FORCEINLINE class USphereComponent* GetCollisionComp() const { return CollisionComp; }
 	/** Returns ProjectileMovement subobject **/
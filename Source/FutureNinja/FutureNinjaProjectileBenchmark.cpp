@@ -0,0 +1,472 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaProjectileBenchmark.h"
+#include "FutureNinjaCharacter.h"
+#include "FutureNinjaProjectile.h"
+#include "FutureNinjaProjectileManager.h"
+#include "FutureNinjaProjectilePool.h"
+#include "AIController.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/UObjectGlobals.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogProjectileBenchmark, Log, All);
+
+static void StartProjectileBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	AFutureNinjaProjectileBenchmark::Start(World, *FString::Join(Args, TEXT(" ")), false);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs StartProjectileBenchmarkCommand(
+	TEXT("FutureNinja.ProjectileBenchmark"),
+	TEXT("Starts the projectile stress benchmark. Accepts BenchShotsPerSecond=, BenchSeconds=, BenchBodies= and BenchInstanced= overrides."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&StartProjectileBenchmark));
+
+//////////////////////////////////////////////////////////////////////////
+// FProjectileBenchmarkPhysicsTick
+
+void FProjectileBenchmarkPhysicsTick::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Benchmark != nullptr)
+	{
+		Benchmark->MarkPhysics(bEndOfPhysics);
+	}
+}
+
+FString FProjectileBenchmarkPhysicsTick::DiagnosticMessage()
+{
+	return bEndOfPhysics ? TEXT("FProjectileBenchmarkPhysicsTick[End]") : TEXT("FProjectileBenchmarkPhysicsTick[Start]");
+}
+
+//////////////////////////////////////////////////////////////////////////
+// AFutureNinjaProjectileBenchmark
+
+AFutureNinjaProjectileBenchmark::AFutureNinjaProjectileBenchmark()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	StartPhysicsTick.bCanEverTick = true;
+	StartPhysicsTick.TickGroup = TG_StartPhysics;
+	StartPhysicsTick.bEndOfPhysics = false;
+
+	EndPhysicsTick.bCanEverTick = true;
+	EndPhysicsTick.TickGroup = TG_EndPhysics;
+	EndPhysicsTick.bEndOfPhysics = true;
+
+	CharacterClass = FStringClassReference(TEXT("/Game/Programming/Keil/FirstPersonCharacter.FirstPersonCharacter_C"));
+	ShotsPerSecond = 30.f;
+	DurationSeconds = 30.f;
+	WarmupSeconds = 2.f;
+	NumPhysicsBodies = 200;
+	RandomSeed = 1337;
+	Origin = FVector(0.f, 0.f, 200.f);
+	MaxAverageGameThreadMs = 8.f;
+	MaxP99FrameMs = 11.1f;
+	MaxGCPauseMs = 5.f;
+
+	Shooter = nullptr;
+	ShooterController = nullptr;
+	ElapsedSeconds = 0.f;
+	ShotsDue = 0.f;
+	ShotsThisFrame = 0;
+	PhysicsStartTime = 0.0;
+	PhysicsMs = 0.0;
+	GCStartTime = 0.0;
+	GCMsThisFrame = 0.0;
+	MaxGCPauseSeenMs = 0.0;
+	LastUsedMemory = 0;
+	LastObjectCount = 0;
+	InstancedVisualsOverride = -1;
+	bFinished = false;
+	bExitWhenDone = false;
+}
+
+AFutureNinjaProjectileBenchmark* AFutureNinjaProjectileBenchmark::Start(UWorld* World, const TCHAR* Params, bool bExitWhenDone)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.bDeferConstruction = true;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	AFutureNinjaProjectileBenchmark* Benchmark = World->SpawnActor<AFutureNinjaProjectileBenchmark>(SpawnParams);
+	if (Benchmark != nullptr)
+	{
+		FParse::Value(Params, TEXT("BenchShotsPerSecond="), Benchmark->ShotsPerSecond);
+		FParse::Value(Params, TEXT("BenchSeconds="), Benchmark->DurationSeconds);
+		FParse::Value(Params, TEXT("BenchBodies="), Benchmark->NumPhysicsBodies);
+		FParse::Value(Params, TEXT("BenchInstanced="), Benchmark->InstancedVisualsOverride);
+		Benchmark->bExitWhenDone = bExitWhenDone;
+		Benchmark->FinishSpawning(FTransform::Identity);
+	}
+	return Benchmark;
+}
+
+void AFutureNinjaProjectileBenchmark::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Random.Initialize(RandomSeed);
+	Samples.Reserve(FMath::CeilToInt(DurationSeconds * 120.f));
+
+	PreGCHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &AFutureNinjaProjectileBenchmark::OnPreGarbageCollect);
+	PostGCHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &AFutureNinjaProjectileBenchmark::OnPostGarbageCollect);
+
+	SpawnPhysicsBodies();
+	SpawnShooter();
+
+	LastUsedMemory = FPlatformMemory::GetStats().UsedPhysical;
+	LastObjectCount = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+	UE_LOG(LogProjectileBenchmark, Display, TEXT("Projectile benchmark started: %.1f shots/s for %.1fs, %d physics bodies"), ShotsPerSecond, DurationSeconds, NumPhysicsBodies);
+}
+
+void AFutureNinjaProjectileBenchmark::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGCHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGCHandle);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFutureNinjaProjectileBenchmark::RegisterActorTickFunctions(bool bRegister)
+{
+	Super::RegisterActorTickFunctions(bRegister);
+
+	if (bRegister)
+	{
+		StartPhysicsTick.Benchmark = this;
+		StartPhysicsTick.RegisterTickFunction(GetLevel());
+		EndPhysicsTick.Benchmark = this;
+		EndPhysicsTick.RegisterTickFunction(GetLevel());
+	}
+	else
+	{
+		if (StartPhysicsTick.IsTickFunctionRegistered())
+		{
+			StartPhysicsTick.UnRegisterTickFunction();
+		}
+		if (EndPhysicsTick.IsTickFunctionRegistered())
+		{
+			EndPhysicsTick.UnRegisterTickFunction();
+		}
+	}
+}
+
+void AFutureNinjaProjectileBenchmark::MarkPhysics(bool bEndOfPhysics)
+{
+	if (bEndOfPhysics)
+	{
+		PhysicsMs = (FPlatformTime::Seconds() - PhysicsStartTime) * 1000.0;
+	}
+	else
+	{
+		PhysicsStartTime = FPlatformTime::Seconds();
+	}
+}
+
+void AFutureNinjaProjectileBenchmark::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	ElapsedSeconds += DeltaSeconds;
+
+	// Everything measured here belongs to the previous frame: GGameThreadTime and the physics window are
+	// only complete once that frame has ended, and the shots counted were fired during it.
+	const uint64 UsedMemory = FPlatformMemory::GetStats().UsedPhysical;
+	const int32 ObjectCount = GUObjectArray.GetObjectArrayNumMinusAvailable();
+	if (ElapsedSeconds > WarmupSeconds)
+	{
+		FFrameSample Sample;
+		Sample.FrameMs = DeltaSeconds * 1000.f;
+		Sample.GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+		Sample.PhysicsMs = PhysicsMs;
+		Sample.GCMs = GCMsThisFrame;
+		Sample.MemoryDeltaBytes = (int64)UsedMemory - (int64)LastUsedMemory;
+		Sample.ObjectDelta = ObjectCount - LastObjectCount;
+		Sample.LiveProjectiles = CountLiveProjectiles();
+		Sample.ShotsFired = ShotsThisFrame;
+		Sample.RenderProxies = CountRenderProxies();
+		Sample.InstanceUpdates = 0;
+		for (TActorIterator<AFutureNinjaProjectileManager> It(GetWorld()); It; ++It)
+		{
+			Sample.InstanceUpdates += It->GetNumInstanceUpdates();
+		}
+		Samples.Add(Sample);
+	}
+	LastUsedMemory = UsedMemory;
+	LastObjectCount = ObjectCount;
+	GCMsThisFrame = 0.0;
+
+	if (ElapsedSeconds > WarmupSeconds + DurationSeconds)
+	{
+		Finish();
+		return;
+	}
+
+	FireDueShots(DeltaSeconds);
+}
+
+void AFutureNinjaProjectileBenchmark::SpawnPhysicsBodies()
+{
+	UStaticMesh* CubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (CubeMesh == nullptr)
+	{
+		UE_LOG(LogProjectileBenchmark, Warning, TEXT("Could not load the cube mesh; running without physics bodies"));
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for (int32 Index = 0; Index < NumPhysicsBodies; ++Index)
+	{
+		const FVector Location = Origin + FVector(Random.FRandRange(500.f, 3000.f), Random.FRandRange(-1500.f, 1500.f), Random.FRandRange(0.f, 400.f));
+		AStaticMeshActor* Body = GetWorld()->SpawnActor<AStaticMeshActor>(Location, FRotator::ZeroRotator, SpawnParams);
+		if (Body == nullptr)
+		{
+			continue;
+		}
+
+		UStaticMeshComponent* MeshComponent = Body->GetStaticMeshComponent();
+		MeshComponent->SetMobility(EComponentMobility::Movable);
+		MeshComponent->SetStaticMesh(CubeMesh);
+		MeshComponent->SetWorldScale3D(FVector(0.5f));
+		MeshComponent->SetCollisionProfileName(TEXT("PhysicsActor"));
+		MeshComponent->SetSimulatePhysics(true);
+	}
+}
+
+void AFutureNinjaProjectileBenchmark::SpawnShooter()
+{
+	UClass* ShooterClass = CharacterClass.TryLoadClass<AFutureNinjaCharacter>();
+	if (ShooterClass == nullptr)
+	{
+		UE_LOG(LogProjectileBenchmark, Warning, TEXT("Could not load %s; falling back to AFutureNinjaCharacter"), *CharacterClass.ToString());
+		ShooterClass = AFutureNinjaCharacter::StaticClass();
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.bDeferConstruction = true;
+
+	Shooter = GetWorld()->SpawnActor<AFutureNinjaCharacter>(ShooterClass, SpawnParams);
+	if (Shooter == nullptr)
+	{
+		return;
+	}
+
+	// Aim comes from the control rotation, so always use the flat-screen muzzle
+	Shooter->SetUsingMotionControllers(false);
+
+	// Only batched kunai can be drawn as instances
+	if (InstancedVisualsOverride >= 0)
+	{
+		Shooter->bUseBatchedProjectiles = true;
+		AFutureNinjaProjectileManager::Get(GetWorld())->bUseInstancedVisuals = InstancedVisualsOverride != 0;
+	}
+	Shooter->FinishSpawning(FTransform(Origin));
+
+	if (Shooter->ProjectileClass == nullptr)
+	{
+		UE_LOG(LogProjectileBenchmark, Error, TEXT("%s has no ProjectileClass; nothing will be fired"), *ShooterClass->GetName());
+	}
+
+	FActorSpawnParameters ControllerSpawnParams;
+	ControllerSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ShooterController = GetWorld()->SpawnActor<AAIController>(ControllerSpawnParams);
+	if (ShooterController != nullptr)
+	{
+		ShooterController->Possess(Shooter);
+	}
+}
+
+void AFutureNinjaProjectileBenchmark::FireDueShots(float DeltaSeconds)
+{
+	ShotsThisFrame = 0;
+	if (Shooter == nullptr || ShooterController == nullptr)
+	{
+		return;
+	}
+
+	ShotsDue += ShotsPerSecond * DeltaSeconds;
+	while (ShotsDue >= 1.f)
+	{
+		ShotsDue -= 1.f;
+
+		ShooterController->SetControlRotation(FRotator(Random.FRandRange(-5.f, 10.f), Random.FRandRange(-30.f, 30.f), 0.f));
+		Shooter->Fire();
+		++ShotsThisFrame;
+	}
+}
+
+int32 AFutureNinjaProjectileBenchmark::CountLiveProjectiles() const
+{
+	if (Shooter == nullptr || Shooter->ProjectileClass == nullptr)
+	{
+		return 0;
+	}
+
+	int32 Live = 0;
+	if (Shooter->bUseBatchedProjectiles)
+	{
+		Live += AFutureNinjaProjectileManager::Get(GetWorld())->GetNumLive();
+	}
+	else
+	{
+		Live += AFutureNinjaProjectilePool::Get(GetWorld())->GetLiveCount(Shooter->ProjectileClass);
+	}
+	return Live;
+}
+
+int32 AFutureNinjaProjectileBenchmark::CountRenderProxies() const
+{
+	int32 Count = 0;
+	for (TActorIterator<AFutureNinjaProjectile> It(GetWorld()); It; ++It)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(*It);
+		for (const UPrimitiveComponent* Primitive : Primitives)
+		{
+			Count += Primitive->IsRenderStateCreated() ? 1 : 0;
+		}
+	}
+
+	for (TActorIterator<AFutureNinjaProjectileManager> It(GetWorld()); It; ++It)
+	{
+		Count += It->CountRenderProxies();
+	}
+	return Count;
+}
+
+void AFutureNinjaProjectileBenchmark::OnPreGarbageCollect()
+{
+	GCStartTime = FPlatformTime::Seconds();
+}
+
+void AFutureNinjaProjectileBenchmark::OnPostGarbageCollect()
+{
+	const double PauseMs = (FPlatformTime::Seconds() - GCStartTime) * 1000.0;
+	GCMsThisFrame += PauseMs;
+	if (ElapsedSeconds > WarmupSeconds)
+	{
+		MaxGCPauseSeenMs = FMath::Max(MaxGCPauseSeenMs, PauseMs);
+	}
+}
+
+void AFutureNinjaProjectileBenchmark::Finish()
+{
+	bFinished = true;
+	SetActorTickEnabled(false);
+
+	const FString BaseName = FString::Printf(TEXT("ProjectileBenchmark-%s"), *FDateTime::Now().ToString());
+
+	bool bPassed = false;
+	if (!WriteReport(BaseName, bPassed))
+	{
+		UE_LOG(LogProjectileBenchmark, Error, TEXT("Failed to write the benchmark report to %s"), *FPaths::ProfilingDir());
+		bPassed = false;
+	}
+
+	if (bPassed)
+	{
+		UE_LOG(LogProjectileBenchmark, Display, TEXT("Projectile benchmark passed"));
+	}
+	else
+	{
+		UE_LOG(LogProjectileBenchmark, Error, TEXT("Projectile benchmark exceeded its thresholds"));
+	}
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, bPassed ? 0 : 1);
+	}
+}
+
+bool AFutureNinjaProjectileBenchmark::WriteReport(const FString& BaseName, bool& bOutPassed) const
+{
+	FString Csv = TEXT("Frame,FrameMs,GameThreadMs,PhysicsMs,GCMs,MemoryDeltaBytes,ObjectDelta,LiveProjectiles,ShotsFired,RenderProxies,InstanceUpdates\n");
+
+	TArray<float> FrameTimes;
+	FrameTimes.Reserve(Samples.Num());
+	double GameThreadSum = 0.0;
+	double PhysicsSum = 0.0;
+	int32 MaxLive = 0;
+	int32 TotalShots = 0;
+	int32 MaxRenderProxies = 0;
+	int64 TotalInstanceUpdates = 0;
+
+	for (int32 Index = 0; Index < Samples.Num(); ++Index)
+	{
+		const FFrameSample& Sample = Samples[Index];
+		Csv += FString::Printf(TEXT("%d,%.3f,%.3f,%.3f,%.3f,%lld,%d,%d,%d,%d,%d\n"), Index, Sample.FrameMs, Sample.GameThreadMs, Sample.PhysicsMs, Sample.GCMs, Sample.MemoryDeltaBytes, Sample.ObjectDelta, Sample.LiveProjectiles, Sample.ShotsFired, Sample.RenderProxies, Sample.InstanceUpdates);
+
+		FrameTimes.Add(Sample.FrameMs);
+		GameThreadSum += Sample.GameThreadMs;
+		PhysicsSum += Sample.PhysicsMs;
+		MaxLive = FMath::Max(MaxLive, Sample.LiveProjectiles);
+		TotalShots += Sample.ShotsFired;
+		MaxRenderProxies = FMath::Max(MaxRenderProxies, Sample.RenderProxies);
+		TotalInstanceUpdates += Sample.InstanceUpdates;
+	}
+
+	FrameTimes.Sort();
+	const int32 NumFrames = FMath::Max(Samples.Num(), 1);
+	const float AverageGameThreadMs = GameThreadSum / NumFrames;
+	const float AveragePhysicsMs = PhysicsSum / NumFrames;
+	const float AverageInstanceUpdates = (float)TotalInstanceUpdates / NumFrames;
+	const float P99FrameMs = FrameTimes.Num() > 0 ? FrameTimes[FMath::Min(FMath::FloorToInt(FrameTimes.Num() * 0.99f), FrameTimes.Num() - 1)] : 0.f;
+
+	bOutPassed = Samples.Num() > 0
+		&& AverageGameThreadMs <= MaxAverageGameThreadMs
+		&& P99FrameMs <= MaxP99FrameMs
+		&& MaxGCPauseSeenMs <= MaxGCPauseMs;
+
+	const FString Json = FString::Printf(
+		TEXT("{\n")
+		TEXT("\t\"frames\": %d,\n")
+		TEXT("\t\"shotsPerSecond\": %.2f,\n")
+		TEXT("\t\"shotsFired\": %d,\n")
+		TEXT("\t\"physicsBodies\": %d,\n")
+		TEXT("\t\"maxLiveProjectiles\": %d,\n")
+		TEXT("\t\"maxRenderProxies\": %d,\n")
+		TEXT("\t\"averageInstanceUpdates\": %.2f,\n")
+		TEXT("\t\"averageGameThreadMs\": %.3f,\n")
+		TEXT("\t\"averagePhysicsMs\": %.3f,\n")
+		TEXT("\t\"p99FrameMs\": %.3f,\n")
+		TEXT("\t\"maxGCPauseMs\": %.3f,\n")
+		TEXT("\t\"thresholds\": { \"averageGameThreadMs\": %.3f, \"p99FrameMs\": %.3f, \"gcPauseMs\": %.3f },\n")
+		TEXT("\t\"passed\": %s\n")
+		TEXT("}\n"),
+		Samples.Num(), ShotsPerSecond, TotalShots, NumPhysicsBodies, MaxLive, MaxRenderProxies, AverageInstanceUpdates,
+		AverageGameThreadMs, AveragePhysicsMs, P99FrameMs, MaxGCPauseSeenMs,
+		MaxAverageGameThreadMs, MaxP99FrameMs, MaxGCPauseMs,
+		bOutPassed ? TEXT("true") : TEXT("false"));
+
+	UE_LOG(LogProjectileBenchmark, Display, TEXT("%d frames, max %d live kunai, max %d kunai render proxies, %.1f instance updates avg, game thread %.2fms avg, physics %.2fms avg, p99 frame %.2fms, worst GC %.2fms"),
+		Samples.Num(), MaxLive, MaxRenderProxies, AverageInstanceUpdates, AverageGameThreadMs, AveragePhysicsMs, P99FrameMs, MaxGCPauseSeenMs);
+
+	const FString Directory = FPaths::ProfilingDir();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*Directory);
+
+	return FFileHelper::SaveStringToFile(Csv, *(Directory / BaseName + TEXT(".csv")))
+		&& FFileHelper::SaveStringToFile(Json, *(Directory / BaseName + TEXT(".json")));
+}
@@ -0,0 +1,188 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "GameFramework/Actor.h"
+#include "FutureNinjaProjectileBenchmark.generated.h"
+
+class AFutureNinjaProjectileBenchmark;
+
+/** Timestamps the start or end of the physics tick groups for the benchmark. */
+USTRUCT()
+struct FProjectileBenchmarkPhysicsTick : public FTickFunction
+{
+	GENERATED_BODY()
+
+	AFutureNinjaProjectileBenchmark* Benchmark;
+
+	/** True for the tick that runs after physics has finished */
+	bool bEndOfPhysics;
+
+	FProjectileBenchmarkPhysicsTick()
+		: Benchmark(nullptr), bEndOfPhysics(false)
+	{}
+
+	// FTickFunction interface
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	// End of FTickFunction interface
+};
+
+template<>
+struct TStructOpsTypeTraits<FProjectileBenchmarkPhysicsTick> : public TStructOpsTypeTraitsBase2<FProjectileBenchmarkPhysicsTick>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * Headless projectile stress test.
+ *
+ * Scatters physics bodies in the current map, possesses an AFutureNinjaCharacter with an AI controller
+ * and fires it through the shipping OnFire path at a fixed rate. Per-frame game thread time, physics
+ * time, memory and UObject churn, and garbage collection pauses are recorded. When the run ends a CSV
+ * of every frame and a JSON summary are written to the profiling directory, and the process exits
+ * with a non-zero code if any threshold was exceeded.
+ *
+ * Each frame also records the render proxies of kunai, visual actors and the projectile manager's own
+ * instanced visuals and impact marks, and the instances the manager moved. Compare the two ways of
+ * drawing batched kunai with -BenchInstanced=0 and -BenchInstanced=1.
+ *
+ * Run with: FutureNinja <Map> -game -nullrhi -unattended -ProjectileBenchmark [-BenchShotsPerSecond=N] [-BenchSeconds=N] [-BenchBodies=N] [-BenchInstanced=0|1]
+ */
+UCLASS(config=Game, notplaceable)
+class AFutureNinjaProjectileBenchmark : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFutureNinjaProjectileBenchmark();
+
+	/**
+	 * Spawns and starts a benchmark in World.
+	 * @param Params		Command line style overrides (BenchShotsPerSecond=, BenchSeconds=, BenchBodies=)
+	 * @param bExitWhenDone	Exit the process with the pass/fail status when the run is done
+	 */
+	static AFutureNinjaProjectileBenchmark* Start(UWorld* World, const TCHAR* Params, bool bExitWhenDone);
+
+	/** Character blueprint to fire with; its ProjectileClass is what gets benchmarked. */
+	UPROPERTY(Config, EditAnywhere, Category = Benchmark)
+	FStringClassReference CharacterClass;
+
+	/** Kunai fired per second. */
+	UPROPERTY(Config, EditAnywhere, Category = Benchmark)
+	float ShotsPerSecond;
+
+	/** Measured length of the run, after warmup. */
+	UPROPERTY(Config, EditAnywhere, Category = Benchmark)
+	float DurationSeconds;
+
+	/** Frames in this initial window are not recorded. */
+	UPROPERTY(Config, EditAnywhere, Category = Benchmark)
+	float WarmupSeconds;
+
+	/** Number of physics bodies scattered in front of the character. */
+	UPROPERTY(Config, EditAnywhere, Category = Benchmark)
+	int32 NumPhysicsBodies;
+
+	/** Seed for body placement and aim, so runs are comparable. */
+	UPROPERTY(Config, EditAnywhere, Category = Benchmark)
+	int32 RandomSeed;
+
+	/** Where the character stands; bodies are scattered in front of it along +X. */
+	UPROPERTY(Config, EditAnywhere, Category = Benchmark)
+	FVector Origin;
+
+	/** Fail if the average game thread time exceeds this. */
+	UPROPERTY(Config, EditAnywhere, Category = Thresholds)
+	float MaxAverageGameThreadMs;
+
+	/** Fail if the 99th percentile frame time exceeds this. */
+	UPROPERTY(Config, EditAnywhere, Category = Thresholds)
+	float MaxP99FrameMs;
+
+	/** Fail if any single garbage collection pause exceeds this. */
+	UPROPERTY(Config, EditAnywhere, Category = Thresholds)
+	float MaxGCPauseMs;
+
+	// AActor interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+	// End of AActor interface
+
+	/** Called from the physics tick functions. */
+	void MarkPhysics(bool bEndOfPhysics);
+
+protected:
+	// AActor interface
+	virtual void RegisterActorTickFunctions(bool bRegister) override;
+	// End of AActor interface
+
+private:
+	/** One recorded frame */
+	struct FFrameSample
+	{
+		float FrameMs;
+		float GameThreadMs;
+		float PhysicsMs;
+		float GCMs;
+		int64 MemoryDeltaBytes;
+		int32 ObjectDelta;
+		int32 LiveProjectiles;
+		int32 ShotsFired;
+		int32 RenderProxies;
+		int32 InstanceUpdates;
+	};
+
+	void SpawnPhysicsBodies();
+	void SpawnShooter();
+	void FireDueShots(float DeltaSeconds);
+	int32 CountLiveProjectiles() const;
+
+	/** Render proxies of every kunai actor and of the projectile manager's components. */
+	int32 CountRenderProxies() const;
+	void Finish();
+	bool WriteReport(const FString& BaseName, bool& bOutPassed) const;
+
+	void OnPreGarbageCollect();
+	void OnPostGarbageCollect();
+
+	FProjectileBenchmarkPhysicsTick StartPhysicsTick;
+	FProjectileBenchmarkPhysicsTick EndPhysicsTick;
+
+	UPROPERTY(Transient)
+	class AFutureNinjaCharacter* Shooter;
+
+	UPROPERTY(Transient)
+	class AAIController* ShooterController;
+
+	FRandomStream Random;
+	TArray<FFrameSample> Samples;
+
+	float ElapsedSeconds;
+	float ShotsDue;
+	int32 ShotsThisFrame;
+
+	double PhysicsStartTime;
+	double PhysicsMs;
+	double GCStartTime;
+	double GCMsThisFrame;
+	double MaxGCPauseSeenMs;
+
+	uint64 LastUsedMemory;
+	int32 LastObjectCount;
+
+	FDelegateHandle PreGCHandle;
+	FDelegateHandle PostGCHandle;
+
+	/** Batched kunai drawn as instances if 1, as actors if 0; the character's own settings if negative */
+	int32 InstancedVisualsOverride;
+
+	bool bFinished;
+	bool bExitWhenDone;
+};
@@ -0,0 +1,785 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaProjectileManager.h"
+#include "FutureNinjaFixedStep.h"
+#include "FutureNinjaHitchDetector.h"
+#include "FutureNinjaCharacter.h"
+#include "FutureNinjaProjectile.h"
+#include "FutureNinjaStatsService.h"
+#include "FutureNinjaTelemetry.h"
+#include "Components/DecalComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SphereComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Materials/MaterialInterface.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogProjectileManager, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Kunai Integrate"), STAT_KunaiIntegrate, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Kunai Sweep"), STAT_KunaiSweep, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Kunai Submit Async Sweeps"), STAT_KunaiSubmitSweeps, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Kunai Harvest Async Sweeps"), STAT_KunaiHarvestSweeps, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Kunai Hit"), STAT_KunaiHit, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Kunai Impulse"), STAT_KunaiImpulse, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Kunai Retire"), STAT_KunaiRetire, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Kunai Update Visuals"), STAT_KunaiVisuals, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Kunai Impact Mark"), STAT_KunaiImpactMark, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Kunai Live"), STAT_KunaiLive, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Kunai Instance Updates"), STAT_KunaiInstanceUpdates, STATGROUP_FutureNinja);
+
+AFutureNinjaProjectileManager::AFutureNinjaProjectileManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	VisualCullDistance = 5000.f;
+	MaxVisuals = 64;
+	MaxBounces = 8;
+	bUseAsyncCollision = true;
+	MaxSubstepDistance = 200.f;
+	MaxSubsteps = 8;
+	bUseInstancedVisuals = false;
+	MaxImpactMarks = 32;
+	ImpactMarkSize = 8.f;
+	NumVisuals = 0;
+	NumInstanceUpdates = 0;
+	ImpactMaterial = nullptr;
+	NextImpactMark = 0;
+
+	SweepQueryParams = FCollisionQueryParams(FName(TEXT("KunaiBatch")), false, this);
+}
+
+AFutureNinjaProjectileManager* AFutureNinjaProjectileManager::Get(UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AFutureNinjaProjectileManager> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<AFutureNinjaProjectileManager>(SpawnParams);
+}
+
+bool AFutureNinjaProjectileManager::Launch(TSubclassOf<AFutureNinjaProjectile> ProjectileClass, const FVector& Location, const FRotator& Rotation, bool bRejectIfBlocked, const FVector& InheritedVelocity)
+{
+	if (ProjectileClass == nullptr)
+	{
+		return false;
+	}
+
+	const int32 ClassIndex = FindOrAddParams(*ProjectileClass);
+	const FKunaiParams& Params = ClassParams[ClassIndex];
+
+	if (bRejectIfBlocked)
+	{
+		if (GetWorld()->OverlapBlockingTestByProfile(Location, FQuat::Identity, Params.CollisionProfileName, FCollisionShape::MakeSphere(Params.CollisionRadius)))
+		{
+			return false;
+		}
+	}
+
+	Positions.Add(Location);
+	Velocities.Add(Rotation.Vector() * Params.InitialSpeed + InheritedVelocity);
+	TargetPositions.Add(Location);
+	StepVelocities.Add(FVector::ZeroVector);
+	RemainingLife.Add(Params.LifeSpan > 0.f ? Params.LifeSpan : BIG_NUMBER);
+	BounceCounts.Add(0);
+	ClassIndices.Add(ClassIndex);
+	Rotations.Add(Rotation.Quaternion());
+	Visuals.Add(nullptr);
+	return true;
+}
+
+void AFutureNinjaProjectileManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (Positions.Num() == 0)
+	{
+		FixedStep.Accumulator = 0.0;
+		return;
+	}
+
+	const float StepSeconds = FFutureNinjaFixedStep::GetStepSeconds();
+	if (StepSeconds > 0.f)
+	{
+		// Fixed steps resolve their collision within the step, or the step's outcome would depend on when the async results land
+		if (PendingSweeps.Num() > 0)
+		{
+			HarvestSweeps();
+			RetireDead();
+		}
+
+		const int32 NumSteps = FixedStep.Advance(DeltaSeconds, StepSeconds);
+		for (int32 Step = 0; Step < NumSteps && Positions.Num() > 0; ++Step)
+		{
+			Integrate(StepSeconds);
+			SweepAndResolve();
+			RetireDead();
+		}
+	}
+	else if (bUseAsyncCollision)
+	{
+		// Kunai indices must not change between submitting sweeps and harvesting them, so retire only in between
+		HarvestSweeps();
+		Integrate(DeltaSeconds);
+		RetireDead();
+		SubmitSweeps(DeltaSeconds);
+	}
+	else
+	{
+		PendingSweeps.Reset();
+		Integrate(DeltaSeconds);
+		SweepAndResolve();
+		RetireDead();
+	}
+	UpdateVisuals();
+}
+
+int32 AFutureNinjaProjectileManager::FindOrAddParams(UClass* ProjectileClass)
+{
+	const int32 Existing = ParamClasses.Find(ProjectileClass);
+	if (Existing != INDEX_NONE)
+	{
+		return Existing;
+	}
+
+	const AFutureNinjaProjectile* DefaultProjectile = ProjectileClass->GetDefaultObject<AFutureNinjaProjectile>();
+	const UProjectileMovementComponent* Movement = DefaultProjectile->GetProjectileMovement();
+
+	FKunaiParams Params;
+	Params.InitialSpeed = Movement->InitialSpeed;
+	Params.MaxSpeed = Movement->MaxSpeed;
+	Params.GravityScale = Movement->ProjectileGravityScale;
+	Params.Bounciness = Movement->Bounciness;
+	Params.Friction = Movement->Friction;
+	Params.StopSimulatingSpeedSquared = FMath::Square(Movement->BounceVelocityStopSimulatingThreshold);
+	Params.CollisionRadius = DefaultProjectile->GetCollisionComp()->GetScaledSphereRadius();
+	Params.LifeSpan = DefaultProjectile->InitialLifeSpan;
+	Params.CollisionProfileName = DefaultProjectile->GetCollisionComp()->GetCollisionProfileName();
+	Params.CollisionObjectType = DefaultProjectile->GetCollisionComp()->GetCollisionObjectType();
+	Params.CollisionResponse = FCollisionResponseParams(DefaultProjectile->GetCollisionComp()->GetCollisionResponseToChannels());
+	Params.bShouldBounce = Movement->bShouldBounce;
+
+	ClassParams.Add(Params);
+	FreeVisuals.AddDefaulted();
+	InstancedVisuals.Add(nullptr);
+	InstancedMeshOffsets.Add(FTransform::Identity);
+	InstanceTransforms.AddDefaulted();
+	return ParamClasses.Add(ProjectileClass);
+}
+
+void AFutureNinjaProjectileManager::Integrate(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KunaiIntegrate);
+	SET_DWORD_STAT(STAT_KunaiLive, Positions.Num());
+
+	const float WorldGravityZ = GetWorld()->GetGravityZ();
+	const int32 Num = Positions.Num();
+
+	const FKunaiParams* RESTRICT ParamsData = ClassParams.GetData();
+	const int32* RESTRICT ClassData = ClassIndices.GetData();
+	const FVector* RESTRICT PositionData = Positions.GetData();
+	FVector* RESTRICT VelocityData = Velocities.GetData();
+	FVector* RESTRICT StepVelocityData = StepVelocities.GetData();
+	FVector* RESTRICT TargetData = TargetPositions.GetData();
+	float* RESTRICT LifeData = RemainingLife.GetData();
+
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		LifeData[Index] -= DeltaSeconds;
+
+		// A kunai at rest stays put until it expires, like a UProjectileMovementComponent that stopped simulating;
+		// with no step to sweep it never touches the surface it lies on again
+		FVector Velocity = VelocityData[Index];
+		StepVelocityData[Index] = Velocity;
+		if (Velocity.IsZero())
+		{
+			TargetData[Index] = PositionData[Index];
+			continue;
+		}
+
+		const FKunaiParams& Params = ParamsData[ClassData[Index]];
+		const float GravityZ = WorldGravityZ * Params.GravityScale;
+
+		// Same integration as UProjectileMovementComponent: constant acceleration over the step, then clamp to MaxSpeed
+		TargetData[Index] = PositionData[Index] + Velocity * DeltaSeconds + FVector(0.f, 0.f, 0.5f * GravityZ * DeltaSeconds * DeltaSeconds);
+		Velocity.Z += GravityZ * DeltaSeconds;
+		if (Params.MaxSpeed > 0.f)
+		{
+			Velocity = Velocity.GetClampedToMaxSize(Params.MaxSpeed);
+		}
+		VelocityData[Index] = Velocity;
+	}
+}
+
+void AFutureNinjaProjectileManager::SweepAndResolve()
+{
+	SCOPE_CYCLE_COUNTER(STAT_KunaiSweep);
+
+	UWorld* const World = GetWorld();
+
+	FHitResult Hit;
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		if (RemainingLife[Index] <= 0.f || Positions[Index] == TargetPositions[Index])
+		{
+			continue;
+		}
+
+		const FKunaiParams& Params = ClassParams[ClassIndices[Index]];
+		const FCollisionShape Shape = FCollisionShape::MakeSphere(Params.CollisionRadius);
+
+		if (World->SweepSingleByProfile(Hit, Positions[Index], TargetPositions[Index], FQuat::Identity, Params.CollisionProfileName, Shape, SweepQueryParams))
+		{
+			Positions[Index] = Hit.Location;
+			if (ResolveHit(Index, Hit))
+			{
+				RemainingLife[Index] = 0.f;
+			}
+		}
+		else
+		{
+			Positions[Index] = TargetPositions[Index];
+		}
+	}
+}
+
+void AFutureNinjaProjectileManager::SubmitSweeps(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KunaiSubmitSweeps);
+
+	UWorld* const World = GetWorld();
+	const float WorldGravityZ = World->GetGravityZ();
+
+	PendingSweeps.Reset();
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		const FVector Start = Positions[Index];
+		const FVector Target = TargetPositions[Index];
+		if (Start == Target)
+		{
+			continue;
+		}
+
+		const FKunaiParams& Params = ClassParams[ClassIndices[Index]];
+		const FCollisionShape Shape = FCollisionShape::MakeSphere(Params.CollisionRadius);
+		const FVector StepVelocity = StepVelocities[Index];
+		const float GravityZ = WorldGravityZ * Params.GravityScale;
+
+		// Split long steps into substeps that follow the arc, so a hitch doesn't turn the step into one straight chord
+		const float StepDistance = FVector::Dist(Start, Target);
+		const int32 NumSubsteps = FMath::Clamp(FMath::CeilToInt(StepDistance / FMath::Max(MaxSubstepDistance, 1.f)), 1, FMath::Max(MaxSubsteps, 1));
+		const float SubstepDuration = DeltaSeconds / NumSubsteps;
+
+		FVector SubstepStart = Start;
+		for (int32 Substep = 0; Substep < NumSubsteps; ++Substep)
+		{
+			const float EndTime = SubstepDuration * (Substep + 1);
+			const FVector SubstepEnd = (Substep == NumSubsteps - 1) ? Target : Start + StepVelocity * EndTime + FVector(0.f, 0.f, 0.5f * GravityZ * EndTime * EndTime);
+
+			FPendingSweep& Sweep = PendingSweeps[PendingSweeps.AddUninitialized()];
+			Sweep.Handle = World->AsyncSweepByChannel(EAsyncTraceType::Single, SubstepStart, SubstepEnd, Params.CollisionObjectType, Shape, SweepQueryParams, Params.CollisionResponse);
+			Sweep.KunaiIndex = Index;
+			Sweep.StartTime = SubstepDuration * Substep;
+			Sweep.Duration = SubstepDuration;
+			Sweep.Start = SubstepStart;
+			Sweep.End = SubstepEnd;
+
+			SubstepStart = SubstepEnd;
+		}
+
+		// Move ahead speculatively; HarvestSweeps rewinds the kunai if one of these sweeps hits
+		Positions[Index] = Target;
+	}
+}
+
+void AFutureNinjaProjectileManager::HarvestSweeps()
+{
+	SCOPE_CYCLE_COUNTER(STAT_KunaiHarvestSweeps);
+
+	UWorld* const World = GetWorld();
+	const float WorldGravityZ = World->GetGravityZ();
+
+	FTraceDatum Datum;
+	FHitResult SyncHit;
+	int32 ResolvedKunai = INDEX_NONE;
+
+	for (const FPendingSweep& Sweep : PendingSweeps)
+	{
+		// Sweeps of one kunai are contiguous and ordered; after the first hit the rest of its path never happened
+		if (Sweep.KunaiIndex == ResolvedKunai || !Positions.IsValidIndex(Sweep.KunaiIndex))
+		{
+			continue;
+		}
+
+		const FKunaiParams& Params = ClassParams[ClassIndices[Sweep.KunaiIndex]];
+		const FHitResult* Hit = nullptr;
+
+		if (World->QueryTraceData(Sweep.Handle, Datum))
+		{
+			if (Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit)
+			{
+				Hit = &Datum.OutHits[0];
+			}
+		}
+		else if (World->SweepSingleByChannel(SyncHit, Sweep.Start, Sweep.End, FQuat::Identity, Params.CollisionObjectType, FCollisionShape::MakeSphere(Params.CollisionRadius), SweepQueryParams, Params.CollisionResponse))
+		{
+			// The result was not available (e.g. the world did not finish its async work); never let a kunai tunnel
+			Hit = &SyncHit;
+		}
+
+		if (Hit == nullptr)
+		{
+			continue;
+		}
+
+		// Rewind to the impact, with the velocity the kunai had at that moment of the step
+		const int32 Index = Sweep.KunaiIndex;
+		const float HitTime = Sweep.StartTime + Hit->Time * Sweep.Duration;
+		Positions[Index] = Hit->Location;
+		Velocities[Index] = StepVelocities[Index] + FVector(0.f, 0.f, WorldGravityZ * Params.GravityScale * HitTime);
+		if (Params.MaxSpeed > 0.f)
+		{
+			Velocities[Index] = Velocities[Index].GetClampedToMaxSize(Params.MaxSpeed);
+		}
+
+		if (ResolveHit(Index, *Hit))
+		{
+			RemainingLife[Index] = 0.f;
+		}
+		ResolvedKunai = Index;
+	}
+
+	PendingSweeps.Reset();
+}
+
+bool AFutureNinjaProjectileManager::ResolveHit(int32 Index, const FHitResult& Hit)
+{
+	FUTURENINJA_SCOPE_STEP(EFutureNinjaStep::Hit, STAT_KunaiHit);
+
+	FFutureNinjaTelemetry::Record(EFutureNinjaTelemetryEvent::Hit, Hit.ImpactPoint);
+	AddImpactMark(Hit);
+
+	AActor* OtherActor = Hit.GetActor();
+	UPrimitiveComponent* OtherComp = Hit.GetComponent();
+
+	// Credit the hit to the stats like AFutureNinjaProjectile::OnHit does
+	if (OtherActor != NULL)
+	{
+		APawn* OtherPawn = Cast<APawn>(OtherActor);
+		const bool bHitEnemy = OtherPawn != NULL && !OtherPawn->IsA<AFutureNinjaCharacter>() && !OtherPawn->IsPlayerControlled();
+		if (bHitEnemy || (OtherComp != NULL && OtherComp->IsSimulatingPhysics()))
+		{
+			if (AFutureNinjaStatsService* StatsService = AFutureNinjaStatsService::Find(GetWorld()))
+			{
+				if (bHitEnemy)
+				{
+					StatsService->AddEnemyHit(OtherPawn);
+				}
+				else
+				{
+					StatsService->PushEvent(EFutureNinjaStatEvent::Hit);
+				}
+			}
+		}
+	}
+
+	// Only add impulse and release the kunai if we hit a physics body, exactly like AFutureNinjaProjectile::OnHit
+	if ((OtherActor != NULL) && (OtherComp != NULL) && OtherComp->IsSimulatingPhysics())
+	{
+		FUTURENINJA_SCOPE_STEP(EFutureNinjaStep::Impulse, STAT_KunaiImpulse);
+		OtherComp->AddImpulseAtLocation(Velocities[Index] * 100.0f, Positions[Index]);
+		return true;
+	}
+
+	const FKunaiParams& Params = ClassParams[ClassIndices[Index]];
+	FVector& Velocity = Velocities[Index];
+
+	if (!Params.bShouldBounce || ++BounceCounts[Index] > MaxBounces)
+	{
+		Velocity = FVector::ZeroVector;
+		return false;
+	}
+
+	// Same response as UProjectileMovementComponent::ComputeBounceDelta
+	const float VDotNormal = (Velocity | Hit.Normal);
+	if (VDotNormal <= 0.f)
+	{
+		const FVector ProjectedNormal = Hit.Normal * -VDotNormal;
+		Velocity += ProjectedNormal;
+		Velocity *= FMath::Clamp(1.f - Params.Friction, 0.f, 1.f);
+		Velocity += ProjectedNormal * FMath::Max(Params.Bounciness, 0.f);
+	}
+
+	if (Velocity.SizeSquared() < Params.StopSimulatingSpeedSquared)
+	{
+		Velocity = FVector::ZeroVector;
+	}
+	return false;
+}
+
+void AFutureNinjaProjectileManager::RetireDead()
+{
+	for (int32 Index = Positions.Num() - 1; Index >= 0; --Index)
+	{
+		if (RemainingLife[Index] <= 0.f)
+		{
+			RemoveKunai(Index);
+		}
+	}
+}
+
+void AFutureNinjaProjectileManager::UpdateVisuals()
+{
+	SCOPE_CYCLE_COUNTER(STAT_KunaiVisuals);
+
+	// Without a local viewer (e.g. a dedicated server) nothing needs a visual
+	FVector ViewLocation;
+	bool bHasViewer = false;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController != nullptr && PlayerController->IsLocalController() && PlayerController->PlayerCameraManager != nullptr)
+		{
+			ViewLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+			bHasViewer = true;
+			break;
+		}
+	}
+
+	if (bUseInstancedVisuals)
+	{
+		UpdateInstancedVisuals(bHasViewer, ViewLocation);
+	}
+	else
+	{
+		UpdateActorVisuals(bHasViewer, ViewLocation);
+	}
+}
+
+void AFutureNinjaProjectileManager::UpdateActorVisuals(bool bHasViewer, const FVector& ViewLocation)
+{
+	// Switched over from instanced visuals
+	for (UInstancedStaticMeshComponent* Instanced : InstancedVisuals)
+	{
+		if (Instanced != nullptr && Instanced->GetInstanceCount() > 0)
+		{
+			Instanced->ClearInstances();
+		}
+	}
+
+	const float CullDistanceSquared = FMath::Square(VisualCullDistance);
+	for (int32 Index = 0; Index < Positions.Num(); ++Index)
+	{
+		const bool bNeedsVisual = bHasViewer && FVector::DistSquared(Positions[Index], ViewLocation) <= CullDistanceSquared;
+		AFutureNinjaProjectile* Visual = Visuals[Index];
+
+		if (!bNeedsVisual)
+		{
+			if (Visual != nullptr)
+			{
+				ReleaseVisual(Index);
+			}
+			continue;
+		}
+
+		if (Visual == nullptr)
+		{
+			if (NumVisuals >= MaxVisuals)
+			{
+				continue;
+			}
+			Visual = AcquireVisual(ClassIndices[Index]);
+			Visuals[Index] = Visual;
+			if (Visual == nullptr)
+			{
+				continue;
+			}
+		}
+
+		// A kunai that came to rest keeps facing the way it landed
+		const FVector& Velocity = Velocities[Index];
+		const FRotator Rotation = Velocity.IsNearlyZero() ? Visual->GetActorRotation() : Velocity.Rotation();
+		Visual->SetActorLocationAndRotation(Positions[Index], Rotation);
+	}
+}
+
+void AFutureNinjaProjectileManager::UpdateInstancedVisuals(bool bHasViewer, const FVector& ViewLocation)
+{
+	// Switched over from visual actors
+	for (int32 Index = 0; NumVisuals > 0 && Index < Visuals.Num(); ++Index)
+	{
+		if (Visuals[Index] != nullptr)
+		{
+			ReleaseVisual(Index);
+		}
+	}
+
+	for (TArray<FTransform>& Transforms : InstanceTransforms)
+	{
+		Transforms.Reset();
+	}
+
+	const float CullDistanceSquared = FMath::Square(VisualCullDistance);
+	for (int32 Index = 0; bHasViewer && Index < Positions.Num(); ++Index)
+	{
+		if (FVector::DistSquared(Positions[Index], ViewLocation) > CullDistanceSquared)
+		{
+			continue;
+		}
+
+		// A kunai that came to rest keeps facing the way it landed
+		const FVector& Velocity = Velocities[Index];
+		if (!Velocity.IsNearlyZero())
+		{
+			Rotations[Index] = Velocity.ToOrientationQuat();
+		}
+
+		const int32 ClassIndex = ClassIndices[Index];
+		InstanceTransforms[ClassIndex].Add(InstancedMeshOffsets[ClassIndex] * FTransform(Rotations[Index], Positions[Index]));
+	}
+
+	NumInstanceUpdates = 0;
+	for (int32 ClassIndex = 0; ClassIndex < InstanceTransforms.Num(); ++ClassIndex)
+	{
+		const TArray<FTransform>& Transforms = InstanceTransforms[ClassIndex];
+		UInstancedStaticMeshComponent* Instanced = InstancedVisuals[ClassIndex];
+		if (Instanced == nullptr)
+		{
+			if (Transforms.Num() == 0)
+			{
+				continue;
+			}
+			Instanced = CreateInstancedVisual(ClassIndex);
+		}
+
+		if (Transforms.Num() == 0)
+		{
+			if (Instanced->GetInstanceCount() > 0)
+			{
+				Instanced->ClearInstances();
+			}
+			continue;
+		}
+
+		while (Instanced->GetInstanceCount() > Transforms.Num())
+		{
+			Instanced->RemoveInstance(Instanced->GetInstanceCount() - 1);
+		}
+
+		// Every instance is moved without touching the render state, which is then rebuilt once for the class
+		const int32 NumExisting = Instanced->GetInstanceCount();
+		for (int32 Index = 0; Index < Transforms.Num(); ++Index)
+		{
+			if (Index < NumExisting)
+			{
+				Instanced->UpdateInstanceTransform(Index, Transforms[Index], true, false, true);
+			}
+			else
+			{
+				Instanced->AddInstanceWorldSpace(Transforms[Index]);
+			}
+		}
+		Instanced->MarkRenderStateDirty();
+
+		NumInstanceUpdates += Transforms.Num();
+	}
+
+	SET_DWORD_STAT(STAT_KunaiInstanceUpdates, NumInstanceUpdates);
+}
+
+UInstancedStaticMeshComponent* AFutureNinjaProjectileManager::CreateInstancedVisual(int32 ClassIndex)
+{
+	UInstancedStaticMeshComponent* Instanced = NewObject<UInstancedStaticMeshComponent>(this);
+	Instanced->bAbsoluteLocation = true;
+	Instanced->bAbsoluteRotation = true;
+	Instanced->bAbsoluteScale = true;
+	Instanced->SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+	Instanced->bGenerateOverlapEvents = false;
+
+	// The mesh is added by the projectile blueprint, so it is only found on a spawned kunai
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AFutureNinjaProjectile* Template = GetWorld()->SpawnActor<AFutureNinjaProjectile>(ParamClasses[ClassIndex], GetActorLocation(), FRotator::ZeroRotator, SpawnParams);
+	const UStaticMeshComponent* MeshComponent = Template != nullptr ? Template->FindComponentByClass<UStaticMeshComponent>() : nullptr;
+
+	if (MeshComponent != nullptr && MeshComponent->GetStaticMesh() != nullptr)
+	{
+		Instanced->SetStaticMesh(MeshComponent->GetStaticMesh());
+		for (int32 MaterialIndex = 0; MaterialIndex < MeshComponent->GetNumMaterials(); ++MaterialIndex)
+		{
+			Instanced->SetMaterial(MaterialIndex, MeshComponent->GetMaterial(MaterialIndex));
+		}
+		Instanced->CastShadow = MeshComponent->CastShadow;
+		InstancedMeshOffsets[ClassIndex] = MeshComponent->GetComponentTransform().GetRelativeTransform(Template->GetActorTransform());
+	}
+	else
+	{
+		UE_LOG(LogProjectileManager, Warning, TEXT("%s has no static mesh to instance; its batched kunai are not drawn"), *ParamClasses[ClassIndex]->GetName());
+	}
+
+	// Kept for when visual actors are switched back on
+	if (Template != nullptr)
+	{
+		Template->DeactivateToPool();
+		FreeVisuals[ClassIndex].Add(Template);
+	}
+
+	Instanced->RegisterComponent();
+	InstancedVisuals[ClassIndex] = Instanced;
+	return Instanced;
+}
+
+uint32 AFutureNinjaProjectileManager::ComputeStateCrc(uint32 Crc) const
+{
+	Crc = FCrc::MemCrc32(Positions.GetData(), Positions.Num() * Positions.GetTypeSize(), Crc);
+	return FCrc::MemCrc32(Velocities.GetData(), Velocities.Num() * Velocities.GetTypeSize(), Crc);
+}
+
+int32 AFutureNinjaProjectileManager::CountRenderProxies() const
+{
+	int32 Count = 0;
+	for (const UInstancedStaticMeshComponent* Instanced : InstancedVisuals)
+	{
+		Count += (Instanced != nullptr && Instanced->IsRenderStateCreated()) ? 1 : 0;
+	}
+	for (const UDecalComponent* Mark : ImpactMarks)
+	{
+		Count += (Mark != nullptr && Mark->IsRenderStateCreated()) ? 1 : 0;
+	}
+	return Count;
+}
+
+bool AFutureNinjaProjectileManager::WantsImpactMarks()
+{
+	return !GetDefault<AFutureNinjaProjectileManager>()->ImpactDecalMaterial.IsNull();
+}
+
+void AFutureNinjaProjectileManager::AddImpactMark(const FHitResult& Hit)
+{
+	SCOPE_CYCLE_COUNTER(STAT_KunaiImpactMark);
+
+	if (ImpactDecalMaterial.IsNull() || GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	// A mark left on something that moves would float where it used to be
+	const UPrimitiveComponent* HitComponent = Hit.GetComponent();
+	if (HitComponent == nullptr || HitComponent->Mobility == EComponentMobility::Movable)
+	{
+		return;
+	}
+
+	if (ImpactMarks.Num() == 0)
+	{
+		ImpactMaterial = Cast<UMaterialInterface>(ImpactDecalMaterial.TryLoad());
+		if (ImpactMaterial == nullptr)
+		{
+			UE_LOG(LogProjectileManager, Warning, TEXT("Could not load the impact decal material %s"), *ImpactDecalMaterial.ToString());
+			ImpactDecalMaterial.Reset();
+			return;
+		}
+
+		// The whole ring is created up front; marks only ever move from here on
+		ImpactMarks.Reserve(MaxImpactMarks);
+		for (int32 Index = 0; Index < MaxImpactMarks; ++Index)
+		{
+			UDecalComponent* Mark = NewObject<UDecalComponent>(this);
+			Mark->bAbsoluteLocation = true;
+			Mark->bAbsoluteRotation = true;
+			Mark->bAbsoluteScale = true;
+			Mark->SetDecalMaterial(ImpactMaterial);
+			Mark->DecalSize = FVector(ImpactMarkSize, ImpactMarkSize, ImpactMarkSize);
+			Mark->SetVisibility(false);
+			Mark->RegisterComponent();
+			ImpactMarks.Add(Mark);
+		}
+		NextImpactMark = 0;
+	}
+
+	FRotator Rotation = Hit.ImpactNormal.Rotation();
+	Rotation.Roll = FMath::FRandRange(-180.f, 180.f);
+
+	UDecalComponent* Mark = ImpactMarks[NextImpactMark];
+	Mark->SetWorldLocationAndRotation(Hit.ImpactPoint, Rotation);
+	Mark->SetVisibility(true);
+	NextImpactMark = (NextImpactMark + 1) % ImpactMarks.Num();
+}
+
+void AFutureNinjaProjectileManager::RemoveKunai(int32 Index)
+{
+	FUTURENINJA_SCOPE_STEP(EFutureNinjaStep::Destroy, STAT_KunaiRetire);
+
+	if (Visuals[Index] != nullptr)
+	{
+		ReleaseVisual(Index);
+	}
+
+	Positions.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	TargetPositions.RemoveAtSwap(Index, 1, false);
+	StepVelocities.RemoveAtSwap(Index, 1, false);
+	RemainingLife.RemoveAtSwap(Index, 1, false);
+	BounceCounts.RemoveAtSwap(Index, 1, false);
+	ClassIndices.RemoveAtSwap(Index, 1, false);
+	Rotations.RemoveAtSwap(Index, 1, false);
+	Visuals.RemoveAtSwap(Index, 1, false);
+}
+
+AFutureNinjaProjectile* AFutureNinjaProjectileManager::AcquireVisual(int32 ClassIndex)
+{
+	AFutureNinjaProjectile* Visual = nullptr;
+
+	TArray<TWeakObjectPtr<AFutureNinjaProjectile>>& FreeList = FreeVisuals[ClassIndex];
+	while (Visual == nullptr && FreeList.Num() > 0)
+	{
+		Visual = FreeList.Pop(false).Get();
+	}
+
+	if (Visual == nullptr)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Visual = GetWorld()->SpawnActor<AFutureNinjaProjectile>(ParamClasses[ClassIndex], GetActorLocation(), FRotator::ZeroRotator, SpawnParams);
+		if (Visual == nullptr)
+		{
+			return nullptr;
+		}
+		Visual->DeactivateToPool();
+	}
+
+	Visual->SetActorHiddenInGame(false);
+	++NumVisuals;
+	return Visual;
+}
+
+void AFutureNinjaProjectileManager::ReleaseVisual(int32 Index)
+{
+	AFutureNinjaProjectile* Visual = Visuals[Index];
+	Visuals[Index] = nullptr;
+
+	if (Visual != nullptr && !Visual->IsPendingKill())
+	{
+		Visual->SetActorHiddenInGame(true);
+		FreeVisuals[ClassIndices[Index]].Add(Visual);
+	}
+	--NumVisuals;
+}
@@ -0,0 +1,249 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "WorldCollision.h"
+#include "FutureNinjaFixedStep.h"
+#include "FutureNinjaProjectileManager.generated.h"
+
+class AFutureNinjaProjectile;
+class UDecalComponent;
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+
+/**
+ * Simulates every batched kunai in the world from contiguous arrays instead of one
+ * UProjectileMovementComponent and USphereComponent per actor.
+ *
+ * Flight parameters are read from the projectile class defaults, so a class flies the same here as it
+ * does as a standalone actor. Actors are only used as visuals, and only for kunai close enough to the
+ * local player to be seen. One manager exists per world; use Get() to find or create it.
+ *
+ * With bUseAsyncCollision the frame's sweeps are submitted together through the async trace API and
+ * read back on the next tick. Kunai move speculatively for that one frame and are rewound to the
+ * impact point when a sweep reports a blocking hit.
+ *
+ * When FutureNinja.FixedStepHz is set, kunai are advanced in fixed steps with blocking sweeps instead,
+ * so a throw flies the same path whatever the frame rate.
+ *
+ * With bUseInstancedVisuals kunai are drawn without actors: every visible kunai of a class becomes one
+ * instance of a single instanced static mesh component, whose instances are all moved in one pass per
+ * tick and whose render state is rebuilt once. The mesh is read from a spawned kunai of the class, since
+ * the projectile blueprint adds it.
+ *
+ * Impact marks of every kunai, batched or not, are drawn by a ring of MaxImpactMarks decal components
+ * owned by the manager; each new mark moves the oldest one.
+ */
+UCLASS(config=Game, notplaceable)
+class AFutureNinjaProjectileManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFutureNinjaProjectileManager();
+
+	/** Returns the manager for World, spawning it on first use. */
+	static AFutureNinjaProjectileManager* Get(UWorld* World);
+
+	/**
+	 * Launches a kunai of ProjectileClass along Rotation.
+	 * @param bRejectIfBlocked	Drop the shot if the launch location is inside blocking geometry
+	 * @param InheritedVelocity	Added to the launch velocity, e.g. the velocity of the throwing hand
+	 * @returns false if the shot was dropped
+	 */
+	bool Launch(TSubclassOf<AFutureNinjaProjectile> ProjectileClass, const FVector& Location, const FRotator& Rotation, bool bRejectIfBlocked = false, const FVector& InheritedVelocity = FVector::ZeroVector);
+
+	/** Number of kunai currently simulated. */
+	int32 GetNumLive() const { return Positions.Num(); }
+
+	/** Number of kunai that currently have a visual actor. */
+	int32 GetNumVisuals() const { return NumVisuals; }
+
+	/** Number of mesh instances moved by the last tick's instanced visual update. */
+	int32 GetNumInstanceUpdates() const { return NumInstanceUpdates; }
+
+	/** Number of the manager's own components that have a render proxy: instanced visuals and impact marks. */
+	int32 CountRenderProxies() const;
+
+	/** Folds the position and velocity of every simulated kunai into Crc, so input replays check them too. */
+	uint32 ComputeStateCrc(uint32 Crc) const;
+
+	/** Moves the oldest impact mark to Hit. Does nothing without an ImpactDecalMaterial. */
+	void AddImpactMark(const FHitResult& Hit);
+
+	/** Whether kunai should report their hits with AddImpactMark. */
+	static bool WantsImpactMarks();
+
+	/** Kunai further than this from the local player camera are simulated without a visual. */
+	UPROPERTY(Config, EditAnywhere, Category = Projectile)
+	float VisualCullDistance;
+
+	/** Upper bound of visual actors alive at once. */
+	UPROPERTY(Config, EditAnywhere, Category = Projectile)
+	int32 MaxVisuals;
+
+	/** Draw kunai as instances of one mesh per projectile class instead of as visual actors. */
+	UPROPERTY(Config, EditAnywhere, Category = Projectile)
+	uint32 bUseInstancedVisuals : 1;
+
+	/** Kunai stop after this many bounces. */
+	UPROPERTY(Config, EditAnywhere, Category = Projectile)
+	int32 MaxBounces;
+
+	/** Resolve collision with async sweeps read back on the next tick instead of blocking sweeps. */
+	UPROPERTY(Config, EditAnywhere, Category = Collision)
+	uint32 bUseAsyncCollision : 1;
+
+	/** Longest distance a single async sweep covers; longer steps are split along the flight arc. */
+	UPROPERTY(Config, EditAnywhere, Category = Collision)
+	float MaxSubstepDistance;
+
+	/** Upper bound of sweeps issued for one kunai in one tick. */
+	UPROPERTY(Config, EditAnywhere, Category = Collision)
+	int32 MaxSubsteps;
+
+	/** Deferred decal material of impact marks; none are drawn if unset. */
+	UPROPERTY(Config, EditAnywhere, Category = ImpactMarks)
+	FStringAssetReference ImpactDecalMaterial;
+
+	/** Decal components in the impact mark ring. */
+	UPROPERTY(Config, EditAnywhere, Category = ImpactMarks, meta = (ClampMin = "1"))
+	int32 MaxImpactMarks;
+
+	/** Width and height of an impact mark. */
+	UPROPERTY(Config, EditAnywhere, Category = ImpactMarks)
+	float ImpactMarkSize;
+
+	// AActor interface
+	virtual void Tick(float DeltaSeconds) override;
+	// End of AActor interface
+
+private:
+	/** Flight parameters shared by every kunai of one projectile class. */
+	struct FKunaiParams
+	{
+		float InitialSpeed;
+		float MaxSpeed;
+		float GravityScale;
+		float Bounciness;
+		float Friction;
+		float StopSimulatingSpeedSquared;
+		float CollisionRadius;
+		float LifeSpan;
+		FName CollisionProfileName;
+		TEnumAsByte<ECollisionChannel> CollisionObjectType;
+		FCollisionResponseParams CollisionResponse;
+		bool bShouldBounce;
+	};
+
+	/** One async sweep covering part of a kunai's last step. */
+	struct FPendingSweep
+	{
+		FTraceHandle Handle;
+		int32 KunaiIndex;
+		/** Seconds into the step at which this substep starts */
+		float StartTime;
+		float Duration;
+		FVector Start;
+		FVector End;
+	};
+
+	/** Returns the index into ClassParams for ProjectileClass, reading its defaults on first use. */
+	int32 FindOrAddParams(UClass* ProjectileClass);
+
+	/** Advances velocity, life and target positions of every kunai. Kunai at rest keep their position as target. */
+	void Integrate(float DeltaSeconds);
+
+	/** Sweeps every moving kunai from its position to its target and resolves hits. */
+	void SweepAndResolve();
+
+	/** Submits the substep sweeps of every moving kunai as one async batch and moves them to their targets. */
+	void SubmitSweeps(float DeltaSeconds);
+
+	/** Reads back last tick's async sweeps and rewinds kunai that hit something. */
+	void HarvestSweeps();
+
+	/**
+	 * Applies a blocking hit to kunai Index, with the same semantics as AFutureNinjaProjectile::OnHit. Only
+	 * moving kunai are swept, so every call is a real impact and leaves a mark.
+	 * @returns true if the kunai must be removed
+	 */
+	bool ResolveHit(int32 Index, const FHitResult& Hit);
+
+	/** Removes kunai whose life ran out or that were released by a hit. */
+	void RetireDead();
+
+	/** Gives visuals to kunai that need one and moves them. */
+	void UpdateVisuals();
+
+	/** Moves the visual actors of kunai within VisualCullDistance of ViewLocation. */
+	void UpdateActorVisuals(bool bHasViewer, const FVector& ViewLocation);
+
+	/** Writes the transforms of kunai within VisualCullDistance of ViewLocation into the instanced visuals. */
+	void UpdateInstancedVisuals(bool bHasViewer, const FVector& ViewLocation);
+
+	/** Creates the instanced visual of a class from the static mesh of a spawned kunai. */
+	UInstancedStaticMeshComponent* CreateInstancedVisual(int32 ClassIndex);
+
+	/** Removes kunai Index, keeping the arrays packed. */
+	void RemoveKunai(int32 Index);
+
+	AFutureNinjaProjectile* AcquireVisual(int32 ClassIndex);
+	void ReleaseVisual(int32 Index);
+
+	TArray<FKunaiParams> ClassParams;
+
+	UPROPERTY(Transient)
+	TArray<UClass*> ParamClasses;
+
+	// One entry per live kunai, all arrays always the same length
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<FVector> TargetPositions;
+	/** Velocity at the start of the current step, used to place substeps on the arc */
+	TArray<FVector> StepVelocities;
+	TArray<float> RemainingLife;
+	TArray<int32> BounceCounts;
+	TArray<int32> ClassIndices;
+	/** Facing of the instanced visual, kept once the kunai comes to rest */
+	TArray<FQuat> Rotations;
+
+	UPROPERTY(Transient)
+	TArray<AFutureNinjaProjectile*> Visuals;
+
+	/** Unused visual actors, per class index */
+	TArray<TArray<TWeakObjectPtr<AFutureNinjaProjectile>>> FreeVisuals;
+
+	int32 NumVisuals;
+
+	/** Instanced visual per class index, created on first use */
+	UPROPERTY(Transient)
+	TArray<UInstancedStaticMeshComponent*> InstancedVisuals;
+
+	/** Transform of the class's mesh relative to its kunai, per class index */
+	TArray<FTransform> InstancedMeshOffsets;
+
+	/** Instance transforms gathered this tick, per class index */
+	TArray<TArray<FTransform>> InstanceTransforms;
+
+	int32 NumInstanceUpdates;
+
+	UPROPERTY(Transient)
+	TArray<UDecalComponent*> ImpactMarks;
+
+	UPROPERTY(Transient)
+	UMaterialInterface* ImpactMaterial;
+
+	/** Ring index of the mark the next impact moves */
+	int32 NextImpactMark;
+
+	/** Sweeps submitted last tick, grouped by kunai in substep order */
+	TArray<FPendingSweep> PendingSweeps;
+
+	FCollisionQueryParams SweepQueryParams;
+
+	/** Frame time not yet simulated when FutureNinja.FixedStepHz is set */
+	FFutureNinjaFixedStep FixedStep;
+};
@@ -0,0 +1,191 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaProjectilePool.h"
+#include "FutureNinjaProjectile.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogProjectilePool, Log, All);
+
+AFutureNinjaProjectilePool::AFutureNinjaProjectilePool()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	DefaultPrewarmCount = 32;
+	MaxPoolSize = 128;
+	OverflowPolicy = EProjectilePoolOverflow::RecycleOldest;
+}
+
+AFutureNinjaProjectilePool* AFutureNinjaProjectilePool::Get(UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AFutureNinjaProjectilePool> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<AFutureNinjaProjectilePool>(SpawnParams);
+}
+
+void AFutureNinjaProjectilePool::Prewarm(TSubclassOf<AFutureNinjaProjectile> ProjectileClass, int32 Count)
+{
+	if (ProjectileClass == nullptr)
+	{
+		return;
+	}
+
+	FProjectileClassPool& Pool = Pools.FindOrAdd(*ProjectileClass);
+	Compact(Pool);
+
+	const int32 Target = FMath::Min(Count > 0 ? Count : DefaultPrewarmCount, MaxPoolSize);
+	while (Pool.Num() < Target)
+	{
+		AFutureNinjaProjectile* Projectile = SpawnPooled(*ProjectileClass);
+		if (Projectile == nullptr)
+		{
+			break;
+		}
+		Pool.Free.Add(Projectile);
+	}
+
+	UE_LOG(LogProjectilePool, Log, TEXT("Prewarmed %d %s"), Pool.Num(), *ProjectileClass->GetName());
+}
+
+AFutureNinjaProjectile* AFutureNinjaProjectilePool::Acquire(TSubclassOf<AFutureNinjaProjectile> ProjectileClass, const FVector& Location, const FRotator& Rotation, ESpawnActorCollisionHandlingMethod CollisionHandling, const FVector& InheritedVelocity)
+{
+	if (ProjectileClass == nullptr)
+	{
+		return nullptr;
+	}
+
+	FProjectileClassPool& Pool = Pools.FindOrAdd(*ProjectileClass);
+	Compact(Pool);
+
+	AFutureNinjaProjectile* Projectile = nullptr;
+	if (Pool.Free.Num() > 0)
+	{
+		Projectile = Pool.Free.Pop(false);
+		++Stats.Hits;
+	}
+	else if (Pool.Num() < MaxPoolSize)
+	{
+		Projectile = SpawnPooled(*ProjectileClass);
+		++Stats.Misses;
+	}
+	else
+	{
+		switch (OverflowPolicy)
+		{
+		case EProjectilePoolOverflow::SpawnTransient:
+		{
+			// Not owned by the pool, so Release() destroys it like an ordinary spawned projectile
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = CollisionHandling;
+			++Stats.Misses;
+			AFutureNinjaProjectile* Transient = GetWorld()->SpawnActor<AFutureNinjaProjectile>(ProjectileClass, Location, Rotation, SpawnParams);
+			if (Transient != nullptr && !InheritedVelocity.IsZero())
+			{
+				Transient->GetProjectileMovement()->Velocity += InheritedVelocity;
+			}
+			return Transient;
+		}
+		case EProjectilePoolOverflow::RecycleOldest:
+			if (Pool.Live.Num() > 0)
+			{
+				Projectile = Pool.Live[0];
+				Pool.Live.RemoveAt(0, 1, false);
+				Projectile->DeactivateToPool();
+				++Stats.Recycled;
+			}
+			break;
+		case EProjectilePoolOverflow::Fail:
+		default:
+			break;
+		}
+	}
+
+	if (Projectile == nullptr)
+	{
+		++Stats.Rejected;
+		return nullptr;
+	}
+
+	if (!Projectile->ActivateFromPool(Location, Rotation, CollisionHandling, InheritedVelocity))
+	{
+		Pool.Free.Add(Projectile);
+		++Stats.Rejected;
+		return nullptr;
+	}
+
+	Pool.Live.Add(Projectile);
+	return Projectile;
+}
+
+void AFutureNinjaProjectilePool::Release(AFutureNinjaProjectile* Projectile)
+{
+	if (Projectile == nullptr)
+	{
+		return;
+	}
+
+	FProjectileClassPool* Pool = Pools.Find(Projectile->GetClass());
+
+	// A projectile can report several hits in one frame; only the first release counts
+	if (Pool == nullptr || Pool->Live.RemoveSingle(Projectile) == 0)
+	{
+		return;
+	}
+
+	Projectile->DeactivateToPool();
+	Pool->Free.Add(Projectile);
+}
+
+int32 AFutureNinjaProjectilePool::GetPoolSize(TSubclassOf<AFutureNinjaProjectile> ProjectileClass) const
+{
+	const FProjectileClassPool* Pool = Pools.Find(*ProjectileClass);
+	return Pool ? Pool->Num() : 0;
+}
+
+int32 AFutureNinjaProjectilePool::GetLiveCount(TSubclassOf<AFutureNinjaProjectile> ProjectileClass) const
+{
+	const FProjectileClassPool* Pool = Pools.Find(*ProjectileClass);
+	return Pool ? Pool->Live.Num() : 0;
+}
+
+void AFutureNinjaProjectilePool::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UE_LOG(LogProjectilePool, Log, TEXT("Projectile pool: %d hits, %d misses, %d recycled, %d rejected"), Stats.Hits, Stats.Misses, Stats.Recycled, Stats.Rejected);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+AFutureNinjaProjectile* AFutureNinjaProjectilePool::SpawnPooled(UClass* ProjectileClass)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AFutureNinjaProjectile* Projectile = GetWorld()->SpawnActor<AFutureNinjaProjectile>(ProjectileClass, GetActorLocation(), FRotator::ZeroRotator, SpawnParams);
+	if (Projectile != nullptr)
+	{
+		Projectile->OwningPool = this;
+		Projectile->DeactivateToPool();
+	}
+	return Projectile;
+}
+
+void AFutureNinjaProjectilePool::Compact(FProjectileClassPool& Pool)
+{
+	Pool.Free.RemoveAllSwap([](AFutureNinjaProjectile* Projectile) { return Projectile == nullptr || Projectile->IsPendingKill(); });
+	Pool.Live.RemoveAll([](AFutureNinjaProjectile* Projectile) { return Projectile == nullptr || Projectile->IsPendingKill(); });
+}
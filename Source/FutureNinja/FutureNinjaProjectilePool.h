@@ -0,0 +1,132 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "FutureNinjaProjectilePool.generated.h"
+
+class AFutureNinjaProjectile;
+
+/** What the pool does when a class has reached MaxPoolSize and every pooled projectile is in flight. */
+UENUM()
+enum class EProjectilePoolOverflow : uint8
+{
+	/** Spawn an extra, unpooled projectile that is destroyed when released. */
+	SpawnTransient,
+	/** Pull the oldest in-flight projectile back and reuse it. */
+	RecycleOldest,
+	/** Refuse the request; the shot is dropped. */
+	Fail
+};
+
+/** Running counters for the pool, summed over every projectile class. */
+USTRUCT(BlueprintType)
+struct FProjectilePoolStats
+{
+	GENERATED_BODY()
+
+	/** Acquires served from a free pooled projectile. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pool)
+	int32 Hits;
+
+	/** Acquires that had to spawn a new actor (either to grow the pool or as an overflow transient). */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pool)
+	int32 Misses;
+
+	/** Acquires served by recycling an in-flight projectile. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pool)
+	int32 Recycled;
+
+	/** Acquires refused by the Fail overflow policy or a blocked spawn location. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pool)
+	int32 Rejected;
+
+	FProjectilePoolStats()
+		: Hits(0), Misses(0), Recycled(0), Rejected(0)
+	{}
+};
+
+/** Free and in-flight projectiles of a single class. */
+USTRUCT()
+struct FProjectileClassPool
+{
+	GENERATED_BODY()
+
+	/** Deactivated projectiles ready to be handed out. */
+	UPROPERTY()
+	TArray<AFutureNinjaProjectile*> Free;
+
+	/** Projectiles currently in flight, oldest first. */
+	UPROPERTY()
+	TArray<AFutureNinjaProjectile*> Live;
+
+	int32 Num() const { return Free.Num() + Live.Num(); }
+};
+
+/**
+ * Keeps deactivated projectiles around so firing does not construct and destroy an actor per shot.
+ * One pool exists per world; use Get() to find or create it.
+ */
+UCLASS(config=Game, notplaceable)
+class AFutureNinjaProjectilePool : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFutureNinjaProjectilePool();
+
+	/** Returns the pool for World, spawning it on first use. */
+	static AFutureNinjaProjectilePool* Get(UWorld* World);
+
+	/** Makes sure at least Count projectiles of ProjectileClass are pooled (clamped to MaxPoolSize). */
+	void Prewarm(TSubclassOf<AFutureNinjaProjectile> ProjectileClass, int32 Count);
+
+	/**
+	 * Hands out an active projectile at the given transform.
+	 * @param CollisionHandling	Same meaning as FActorSpawnParameters::SpawnCollisionHandlingOverride
+	 * @param InheritedVelocity	Added to the projectile's launch velocity
+	 * @returns the projectile, or null if the overflow policy or the spawn location refused it
+	 */
+	AFutureNinjaProjectile* Acquire(TSubclassOf<AFutureNinjaProjectile> ProjectileClass, const FVector& Location, const FRotator& Rotation, ESpawnActorCollisionHandlingMethod CollisionHandling = ESpawnActorCollisionHandlingMethod::AlwaysSpawn, const FVector& InheritedVelocity = FVector::ZeroVector);
+
+	/** Deactivates Projectile and returns it to its free list. */
+	void Release(AFutureNinjaProjectile* Projectile);
+
+	/** Returns the hit/miss counters. */
+	const FProjectilePoolStats& GetStats() const { return Stats; }
+
+	/** Number of projectiles currently pooled for ProjectileClass, free and in flight. */
+	int32 GetPoolSize(TSubclassOf<AFutureNinjaProjectile> ProjectileClass) const;
+
+	/** Number of pooled projectiles of ProjectileClass currently in flight. */
+	int32 GetLiveCount(TSubclassOf<AFutureNinjaProjectile> ProjectileClass) const;
+
+	/** Projectiles created per class by Prewarm when the caller does not ask for a count. */
+	UPROPERTY(Config, EditAnywhere, Category = Pool)
+	int32 DefaultPrewarmCount;
+
+	/** Upper bound of pooled projectiles per class. */
+	UPROPERTY(Config, EditAnywhere, Category = Pool)
+	int32 MaxPoolSize;
+
+	/** What to do when MaxPoolSize is reached and nothing is free. */
+	UPROPERTY(Config, EditAnywhere, Category = Pool)
+	EProjectilePoolOverflow OverflowPolicy;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	/** Spawns a pooled projectile in its deactivated state. */
+	AFutureNinjaProjectile* SpawnPooled(UClass* ProjectileClass);
+
+	/** Drops destroyed projectiles the garbage collector has nulled out. */
+	static void Compact(FProjectileClassPool& Pool);
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FProjectileClassPool> Pools;
+
+	UPROPERTY(Transient)
+	FProjectilePoolStats Stats;
+};
@@ -0,0 +1,381 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaReplicationBudgeter.h"
+#include "FutureNinja.h"
+#include "FutureNinjaCharacter.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogReplicationBudget, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Replication Budget"), STAT_ReplicationBudget, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Replicated Enemies Awake"), STAT_ReplicatedEnemiesAwake, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Replicated Enemies Dormant"), STAT_ReplicatedEnemiesDormant, STATGROUP_FutureNinja);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Replication Budget Scale"), STAT_ReplicationBudgetScale, STATGROUP_FutureNinja);
+
+AFutureNinjaReplicationBudgeter::AFutureNinjaReplicationBudgeter()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	// After movement, so dormancy sees where enemies ended up before the net driver replicates them
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	UpdatePeriod = 0.25f;
+	BytesPerSecondBudget = 12000;
+	MinNetUpdateFrequency = 2.f;
+	MaxNetUpdateFrequency = 30.f;
+	NearDistance = 1000.f;
+	FarDistance = 8000.f;
+	CullDistance = 15000.f;
+	MinNetPriority = 0.5f;
+	MaxNetPriority = 3.f;
+	DefaultBytesPerUpdate = 40;
+	ReportInterval = 5.f;
+
+	BudgetScale = 1.f;
+	TimeSinceUpdate = 0.f;
+	LastReportTime = 0.0;
+	bInstalledActorChannel = false;
+}
+
+AFutureNinjaReplicationBudgeter* AFutureNinjaReplicationBudgeter::Get(UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AFutureNinjaReplicationBudgeter> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<AFutureNinjaReplicationBudgeter>(SpawnParams);
+}
+
+void AFutureNinjaReplicationBudgeter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	InstallActorChannel();
+
+	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	{
+		OnActorSpawned(*It);
+	}
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AFutureNinjaReplicationBudgeter::OnActorSpawned));
+}
+
+void AFutureNinjaReplicationBudgeter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+
+	for (FEntry& Entry : Entries)
+	{
+		Restore(Entry);
+	}
+	Entries.Reset();
+
+	// Channels already open keep counting; new ones go back to the engine class
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (bInstalledActorChannel && NetDriver != nullptr)
+	{
+		NetDriver->ChannelClasses[CHTYPE_Actor] = UActorChannel::StaticClass();
+	}
+	bInstalledActorChannel = false;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFutureNinjaReplicationBudgeter::InstallActorChannel()
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (!bInstalledActorChannel && NetDriver != nullptr && NetDriver->IsServer())
+	{
+		NetDriver->ChannelClasses[CHTYPE_Actor] = UFutureNinjaActorChannel::StaticClass();
+		bInstalledActorChannel = true;
+	}
+}
+
+void AFutureNinjaReplicationBudgeter::OnActorSpawned(AActor* Actor)
+{
+	APawn* Pawn = Cast<APawn>(Actor);
+	if (Pawn != nullptr && Pawn->GetIsReplicated() && !Pawn->IsA<AFutureNinjaCharacter>() && !Pawn->IsPlayerControlled())
+	{
+		Register(Pawn);
+	}
+}
+
+void AFutureNinjaReplicationBudgeter::Register(AActor* Actor)
+{
+	if (Actor == nullptr || Entries.ContainsByPredicate([Actor](const FEntry& Entry) { return Entry.Actor == Actor; }))
+	{
+		return;
+	}
+
+	FEntry Entry;
+	Entry.Actor = Actor;
+	Entry.OriginalNetUpdateFrequency = Actor->NetUpdateFrequency;
+	Entry.OriginalNetPriority = Actor->NetPriority;
+	Entry.OriginalNetCullDistanceSquared = Actor->NetCullDistanceSquared;
+	Entry.Distance = 0.f;
+	Entry.bDormant = false;
+	Entries.Add(Entry);
+
+	Actor->NetCullDistanceSquared = FMath::Square(CullDistance);
+}
+
+void AFutureNinjaReplicationBudgeter::Unregister(AActor* Actor)
+{
+	const int32 Index = Entries.IndexOfByPredicate([Actor](const FEntry& Entry) { return Entry.Actor == Actor; });
+	if (Index != INDEX_NONE)
+	{
+		Restore(Entries[Index]);
+		Entries.RemoveAtSwap(Index, 1, false);
+	}
+}
+
+void AFutureNinjaReplicationBudgeter::Restore(FEntry& Entry)
+{
+	AActor* Actor = Entry.Actor.Get();
+	if (Actor == nullptr || Actor->IsPendingKill())
+	{
+		return;
+	}
+
+	if (Entry.bDormant)
+	{
+		Actor->SetNetDormancy(DORM_Awake);
+		Entry.bDormant = false;
+	}
+	Actor->NetUpdateFrequency = Entry.OriginalNetUpdateFrequency;
+	Actor->NetPriority = Entry.OriginalNetPriority;
+	Actor->NetCullDistanceSquared = Entry.OriginalNetCullDistanceSquared;
+}
+
+void AFutureNinjaReplicationBudgeter::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_ReplicationBudget);
+
+	InstallActorChannel();
+
+	// Every frame, so an enemy taken out of the pool is awake before the net driver runs
+	UpdateDormancy();
+
+	TimeSinceUpdate += DeltaSeconds;
+	if (TimeSinceUpdate >= UpdatePeriod)
+	{
+		TimeSinceUpdate = 0.f;
+		UpdateBudget();
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (LastReportTime == 0.0)
+	{
+		LastReportTime = Now;
+	}
+	else if (ReportInterval > 0.f && Now - LastReportTime >= ReportInterval)
+	{
+		Report(Now - LastReportTime);
+		LastReportTime = Now;
+	}
+}
+
+void AFutureNinjaReplicationBudgeter::UpdateDormancy()
+{
+	int32 NumDormant = 0;
+
+	for (int32 Index = Entries.Num() - 1; Index >= 0; --Index)
+	{
+		FEntry& Entry = Entries[Index];
+		AActor* Actor = Entry.Actor.Get();
+		if (Actor == nullptr || Actor->IsPendingKill())
+		{
+			Entries.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		// Only pooled enemies sleep: a standing enemy may still turn, aim or change state, which dormancy would hide.
+		// The channel still sends the hidden state before it goes dormant.
+		if (Actor->bHidden && !Entry.bDormant)
+		{
+			Actor->SetNetDormancy(DORM_DormantAll);
+			Entry.bDormant = true;
+		}
+		else if (!Actor->bHidden && Entry.bDormant)
+		{
+			Actor->SetNetDormancy(DORM_Awake);
+			Entry.bDormant = false;
+		}
+
+		NumDormant += Entry.bDormant ? 1 : 0;
+	}
+
+	SET_DWORD_STAT(STAT_ReplicatedEnemiesAwake, Entries.Num() - NumDormant);
+	SET_DWORD_STAT(STAT_ReplicatedEnemiesDormant, NumDormant);
+}
+
+void AFutureNinjaReplicationBudgeter::UpdateBudget()
+{
+	// Fold what the channels sent into the per-update cost of each class
+	TMap<FName, FFutureNinjaClassTraffic> Traffic;
+	UFutureNinjaActorChannel::ConsumeTraffic(Traffic);
+	for (const TPair<FName, FFutureNinjaClassTraffic>& Pair : Traffic)
+	{
+		FFutureNinjaClassTraffic& Total = ReportTraffic.FindOrAdd(Pair.Key);
+		Total.Bytes += Pair.Value.Bytes;
+		Total.Bunches += Pair.Value.Bunches;
+
+		if (Pair.Value.Bunches > 0)
+		{
+			const float Sample = (float)Pair.Value.Bytes / Pair.Value.Bunches;
+			float* Cost = BytesPerUpdate.Find(Pair.Key);
+			if (Cost != nullptr)
+			{
+				*Cost = FMath::Lerp(*Cost, Sample, 0.25f);
+			}
+			else
+			{
+				BytesPerUpdate.Add(Pair.Key, Sample);
+			}
+		}
+	}
+
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (NetDriver == nullptr || NetDriver->ClientConnections.Num() == 0)
+	{
+		return;
+	}
+
+	// Steer by the busiest connection; the others have room to spare
+	int32 BusiestBytesPerSecond = 0;
+	for (const UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection != nullptr)
+		{
+			BusiestBytesPerSecond = FMath::Max(BusiestBytesPerSecond, Connection->OutBytesPerSecond);
+		}
+	}
+	if (BusiestBytesPerSecond > BytesPerSecondBudget)
+	{
+		BudgetScale = FMath::Max(BudgetScale * 0.9f, 0.1f);
+	}
+	else if (BusiestBytesPerSecond < BytesPerSecondBudget * 0.85f)
+	{
+		BudgetScale = FMath::Min(BudgetScale * 1.05f, 1.f);
+	}
+	SET_FLOAT_STAT(STAT_ReplicationBudgetScale, BudgetScale);
+
+	ViewLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController != nullptr)
+		{
+			FVector Location;
+			FRotator Rotation;
+			PlayerController->GetPlayerViewPoint(Location, Rotation);
+			ViewLocations.Add(Location);
+		}
+	}
+	if (ViewLocations.Num() == 0)
+	{
+		return;
+	}
+
+	// Rank awake enemies by their distance to the nearest player, and reserve the minimum rate for all of them
+	Ranked.Reset();
+	float Remaining = BytesPerSecondBudget * BudgetScale;
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		FEntry& Entry = Entries[Index];
+		const AActor* Actor = Entry.Actor.Get();
+		if (Entry.bDormant || Actor == nullptr)
+		{
+			continue;
+		}
+
+		float DistanceSquared = MAX_FLT;
+		for (const FVector& ViewLocation : ViewLocations)
+		{
+			DistanceSquared = FMath::Min(DistanceSquared, FVector::DistSquared(ViewLocation, Actor->GetActorLocation()));
+		}
+		Entry.Distance = FMath::Sqrt(DistanceSquared);
+		if (Entry.Distance > CullDistance)
+		{
+			continue;
+		}
+
+		const float* Cost = BytesPerUpdate.Find(Actor->GetClass()->GetFName());
+		Remaining -= MinNetUpdateFrequency * (Cost != nullptr ? *Cost : DefaultBytesPerUpdate);
+		Ranked.Add(Index);
+	}
+
+	Ranked.Sort([this](int32 A, int32 B) { return Entries[A].Distance < Entries[B].Distance; });
+
+	// Hand out what is left nearest first
+	const float FalloffRange = FMath::Max(FarDistance - NearDistance, 1.f);
+	for (int32 Index : Ranked)
+	{
+		FEntry& Entry = Entries[Index];
+		AActor* Actor = Entry.Actor.Get();
+
+		const float Alpha = FMath::Clamp((Entry.Distance - NearDistance) / FalloffRange, 0.f, 1.f);
+		const float* Cost = BytesPerUpdate.Find(Actor->GetClass()->GetFName());
+		const float BytesPerUpdateOfActor = FMath::Max(Cost != nullptr ? *Cost : (float)DefaultBytesPerUpdate, 1.f);
+
+		const float Wanted = FMath::Lerp(MaxNetUpdateFrequency, MinNetUpdateFrequency, Alpha) - MinNetUpdateFrequency;
+		const float Extra = FMath::Clamp(Remaining / BytesPerUpdateOfActor, 0.f, Wanted);
+		Remaining -= Extra * BytesPerUpdateOfActor;
+
+		Actor->NetUpdateFrequency = MinNetUpdateFrequency + Extra;
+		Actor->NetPriority = FMath::Lerp(MaxNetPriority, MinNetPriority, Alpha);
+	}
+}
+
+void AFutureNinjaReplicationBudgeter::Report(double Elapsed)
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (NetDriver == nullptr || NetDriver->ClientConnections.Num() == 0)
+	{
+		ReportTraffic.Reset();
+		return;
+	}
+
+	int32 MinBytesPerSecond = MAX_int32;
+	int32 MaxBytesPerSecond = 0;
+	for (const UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection != nullptr)
+		{
+			MinBytesPerSecond = FMath::Min(MinBytesPerSecond, Connection->OutBytesPerSecond);
+			MaxBytesPerSecond = FMath::Max(MaxBytesPerSecond, Connection->OutBytesPerSecond);
+		}
+	}
+
+	const int32 NumDormant = Entries.FilterByPredicate([](const FEntry& Entry) { return Entry.bDormant; }).Num();
+	UE_LOG(LogReplicationBudget, Log, TEXT("Budget %d B/s per connection at %.0f%%; %d connections out %d-%d B/s; %d enemies awake, %d dormant"),
+		BytesPerSecondBudget, BudgetScale * 100.f, NetDriver->ClientConnections.Num(), MinBytesPerSecond == MAX_int32 ? 0 : MinBytesPerSecond, MaxBytesPerSecond,
+		Entries.Num() - NumDormant, NumDormant);
+
+	ReportTraffic.ValueSort([](const FFutureNinjaClassTraffic& A, const FFutureNinjaClassTraffic& B) { return A.Bytes > B.Bytes; });
+	for (const TPair<FName, FFutureNinjaClassTraffic>& Pair : ReportTraffic)
+	{
+		UE_LOG(LogReplicationBudget, Log, TEXT("  %s: %.0f B/s, %.1f bunches/s, %.0f B per bunch"),
+			*Pair.Key.ToString(), Pair.Value.Bytes / Elapsed, Pair.Value.Bunches / Elapsed,
+			Pair.Value.Bunches > 0 ? (double)Pair.Value.Bytes / Pair.Value.Bunches : 0.0);
+	}
+	ReportTraffic.Reset();
+}
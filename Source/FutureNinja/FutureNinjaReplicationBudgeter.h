@@ -0,0 +1,148 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "FutureNinjaActorChannel.h"
+#include "FutureNinjaReplicationBudgeter.generated.h"
+
+/**
+ * Keeps the server's enemy replication inside a per-connection byte budget.
+ *
+ * Every UpdatePeriod the replicated enemies are ranked by their distance to the nearest player's view point
+ * (the HMD for VR players). Each one is given MinNetUpdateFrequency, then the budget left over is handed
+ * out nearest first, up to MaxNetUpdateFrequency, using the measured cost of one update of the actor's
+ * class. The budget is corrected against the bytes per second the busiest connection actually sends, so
+ * player, shot and RPC traffic is accounted for. Net priority follows the same ranking, and actors beyond
+ * CullDistance are not relevant to a connection at all. Distance is measured per connection by the engine,
+ * so a co-op partner on the other side of the arena still receives the enemies next to them.
+ *
+ * Enemies pooled by the wave director are made dormant and stop costing anything until they are taken out
+ * of the pool. Enemies in play are never made dormant, so gameplay code changing their replicated state,
+ * such as a standing turret turning to aim, needs no special care.
+ *
+ * Every ReportInterval seconds the log shows the budget, the connections and the bytes per second sent for
+ * each actor class. To try it, run a dedicated server and lagging clients on one machine:
+ *   UE4Editor FutureNinja.uproject /Game/Programming/Keil/KeilMap -server -log
+ *   UE4Editor FutureNinja.uproject 127.0.0.1 -game -log -ExecCmds="NetEmulation.PktLag 150, NetEmulation.PktLoss 5"
+ *
+ * Only enemy pawns are managed; kunai are not replicated actors but shots, see FFutureNinjaShot. One budgeter
+ * exists per server world; use Get() to find or create it.
+ */
+UCLASS(config=Game, notplaceable)
+class AFutureNinjaReplicationBudgeter : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFutureNinjaReplicationBudgeter();
+
+	/** Returns the budgeter for World, spawning it on first use. */
+	static AFutureNinjaReplicationBudgeter* Get(UWorld* World);
+
+	/** Starts managing Actor's replication. Replicated enemies are registered automatically when spawned. */
+	void Register(AActor* Actor);
+
+	/** Stops managing Actor and restores its replication settings. */
+	void Unregister(AActor* Actor);
+
+	/** Seconds between two rankings of every managed actor. */
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	float UpdatePeriod;
+
+	/** Bytes per second each client connection may receive. */
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	int32 BytesPerSecondBudget;
+
+	/** Update rate every relevant enemy keeps, however tight the budget. */
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	float MinNetUpdateFrequency;
+
+	/** Update rate of the nearest enemies when the budget allows. */
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	float MaxNetUpdateFrequency;
+
+	/** Enemies within this distance of a player want MaxNetUpdateFrequency. */
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	float NearDistance;
+
+	/** Enemies beyond this distance of every player want MinNetUpdateFrequency. */
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	float FarDistance;
+
+	/** Enemies further than this from a player are not replicated to that player. */
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	float CullDistance;
+
+	/** Net priority of the furthest and the nearest enemies. */
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	float MinNetPriority;
+
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	float MaxNetPriority;
+
+	/** Assumed bytes per update of a class that has not sent anything yet. */
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	int32 DefaultBytesPerUpdate;
+
+	/** Seconds between two traffic reports in the log, 0 for none. */
+	UPROPERTY(Config, EditAnywhere, Category = Replication)
+	float ReportInterval;
+
+	// AActor interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+	// End of AActor interface
+
+private:
+	struct FEntry
+	{
+		TWeakObjectPtr<AActor> Actor;
+		/** Replication settings before registration, restored on unregister */
+		float OriginalNetUpdateFrequency;
+		float OriginalNetPriority;
+		float OriginalNetCullDistanceSquared;
+		/** Distance to the nearest view point at the last ranking */
+		float Distance;
+		bool bDormant;
+	};
+
+	/** Puts pooled actors to sleep and wakes the ones back in play. */
+	void UpdateDormancy();
+
+	/** Ranks awake actors and sets their update frequency and priority within the budget. */
+	void UpdateBudget();
+
+	/** Installs the counting actor channel on the net driver once it exists. */
+	void InstallActorChannel();
+
+	void Restore(FEntry& Entry);
+	void Report(double Elapsed);
+
+	void OnActorSpawned(AActor* Actor);
+
+	TArray<FEntry> Entries;
+
+	/** View points of every player, refreshed each ranking */
+	TArray<FVector> ViewLocations;
+
+	/** Ranking scratch, indices into Entries */
+	TArray<int32> Ranked;
+
+	/** Measured bytes per update of each class, smoothed */
+	TMap<FName, float> BytesPerUpdate;
+
+	/** Traffic per class since the last report */
+	TMap<FName, FFutureNinjaClassTraffic> ReportTraffic;
+
+	/** Fraction of BytesPerSecondBudget handed to enemies, corrected against measured connection traffic */
+	float BudgetScale;
+
+	float TimeSinceUpdate;
+	double LastReportTime;
+	bool bInstalledActorChannel;
+
+	FDelegateHandle ActorSpawnedHandle;
+};
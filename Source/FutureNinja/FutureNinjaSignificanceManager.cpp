@@ -0,0 +1,386 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaSignificanceManager.h"
+#include "FutureNinja.h"
+#include "FutureNinjaCharacter.h"
+#include "AIController.h"
+#include "BrainComponent.h"
+#include "Camera/CameraComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/MovementComponent.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_SignificanceUpdate, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance High"), STAT_SignificanceHigh, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Medium"), STAT_SignificanceMedium, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Low"), STAT_SignificanceLow, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Dormant"), STAT_SignificanceDormant, STATGROUP_FutureNinja);
+
+AFutureNinjaSignificanceManager::AFutureNinjaSignificanceManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	UpdatePeriod = 0.25f;
+	MaxDistance = 5000.f;
+	ViewConeHalfAngle = 60.f;
+	OutOfViewScale = 0.4f;
+	ThreatRadius = 600.f;
+	ThreatSpeed = 600.f;
+	ThreatWeight = 0.3f;
+	HighThreshold = 0.6f;
+	MediumThreshold = 0.35f;
+	LowThreshold = 0.1f;
+	Hysteresis = 0.05f;
+
+	MediumSettings.TickInterval = 0.033f;
+	MediumSettings.AnimTickInterval = 0.033f;
+	MediumSettings.bOnlyAnimateWhenRendered = true;
+	MediumSettings.BehaviorTreeTickInterval = 0.033f;
+
+	LowSettings.TickInterval = 0.1f;
+	LowSettings.AnimTickInterval = 0.1f;
+	LowSettings.bOnlyAnimateWhenRendered = true;
+	LowSettings.BehaviorTreeTickInterval = 0.1f;
+
+	DormantSettings.TickInterval = 0.5f;
+	DormantSettings.AnimTickInterval = 0.5f;
+	DormantSettings.bOnlyAnimateWhenRendered = true;
+	// Still thinking a few times a second, so an enemy behind the player keeps coming
+	DormantSettings.BehaviorTreeTickInterval = 0.25f;
+
+	Cursor = 0;
+	FMemory::Memzero(BucketCounts);
+}
+
+AFutureNinjaSignificanceManager* AFutureNinjaSignificanceManager::Get(UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AFutureNinjaSignificanceManager> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<AFutureNinjaSignificanceManager>(SpawnParams);
+}
+
+void AFutureNinjaSignificanceManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	{
+		OnActorSpawned(*It);
+	}
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AFutureNinjaSignificanceManager::OnActorSpawned));
+}
+
+void AFutureNinjaSignificanceManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+
+	// Leave surviving enemies simulating at full rate
+	for (const FEntry& Entry : Entries)
+	{
+		if (Entry.Bucket != ESignificanceBucket::Num && Entry.Pawn.IsValid())
+		{
+			ApplySettings(Entry.Pawn.Get(), FSignificanceBucketSettings());
+		}
+	}
+	Entries.Reset();
+	FMemory::Memzero(BucketCounts);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFutureNinjaSignificanceManager::OnActorSpawned(AActor* Actor)
+{
+	APawn* Pawn = Cast<APawn>(Actor);
+	if (Pawn != nullptr && !Pawn->IsA<AFutureNinjaCharacter>() && !Pawn->IsPlayerControlled())
+	{
+		Register(Pawn);
+	}
+}
+
+void AFutureNinjaSignificanceManager::Register(APawn* Pawn)
+{
+	if (Pawn == nullptr || Entries.ContainsByPredicate([Pawn](const FEntry& Entry) { return Entry.Pawn == Pawn; }))
+	{
+		return;
+	}
+
+	// Scored on the next pass of the cursor; until then the pawn keeps its defaults
+	FEntry Entry;
+	Entry.Pawn = Pawn;
+	Entry.Bucket = ESignificanceBucket::Num;
+	Entries.Add(Entry);
+}
+
+void AFutureNinjaSignificanceManager::Unregister(APawn* Pawn)
+{
+	const int32 Index = Entries.IndexOfByPredicate([Pawn](const FEntry& Entry) { return Entry.Pawn == Pawn; });
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (Entries[Index].Bucket != ESignificanceBucket::Num)
+	{
+		--BucketCounts[(int32)Entries[Index].Bucket];
+		if (Pawn != nullptr)
+		{
+			ApplySettings(Pawn, FSignificanceBucketSettings());
+		}
+	}
+	Entries.RemoveAtSwap(Index, 1, false);
+}
+
+void AFutureNinjaSignificanceManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_SignificanceUpdate);
+
+	GatherViewPoints();
+	if (Entries.Num() == 0 || ViewPoints.Num() == 0)
+	{
+		return;
+	}
+
+	// Enough entries per tick that all of them are rescored once per UpdatePeriod
+	const int32 NumToUpdate = UpdatePeriod > 0.f
+		? FMath::Clamp(FMath::CeilToInt(Entries.Num() * DeltaSeconds / UpdatePeriod), 1, Entries.Num())
+		: Entries.Num();
+
+	for (int32 Step = 0; Step < NumToUpdate && Entries.Num() > 0; ++Step)
+	{
+		if (Cursor >= Entries.Num())
+		{
+			Cursor = 0;
+		}
+
+		FEntry& Entry = Entries[Cursor];
+		APawn* Pawn = Entry.Pawn.Get();
+		if (Pawn == nullptr || Pawn->IsPendingKill() || Pawn->IsPlayerControlled())
+		{
+			if (Entry.Bucket != ESignificanceBucket::Num)
+			{
+				--BucketCounts[(int32)Entry.Bucket];
+				if (Pawn != nullptr)
+				{
+					ApplySettings(Pawn, FSignificanceBucketSettings());
+				}
+			}
+
+			// The swapped in entry takes this slot and is visited next
+			Entries.RemoveAtSwap(Cursor, 1, false);
+			continue;
+		}
+
+		if (Pawn->bHidden)
+		{
+			// Pooled by the wave director; settings are reapplied once it is back in the fight
+			if (Entry.Bucket != ESignificanceBucket::Num)
+			{
+				--BucketCounts[(int32)Entry.Bucket];
+				Entry.Bucket = ESignificanceBucket::Num;
+			}
+		}
+		else
+		{
+			// On a co-op server an enemy matters as much as it does to the player nearest to it
+			const FVector PawnLocation = Pawn->GetActorLocation();
+			const FViewPoint* Nearest = &ViewPoints[0];
+			for (const FViewPoint& ViewPoint : ViewPoints)
+			{
+				if (FVector::DistSquared(ViewPoint.Location, PawnLocation) < FVector::DistSquared(Nearest->Location, PawnLocation))
+				{
+					Nearest = &ViewPoint;
+				}
+			}
+
+			const float Score = ScorePawn(Pawn, Nearest->Location, Nearest->Direction);
+			const ESignificanceBucket Bucket = PickBucket(Score, Entry.Bucket);
+			if (Bucket != Entry.Bucket)
+			{
+				if (Entry.Bucket != ESignificanceBucket::Num)
+				{
+					--BucketCounts[(int32)Entry.Bucket];
+				}
+				++BucketCounts[(int32)Bucket];
+				Entry.Bucket = Bucket;
+				ApplySettings(Pawn, GetSettings(Bucket));
+			}
+		}
+		++Cursor;
+	}
+
+	SET_DWORD_STAT(STAT_SignificanceHigh, BucketCounts[(int32)ESignificanceBucket::High]);
+	SET_DWORD_STAT(STAT_SignificanceMedium, BucketCounts[(int32)ESignificanceBucket::Medium]);
+	SET_DWORD_STAT(STAT_SignificanceLow, BucketCounts[(int32)ESignificanceBucket::Low]);
+	SET_DWORD_STAT(STAT_SignificanceDormant, BucketCounts[(int32)ESignificanceBucket::Dormant]);
+}
+
+float AFutureNinjaSignificanceManager::ScorePawn(const APawn* Pawn, const FVector& ViewLocation, const FVector& ViewDirection) const
+{
+	const FVector ToPawn = Pawn->GetActorLocation() - ViewLocation;
+	const float Distance = ToPawn.Size();
+	if (Distance <= ThreatRadius)
+	{
+		return 1.f + ThreatWeight;
+	}
+
+	float Score = 1.f - FMath::Clamp(Distance / FMath::Max(MaxDistance, 1.f), 0.f, 1.f);
+
+	const FVector Direction = ToPawn / Distance;
+	if (FVector::DotProduct(Direction, ViewDirection) < FMath::Cos(FMath::DegreesToRadians(ViewConeHalfAngle)))
+	{
+		Score *= OutOfViewScale;
+	}
+
+	// Anything closing in on the player matters, wherever it is
+	const float ClosingSpeed = -FVector::DotProduct(Pawn->GetVelocity(), Direction);
+	if (ClosingSpeed > 0.f && ThreatSpeed > 0.f)
+	{
+		Score += ThreatWeight * FMath::Min(ClosingSpeed / ThreatSpeed, 1.f);
+	}
+
+	return Score;
+}
+
+ESignificanceBucket AFutureNinjaSignificanceManager::PickBucket(float Score, ESignificanceBucket Current) const
+{
+	const float Thresholds[] = { HighThreshold, MediumThreshold, LowThreshold, -MAX_FLT };
+	const int32 CurrentIndex = (int32)Current;
+
+	if (Current == ESignificanceBucket::Num)
+	{
+		for (int32 Index = 0; Index < (int32)ESignificanceBucket::Num; ++Index)
+		{
+			if (Score >= Thresholds[Index])
+			{
+				return (ESignificanceBucket)Index;
+			}
+		}
+	}
+
+	// Promote to the most significant bucket cleared by the margin
+	for (int32 Index = 0; Index < CurrentIndex; ++Index)
+	{
+		if (Score >= Thresholds[Index] + Hysteresis)
+		{
+			return (ESignificanceBucket)Index;
+		}
+	}
+
+	// Demote once the current threshold is missed by the margin
+	if (Score < Thresholds[CurrentIndex] - Hysteresis)
+	{
+		for (int32 Index = CurrentIndex + 1; Index < (int32)ESignificanceBucket::Num; ++Index)
+		{
+			if (Score >= Thresholds[Index] - Hysteresis)
+			{
+				return (ESignificanceBucket)Index;
+			}
+		}
+	}
+
+	return Current;
+}
+
+const FSignificanceBucketSettings& AFutureNinjaSignificanceManager::GetSettings(ESignificanceBucket Bucket) const
+{
+	switch (Bucket)
+	{
+	case ESignificanceBucket::High:
+		return HighSettings;
+	case ESignificanceBucket::Medium:
+		return MediumSettings;
+	case ESignificanceBucket::Low:
+		return LowSettings;
+	default:
+		return DormantSettings;
+	}
+}
+
+void AFutureNinjaSignificanceManager::ApplySettings(APawn* Pawn, const FSignificanceBucketSettings& Settings)
+{
+	Pawn->SetActorTickInterval(Settings.TickInterval);
+
+	for (UActorComponent* Component : Pawn->GetComponents())
+	{
+		if (USkeletalMeshComponent* SkeletalMesh = Cast<USkeletalMeshComponent>(Component))
+		{
+			SkeletalMesh->SetComponentTickInterval(Settings.AnimTickInterval);
+			SkeletalMesh->MeshComponentUpdateFlag = Settings.bOnlyAnimateWhenRendered
+				? EMeshComponentUpdateFlag::OnlyTickPoseWhenRendered
+				: EMeshComponentUpdateFlag::AlwaysTickPoseAndRefreshBones;
+		}
+		else if (Component->IsA<UMovementComponent>())
+		{
+			Component->SetComponentTickInterval(Settings.TickInterval);
+		}
+	}
+
+	AAIController* AIController = Cast<AAIController>(Pawn->GetController());
+	if (AIController != nullptr)
+	{
+		AIController->SetActorTickInterval(Settings.TickInterval);
+
+		UBrainComponent* Brain = AIController->BrainComponent;
+		if (Brain != nullptr)
+		{
+			Brain->SetComponentTickInterval(Settings.BehaviorTreeTickInterval);
+		}
+	}
+}
+
+void AFutureNinjaSignificanceManager::GatherViewPoints()
+{
+	ViewPoints.Reset();
+
+	// Every player's controller exists where enemies have authority, remote ones included
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController == nullptr)
+		{
+			continue;
+		}
+
+		FViewPoint ViewPoint;
+		const AFutureNinjaCharacter* Character = Cast<AFutureNinjaCharacter>(PlayerController->GetPawn());
+		if (Character != nullptr && Character->GetFirstPersonCameraComponent() != nullptr)
+		{
+			const UCameraComponent* Camera = Character->GetFirstPersonCameraComponent();
+			ViewPoint.Location = Camera->GetComponentLocation();
+			ViewPoint.Direction = Camera->GetForwardVector();
+		}
+		else if (PlayerController->PlayerCameraManager != nullptr)
+		{
+			ViewPoint.Location = PlayerController->PlayerCameraManager->GetCameraLocation();
+			ViewPoint.Direction = PlayerController->PlayerCameraManager->GetCameraRotation().Vector();
+		}
+		else
+		{
+			continue;
+		}
+
+		ViewPoints.Add(ViewPoint);
+	}
+}
@@ -0,0 +1,183 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "FutureNinjaSignificanceManager.generated.h"
+
+/** How much of an enemy's simulation keeps running. */
+UENUM()
+enum class ESignificanceBucket : uint8
+{
+	High,
+	Medium,
+	Low,
+	/** Everything, the behavior tree included, ticking as rarely as allowed. */
+	Dormant,
+	Num UMETA(Hidden)
+};
+
+/** What an enemy in a bucket is allowed to run. */
+USTRUCT()
+struct FSignificanceBucketSettings
+{
+	GENERATED_BODY()
+
+	/** Tick interval of the actor and its movement component, 0 for every frame. */
+	UPROPERTY(EditAnywhere, Category = Significance)
+	float TickInterval;
+
+	/** Tick interval of skeletal meshes, which is how often their animation updates. */
+	UPROPERTY(EditAnywhere, Category = Significance)
+	float AnimTickInterval;
+
+	/** Only tick animation while the mesh is rendered. */
+	UPROPERTY(EditAnywhere, Category = Significance)
+	bool bOnlyAnimateWhenRendered;
+
+	/** Tick interval of the behavior tree, 0 for every frame. The tree is never paused, so enemies keep pursuing the player. */
+	UPROPERTY(EditAnywhere, Category = Significance)
+	float BehaviorTreeTickInterval;
+
+	FSignificanceBucketSettings()
+		: TickInterval(0.f), AnimTickInterval(0.f), bOnlyAnimateWhenRendered(false), BehaviorTreeTickInterval(0.f)
+	{}
+};
+
+/**
+ * Scales how much AI enemies simulate by how much they matter to the VR player.
+ *
+ * Each enemy is scored by its distance to the first person camera, whether it is inside the view cone and
+ * how threatening it is (close, or closing in fast). The score picks a bucket, with hysteresis so enemies on
+ * a threshold do not flicker, and the bucket sets tick intervals, animation rate and how often the behavior
+ * tree runs. Scores are refreshed round-robin so every enemy is revisited once per UpdatePeriod, and
+ * settings are only touched when an enemy changes bucket. There is no per-frame sort. With several
+ * players, each enemy is scored against the camera of the player nearest to it.
+ *
+ * Every non-player pawn spawned into the world is tracked. One manager exists per world; use Get() to
+ * find or create it.
+ */
+UCLASS(config=Game, notplaceable)
+class AFutureNinjaSignificanceManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFutureNinjaSignificanceManager();
+
+	/** Returns the manager for World, spawning it on first use. */
+	static AFutureNinjaSignificanceManager* Get(UWorld* World);
+
+	/** Starts tracking Pawn. Pawns are registered automatically when spawned. */
+	void Register(APawn* Pawn);
+
+	/** Stops tracking Pawn and restores full-rate simulation. */
+	void Unregister(APawn* Pawn);
+
+	/** Number of tracked enemies in Bucket. */
+	int32 GetBucketCount(ESignificanceBucket Bucket) const { return BucketCounts[(int32)Bucket]; }
+
+	/** Seconds over which every enemy is rescored once. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float UpdatePeriod;
+
+	/** Enemies further than this from the camera score zero for distance. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float MaxDistance;
+
+	/** Half angle of the view cone, in degrees. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float ViewConeHalfAngle;
+
+	/** Score multiplier for enemies outside the view cone. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float OutOfViewScale;
+
+	/** Enemies within this distance of the camera are always fully significant. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float ThreatRadius;
+
+	/** Speed towards the player, in cm/s, at which the threat term saturates. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float ThreatSpeed;
+
+	/** Weight of the closing speed in the score. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float ThreatWeight;
+
+	/** Lowest score of the High bucket. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float HighThreshold;
+
+	/** Lowest score of the Medium bucket. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float MediumThreshold;
+
+	/** Lowest score of the Low bucket; anything below is Dormant. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float LowThreshold;
+
+	/** An enemy only changes bucket once its score crosses a threshold by this much. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	float Hysteresis;
+
+	/** What each bucket runs. */
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	FSignificanceBucketSettings HighSettings;
+
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	FSignificanceBucketSettings MediumSettings;
+
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	FSignificanceBucketSettings LowSettings;
+
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	FSignificanceBucketSettings DormantSettings;
+
+	// AActor interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+	// End of AActor interface
+
+private:
+	struct FEntry
+	{
+		TWeakObjectPtr<APawn> Pawn;
+		/** Bucket whose settings are applied, or Num if none are */
+		ESignificanceBucket Bucket;
+	};
+
+	/** Scores Pawn against the viewer. */
+	float ScorePawn(const APawn* Pawn, const FVector& ViewLocation, const FVector& ViewDirection) const;
+
+	/** Returns the bucket for Score, staying in Current unless a threshold is crossed by Hysteresis. */
+	ESignificanceBucket PickBucket(float Score, ESignificanceBucket Current) const;
+
+	const FSignificanceBucketSettings& GetSettings(ESignificanceBucket Bucket) const;
+
+	/** Applies Settings to every part of Pawn it controls. */
+	static void ApplySettings(APawn* Pawn, const FSignificanceBucketSettings& Settings);
+
+	/** Finds the first person camera of every player, falling back to their player camera managers. */
+	void GatherViewPoints();
+
+	void OnActorSpawned(AActor* Actor);
+
+	/** Where a player's camera is and where it looks */
+	struct FViewPoint
+	{
+		FVector Location;
+		FVector Direction;
+	};
+
+	TArray<FEntry> Entries;
+	int32 Cursor;
+
+	/** Gathered at the start of every tick */
+	TArray<FViewPoint> ViewPoints;
+	int32 BucketCounts[(int32)ESignificanceBucket::Num];
+
+	FDelegateHandle ActorSpawnedHandle;
+};
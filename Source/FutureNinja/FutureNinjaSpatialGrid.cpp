@@ -0,0 +1,373 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaSpatialGrid.h"
+#include "FutureNinja.h"
+#include "FutureNinjaCharacter.h"
+#include "FutureNinjaProjectile.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+
+DECLARE_CYCLE_STAT(TEXT("Spatial Grid Update"), STAT_SpatialGridUpdate, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Spatial Grid Query"), STAT_SpatialGridQuery, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spatial Grid Actors"), STAT_SpatialGridActors, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spatial Grid Cells"), STAT_SpatialGridCells, STATGROUP_FutureNinja);
+
+static const int32 CellCoordBits = 21;
+static const int32 CellCoordBias = 1 << (CellCoordBits - 1);
+static const uint64 CellCoordMask = (1ull << CellCoordBits) - 1;
+
+AFutureNinjaSpatialGrid::AFutureNinjaSpatialGrid()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	// After movement and physics, so queries during the next frame see where everything ended up
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	CellSize = 500.f;
+	MaxCellsPerQuery = 512;
+	bTrackWorldActors = true;
+
+	FreeHead = INDEX_NONE;
+	NumInGrid = 0;
+}
+
+AFutureNinjaSpatialGrid* AFutureNinjaSpatialGrid::Get(UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AFutureNinjaSpatialGrid> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill() && It->bTrackWorldActors)
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<AFutureNinjaSpatialGrid>(SpawnParams);
+}
+
+void AFutureNinjaSpatialGrid::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!bTrackWorldActors)
+	{
+		return;
+	}
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		OnActorSpawned(*It);
+	}
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AFutureNinjaSpatialGrid::OnActorSpawned));
+}
+
+void AFutureNinjaSpatialGrid::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+
+	Entries.Reset();
+	Cells.Reset();
+	EntryIndices.Reset();
+	FreeHead = INDEX_NONE;
+	NumInGrid = 0;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFutureNinjaSpatialGrid::OnActorSpawned(AActor* Actor)
+{
+	if (Actor->IsA<AFutureNinjaProjectile>())
+	{
+		Register(Actor, ESpatialGridKind::Projectile);
+	}
+	else
+	{
+		APawn* Pawn = Cast<APawn>(Actor);
+		if (Pawn != nullptr && !Pawn->IsA<AFutureNinjaCharacter>() && !Pawn->IsPlayerControlled())
+		{
+			Register(Pawn, ESpatialGridKind::Enemy);
+		}
+	}
+}
+
+void AFutureNinjaSpatialGrid::Register(AActor* Actor, ESpatialGridKind Kind)
+{
+	if (Actor == nullptr || EntryIndices.Contains(Actor))
+	{
+		return;
+	}
+
+	int32 Index = FreeHead;
+	if (Index != INDEX_NONE)
+	{
+		FreeHead = Entries[Index].Next;
+	}
+	else
+	{
+		Index = Entries.AddDefaulted();
+	}
+
+	FEntry& Entry = Entries[Index];
+	Entry.Actor = Actor;
+	Entry.Location = Actor->GetActorLocation();
+	Entry.Cell = InvalidCell;
+	Entry.Prev = INDEX_NONE;
+	Entry.Next = INDEX_NONE;
+	Entry.Kind = Kind;
+	EntryIndices.Add(Actor, Index);
+
+	if (!Actor->bHidden)
+	{
+		Link(Index, ToCoords(Entry.Location));
+	}
+}
+
+void AFutureNinjaSpatialGrid::Unregister(AActor* Actor)
+{
+	int32 Index;
+	if (EntryIndices.RemoveAndCopyValue(Actor, Index))
+	{
+		FreeEntry(Index);
+	}
+}
+
+void AFutureNinjaSpatialGrid::FreeEntry(int32 Index)
+{
+	Unlink(Index);
+
+	FEntry& Entry = Entries[Index];
+	Entry.Actor = nullptr;
+	Entry.Next = FreeHead;
+	FreeHead = Index;
+}
+
+void AFutureNinjaSpatialGrid::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	UpdateAll();
+}
+
+void AFutureNinjaSpatialGrid::UpdateAll()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpatialGridUpdate);
+
+	for (auto It = EntryIndices.CreateIterator(); It; ++It)
+	{
+		const int32 Index = It.Value();
+		FEntry& Entry = Entries[Index];
+		AActor* Actor = Entry.Actor.Get();
+		if (Actor == nullptr || Actor->IsPendingKill())
+		{
+			It.RemoveCurrent();
+			FreeEntry(Index);
+			continue;
+		}
+
+		if (Actor->bHidden)
+		{
+			Unlink(Index);
+			continue;
+		}
+
+		// Only entries that crossed a cell border are relinked
+		Entry.Location = Actor->GetActorLocation();
+		const FIntVector Coords = ToCoords(Entry.Location);
+		if (Entry.Cell != ToKey(Coords))
+		{
+			Unlink(Index);
+			Link(Index, Coords);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_SpatialGridActors, NumInGrid);
+	SET_DWORD_STAT(STAT_SpatialGridCells, Cells.Num());
+}
+
+FIntVector AFutureNinjaSpatialGrid::ToCoords(const FVector& Location) const
+{
+	const float InvCellSize = 1.f / CellSize;
+	return FIntVector(
+		FMath::FloorToInt(Location.X * InvCellSize),
+		FMath::FloorToInt(Location.Y * InvCellSize),
+		FMath::FloorToInt(Location.Z * InvCellSize));
+}
+
+uint64 AFutureNinjaSpatialGrid::ToKey(const FIntVector& Coords)
+{
+	return ((uint64)((Coords.X + CellCoordBias) & CellCoordMask))
+		| ((uint64)((Coords.Y + CellCoordBias) & CellCoordMask) << CellCoordBits)
+		| ((uint64)((Coords.Z + CellCoordBias) & CellCoordMask) << (2 * CellCoordBits));
+}
+
+FIntVector AFutureNinjaSpatialGrid::FromKey(uint64 Key)
+{
+	return FIntVector(
+		(int32)(Key & CellCoordMask) - CellCoordBias,
+		(int32)((Key >> CellCoordBits) & CellCoordMask) - CellCoordBias,
+		(int32)((Key >> (2 * CellCoordBits)) & CellCoordMask) - CellCoordBias);
+}
+
+void AFutureNinjaSpatialGrid::Link(int32 Index, const FIntVector& Coords)
+{
+	FEntry& Entry = Entries[Index];
+	Entry.Cell = ToKey(Coords);
+
+	int32& Head = Cells.FindOrAdd(Entry.Cell, INDEX_NONE);
+	Entry.Prev = INDEX_NONE;
+	Entry.Next = Head;
+	if (Head != INDEX_NONE)
+	{
+		Entries[Head].Prev = Index;
+	}
+	Head = Index;
+	++NumInGrid;
+}
+
+void AFutureNinjaSpatialGrid::Unlink(int32 Index)
+{
+	FEntry& Entry = Entries[Index];
+	if (Entry.Cell == InvalidCell)
+	{
+		return;
+	}
+
+	if (Entry.Next != INDEX_NONE)
+	{
+		Entries[Entry.Next].Prev = Entry.Prev;
+	}
+	if (Entry.Prev != INDEX_NONE)
+	{
+		Entries[Entry.Prev].Next = Entry.Next;
+	}
+	else if (Entry.Next != INDEX_NONE)
+	{
+		Cells[Entry.Cell] = Entry.Next;
+	}
+	else
+	{
+		Cells.Remove(Entry.Cell);
+	}
+
+	Entry.Cell = InvalidCell;
+	Entry.Prev = INDEX_NONE;
+	Entry.Next = INDEX_NONE;
+	--NumInGrid;
+}
+
+template<typename VisitorType>
+void AFutureNinjaSpatialGrid::ForEachInBox(const FVector& Min, const FVector& Max, ESpatialGridKind Kinds, VisitorType Visit) const
+{
+	const FIntVector MinCoords = ToCoords(Min);
+	const FIntVector MaxCoords = ToCoords(Max);
+
+	auto VisitCell = [this, Kinds, &Visit](int32 Head)
+	{
+		for (int32 Index = Head; Index != INDEX_NONE; Index = Entries[Index].Next)
+		{
+			const FEntry& Entry = Entries[Index];
+			if (EnumHasAnyFlags(Entry.Kind, Kinds) && !Visit(Entry))
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	const int64 NumCovered = (int64)(MaxCoords.X - MinCoords.X + 1) * (MaxCoords.Y - MinCoords.Y + 1) * (MaxCoords.Z - MinCoords.Z + 1);
+	if (NumCovered > FMath::Min<int64>(MaxCellsPerQuery, Cells.Num()))
+	{
+		// Big query over a sparse grid; cheaper to look at what is occupied
+		for (const TPair<uint64, int32>& Cell : Cells)
+		{
+			const FIntVector Coords = FromKey(Cell.Key);
+			if (Coords.X >= MinCoords.X && Coords.X <= MaxCoords.X
+				&& Coords.Y >= MinCoords.Y && Coords.Y <= MaxCoords.Y
+				&& Coords.Z >= MinCoords.Z && Coords.Z <= MaxCoords.Z
+				&& !VisitCell(Cell.Value))
+			{
+				return;
+			}
+		}
+		return;
+	}
+
+	for (int32 Z = MinCoords.Z; Z <= MaxCoords.Z; ++Z)
+	{
+		for (int32 Y = MinCoords.Y; Y <= MaxCoords.Y; ++Y)
+		{
+			for (int32 X = MinCoords.X; X <= MaxCoords.X; ++X)
+			{
+				const int32* Head = Cells.Find(ToKey(FIntVector(X, Y, Z)));
+				if (Head != nullptr && !VisitCell(*Head))
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+int32 AFutureNinjaSpatialGrid::QuerySphere(const FVector& Center, float Radius, ESpatialGridKind Kinds, AActor** OutActors, int32 MaxActors) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpatialGridQuery);
+
+	int32 NumFound = 0;
+	if (MaxActors <= 0)
+	{
+		return NumFound;
+	}
+
+	const float RadiusSquared = FMath::Square(Radius);
+	ForEachInBox(Center - FVector(Radius), Center + FVector(Radius), Kinds, [&](const FEntry& Entry)
+	{
+		AActor* Actor = Entry.Actor.Get();
+		if (Actor != nullptr && FVector::DistSquared(Entry.Location, Center) <= RadiusSquared)
+		{
+			OutActors[NumFound++] = Actor;
+		}
+		return NumFound < MaxActors;
+	});
+	return NumFound;
+}
+
+int32 AFutureNinjaSpatialGrid::QueryCone(const FVector& Apex, const FVector& Direction, float Length, float HalfAngleDegrees, ESpatialGridKind Kinds, AActor** OutActors, int32 MaxActors) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpatialGridQuery);
+
+	int32 NumFound = 0;
+	if (MaxActors <= 0)
+	{
+		return NumFound;
+	}
+
+	// Box around the apex and the cap of the cone, which is enough for any angle up to 90 degrees
+	const FVector End = Apex + Direction * Length;
+	const float CapRadius = Length * FMath::Sin(FMath::DegreesToRadians(FMath::Min(HalfAngleDegrees, 90.f)));
+	const FVector Min = HalfAngleDegrees > 90.f ? Apex - FVector(Length) : Apex.ComponentMin(End) - FVector(CapRadius);
+	const FVector Max = HalfAngleDegrees > 90.f ? Apex + FVector(Length) : Apex.ComponentMax(End) + FVector(CapRadius);
+
+	const float LengthSquared = FMath::Square(Length);
+	const float CosHalfAngle = FMath::Cos(FMath::DegreesToRadians(HalfAngleDegrees));
+	ForEachInBox(Min, Max, Kinds, [&](const FEntry& Entry)
+	{
+		const FVector ToEntry = Entry.Location - Apex;
+		const float DistSquared = ToEntry.SizeSquared();
+		AActor* Actor = Entry.Actor.Get();
+		if (Actor != nullptr && DistSquared <= LengthSquared
+			&& (DistSquared < KINDA_SMALL_NUMBER || FVector::DotProduct(ToEntry, Direction) >= CosHalfAngle * FMath::Sqrt(DistSquared)))
+		{
+			OutActors[NumFound++] = Actor;
+		}
+		return NumFound < MaxActors;
+	});
+	return NumFound;
+}
@@ -0,0 +1,130 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "FutureNinjaSpatialGrid.generated.h"
+
+/** What a registered actor is, so queries can ask for only some of them. */
+enum class ESpatialGridKind : uint8
+{
+	Enemy = 1 << 0,
+	Projectile = 1 << 1,
+
+	All = 0xff
+};
+ENUM_CLASS_FLAGS(ESpatialGridKind);
+
+/**
+ * Uniform spatial hash of live enemies and kunai for cheap proximity queries (homing, area damage,
+ * crowding) without going through the physics scene.
+ *
+ * Actors are bucketed into cubic cells hashed by their packed coordinates, each cell being an
+ * intrusive list through the entry array. Every tick the cached location of each entry is refreshed and
+ * the entry is only relinked when it crossed into another cell. Hidden actors, i.e. pooled kunai and
+ * pooled enemies, are kept registered but out of every cell. Queries test the cached locations, so they
+ * see positions as of the last grid tick, and write into caller-provided buffers without allocating.
+ *
+ * Every non-player pawn and every AFutureNinjaProjectile spawned into the world is registered. Kunai
+ * simulated by AFutureNinjaProjectileManager are not actors and are not in the grid. One grid exists per
+ * world; use Get() to find or create it. Grids spawned with bTrackWorldActors cleared, e.g. by benchmarks,
+ * only hold what is registered by hand and are never returned by Get().
+ */
+UCLASS(config=Game, notplaceable)
+class AFutureNinjaSpatialGrid : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFutureNinjaSpatialGrid();
+
+	/** Returns the grid for World, spawning it on first use. */
+	static AFutureNinjaSpatialGrid* Get(UWorld* World);
+
+	/** Starts tracking Actor as Kind. Enemies and kunai are registered automatically when spawned. */
+	void Register(AActor* Actor, ESpatialGridKind Kind);
+
+	/** Stops tracking Actor. */
+	void Unregister(AActor* Actor);
+
+	/** Refreshes every cached location now instead of waiting for the next tick. */
+	void UpdateAll();
+
+	/**
+	 * Finds the actors within Radius of Center.
+	 * @param Kinds			Only actors of these kinds are returned
+	 * @param OutActors		Receives up to MaxActors actors, in no particular order
+	 * @returns the number of actors written to OutActors
+	 */
+	int32 QuerySphere(const FVector& Center, float Radius, ESpatialGridKind Kinds, AActor** OutActors, int32 MaxActors) const;
+
+	/**
+	 * Finds the actors within Length of Apex and within HalfAngleDegrees of Direction, which must be normalized.
+	 * @returns the number of actors written to OutActors
+	 */
+	int32 QueryCone(const FVector& Apex, const FVector& Direction, float Length, float HalfAngleDegrees, ESpatialGridKind Kinds, AActor** OutActors, int32 MaxActors) const;
+
+	/** Number of actors currently in a cell. */
+	int32 GetNumInGrid() const { return NumInGrid; }
+
+	/** Edge length of a cell. Should be about the radius of the common queries. */
+	UPROPERTY(Config, EditAnywhere, Category = Grid)
+	float CellSize;
+
+	/** Queries covering more cells than this, or than are occupied, walk the occupied cells instead of the covered ones. */
+	UPROPERTY(Config, EditAnywhere, Category = Grid)
+	int32 MaxCellsPerQuery;
+
+	/** Register the world's enemies and kunai at BeginPlay and as they spawn. Must be set before BeginPlay. */
+	UPROPERTY(Transient)
+	uint32 bTrackWorldActors : 1;
+
+	// AActor interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+	// End of AActor interface
+
+private:
+	struct FEntry
+	{
+		TWeakObjectPtr<AActor> Actor;
+		/** Location at the last update */
+		FVector Location;
+		/** Key of the cell the entry is linked into, or InvalidCell */
+		uint64 Cell;
+		/** Neighbours in the cell list, or in the free list for unused entries */
+		int32 Prev;
+		int32 Next;
+		ESpatialGridKind Kind;
+	};
+
+	static const uint64 InvalidCell = ~0ull;
+
+	FIntVector ToCoords(const FVector& Location) const;
+	/** Packs cell coordinates into 21 bits each; exact for any level that fits in +-2^20 cells. */
+	static uint64 ToKey(const FIntVector& Coords);
+	static FIntVector FromKey(uint64 Key);
+
+	void Link(int32 Index, const FIntVector& Coords);
+	void Unlink(int32 Index);
+	void FreeEntry(int32 Index);
+
+	/** Calls Visit with every entry of the given kinds whose cell overlaps the box, stopping when it returns false. */
+	template<typename VisitorType>
+	void ForEachInBox(const FVector& Min, const FVector& Max, ESpatialGridKind Kinds, VisitorType Visit) const;
+
+	void OnActorSpawned(AActor* Actor);
+
+	TArray<FEntry> Entries;
+	/** Head entry of every occupied cell */
+	TMap<uint64, int32> Cells;
+	TMap<TWeakObjectPtr<AActor>, int32> EntryIndices;
+
+	/** First unused entry */
+	int32 FreeHead;
+	int32 NumInGrid;
+
+	FDelegateHandle ActorSpawnedHandle;
+};
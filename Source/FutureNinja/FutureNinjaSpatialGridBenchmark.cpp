@@ -0,0 +1,149 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaSpatialGridBenchmark.h"
+#include "FutureNinjaSpatialGrid.h"
+#include "Components/SphereComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSpatialGridBenchmark, Log, All);
+
+static void RunSpatialGridBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	FFutureNinjaSpatialGridBenchmark::Run(World, *FString::Join(Args, TEXT(" ")));
+}
+
+static FAutoConsoleCommandWithWorldAndArgs RunSpatialGridBenchmarkCommand(
+	TEXT("FutureNinja.SpatialGridBenchmark"),
+	TEXT("Times spatial grid queries against OverlapMultiByChannel at 10, 100 and 1000 actors. Accepts Queries=, Radius= and Extent= overrides."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunSpatialGridBenchmark));
+
+bool FFutureNinjaSpatialGridBenchmark::Run(UWorld* World, const TCHAR* Params)
+{
+	if (World == nullptr)
+	{
+		return false;
+	}
+
+	int32 NumQueries = 10000;
+	float Radius = 500.f;
+	float Extent = 5000.f;
+	FParse::Value(Params, TEXT("Queries="), NumQueries);
+	FParse::Value(Params, TEXT("Radius="), Radius);
+	FParse::Value(Params, TEXT("Extent="), Extent);
+	NumQueries = FMath::Max(NumQueries, 1);
+
+	// Far from the level so its own geometry does not show up in the overlaps
+	const FVector Origin(0.f, 0.f, 100000.f);
+	const ECollisionChannel Channel = ECC_WorldDynamic;
+	const int32 ActorCounts[] = { 10, 100, 1000 };
+	const int32 MaxResults = 1024;
+
+	AActor* Results[MaxResults];
+	TArray<FOverlapResult> Overlaps;
+	Overlaps.Reserve(MaxResults);
+	FCollisionQueryParams QueryParams(FName(TEXT("SpatialGridBenchmark")), false);
+
+	FString Csv = TEXT("Actors,Queries,OverlapUsPerQuery,GridUsPerQuery,GridUpdateUs,OverlapHits,GridHits\n");
+
+	for (const int32 NumActors : ActorCounts)
+	{
+		FRandomStream Random(1337);
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.ObjectFlags |= RF_Transient;
+
+		// A grid that only knows the benchmark actors: it skips the world's actors and is invisible to Get()
+		FActorSpawnParameters GridSpawnParams = SpawnParams;
+		GridSpawnParams.bDeferConstruction = true;
+		AFutureNinjaSpatialGrid* Grid = World->SpawnActor<AFutureNinjaSpatialGrid>(GridSpawnParams);
+		Grid->bTrackWorldActors = false;
+		Grid->FinishSpawning(FTransform::Identity);
+		Grid->SetActorTickEnabled(false);
+
+		TArray<AActor*> Actors;
+		for (int32 Index = 0; Index < NumActors; ++Index)
+		{
+			const FVector Location = Origin + FVector(Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent * 0.1f, Extent * 0.1f));
+			AActor* Actor = World->SpawnActor<AActor>(AActor::StaticClass(), Location, FRotator::ZeroRotator, SpawnParams);
+
+			USphereComponent* Sphere = NewObject<USphereComponent>(Actor);
+			Sphere->InitSphereRadius(1.f);
+			Sphere->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+			Sphere->SetCollisionObjectType(Channel);
+			Sphere->SetCollisionResponseToAllChannels(ECR_Overlap);
+			Actor->SetRootComponent(Sphere);
+			Sphere->RegisterComponent();
+			Actor->SetActorLocation(Location);
+
+			Grid->Register(Actor, ESpatialGridKind::Enemy);
+			Actors.Add(Actor);
+		}
+
+		TArray<FVector> Centers;
+		Centers.Reserve(NumQueries);
+		for (int32 Index = 0; Index < NumQueries; ++Index)
+		{
+			Centers.Add(Origin + FVector(Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), 0.f));
+		}
+
+		int64 OverlapHits = 0;
+		const double OverlapStart = FPlatformTime::Seconds();
+		for (const FVector& Center : Centers)
+		{
+			World->OverlapMultiByChannel(Overlaps, Center, FQuat::Identity, Channel, FCollisionShape::MakeSphere(Radius), QueryParams);
+			OverlapHits += Overlaps.Num();
+		}
+		const double OverlapSeconds = FPlatformTime::Seconds() - OverlapStart;
+
+		int64 GridHits = 0;
+		const double GridStart = FPlatformTime::Seconds();
+		for (const FVector& Center : Centers)
+		{
+			GridHits += Grid->QuerySphere(Center, Radius, ESpatialGridKind::All, Results, MaxResults);
+		}
+		const double GridSeconds = FPlatformTime::Seconds() - GridStart;
+
+		// Move everything a little, as a frame of walking enemies would, and time the incremental update
+		for (AActor* Actor : Actors)
+		{
+			Actor->SetActorLocation(Actor->GetActorLocation() + FVector(Random.FRandRange(-50.f, 50.f), Random.FRandRange(-50.f, 50.f), 0.f));
+		}
+		const double UpdateStart = FPlatformTime::Seconds();
+		Grid->UpdateAll();
+		const double UpdateSeconds = FPlatformTime::Seconds() - UpdateStart;
+
+		const double OverlapUs = OverlapSeconds * 1000000.0 / NumQueries;
+		const double GridUs = GridSeconds * 1000000.0 / NumQueries;
+		UE_LOG(LogSpatialGridBenchmark, Display, TEXT("%4d actors: OverlapMultiByChannel %.3fus/query, grid %.3fus/query (%.1fx), grid update %.1fus; hits %lld vs %lld"),
+			NumActors, OverlapUs, GridUs, GridUs > 0.0 ? OverlapUs / GridUs : 0.0, UpdateSeconds * 1000000.0, OverlapHits, GridHits);
+		if (OverlapHits != GridHits)
+		{
+			UE_LOG(LogSpatialGridBenchmark, Warning, TEXT("Grid and overlap disagree on the number of hits; overlap tests the sphere bounds, the grid the actor origin"));
+		}
+
+		Csv += FString::Printf(TEXT("%d,%d,%.4f,%.4f,%.2f,%lld,%lld\n"), NumActors, NumQueries, OverlapUs, GridUs, UpdateSeconds * 1000000.0, OverlapHits, GridHits);
+
+		for (AActor* Actor : Actors)
+		{
+			Actor->Destroy();
+		}
+		Grid->Destroy();
+	}
+
+	const FString Directory = FPaths::ProfilingDir();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*Directory);
+
+	const FString FileName = Directory / FString::Printf(TEXT("SpatialGridBenchmark-%s.csv"), *FDateTime::Now().ToString());
+	if (!FFileHelper::SaveStringToFile(Csv, *FileName))
+	{
+		UE_LOG(LogSpatialGridBenchmark, Error, TEXT("Failed to write %s"), *FileName);
+		return false;
+	}
+	return true;
+}
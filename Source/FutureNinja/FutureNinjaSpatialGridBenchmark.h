@@ -0,0 +1,25 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UWorld;
+
+/**
+ * Microbenchmark of AFutureNinjaSpatialGrid against OverlapMultiByChannel.
+ *
+ * For 10, 100 and 1,000 actors scattered in a box, spawns bare actors with an overlapping sphere each,
+ * registers them with a private grid and times the same random sphere queries through both paths. The
+ * grid is also timed while every actor moves, to cover the incremental update. Results are logged and
+ * written to a CSV in the profiling directory. Runs synchronously and cleans up after itself.
+ *
+ * Run with: FutureNinja.SpatialGridBenchmark [Queries=N] [Radius=N] [Extent=N], or -SpatialGridBenchmark
+ * on the command line to run it once the game starts and exit.
+ */
+class FFutureNinjaSpatialGridBenchmark
+{
+public:
+	/** Runs every actor count in World. @returns false if the report could not be written */
+	static bool Run(UWorld* World, const TCHAR* Params);
+};
@@ -0,0 +1,135 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaSpringArmComponent.h"
+#include "FutureNinja.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSpringArm, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Spring Arm Probe"), STAT_SpringArmProbe, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spring Arm Probes Skipped"), STAT_SpringArmProbesSkipped, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spring Arm Probes Coherent"), STAT_SpringArmProbesCoherent, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spring Arm Probes Full"), STAT_SpringArmProbesFull, STATGROUP_FutureNinja);
+
+UFutureNinjaSpringArmComponent::UFutureNinjaSpringArmComponent()
+{
+	bReuseProbes = true;
+	ProbeReuseDistance = 0.5f;
+	MaxProbeAge = 0.25f;
+
+	ProbedOrigin = FVector::ZeroVector;
+	ProbedDesired = FVector::ZeroVector;
+	ProbedFraction = 1.f;
+	bProbeBlocked = false;
+	ProbeAge = 0.f;
+	bHasProbe = false;
+}
+
+void UFutureNinjaSpringArmComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UE_LOG(LogSpringArm, Log, TEXT("Spring arm probes: %d skipped, %d coherent, %d full"),
+		ProbeStats.ProbesSkipped, ProbeStats.CoherentProbes, ProbeStats.FullProbes);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UFutureNinjaSpringArmComponent::UpdateDesiredArmLocation(bool bDoTrace, bool bDoLocationLag, bool bDoRotationLag, float DeltaTime)
+{
+	// Lay the arm out without collision; it leaves both ends in PreviousArmOrigin and UnfixedCameraPosition
+	Super::UpdateDesiredArmLocation(false, bDoLocationLag, bDoRotationLag, DeltaTime);
+
+	if (!bDoTrace || TargetArmLength == 0.f)
+	{
+		bHasProbe = false;
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_SpringArmProbe);
+
+	const FVector Origin = PreviousArmOrigin;
+	const FVector Desired = UnfixedCameraPosition;
+	ProbeAge += DeltaTime;
+
+	const float ReuseDistanceSquared = FMath::Square(ProbeReuseDistance);
+	if (bReuseProbes && bHasProbe && ProbeAge < MaxProbeAge
+		&& FVector::DistSquared(Origin, ProbedOrigin) <= ReuseDistanceSquared
+		&& FVector::DistSquared(Desired, ProbedDesired) <= ReuseDistanceSquared)
+	{
+		++ProbeStats.ProbesSkipped;
+		INC_DWORD_STAT(STAT_SpringArmProbesSkipped);
+	}
+	else
+	{
+		bProbeBlocked = ProbeArm(Origin, Desired, ProbedFraction);
+		ProbedOrigin = Origin;
+		ProbedDesired = Desired;
+		ProbeAge = 0.f;
+		bHasProbe = true;
+	}
+
+	// Same placement as the stock arm, from the stored fraction instead of a fresh hit
+	const FVector HitLocation = Origin + (Desired - Origin) * ProbedFraction;
+	const FVector ResultLocation = BlendLocations(Desired, HitLocation, bProbeBlocked, DeltaTime);
+	if (ResultLocation != Desired)
+	{
+		bIsCameraFixed = true;
+
+		const FTransform WorldCameraTransform(PreviousDesiredRot, ResultLocation);
+		const FTransform RelativeCameraTransform = WorldCameraTransform.GetRelativeTransform(GetComponentTransform());
+		RelativeSocketLocation = RelativeCameraTransform.GetLocation();
+		RelativeSocketRotation = RelativeCameraTransform.GetRotation();
+		UpdateChildTransforms();
+	}
+}
+
+bool UFutureNinjaSpringArmComponent::ProbeArm(const FVector& Origin, const FVector& Desired, float& OutFraction)
+{
+	OutFraction = 1.f;
+
+	const float ArmLength = (Desired - Origin).Size();
+	if (ArmLength <= KINDA_SMALL_NUMBER)
+	{
+		LastHitComponent.Reset();
+		return false;
+	}
+
+	const FCollisionShape Shape = FCollisionShape::MakeSphere(ProbeSize);
+	const FCollisionQueryParams QueryParams(FName(TEXT("SpringArm")), false, GetOwner());
+	FHitResult Hit;
+
+	// Geometry rarely moves between probes: if the last blocker still blocks, only what lies in front of it can be closer
+	UPrimitiveComponent* LastHit = LastHitComponent.Get();
+	if (LastHit != nullptr && LastHit->IsCollisionEnabled() && LastHit->GetCollisionResponseToChannel(ProbeChannel) == ECR_Block
+		&& LastHit->SweepComponent(Hit, Origin, Desired, FQuat::Identity, Shape))
+	{
+		const FVector LastHitLocation = Hit.Location;
+		++ProbeStats.CoherentProbes;
+		INC_DWORD_STAT(STAT_SpringArmProbesCoherent);
+
+		if (GetWorld()->SweepSingleByChannel(Hit, Origin, LastHitLocation, FQuat::Identity, ProbeChannel, Shape, QueryParams))
+		{
+			LastHitComponent = Hit.GetComponent();
+			OutFraction = (Hit.Location - Origin).Size() / ArmLength;
+		}
+		else
+		{
+			OutFraction = (LastHitLocation - Origin).Size() / ArmLength;
+		}
+		return true;
+	}
+
+	++ProbeStats.FullProbes;
+	INC_DWORD_STAT(STAT_SpringArmProbesFull);
+
+	if (GetWorld()->SweepSingleByChannel(Hit, Origin, Desired, FQuat::Identity, ProbeChannel, Shape, QueryParams))
+	{
+		LastHitComponent = Hit.GetComponent();
+		OutFraction = (Hit.Location - Origin).Size() / ArmLength;
+		return true;
+	}
+
+	LastHitComponent.Reset();
+	return false;
+}
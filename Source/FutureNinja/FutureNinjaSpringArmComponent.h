@@ -0,0 +1,97 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/SpringArmComponent.h"
+#include "FutureNinjaSpringArmComponent.generated.h"
+
+class UPrimitiveComponent;
+
+/** Running counters of the spring arm's collision probes. */
+USTRUCT(BlueprintType)
+struct FSpringArmProbeStats
+{
+	GENERATED_BODY()
+
+	/** Frames that reused the previous probe because the arm had not moved. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
+	int32 ProbesSkipped;
+
+	/** Probes answered by the primitive the previous probe hit, plus a sweep up to that hit. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
+	int32 CoherentProbes;
+
+	/** Probes that swept the whole arm against the world. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera)
+	int32 FullProbes;
+
+	FSpringArmProbeStats()
+		: ProbesSkipped(0), CoherentProbes(0), FullProbes(0)
+	{}
+};
+
+/**
+ * Spring arm that does not sweep the world when it does not have to.
+ *
+ * The arm is laid out by the stock spring arm, lag included, and only the collision probe is replaced. While
+ * both ends of the arm stay within ProbeReuseDistance of where they were at the last probe, and that probe is
+ * younger than MaxProbeAge, the camera is pulled in by the same fraction of the arm as then. When a probe is
+ * needed and the last one hit something, that primitive is tested first; if it is still in the way, only the
+ * part of the arm in front of it is swept against the world. Otherwise the whole arm is swept.
+ */
+UCLASS(ClassGroup=(FutureNinja), config=Game, meta=(BlueprintSpawnableComponent))
+class UFutureNinjaSpringArmComponent : public USpringArmComponent
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaSpringArmComponent();
+
+	/** Reuse the last probe while the arm stays put. */
+	UPROPERTY(Config, EditAnywhere, Category = CameraCollision)
+	uint32 bReuseProbes : 1;
+
+	/** How far either end of the arm may move before the world is probed again. */
+	UPROPERTY(Config, EditAnywhere, Category = CameraCollision, meta = (ClampMin = "0.0"))
+	float ProbeReuseDistance;
+
+	/** Longest a probe is reused, so moving geometry is noticed even while the arm stands still. */
+	UPROPERTY(Config, EditAnywhere, Category = CameraCollision, meta = (ClampMin = "0.0"))
+	float MaxProbeAge;
+
+	/** Returns the probe counters. */
+	const FSpringArmProbeStats& GetProbeStats() const { return ProbeStats; }
+
+	// UActorComponent interface
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// End of UActorComponent interface
+
+protected:
+	// USpringArmComponent interface
+	virtual void UpdateDesiredArmLocation(bool bDoTrace, bool bDoLocationLag, bool bDoRotationLag, float DeltaTime) override;
+	// End of USpringArmComponent interface
+
+	/**
+	 * Finds how far along the arm from Origin to Desired the probe sphere can go.
+	 * @returns true if something blocks the arm, with OutFraction set to the free part of it
+	 */
+	bool ProbeArm(const FVector& Origin, const FVector& Desired, float& OutFraction);
+
+private:
+	/** Ends of the arm at the last probe */
+	FVector ProbedOrigin;
+	FVector ProbedDesired;
+
+	/** Result of the last probe */
+	float ProbedFraction;
+	bool bProbeBlocked;
+	float ProbeAge;
+	bool bHasProbe;
+
+	/** What the last probe hit, tested first by the next one */
+	TWeakObjectPtr<UPrimitiveComponent> LastHitComponent;
+
+	UPROPERTY(Transient)
+	FSpringArmProbeStats ProbeStats;
+};
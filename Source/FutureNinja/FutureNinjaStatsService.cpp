@@ -0,0 +1,425 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaStatsService.h"
+#include "FutureNinja.h"
+#include "FutureNinjaCharacter.h"
+#include "FutureNinjaHUD.h"
+#include "FutureNinjaProjectile.h"
+#include "Async/Async.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogStatsService, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Stats Service Drain"), STAT_StatsServiceDrain, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Stat Events"), STAT_StatEvents, STATGROUP_FutureNinja);
+
+static const uint32 SessionLogMagic = 0x464E5353; // 'FNSS'
+static const int32 SessionLogVersion = 1;
+
+/** Services between BeginPlay and EndPlay, at most one per world, so Find() never walks the actors */
+static TArray<AFutureNinjaStatsService*> ServicesInPlay;
+
+AFutureNinjaStatsService::AFutureNinjaStatsService()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	// After gameplay and physics, so the events of this frame are counted in it
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	PointsPerHit = 10;
+	PointsPerKill = 100;
+	MaxStreakMultiplier = 5;
+	DamagePerHit = 25;
+	KillCreditSeconds = 5.f;
+	KillStreakWindow = 4.f;
+	RollingWindowSeconds = 10.f;
+	bWriteSessionLog = true;
+	LogFlushBytes = 4096;
+
+	NewestSecond = 0;
+	NotifiedSecond = 0;
+	WindowKills = 0;
+	WindowDamage = 0;
+	LastKillTime = -BIG_NUMBER;
+	SessionStartSeconds = 0.0;
+	LastLoggedTime = 0.f;
+	EventsLogged = 0;
+}
+
+AFutureNinjaStatsService* AFutureNinjaStatsService::Find(UWorld* World)
+{
+	// Called on every kunai hit; there are only ever as many services as worlds in play
+	for (AFutureNinjaStatsService* Service : ServicesInPlay)
+	{
+		if (Service->GetWorld() == World)
+		{
+			return Service;
+		}
+	}
+	return nullptr;
+}
+
+AFutureNinjaStatsService* AFutureNinjaStatsService::Get(UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	// Also finds a service spawned before the world began play
+	for (TActorIterator<AFutureNinjaStatsService> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<AFutureNinjaStatsService>(SpawnParams);
+}
+
+void AFutureNinjaStatsService::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ServicesInPlay.AddUnique(this);
+	SessionStartSeconds = FPlatformTime::Seconds();
+
+	Buckets.SetNumZeroed(FMath::Max(FMath::CeilToInt(RollingWindowSeconds), 1));
+	NewestSecond = 0;
+	WindowKills = 0;
+	WindowDamage = 0;
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		OnActorSpawned(*It);
+	}
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AFutureNinjaStatsService::OnActorSpawned));
+
+	if (bWriteSessionLog)
+	{
+		LogPath = FPaths::ProfilingDir() / TEXT("SessionStats") / FString::Printf(TEXT("%s-%s.fnstats"), *GetWorld()->GetMapName(), *FDateTime::Now().ToString());
+
+		FMemoryWriter Writer(LogBuffer);
+		uint32 Magic = SessionLogMagic;
+		int32 Version = SessionLogVersion;
+		int64 StartTicks = FDateTime::UtcNow().GetTicks();
+		FString MapName = GetWorld()->GetMapName();
+		Writer << Magic << Version << StartTicks << MapName;
+	}
+
+	Notify();
+}
+
+void AFutureNinjaStatsService::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	ServicesInPlay.RemoveSingleSwap(this);
+	LastCreditTimes.Reset();
+
+	// Events queued this frame still belong to the session
+	FFutureNinjaStatEventRecord Event;
+	while (Queue.Dequeue(Event))
+	{
+		Apply(Event);
+	}
+
+	if (bWriteSessionLog)
+	{
+		FlushLog(true);
+		UE_LOG(LogStatsService, Log, TEXT("Wrote %d stat events to %s"), EventsLogged, *LogPath);
+	}
+
+	UE_LOG(LogStatsService, Log, TEXT("Session stats: score %d, %d kills, best streak %d, %d hits, %d damage"),
+		Stats.Score, Stats.Kills, Stats.BestKillStreak, Stats.Hits, Stats.Damage);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AFutureNinjaStatsService::PushEvent(EFutureNinjaStatEvent Type, int32 Amount)
+{
+	FFutureNinjaStatEventRecord Event;
+	Event.Type = Type;
+	Event.Amount = Amount;
+	Event.Time = GetSessionTime();
+	Queue.Enqueue(Event);
+}
+
+float AFutureNinjaStatsService::GetSessionTime() const
+{
+	return (float)(FPlatformTime::Seconds() - SessionStartSeconds);
+}
+
+void AFutureNinjaStatsService::OnActorSpawned(AActor* Actor)
+{
+	APawn* Pawn = Cast<APawn>(Actor);
+	if (Pawn != nullptr && !Pawn->IsA<AFutureNinjaCharacter>() && !Pawn->IsPlayerControlled())
+	{
+		Pawn->OnTakeAnyDamage.AddUniqueDynamic(this, &AFutureNinjaStatsService::OnEnemyDamaged);
+		Pawn->OnDestroyed.AddUniqueDynamic(this, &AFutureNinjaStatsService::OnEnemyDestroyed);
+	}
+}
+
+void AFutureNinjaStatsService::AddEnemyHit(APawn* Enemy)
+{
+	PushEvent(EFutureNinjaStatEvent::EnemyHit);
+	if (Enemy != nullptr)
+	{
+		LastCreditTimes.Add(Enemy, GetSessionTime());
+	}
+}
+
+void AFutureNinjaStatsService::OnEnemyDamaged(AActor* DamagedActor, float Damage, const UDamageType* DamageType, AController* InstigatedBy, AActor* DamageCauser)
+{
+	const bool bByPlayer = (InstigatedBy != nullptr && InstigatedBy->IsPlayerController()) || Cast<AFutureNinjaProjectile>(DamageCauser) != nullptr;
+	if (Damage > 0.f && bByPlayer)
+	{
+		LastCreditTimes.Add(CastChecked<APawn>(DamagedActor), GetSessionTime());
+	}
+}
+
+void AFutureNinjaStatsService::OnEnemyDestroyed(AActor* DestroyedActor)
+{
+	ReportEnemyRemoved(Cast<APawn>(DestroyedActor));
+}
+
+void AFutureNinjaStatsService::ReportEnemyRemoved(APawn* Enemy)
+{
+	float CreditTime = 0.f;
+	if (Enemy != nullptr && LastCreditTimes.RemoveAndCopyValue(Enemy, CreditTime) && GetSessionTime() - CreditTime <= KillCreditSeconds)
+	{
+		PushEvent(EFutureNinjaStatEvent::Kill);
+	}
+}
+
+void AFutureNinjaStatsService::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_StatsServiceDrain);
+
+	int32 NumEvents = 0;
+	FFutureNinjaStatEventRecord Event;
+	while (Queue.Dequeue(Event))
+	{
+		Apply(Event);
+		++NumEvents;
+	}
+	SET_DWORD_STAT(STAT_StatEvents, NumEvents);
+
+	const float Now = GetSessionTime();
+	if (Stats.KillStreak > 0 && Now - LastKillTime > KillStreakWindow)
+	{
+		Stats.KillStreak = 0;
+	}
+	AdvanceWindow(Now);
+
+	// The rates change every tick until the window fills, so they alone only notify when a second rolls over
+	if (!Stats.HasSameTotals(NotifiedStats) || NewestSecond != NotifiedSecond)
+	{
+		if (NewestSecond != NotifiedSecond)
+		{
+			PruneCredit(Now);
+		}
+		Notify();
+	}
+
+	if (bWriteSessionLog && LogBuffer.Num() >= LogFlushBytes)
+	{
+		FlushLog(false);
+	}
+}
+
+void AFutureNinjaStatsService::Apply(const FFutureNinjaStatEventRecord& Event)
+{
+	AdvanceWindow(Event.Time);
+	FWindowBucket& Bucket = Buckets[NewestSecond % Buckets.Num()];
+
+	switch (Event.Type)
+	{
+	case EFutureNinjaStatEvent::Hit:
+		Stats.Hits += Event.Amount;
+		break;
+	case EFutureNinjaStatEvent::EnemyHit:
+		Stats.Hits += Event.Amount;
+		Stats.Damage += Event.Amount * DamagePerHit;
+		Stats.Score += Event.Amount * PointsPerHit;
+		Bucket.Damage += Event.Amount * DamagePerHit;
+		WindowDamage += Event.Amount * DamagePerHit;
+		break;
+	case EFutureNinjaStatEvent::Kill:
+		if (Event.Time - LastKillTime > KillStreakWindow)
+		{
+			Stats.KillStreak = 0;
+		}
+		LastKillTime = Event.Time;
+		Stats.Kills += Event.Amount;
+		Stats.KillStreak += Event.Amount;
+		Stats.BestKillStreak = FMath::Max(Stats.BestKillStreak, Stats.KillStreak);
+		Stats.Score += Event.Amount * PointsPerKill * FMath::Clamp(Stats.KillStreak, 1, FMath::Max(MaxStreakMultiplier, 1));
+		Bucket.Kills += Event.Amount;
+		WindowKills += Event.Amount;
+		break;
+	}
+
+	if (bWriteSessionLog)
+	{
+		LogEvent(Event);
+	}
+}
+
+void AFutureNinjaStatsService::AdvanceWindow(float Time)
+{
+	// Events from other threads can be stamped slightly before ones already counted; they join the newest bucket
+	const int32 Second = FMath::FloorToInt(Time);
+	const int32 NumToClear = FMath::Min(Second - NewestSecond, Buckets.Num());
+	for (int32 Step = 1; Step <= NumToClear; ++Step)
+	{
+		FWindowBucket& Bucket = Buckets[(NewestSecond + Step) % Buckets.Num()];
+		WindowKills -= Bucket.Kills;
+		WindowDamage -= Bucket.Damage;
+		Bucket.Kills = 0;
+		Bucket.Damage = 0;
+	}
+	NewestSecond = FMath::Max(NewestSecond, Second);
+
+	// Early in the session the window only covers the seconds played so far
+	const float WindowSeconds = FMath::Clamp(Time, 1.f, (float)Buckets.Num());
+	Stats.KillsPerMinute = WindowKills * 60.f / WindowSeconds;
+	Stats.DamagePerSecond = WindowDamage / WindowSeconds;
+}
+
+void AFutureNinjaStatsService::PruneCredit(float Time)
+{
+	// Enemies that are never destroyed, such as pooled ones left parked, would otherwise stay in the map for good
+	for (auto It = LastCreditTimes.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || Time - It.Value() > KillCreditSeconds)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void AFutureNinjaStatsService::Notify()
+{
+	NotifiedStats = Stats;
+	NotifiedSecond = NewestSecond;
+	OnStatsChanged.Broadcast(Stats);
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		AFutureNinjaHUD* HUD = PlayerController != nullptr ? Cast<AFutureNinjaHUD>(PlayerController->GetHUD()) : nullptr;
+		if (HUD != nullptr)
+		{
+			HUD->SetElementValue(EFutureNinjaHUDElement::Score, Stats.Score);
+			HUD->SetElementValue(EFutureNinjaHUDElement::KillStreak, Stats.KillStreak);
+			HUD->SetElementValue(EFutureNinjaHUDElement::Damage, Stats.Damage);
+		}
+	}
+}
+
+void AFutureNinjaStatsService::LogEvent(const FFutureNinjaStatEventRecord& Event)
+{
+	// Type, then milliseconds since the previous event and the amount as packed integers
+	FMemoryWriter Writer(LogBuffer, false, true);
+
+	uint8 Type = (uint8)Event.Type;
+	uint32 DeltaMs = (uint32)FMath::Max(FMath::RoundToInt((Event.Time - LastLoggedTime) * 1000.f), 0);
+	uint32 Amount = (uint32)FMath::Max(Event.Amount, 0);
+	Writer << Type;
+	Writer.SerializeIntPacked(DeltaMs);
+	Writer.SerializeIntPacked(Amount);
+
+	// Advance by the rounded delta so rounding does not drift over a long session
+	LastLoggedTime += DeltaMs / 1000.f;
+	++EventsLogged;
+}
+
+void AFutureNinjaStatsService::FlushLog(bool bWait)
+{
+	// Appends must land in order, so a write waits for the one before it
+	if (PendingWrite.IsValid())
+	{
+		PendingWrite.Wait();
+	}
+
+	if (LogBuffer.Num() > 0)
+	{
+		TArray<uint8> Bytes = MoveTemp(LogBuffer);
+		LogBuffer.Reset();
+
+		const FString Path = LogPath;
+		PendingWrite = Async<void>(EAsyncExecution::ThreadPool, [Bytes, Path]()
+		{
+			FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*FPaths::GetPath(Path));
+			TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Path, FILEWRITE_Append));
+			if (!Writer)
+			{
+				UE_LOG(LogStatsService, Error, TEXT("Failed to open %s for writing"), *Path);
+				return;
+			}
+			Writer->Serialize(const_cast<uint8*>(Bytes.GetData()), Bytes.Num());
+			Writer->Close();
+		});
+	}
+
+	if (bWait && PendingWrite.IsValid())
+	{
+		PendingWrite.Wait();
+	}
+}
+
+bool AFutureNinjaStatsService::ReadSessionLog(const FString& Path, TArray<FFutureNinjaStatEventRecord>& OutEvents)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Path));
+	if (!Reader)
+	{
+		UE_LOG(LogStatsService, Error, TEXT("Failed to open %s"), *Path);
+		return false;
+	}
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	*Reader << Magic << Version;
+	if (Magic != SessionLogMagic || Version != SessionLogVersion)
+	{
+		UE_LOG(LogStatsService, Error, TEXT("%s is not a version %d session log"), *Path, SessionLogVersion);
+		return false;
+	}
+
+	int64 StartTicks = 0;
+	FString MapName;
+	*Reader << StartTicks << MapName;
+
+	OutEvents.Reset();
+	float Time = 0.f;
+	while (!Reader->AtEnd() && !Reader->IsError())
+	{
+		uint8 Type = 0;
+		uint32 DeltaMs = 0;
+		uint32 Amount = 0;
+		*Reader << Type;
+		Reader->SerializeIntPacked(DeltaMs);
+		Reader->SerializeIntPacked(Amount);
+
+		Time += DeltaMs / 1000.f;
+
+		FFutureNinjaStatEventRecord& Event = OutEvents[OutEvents.AddUninitialized()];
+		Event.Type = (EFutureNinjaStatEvent)Type;
+		Event.Amount = (int32)Amount;
+		Event.Time = Time;
+	}
+
+	return Reader->Close() && !Reader->IsError();
+}
@@ -0,0 +1,242 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Async/Future.h"
+#include "Containers/Queue.h"
+#include "FutureNinjaStatsService.generated.h"
+
+/** Kinds of gameplay event the stats service counts. */
+UENUM(BlueprintType)
+enum class EFutureNinjaStatEvent : uint8
+{
+	/** A kunai hit a physics body */
+	Hit,
+	/** A kunai hit an enemy */
+	EnemyHit,
+	/** An enemy the player recently hit died or was handed back to the wave director */
+	Kill
+};
+
+/** One gameplay event, as queued and as stored in the session log. */
+struct FFutureNinjaStatEventRecord
+{
+	EFutureNinjaStatEvent Type;
+	int32 Amount;
+	/** Seconds since the session started */
+	float Time;
+};
+
+/** Totals and rolling rates of the running session. */
+USTRUCT(BlueprintType)
+struct FFutureNinjaSessionStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stats)
+	int32 Score;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stats)
+	int32 Kills;
+
+	/** Kills made no more than KillStreakWindow apart, up to now. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stats)
+	int32 KillStreak;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stats)
+	int32 BestKillStreak;
+
+	/** Kunai that hit a physics body or an enemy. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stats)
+	int32 Hits;
+
+	/** Damage dealt to enemies. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stats)
+	int32 Damage;
+
+	/** Kills per minute over the last RollingWindowSeconds. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stats)
+	float KillsPerMinute;
+
+	/** Damage per second over the last RollingWindowSeconds. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Stats)
+	float DamagePerSecond;
+
+	FFutureNinjaSessionStats()
+		: Score(0), Kills(0), KillStreak(0), BestKillStreak(0), Hits(0), Damage(0), KillsPerMinute(0.f), DamagePerSecond(0.f)
+	{}
+
+	/** Compares everything but the rates, which drift with time alone while the window fills. */
+	bool HasSameTotals(const FFutureNinjaSessionStats& Other) const
+	{
+		return Score == Other.Score && Kills == Other.Kills && KillStreak == Other.KillStreak && BestKillStreak == Other.BestKillStreak
+			&& Hits == Other.Hits && Damage == Other.Damage;
+	}
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnFutureNinjaStatsChanged, const FFutureNinjaSessionStats&, Stats);
+
+/**
+ * Turns gameplay events into score, kill streak and damage.
+ *
+ * Kunai hits and enemy deaths are pushed with PushEvent into a lock-free queue, which is safe from any
+ * thread and costs the producer a single lock-free enqueue. Once per tick the queue is drained into the
+ * totals and into one-second buckets that give the rolling rates. OnStatsChanged fires, and the values are
+ * pushed into every local AFutureNinjaHUD, only on ticks where a total changed or the window moved on to a
+ * new second, so nothing polls the stats per frame and the rates refresh once a second.
+ *
+ * With bWriteSessionLog every event is also appended to Saved/Profiling/SessionStats/<Map>-<Date>.fnstats:
+ * a small header, then per event its type and the packed milliseconds since the previous event and amount,
+ * about three bytes each. The log is written on a worker thread every LogFlushBytes and at EndPlay; load it
+ * offline with ReadSessionLog.
+ *
+ * Enemies are the pawns that are neither a player character nor player controlled. An enemy counts as a
+ * kill when it is destroyed, or handed back to the wave director's pool, within KillCreditSeconds of being
+ * hit by a kunai or damaged by a player; enemies removed for any other reason, such as falling out of the
+ * world or the level unloading, are not kills. One service exists per world; use Get() to find or create it.
+ */
+UCLASS(config=Game, notplaceable)
+class AFutureNinjaStatsService : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFutureNinjaStatsService();
+
+	/** Returns the service for World, spawning it on first use. */
+	static AFutureNinjaStatsService* Get(UWorld* World);
+
+	/** Returns the service in play in World if there is one, without searching the world. Game thread only. */
+	static AFutureNinjaStatsService* Find(UWorld* World);
+
+	/** Queues an event for the next tick. Safe to call from any thread. */
+	void PushEvent(EFutureNinjaStatEvent Type, int32 Amount = 1);
+
+	/** Queues a kunai hit on Enemy and credits the player with Enemy's death for KillCreditSeconds. Game thread only. */
+	void AddEnemyHit(APawn* Enemy);
+
+	/** Counts Enemy leaving play as a kill if the player has credit for it. Game thread only. */
+	void ReportEnemyRemoved(APawn* Enemy);
+
+	/** Returns the current totals and rates. */
+	UFUNCTION(BlueprintPure, Category = Stats)
+	const FFutureNinjaSessionStats& GetStats() const { return Stats; }
+
+	/** Reads the events of a session log written by the service. */
+	static bool ReadSessionLog(const FString& Path, TArray<FFutureNinjaStatEventRecord>& OutEvents);
+
+	/** Fires after a tick that changed the stats. */
+	UPROPERTY(BlueprintAssignable, Category = Stats)
+	FOnFutureNinjaStatsChanged OnStatsChanged;
+
+	/** Score of a kunai hitting an enemy. */
+	UPROPERTY(Config, EditAnywhere, Category = Stats)
+	int32 PointsPerHit;
+
+	/** Score of a kill, multiplied by the kill streak up to MaxStreakMultiplier. */
+	UPROPERTY(Config, EditAnywhere, Category = Stats)
+	int32 PointsPerKill;
+
+	UPROPERTY(Config, EditAnywhere, Category = Stats)
+	int32 MaxStreakMultiplier;
+
+	/** Damage a kunai deals to an enemy. */
+	UPROPERTY(Config, EditAnywhere, Category = Stats)
+	int32 DamagePerHit;
+
+	/** An enemy removed no later than this after the player last hit or damaged it counts as a kill. */
+	UPROPERTY(Config, EditAnywhere, Category = Stats)
+	float KillCreditSeconds;
+
+	/** Longest time between two kills of the same streak. */
+	UPROPERTY(Config, EditAnywhere, Category = Stats)
+	float KillStreakWindow;
+
+	/** Length of the window the rates are measured over, rounded up to whole seconds. */
+	UPROPERTY(Config, EditAnywhere, Category = Stats)
+	float RollingWindowSeconds;
+
+	/** Append every event to a binary session log. */
+	UPROPERTY(Config, EditAnywhere, Category = Stats)
+	uint32 bWriteSessionLog : 1;
+
+	/** Buffered log bytes that trigger a write. */
+	UPROPERTY(Config, EditAnywhere, Category = Stats)
+	int32 LogFlushBytes;
+
+	// AActor interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+	// End of AActor interface
+
+private:
+	/** Watches enemy pawns for player damage and for being destroyed. */
+	void OnActorSpawned(AActor* Actor);
+
+	UFUNCTION()
+	void OnEnemyDamaged(AActor* DamagedActor, float Damage, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
+
+	UFUNCTION()
+	void OnEnemyDestroyed(AActor* DestroyedActor);
+
+	/** Adds Event to the totals and the current bucket. */
+	void Apply(const FFutureNinjaStatEventRecord& Event);
+
+	/** Moves the rolling window up to Time and recomputes the rates. */
+	void AdvanceWindow(float Time);
+
+	/** Forgets the credit of enemies that are gone or were last hit longer than KillCreditSeconds ago. */
+	void PruneCredit(float Time);
+
+	/** Tells OnStatsChanged and the HUDs about the new stats. */
+	void Notify();
+
+	/** Appends Event to LogBuffer. */
+	void LogEvent(const FFutureNinjaStatEventRecord& Event);
+
+	/** Hands LogBuffer to a worker thread that appends it to the log file. */
+	void FlushLog(bool bWait);
+
+	/** Seconds since the session started */
+	float GetSessionTime() const;
+
+	TQueue<FFutureNinjaStatEventRecord, EQueueMode::Mpsc> Queue;
+
+	UPROPERTY(Transient)
+	FFutureNinjaSessionStats Stats;
+
+	/** Stats the last notification was sent with */
+	FFutureNinjaSessionStats NotifiedStats;
+	/** NewestSecond when the last notification was sent */
+	int32 NotifiedSecond;
+
+	/** Kills and damage per second of the rolling window, as a ring */
+	struct FWindowBucket
+	{
+		int32 Kills;
+		int32 Damage;
+	};
+	TArray<FWindowBucket> Buckets;
+	/** Whole second of the session the newest bucket covers */
+	int32 NewestSecond;
+	int32 WindowKills;
+	int32 WindowDamage;
+
+	float LastKillTime;
+	double SessionStartSeconds;
+
+	/** Session time each enemy was last hit or damaged by the player */
+	TMap<TWeakObjectPtr<APawn>, float> LastCreditTimes;
+
+	/** Encoded events not yet written */
+	TArray<uint8> LogBuffer;
+	FString LogPath;
+	float LastLoggedTime;
+	int32 EventsLogged;
+	TFuture<void> PendingWrite;
+
+	FDelegateHandle ActorSpawnedHandle;
+};
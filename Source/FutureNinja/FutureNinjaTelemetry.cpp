@@ -0,0 +1,484 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaTelemetry.h"
+#include "FutureNinja.h"
+#include "CoreGlobals.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTLS.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/Compression.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogTelemetry, Log, All);
+
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Telemetry Us Per Frame"), STAT_TelemetryUsPerFrame, STATGROUP_FutureNinja);
+
+static TAutoConsoleVariable<int32> CVarTelemetryFlushMs(
+	TEXT("FutureNinja.TelemetryFlushMs"),
+	50,
+	TEXT("Milliseconds between two blocks written by the telemetry recorder. Each thread keeps 4096 records until then."));
+
+static FAutoConsoleCommand TelemetryStartCommand(
+	TEXT("FutureNinja.TelemetryStart"),
+	TEXT("Starts recording telemetry to Saved/Profiling/Telemetry. Takes an optional file name."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args) { FFutureNinjaTelemetry::Get().Start(Args.Num() > 0 ? Args[0] : FString()); }));
+
+static FAutoConsoleCommand TelemetryStopCommand(
+	TEXT("FutureNinja.TelemetryStop"),
+	TEXT("Stops recording telemetry and closes the file."),
+	FConsoleCommandDelegate::CreateLambda([]() { FFutureNinjaTelemetry::Get().Stop(); }));
+
+static const uint32 TelemetryMagic = 0x464E544D; // 'FNTM'
+static const int32 TelemetryVersion = 1;
+
+/** Values are stored as integers in 1/TelemetryQuantization units */
+static const float TelemetryQuantization = 100.f;
+
+static const TCHAR* TelemetryEventNames[(int32)EFutureNinjaTelemetryEvent::Num] =
+{
+	TEXT("Frame"),
+	TEXT("Throw"),
+	TEXT("Hit"),
+	TEXT("EnemySpawn"),
+	TEXT("GameStart"),
+};
+
+namespace FutureNinjaTelemetry
+{
+	void WriteVarInt(TArray<uint8>& Bytes, uint64 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Bytes.Add((uint8)(Value | 0x80));
+			Value >>= 7;
+		}
+		Bytes.Add((uint8)Value);
+	}
+
+	bool ReadVarInt(const uint8*& Data, const uint8* End, uint64& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; Shift < 64 && Data < End; Shift += 7)
+		{
+			const uint8 Byte = *Data++;
+			OutValue |= (uint64)(Byte & 0x7f) << Shift;
+			if ((Byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	FORCEINLINE uint64 ZigZag(int64 Value)
+	{
+		return ((uint64)Value << 1) ^ (uint64)(Value >> 63);
+	}
+
+	FORCEINLINE int64 UnZigZag(uint64 Value)
+	{
+		return (int64)(Value >> 1) ^ -(int64)(Value & 1);
+	}
+
+	FORCEINLINE int32 Quantize(float Value)
+	{
+		return (int32)FMath::Clamp(FMath::RoundToDouble((double)Value * TelemetryQuantization), (double)MIN_int32, (double)MAX_int32);
+	}
+}
+
+bool FFutureNinjaTelemetry::bRecording = false;
+
+FFutureNinjaTelemetry& FFutureNinjaTelemetry::Get()
+{
+	static FFutureNinjaTelemetry Telemetry;
+	return Telemetry;
+}
+
+FFutureNinjaTelemetry::FFutureNinjaTelemetry()
+	: TlsSlot(FPlatformTLS::AllocTlsSlot())
+	, WriterThread(nullptr)
+	, WakeEvent(nullptr)
+	, Writer(nullptr)
+	, RecordsWritten(0)
+	, BytesWritten(0)
+	, LastFrameCycles(0)
+	, LastRecordCycles(0)
+	, OverheadUsSum(0.0)
+	, OverheadUsMax(0.f)
+	, FramesRecorded(0)
+{
+	FCoreDelegates::OnEndFrame.AddRaw(this, &FFutureNinjaTelemetry::OnEndFrame);
+	FCoreDelegates::OnPreExit.AddRaw(this, &FFutureNinjaTelemetry::Stop);
+}
+
+FFutureNinjaTelemetry::~FFutureNinjaTelemetry()
+{
+	// Stopped in OnPreExit; threads that recorded may be gone, so their rings are freed here rather than with them
+	for (FThreadRing* Ring : Rings)
+	{
+		delete Ring;
+	}
+	FPlatformTLS::FreeTlsSlot(TlsSlot);
+}
+
+FFutureNinjaTelemetry::FThreadRing& FFutureNinjaTelemetry::GetThreadRing()
+{
+	FThreadRing* Ring = (FThreadRing*)FPlatformTLS::GetTlsValue(TlsSlot);
+	if (Ring == nullptr)
+	{
+		Ring = new FThreadRing();
+		Ring->RecordCycles = 0;
+
+		FScopeLock Lock(&RingsLock);
+		Ring->ThreadIndex = (uint8)FMath::Min(Rings.Num(), 255);
+		Rings.Add(Ring);
+		FPlatformTLS::SetTlsValue(TlsSlot, Ring);
+	}
+	return *Ring;
+}
+
+void FFutureNinjaTelemetry::RecordInternal(EFutureNinjaTelemetryEvent Type, float Value0, float Value1, float Value2)
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	FThreadRing& Ring = GetThreadRing();
+
+	// Indices only grow; unsigned arithmetic keeps the fill level right when they wrap
+	const uint32 Head = (uint32)Ring.Head.GetValue();
+	if (Head - (uint32)Ring.Tail.GetValue() >= (uint32)FThreadRing::Capacity)
+	{
+		Ring.Dropped.Increment();
+	}
+	else
+	{
+		FFutureNinjaTelemetryRecord& Record = Ring.Records[Head & (FThreadRing::Capacity - 1)];
+		Record.Cycles = StartCycles;
+		Record.Type = Type;
+		Record.ThreadIndex = Ring.ThreadIndex;
+		Record.Values[0] = Value0;
+		Record.Values[1] = Value1;
+		Record.Values[2] = Value2;
+
+		// Publishes the record to the writer; the exchange is a full barrier
+		Ring.Head.Set((int32)(Head + 1));
+	}
+
+	Ring.RecordCycles += FPlatformTime::Cycles64() - StartCycles;
+}
+
+bool FFutureNinjaTelemetry::Start(const FString& Name)
+{
+	if (bRecording)
+	{
+		UE_LOG(LogTelemetry, Warning, TEXT("Telemetry is already being recorded to %s"), *Path);
+		return false;
+	}
+
+	const FString Directory = FPaths::ProfilingDir() / TEXT("Telemetry");
+	Path = Directory / FPaths::SetExtension(Name.IsEmpty() ? FDateTime::Now().ToString() : Name, TEXT(".fntel"));
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*Directory);
+
+	Writer = IFileManager::Get().CreateFileWriter(*Path);
+	if (Writer == nullptr)
+	{
+		UE_LOG(LogTelemetry, Error, TEXT("Failed to open %s for writing"), *Path);
+		return false;
+	}
+
+	uint32 Magic = TelemetryMagic;
+	int32 Version = TelemetryVersion;
+	double SecondsPerCycle = FPlatformTime::GetSecondsPerCycle64();
+	int64 StartTicks = FDateTime::UtcNow().GetTicks();
+	*Writer << Magic << Version << SecondsPerCycle << StartTicks;
+
+	// Nothing is draining the rings yet, so the game thread may move their tails: drop whatever is left from before
+	{
+		FScopeLock Lock(&RingsLock);
+		for (FThreadRing* Ring : Rings)
+		{
+			Ring->Tail.Set(Ring->Head.GetValue());
+			Ring->Dropped.Reset();
+		}
+	}
+
+	RecordsWritten = 0;
+	BytesWritten = Writer->Tell();
+	LastFrameCycles = FPlatformTime::Cycles64();
+	LastRecordCycles = GetThreadRing().RecordCycles;
+	OverheadUsSum = 0.0;
+	OverheadUsMax = 0.f;
+	FramesRecorded = 0;
+
+	StopRequested.Reset();
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	bRecording = true;
+	WriterThread = FRunnableThread::Create(this, TEXT("FutureNinjaTelemetry"), 0, TPri_BelowNormal);
+
+	UE_LOG(LogTelemetry, Log, TEXT("Recording telemetry to %s"), *Path);
+	return true;
+}
+
+void FFutureNinjaTelemetry::Stop()
+{
+	if (WriterThread == nullptr)
+	{
+		return;
+	}
+
+	bRecording = false;
+	StopRequested.Set(1);
+	WakeEvent->Trigger();
+	WriterThread->WaitForCompletion();
+	delete WriterThread;
+	WriterThread = nullptr;
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	WakeEvent = nullptr;
+
+	Writer->Close();
+	delete Writer;
+	Writer = nullptr;
+
+	int32 Dropped = 0;
+	{
+		FScopeLock Lock(&RingsLock);
+		for (FThreadRing* Ring : Rings)
+		{
+			Dropped += Ring->Dropped.Reset();
+		}
+	}
+
+	UE_LOG(LogTelemetry, Log, TEXT("Wrote %lld telemetry records in %lld bytes (%.2f per record) to %s, dropped %d"),
+		RecordsWritten, BytesWritten, RecordsWritten > 0 ? (double)BytesWritten / RecordsWritten : 0.0, *Path, Dropped);
+	UE_LOG(LogTelemetry, Log, TEXT("Recorder cost on the game thread: %.2fus per frame on average, %.2fus at most, over %d frames"),
+		FramesRecorded > 0 ? OverheadUsSum / FramesRecorded : 0.0, OverheadUsMax, FramesRecorded);
+}
+
+void FFutureNinjaTelemetry::OnEndFrame()
+{
+	if (!bRecording)
+	{
+		return;
+	}
+
+	const uint64 NowCycles = FPlatformTime::Cycles64();
+	const float FrameMs = (float)FPlatformTime::ToMilliseconds64(NowCycles - LastFrameCycles);
+	LastFrameCycles = NowCycles;
+
+	// The frame record's own cost is counted in the next frame
+	const uint64 RecordCycles = GetThreadRing().RecordCycles;
+	const float OverheadUs = (float)(FPlatformTime::ToSeconds64(RecordCycles - LastRecordCycles) * 1000000.0);
+	LastRecordCycles = RecordCycles;
+
+	OverheadUsSum += OverheadUs;
+	OverheadUsMax = FMath::Max(OverheadUsMax, OverheadUs);
+	++FramesRecorded;
+	SET_FLOAT_STAT(STAT_TelemetryUsPerFrame, OverheadUs);
+
+	RecordInternal(EFutureNinjaTelemetryEvent::Frame, FrameMs, FPlatformTime::ToMilliseconds(GGameThreadTime), OverheadUs);
+}
+
+uint32 FFutureNinjaTelemetry::Run()
+{
+	while (StopRequested.GetValue() == 0)
+	{
+		WakeEvent->Wait(FMath::Max(CVarTelemetryFlushMs.GetValueOnAnyThread(), 1));
+		WriteBlock();
+	}
+
+	// Records made right before the stop
+	WriteBlock();
+	return 0;
+}
+
+void FFutureNinjaTelemetry::WriteBlock()
+{
+	using namespace FutureNinjaTelemetry;
+
+	BlockRecords.Reset();
+	{
+		FScopeLock Lock(&RingsLock);
+		for (FThreadRing* Ring : Rings)
+		{
+			const uint32 Head = (uint32)Ring->Head.GetValue();
+			for (uint32 Index = (uint32)Ring->Tail.GetValue(); Index != Head; ++Index)
+			{
+				BlockRecords.Add(Ring->Records[Index & (FThreadRing::Capacity - 1)]);
+			}
+			Ring->Tail.Set((int32)Head);
+		}
+	}
+
+	if (BlockRecords.Num() == 0)
+	{
+		return;
+	}
+
+	// Each thread's records are in order already; interleave them so the cycle deltas stay small
+	BlockRecords.Sort([](const FFutureNinjaTelemetryRecord& A, const FFutureNinjaTelemetryRecord& B) { return A.Cycles < B.Cycles; });
+
+	uint64 BaseCycles = BlockRecords[0].Cycles;
+	uint64 PreviousCycles = BaseCycles;
+	int32 PreviousValues[(int32)EFutureNinjaTelemetryEvent::Num][3] = {};
+
+	BlockBytes.Reset();
+	for (const FFutureNinjaTelemetryRecord& Record : BlockRecords)
+	{
+		BlockBytes.Add((uint8)Record.Type);
+		BlockBytes.Add(Record.ThreadIndex);
+		WriteVarInt(BlockBytes, Record.Cycles - PreviousCycles);
+		PreviousCycles = Record.Cycles;
+
+		int32* Previous = PreviousValues[(int32)Record.Type];
+		for (int32 ValueIndex = 0; ValueIndex < 3; ++ValueIndex)
+		{
+			const int32 Quantized = Quantize(Record.Values[ValueIndex]);
+			WriteVarInt(BlockBytes, ZigZag((int64)Quantized - Previous[ValueIndex]));
+			Previous[ValueIndex] = Quantized;
+		}
+	}
+
+	int32 NumRecords = BlockRecords.Num();
+	int32 UncompressedSize = BlockBytes.Num();
+	int32 CompressedSize = FCompression::CompressMemoryBound(COMPRESS_ZLIB, UncompressedSize);
+	CompressedBytes.SetNumUninitialized(CompressedSize);
+
+	const bool bCompressed = FCompression::CompressMemory(COMPRESS_ZLIB, CompressedBytes.GetData(), CompressedSize, BlockBytes.GetData(), UncompressedSize);
+	if (!bCompressed)
+	{
+		// A size of 0 marks a block stored as is
+		CompressedSize = 0;
+	}
+
+	*Writer << NumRecords << BaseCycles << UncompressedSize << CompressedSize;
+	if (bCompressed)
+	{
+		Writer->Serialize(CompressedBytes.GetData(), CompressedSize);
+	}
+	else
+	{
+		Writer->Serialize(BlockBytes.GetData(), UncompressedSize);
+	}
+	Writer->Flush();
+
+	RecordsWritten += NumRecords;
+	BytesWritten = Writer->Tell();
+}
+
+bool FFutureNinjaTelemetry::ReadFile(const FString& FilePath, TArray<FFutureNinjaTelemetryRecord>& OutRecords, double& OutSecondsPerCycle)
+{
+	using namespace FutureNinjaTelemetry;
+
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!Reader)
+	{
+		UE_LOG(LogTelemetry, Error, TEXT("Failed to open %s"), *FilePath);
+		return false;
+	}
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	*Reader << Magic << Version;
+	if (Magic != TelemetryMagic || Version != TelemetryVersion)
+	{
+		UE_LOG(LogTelemetry, Error, TEXT("%s is not a version %d telemetry file"), *FilePath, TelemetryVersion);
+		return false;
+	}
+
+	int64 StartTicks = 0;
+	*Reader << OutSecondsPerCycle << StartTicks;
+
+	OutRecords.Reset();
+	TArray<uint8> Compressed;
+	TArray<uint8> Bytes;
+	while (!Reader->AtEnd())
+	{
+		int32 NumRecords = 0;
+		uint64 BaseCycles = 0;
+		int32 UncompressedSize = 0;
+		int32 CompressedSize = 0;
+		*Reader << NumRecords << BaseCycles << UncompressedSize << CompressedSize;
+		if (Reader->IsError() || NumRecords < 0 || UncompressedSize < 0 || CompressedSize < 0 || Reader->Tell() + (CompressedSize > 0 ? CompressedSize : UncompressedSize) > Reader->TotalSize())
+		{
+			// A block cut short by a crash ends the file
+			UE_LOG(LogTelemetry, Warning, TEXT("%s ends with an incomplete block"), *FilePath);
+			break;
+		}
+
+		Bytes.SetNumUninitialized(UncompressedSize);
+		if (CompressedSize > 0)
+		{
+			Compressed.SetNumUninitialized(CompressedSize);
+			Reader->Serialize(Compressed.GetData(), CompressedSize);
+			if (!FCompression::UncompressMemory(COMPRESS_ZLIB, Bytes.GetData(), UncompressedSize, Compressed.GetData(), CompressedSize))
+			{
+				UE_LOG(LogTelemetry, Error, TEXT("%s has a corrupt block"), *FilePath);
+				return false;
+			}
+		}
+		else
+		{
+			Reader->Serialize(Bytes.GetData(), UncompressedSize);
+		}
+
+		const uint8* Data = Bytes.GetData();
+		const uint8* End = Data + Bytes.Num();
+		uint64 Cycles = BaseCycles;
+		int32 PreviousValues[(int32)EFutureNinjaTelemetryEvent::Num][3] = {};
+
+		for (int32 RecordIndex = 0; RecordIndex < NumRecords; ++RecordIndex)
+		{
+			if (End - Data < 2 || Data[0] >= (uint8)EFutureNinjaTelemetryEvent::Num)
+			{
+				UE_LOG(LogTelemetry, Error, TEXT("%s has a corrupt block"), *FilePath);
+				return false;
+			}
+
+			FFutureNinjaTelemetryRecord& Record = OutRecords[OutRecords.AddUninitialized()];
+			Record.Type = (EFutureNinjaTelemetryEvent)*Data++;
+			Record.ThreadIndex = *Data++;
+
+			uint64 Delta = 0;
+			bool bOk = ReadVarInt(Data, End, Delta);
+			Cycles += Delta;
+			Record.Cycles = Cycles;
+
+			int32* Previous = PreviousValues[(int32)Record.Type];
+			for (int32 ValueIndex = 0; ValueIndex < 3; ++ValueIndex)
+			{
+				bOk = bOk && ReadVarInt(Data, End, Delta);
+				Previous[ValueIndex] = (int32)(Previous[ValueIndex] + UnZigZag(Delta));
+				Record.Values[ValueIndex] = Previous[ValueIndex] / TelemetryQuantization;
+			}
+
+			if (!bOk)
+			{
+				UE_LOG(LogTelemetry, Error, TEXT("%s has a corrupt block"), *FilePath);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool FFutureNinjaTelemetry::WriteCsv(const FString& CsvPath, const TArray<FFutureNinjaTelemetryRecord>& Records, double SecondsPerCycle)
+{
+	FString Csv = TEXT("Seconds,Thread,Event,Value0,Value1,Value2\n");
+	Csv.Reserve(Records.Num() * 48);
+
+	const uint64 FirstCycles = Records.Num() > 0 ? Records[0].Cycles : 0;
+	for (const FFutureNinjaTelemetryRecord& Record : Records)
+	{
+		Csv += FString::Printf(TEXT("%.6f,%d,%s,%.2f,%.2f,%.2f\n"),
+			(Record.Cycles - FirstCycles) * SecondsPerCycle, Record.ThreadIndex, TelemetryEventNames[(int32)Record.Type],
+			Record.Values[0], Record.Values[1], Record.Values[2]);
+	}
+
+	return FFileHelper::SaveStringToFile(Csv, *CsvPath);
+}
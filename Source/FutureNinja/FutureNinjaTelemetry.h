@@ -0,0 +1,153 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter.h"
+
+class FArchive;
+class FEvent;
+class FRunnableThread;
+
+/** Kinds of telemetry record. */
+enum class EFutureNinjaTelemetryEvent : uint8
+{
+	/** End of a frame: frame ms, game thread ms, recorder us spent on the game thread */
+	Frame,
+	/** A kunai was thrown: muzzle location */
+	Throw,
+	/** A kunai hit something: hit location */
+	Hit,
+	/** An enemy joined the fight: its location */
+	EnemySpawn,
+	/** The game mode started play: nothing */
+	GameStart,
+
+	Num
+};
+
+/** One fixed-size record, as stored in the per-thread rings and returned by the reader. */
+struct FFutureNinjaTelemetryRecord
+{
+	uint64 Cycles;
+	EFutureNinjaTelemetryEvent Type;
+	/** Registration order of the thread that made the record */
+	uint8 ThreadIndex;
+	float Values[3];
+};
+
+/**
+ * Records throws, hits, enemy spawns and frame times of a play session to a compact binary file.
+ *
+ * Record() writes one fixed-size record into a ring owned by the calling thread, so producers never lock
+ * or wait on each other; a full ring drops the record and counts it. A writer thread wakes every
+ * FutureNinja.TelemetryFlushMs, drains every ring, orders the records by time and encodes them as a
+ * block: cycle deltas and values, quantized to 1/100 and delta-encoded against the previous record of
+ * the same type, as variable-length integers, zlib compressed. Blocks decode independently, so a crashed
+ * session loses at most the last one.
+ *
+ * Start with -Telemetry[=Name] or FutureNinja.TelemetryStart; files go to Saved/Profiling/Telemetry.
+ * Each frame record carries the us the recorder cost the game thread in that frame, and Stop() logs the
+ * average and worst. Convert a file to CSV with
+ *   UE4Editor-Cmd FutureNinja.uproject -run=FutureNinjaTelemetry -In=<File> [-Out=<Csv>]
+ */
+class FFutureNinjaTelemetry : public FRunnable
+{
+public:
+	/** Returns the recorder, hooking it to the end of the frame on first use. */
+	static FFutureNinjaTelemetry& Get();
+
+	/** Whether records are being kept. */
+	static FORCEINLINE bool IsRecording() { return bRecording; }
+
+	/** Records Type with up to three values. Safe to call from any thread; does nothing unless recording. */
+	FORCEINLINE static void Record(EFutureNinjaTelemetryEvent Type, float Value0 = 0.f, float Value1 = 0.f, float Value2 = 0.f)
+	{
+		if (bRecording)
+		{
+			Get().RecordInternal(Type, Value0, Value1, Value2);
+		}
+	}
+
+	FORCEINLINE static void Record(EFutureNinjaTelemetryEvent Type, const FVector& Location)
+	{
+		Record(Type, Location.X, Location.Y, Location.Z);
+	}
+
+	/** Starts writing to the file called Name, or to one named after the date if Name is empty. */
+	bool Start(const FString& Name);
+
+	/** Writes what is left and closes the file. */
+	void Stop();
+
+	/** Reads every record of a telemetry file. */
+	static bool ReadFile(const FString& FilePath, TArray<FFutureNinjaTelemetryRecord>& OutRecords, double& OutSecondsPerCycle);
+
+	/** Writes Records as CSV, with times in seconds since the first record. */
+	static bool WriteCsv(const FString& CsvPath, const TArray<FFutureNinjaTelemetryRecord>& Records, double SecondsPerCycle);
+
+	// FRunnable interface
+	virtual uint32 Run() override;
+	// End of FRunnable interface
+
+private:
+	FFutureNinjaTelemetry();
+	virtual ~FFutureNinjaTelemetry();
+
+	/** Records one thread has made and the writer has not taken yet. Single producer, single consumer. */
+	struct FThreadRing
+	{
+		static const int32 Capacity = 4096;
+
+		FFutureNinjaTelemetryRecord Records[Capacity];
+		/** Records written, ever; only the owning thread moves it */
+		FThreadSafeCounter Head;
+		/** Records taken, ever; only the writer moves it */
+		FThreadSafeCounter Tail;
+		FThreadSafeCounter Dropped;
+		/** Cycles the owning thread spent recording */
+		uint64 RecordCycles;
+		uint8 ThreadIndex;
+	};
+
+	void RecordInternal(EFutureNinjaTelemetryEvent Type, float Value0, float Value1, float Value2);
+
+	/** Returns the calling thread's ring, creating it on first use. */
+	FThreadRing& GetThreadRing();
+
+	void OnEndFrame();
+
+	/** Takes every ring's records and writes them as one block. Writer thread only. */
+	void WriteBlock();
+
+	static bool bRecording;
+
+	uint32 TlsSlot;
+
+	FCriticalSection RingsLock;
+	TArray<FThreadRing*> Rings;
+
+	FRunnableThread* WriterThread;
+	FEvent* WakeEvent;
+	FThreadSafeCounter StopRequested;
+
+	/** Open file, used by the writer thread while recording */
+	FArchive* Writer;
+	FString Path;
+
+	/** Scratch buffers of the writer thread */
+	TArray<FFutureNinjaTelemetryRecord> BlockRecords;
+	TArray<uint8> BlockBytes;
+	TArray<uint8> CompressedBytes;
+
+	int64 RecordsWritten;
+	int64 BytesWritten;
+
+	/** Game thread cost of the recorder, for the frame records and the report */
+	uint64 LastFrameCycles;
+	uint64 LastRecordCycles;
+	double OverheadUsSum;
+	float OverheadUsMax;
+	int32 FramesRecorded;
+};
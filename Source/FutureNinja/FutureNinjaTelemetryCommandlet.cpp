@@ -0,0 +1,77 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaTelemetryCommandlet.h"
+#include "FutureNinjaTelemetry.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogTelemetryCommandlet, Log, All);
+
+UFutureNinjaTelemetryCommandlet::UFutureNinjaTelemetryCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+
+	HelpDescription = TEXT("Converts a FutureNinja telemetry file to CSV");
+	HelpUsage = TEXT("-run=FutureNinjaTelemetry -In=<File> [-Out=<Csv>]");
+}
+
+int32 UFutureNinjaTelemetryCommandlet::Main(const FString& Params)
+{
+	FString InPath;
+	if (!FParse::Value(*Params, TEXT("In="), InPath))
+	{
+		UE_LOG(LogTelemetryCommandlet, Error, TEXT("Usage: %s"), *HelpUsage);
+		return 1;
+	}
+
+	if (!FPaths::FileExists(InPath))
+	{
+		InPath = FPaths::ProfilingDir() / TEXT("Telemetry") / FPaths::SetExtension(InPath, TEXT(".fntel"));
+	}
+
+	FString OutPath;
+	if (!FParse::Value(*Params, TEXT("Out="), OutPath))
+	{
+		OutPath = FPaths::ChangeExtension(InPath, TEXT(".csv"));
+	}
+
+	TArray<FFutureNinjaTelemetryRecord> Records;
+	double SecondsPerCycle = 0.0;
+	if (!FFutureNinjaTelemetry::ReadFile(InPath, Records, SecondsPerCycle))
+	{
+		return 1;
+	}
+
+	int32 Counts[(int32)EFutureNinjaTelemetryEvent::Num] = {};
+	TArray<float> FrameMs;
+	for (const FFutureNinjaTelemetryRecord& Record : Records)
+	{
+		++Counts[(int32)Record.Type];
+		if (Record.Type == EFutureNinjaTelemetryEvent::Frame)
+		{
+			FrameMs.Add(Record.Values[0]);
+		}
+	}
+
+	UE_LOG(LogTelemetryCommandlet, Display, TEXT("%d records: %d frames, %d throws, %d hits, %d enemy spawns"),
+		Records.Num(), Counts[(int32)EFutureNinjaTelemetryEvent::Frame], Counts[(int32)EFutureNinjaTelemetryEvent::Throw],
+		Counts[(int32)EFutureNinjaTelemetryEvent::Hit], Counts[(int32)EFutureNinjaTelemetryEvent::EnemySpawn]);
+
+	if (FrameMs.Num() > 0)
+	{
+		FrameMs.Sort();
+		UE_LOG(LogTelemetryCommandlet, Display, TEXT("Frame ms: median %.2f, p99 %.2f, max %.2f"),
+			FrameMs[FrameMs.Num() / 2], FrameMs[FMath::Min(FrameMs.Num() * 99 / 100, FrameMs.Num() - 1)], FrameMs.Last());
+	}
+
+	if (!FFutureNinjaTelemetry::WriteCsv(OutPath, Records, SecondsPerCycle))
+	{
+		UE_LOG(LogTelemetryCommandlet, Error, TEXT("Failed to write %s"), *OutPath);
+		return 1;
+	}
+
+	UE_LOG(LogTelemetryCommandlet, Display, TEXT("Wrote %s"), *OutPath);
+	return 0;
+}
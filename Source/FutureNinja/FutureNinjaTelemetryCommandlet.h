@@ -0,0 +1,27 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "FutureNinjaTelemetryCommandlet.generated.h"
+
+/**
+ * Converts a telemetry file written by FFutureNinjaTelemetry to CSV, without starting the game:
+ *   UE4Editor-Cmd FutureNinja.uproject -run=FutureNinjaTelemetry -In=<File> [-Out=<Csv>]
+ *
+ * In may be a full path or the name of a file in Saved/Profiling/Telemetry. Out defaults to In with a
+ * .csv extension. Prints the number of records of each kind and the frame time spread.
+ */
+UCLASS()
+class UFutureNinjaTelemetryCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaTelemetryCommandlet();
+
+	// UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+	// End of UCommandlet interface
+};
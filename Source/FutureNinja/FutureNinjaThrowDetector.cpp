@@ -0,0 +1,139 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaThrowDetector.h"
+
+FFutureNinjaThrowDetector::FFutureNinjaThrowDetector(const FFutureNinjaThrowSettings& InSettings)
+	: Settings(InSettings)
+{
+	Reset();
+}
+
+void FFutureNinjaThrowDetector::Reset()
+{
+	RingHead = 0;
+	RingCount = 0;
+
+	bHasSample = false;
+	LastTime = 0.0;
+	LastPosition = FVector::ZeroVector;
+	Velocity = FVector::ZeroVector;
+	Acceleration = FVector::ZeroVector;
+
+	State = EState::Idle;
+	StateStartTime = 0.0;
+	PeakTime = 0.0;
+	PeakSpeed = 0.f;
+}
+
+bool FFutureNinjaThrowDetector::AddSample(const FFutureNinjaPoseSample& Sample, FFutureNinjaThrow& OutThrow)
+{
+	if (!bHasSample)
+	{
+		bHasSample = true;
+		LastTime = Sample.Time;
+		LastPosition = Sample.Position;
+		return false;
+	}
+
+	const float DeltaTime = (float)(Sample.Time - LastTime);
+	if (DeltaTime <= 0.f)
+	{
+		return false;
+	}
+
+	// Exponential smoothing with a time constant, so the response is the same at 90 Hz and 1000 Hz
+	const FVector RawVelocity = (Sample.Position - LastPosition) / DeltaTime;
+	const FVector PreviousVelocity = Velocity;
+	Velocity += (RawVelocity - Velocity) * (1.f - FMath::Exp(-DeltaTime / FMath::Max(Settings.VelocityTimeConstant, KINDA_SMALL_NUMBER)));
+
+	const FVector RawAcceleration = (Velocity - PreviousVelocity) / DeltaTime;
+	Acceleration += (RawAcceleration - Acceleration) * (1.f - FMath::Exp(-DeltaTime / FMath::Max(Settings.AccelerationTimeConstant, KINDA_SMALL_NUMBER)));
+
+	LastTime = Sample.Time;
+	LastPosition = Sample.Position;
+
+	RingVelocities[RingHead] = Velocity;
+	RingTimes[RingHead] = Sample.Time;
+	RingHead = (RingHead + 1) % RingSize;
+	RingCount = FMath::Min(RingCount + 1, RingSize);
+
+	const float Speed = Velocity.Size();
+
+	switch (State)
+	{
+	case EState::Idle:
+		if (Speed >= Settings.StartSpeed)
+		{
+			State = EState::WindUp;
+			StateStartTime = Sample.Time;
+			PeakTime = Sample.Time;
+			PeakSpeed = Speed;
+		}
+		break;
+
+	case EState::WindUp:
+	{
+		if (Speed > PeakSpeed)
+		{
+			PeakTime = Sample.Time;
+			PeakSpeed = Speed;
+			break;
+		}
+
+		const float AlongMotion = Speed > KINDA_SMALL_NUMBER ? FVector::DotProduct(Acceleration, Velocity) / Speed : 0.f;
+		const bool bSlowing = Speed < PeakSpeed * Settings.ReleaseSpeedFraction || AlongMotion < -Settings.ReleaseDeceleration;
+		if (!bSlowing)
+		{
+			break;
+		}
+
+		if (PeakSpeed >= Settings.MinThrowSpeed && PeakTime - StateStartTime >= Settings.MinWindUpSeconds)
+		{
+			OutThrow.Time = Sample.Time;
+			OutThrow.Location = Sample.Position;
+			OutThrow.Direction = ComputeThrowDirection();
+			OutThrow.Speed = PeakSpeed;
+
+			State = EState::Cooldown;
+			StateStartTime = Sample.Time;
+			return true;
+		}
+
+		// A flick that never got fast enough
+		if (Speed < Settings.StartSpeed)
+		{
+			State = EState::Idle;
+		}
+		break;
+	}
+
+	case EState::Cooldown:
+		if (Sample.Time - StateStartTime >= Settings.CooldownSeconds && Speed < Settings.StartSpeed)
+		{
+			State = EState::Idle;
+		}
+		break;
+	}
+
+	return false;
+}
+
+FVector FFutureNinjaThrowDetector::ComputeThrowDirection() const
+{
+	FVector Sum = FVector::ZeroVector;
+	for (int32 Age = 0; Age < RingCount; ++Age)
+	{
+		const int32 Index = (RingHead - 1 - Age + RingSize) % RingSize;
+		if (RingTimes[Index] > PeakTime)
+		{
+			continue;
+		}
+		if (PeakTime - RingTimes[Index] > Settings.DirectionWindowSeconds)
+		{
+			break;
+		}
+		Sum += RingVelocities[Index];
+	}
+
+	return Sum.IsNearlyZero() ? Velocity.GetSafeNormal() : Sum.GetSafeNormal();
+}
@@ -0,0 +1,138 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FutureNinjaPoseHistory.h"
+#include "FutureNinjaThrowDetector.generated.h"
+
+/** Thresholds of the throw gesture. Speeds are in cm/s, times in seconds. */
+USTRUCT()
+struct FFutureNinjaThrowSettings
+{
+	GENERATED_BODY()
+
+	/** Hand speed at which a throw starts winding up. */
+	UPROPERTY(EditAnywhere, Category = Throw)
+	float StartSpeed;
+
+	/** Peak hand speed a wind-up must reach to count as a throw. */
+	UPROPERTY(EditAnywhere, Category = Throw)
+	float MinThrowSpeed;
+
+	/** The throw is released once the hand slows below this fraction of the peak speed. */
+	UPROPERTY(EditAnywhere, Category = Throw)
+	float ReleaseSpeedFraction;
+
+	/** The throw is also released once the hand decelerates along its motion faster than this, in cm/s^2. */
+	UPROPERTY(EditAnywhere, Category = Throw)
+	float ReleaseDeceleration;
+
+	/** Shortest wind-up that can release a throw, so jitter spikes do not. */
+	UPROPERTY(EditAnywhere, Category = Throw)
+	float MinWindUpSeconds;
+
+	/** Time constant of the velocity low-pass filter. */
+	UPROPERTY(EditAnywhere, Category = Throw)
+	float VelocityTimeConstant;
+
+	/** Time constant of the acceleration low-pass filter. */
+	UPROPERTY(EditAnywhere, Category = Throw)
+	float AccelerationTimeConstant;
+
+	/** The throw direction is the mean velocity over this window leading up to the peak. */
+	UPROPERTY(EditAnywhere, Category = Throw)
+	float DirectionWindowSeconds;
+
+	/** Time after a release during which no new throw can start. */
+	UPROPERTY(EditAnywhere, Category = Throw)
+	float CooldownSeconds;
+
+	FFutureNinjaThrowSettings()
+		: StartSpeed(150.f)
+		, MinThrowSpeed(300.f)
+		, ReleaseSpeedFraction(0.7f)
+		, ReleaseDeceleration(6000.f)
+		, MinWindUpSeconds(0.05f)
+		, VelocityTimeConstant(0.01f)
+		, AccelerationTimeConstant(0.02f)
+		, DirectionWindowSeconds(0.03f)
+		, CooldownSeconds(0.3f)
+	{}
+};
+
+/** A recognized throw. */
+struct FFutureNinjaThrow
+{
+	/** Time of the sample that released the throw */
+	double Time;
+	/** Hand position at release */
+	FVector Location;
+	/** Unit throw direction */
+	FVector Direction;
+	/** Peak hand speed of the throw, in cm/s */
+	float Speed;
+};
+
+/**
+ * Recognizes throw gestures in the pose stream of one hand.
+ *
+ * Samples are fed one at a time, oldest first. Each sample costs a constant amount of work and no
+ * allocation. The filtered velocity and acceleration are updated incrementally, and the recent
+ * velocities live in a fixed ring, so the cost per frame only depends on how many samples the caller
+ * feeds.
+ */
+class FFutureNinjaThrowDetector
+{
+public:
+	explicit FFutureNinjaThrowDetector(const FFutureNinjaThrowSettings& InSettings = FFutureNinjaThrowSettings());
+
+	/** Replaces the thresholds; the filter state is kept. */
+	void SetSettings(const FFutureNinjaThrowSettings& InSettings) { Settings = InSettings; }
+
+	/** Forgets all samples and any throw in progress. */
+	void Reset();
+
+	/**
+	 * Feeds the next sample. Samples not newer than the last one are ignored.
+	 * @returns true if this sample released a throw, which is written to OutThrow
+	 */
+	bool AddSample(const FFutureNinjaPoseSample& Sample, FFutureNinjaThrow& OutThrow);
+
+	/** Time of the newest sample fed, or 0 if none. */
+	double GetLastSampleTime() const { return bHasSample ? LastTime : 0.0; }
+
+	/** Filtered hand velocity. */
+	const FVector& GetVelocity() const { return Velocity; }
+
+private:
+	enum class EState : uint8
+	{
+		Idle,
+		WindUp,
+		Cooldown,
+	};
+
+	/** Mean filtered velocity over DirectionWindowSeconds up to and including PeakTime. */
+	FVector ComputeThrowDirection() const;
+
+	FFutureNinjaThrowSettings Settings;
+
+	/** Filtered velocities of the most recent samples */
+	static const int32 RingSize = 64;
+	FVector RingVelocities[RingSize];
+	double RingTimes[RingSize];
+	int32 RingHead;
+	int32 RingCount;
+
+	bool bHasSample;
+	double LastTime;
+	FVector LastPosition;
+	FVector Velocity;
+	FVector Acceleration;
+
+	EState State;
+	double StateStartTime;
+	double PeakTime;
+	float PeakSpeed;
+};
@@ -0,0 +1,306 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaThrowGestureComponent.h"
+#include "FutureNinjaControllerPoseTracker.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectIterator.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogThrowGesture, Log, All);
+
+/** Upper bound of MaxSamplesPerFrame; sizes the per-tick copy buffer */
+static const int32 MaxSamplesPerFrameLimit = 64;
+
+/** A detected throw within this many seconds of a labelled release counts as a match */
+static const double ReplayMatchTolerance = 0.1;
+
+static void ToggleRecordPoseTrace(UWorld* World)
+{
+	for (TObjectIterator<UFutureNinjaThrowGestureComponent> It; It; ++It)
+	{
+		if (It->GetWorld() == World && It->IsComponentTickEnabled())
+		{
+			It->ToggleRecording();
+		}
+	}
+}
+
+static FAutoConsoleCommandWithWorld RecordPoseTraceCommand(
+	TEXT("FutureNinja.RecordPoseTrace"),
+	TEXT("Starts or stops recording motion controller poses to Saved/Profiling/PoseTraces. Fire presses are recorded as throw releases."),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&ToggleRecordPoseTrace));
+
+static void ReplayPoseTraces(const TArray<FString>& Args)
+{
+	UFutureNinjaThrowGestureComponent::ReplayTraces(Args.Num() > 0 ? Args[0] : FPaths::ProfilingDir() / TEXT("PoseTraces"));
+}
+
+static FAutoConsoleCommand ReplayPoseTracesCommand(
+	TEXT("FutureNinja.ReplayPoseTraces"),
+	TEXT("Replays the recorded pose traces in the given directory (default Saved/Profiling/PoseTraces) through the throw detector."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&ReplayPoseTraces));
+
+UFutureNinjaThrowGestureComponent::UFutureNinjaThrowGestureComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+
+	MaxSamplesPerFrame = 32;
+
+	PoseTracker = nullptr;
+	bRecording = false;
+}
+
+void UFutureNinjaThrowGestureComponent::SetPoseTracker(UFutureNinjaControllerPoseTracker* InPoseTracker)
+{
+	if (PoseTracker != nullptr)
+	{
+		RemoveTickPrerequisiteComponent(PoseTracker);
+	}
+
+	PoseTracker = InPoseTracker;
+	RightDetector.Reset();
+	LeftDetector.Reset();
+
+	if (PoseTracker != nullptr)
+	{
+		AddTickPrerequisiteComponent(PoseTracker);
+	}
+}
+
+void UFutureNinjaThrowGestureComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	RightDetector.SetSettings(Settings);
+	LeftDetector.SetSettings(Settings);
+}
+
+void UFutureNinjaThrowGestureComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bRecording)
+	{
+		ToggleRecording();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UFutureNinjaThrowGestureComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (PoseTracker != nullptr)
+	{
+		ConsumeSamples(EControllerHand::Right, RightDetector);
+		ConsumeSamples(EControllerHand::Left, LeftDetector);
+	}
+}
+
+void UFutureNinjaThrowGestureComponent::ConsumeSamples(EControllerHand Hand, FFutureNinjaThrowDetector& Detector)
+{
+	FFutureNinjaPoseSample Samples[MaxSamplesPerFrameLimit];
+	const int32 NumCopied = PoseTracker->GetHistory(Hand).CopyRecent(Samples, FMath::Clamp(MaxSamplesPerFrame, 1, MaxSamplesPerFrameLimit));
+
+	// Samples come newest first; skip the ones the detector has already seen
+	const double LastTime = Detector.GetLastSampleTime();
+	int32 NumNew = 0;
+	while (NumNew < NumCopied && Samples[NumNew].Time > LastTime)
+	{
+		++NumNew;
+	}
+
+	const FTransform TrackingToWorld = PoseTracker->GetTrackingToWorld(Hand);
+	for (int32 Index = NumNew - 1; Index >= 0; --Index)
+	{
+		if (bRecording)
+		{
+			FTraceRow& Row = TraceRows[TraceRows.AddUninitialized()];
+			Row.Hand = Hand;
+			Row.Sample = Samples[Index];
+			Row.bRelease = false;
+		}
+
+		FFutureNinjaThrow Throw;
+		if (Detector.AddSample(Samples[Index], Throw))
+		{
+			UE_LOG(LogThrowGesture, Verbose, TEXT("%s hand throw at %.1f cm/s"), Hand == EControllerHand::Left ? TEXT("Left") : TEXT("Right"), Throw.Speed);
+			const FVector Location = TrackingToWorld.TransformPosition(Throw.Location);
+			const FVector Direction = TrackingToWorld.TransformVectorNoScale(Throw.Direction).GetSafeNormal();
+			OnThrow.Broadcast(Hand, Location, Direction, Throw.Speed);
+		}
+	}
+}
+
+void UFutureNinjaThrowGestureComponent::MarkRelease(EControllerHand Hand)
+{
+	if (!bRecording)
+	{
+		return;
+	}
+
+	for (int32 Index = TraceRows.Num() - 1; Index >= 0; --Index)
+	{
+		if (TraceRows[Index].Hand == Hand)
+		{
+			TraceRows[Index].bRelease = true;
+			return;
+		}
+	}
+}
+
+void UFutureNinjaThrowGestureComponent::ToggleRecording()
+{
+	if (bRecording)
+	{
+		bRecording = false;
+		WriteTrace();
+	}
+	else
+	{
+		// About a minute at 90 Hz for both hands before the array has to grow
+		TraceRows.Reset(90 * 60 * 2);
+		bRecording = true;
+		UE_LOG(LogThrowGesture, Log, TEXT("Recording pose trace"));
+	}
+}
+
+void UFutureNinjaThrowGestureComponent::WriteTrace()
+{
+	if (TraceRows.Num() == 0)
+	{
+		return;
+	}
+
+	const double StartTime = TraceRows[0].Sample.Time;
+	FString Csv = TEXT("Hand,Time,X,Y,Z,Release\n");
+	for (const FTraceRow& Row : TraceRows)
+	{
+		Csv += FString::Printf(TEXT("%s,%.6f,%.3f,%.3f,%.3f,%d\n"),
+			Row.Hand == EControllerHand::Left ? TEXT("L") : TEXT("R"),
+			Row.Sample.Time - StartTime,
+			Row.Sample.Position.X, Row.Sample.Position.Y, Row.Sample.Position.Z,
+			Row.bRelease ? 1 : 0);
+	}
+
+	const FString Directory = FPaths::ProfilingDir() / TEXT("PoseTraces");
+	const FString FileName = Directory / FString::Printf(TEXT("PoseTrace-%s.csv"), *FDateTime::Now().ToString());
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*Directory);
+	if (FFileHelper::SaveStringToFile(Csv, *FileName))
+	{
+		UE_LOG(LogThrowGesture, Log, TEXT("Wrote %d pose samples to %s"), TraceRows.Num(), *FileName);
+	}
+	else
+	{
+		UE_LOG(LogThrowGesture, Error, TEXT("Failed to write pose trace %s"), *FileName);
+	}
+
+	TraceRows.Empty();
+}
+
+bool UFutureNinjaThrowGestureComponent::ReplayTrace(const FString& Path, FFutureNinjaPoseTraceReplay& OutReplay)
+{
+	OutReplay = FFutureNinjaPoseTraceReplay();
+
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *Path))
+	{
+		return false;
+	}
+
+	const FFutureNinjaThrowSettings& DefaultSettings = GetDefault<UFutureNinjaThrowGestureComponent>()->Settings;
+	FFutureNinjaThrowDetector Detectors[2] = { FFutureNinjaThrowDetector(DefaultSettings), FFutureNinjaThrowDetector(DefaultSettings) };
+
+	TArray<FString> Fields;
+	for (int32 LineIndex = 1; LineIndex < Lines.Num(); ++LineIndex)
+	{
+		Lines[LineIndex].ParseIntoArray(Fields, TEXT(","), false);
+		if (Fields.Num() < 6)
+		{
+			continue;
+		}
+
+		const int32 HandIndex = Fields[0] == TEXT("L") ? 1 : 0;
+		FFutureNinjaPoseSample Sample;
+		Sample.Time = FCString::Atod(*Fields[1]);
+		Sample.Position = FVector(FCString::Atof(*Fields[2]), FCString::Atof(*Fields[3]), FCString::Atof(*Fields[4]));
+		if (FCString::Atoi(*Fields[5]) != 0)
+		{
+			OutReplay.Releases[HandIndex].Add(Sample.Time);
+		}
+
+		FFutureNinjaThrow Throw;
+		const uint32 StartCycles = FPlatformTime::Cycles();
+		const bool bThrow = Detectors[HandIndex].AddSample(Sample, Throw);
+		const uint32 Cycles = FPlatformTime::Cycles() - StartCycles;
+
+		OutReplay.TotalCycles += Cycles;
+		OutReplay.MaxCycles = FMath::Max(OutReplay.MaxCycles, Cycles);
+		++OutReplay.NumSamples;
+
+		if (bThrow)
+		{
+			OutReplay.Throws[HandIndex].Add(Throw);
+		}
+	}
+
+	return true;
+}
+
+bool UFutureNinjaThrowGestureComponent::ReplayTraces(const FString& Directory)
+{
+	TArray<FString> FileNames;
+	IFileManager::Get().FindFiles(FileNames, *(Directory / TEXT("*.csv")), true, false);
+	if (FileNames.Num() == 0)
+	{
+		UE_LOG(LogThrowGesture, Warning, TEXT("No pose traces in %s"), *Directory);
+		return false;
+	}
+
+	bool bAllPassed = true;
+
+	for (const FString& FileName : FileNames)
+	{
+		FFutureNinjaPoseTraceReplay Replay;
+		if (!ReplayTrace(Directory / FileName, Replay))
+		{
+			UE_LOG(LogThrowGesture, Error, TEXT("%s: could not be read"), *FileName);
+			bAllPassed = false;
+			continue;
+		}
+
+		int32 Matched = 0;
+		int32 Missed = 0;
+		int32 Spurious = 0;
+		for (int32 HandIndex = 0; HandIndex < 2; ++HandIndex)
+		{
+			const TArray<FFutureNinjaThrow>& Throws = Replay.Throws[HandIndex];
+			const TArray<double>& Releases = Replay.Releases[HandIndex];
+			for (double Release : Releases)
+			{
+				const bool bFound = Throws.ContainsByPredicate([Release](const FFutureNinjaThrow& Throw) { return FMath::Abs(Throw.Time - Release) <= ReplayMatchTolerance; });
+				bFound ? ++Matched : ++Missed;
+			}
+			for (const FFutureNinjaThrow& Throw : Throws)
+			{
+				const double Time = Throw.Time;
+				const bool bLabelled = Releases.ContainsByPredicate([Time](double Release) { return FMath::Abs(Time - Release) <= ReplayMatchTolerance; });
+				Spurious += bLabelled ? 0 : 1;
+			}
+		}
+
+		const bool bPassed = Missed == 0 && Spurious == 0;
+		bAllPassed &= bPassed;
+
+		UE_LOG(LogThrowGesture, Display, TEXT("%s %s: %d samples, %d/%d releases matched, %d spurious throws, %.3f us/sample average, %.3f us max"),
+			bPassed ? TEXT("PASS") : TEXT("FAIL"), *FileName, Replay.NumSamples, Matched, Matched + Missed, Spurious,
+			Replay.NumSamples > 0 ? FPlatformTime::ToMilliseconds(Replay.TotalCycles) * 1000.f / Replay.NumSamples : 0.f,
+			FPlatformTime::ToMilliseconds(Replay.MaxCycles) * 1000.f);
+	}
+
+	return bAllPassed;
+}
@@ -0,0 +1,113 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "InputCoreTypes.h"
+#include "FutureNinjaThrowDetector.h"
+#include "FutureNinjaThrowGestureComponent.generated.h"
+
+class UFutureNinjaControllerPoseTracker;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FOnFutureNinjaThrow, EControllerHand, Hand, FVector, Location, FVector, Direction, float, Speed);
+
+/** What replaying one pose trace through a detector gave. Index 0 is the right hand, 1 the left. */
+struct FFutureNinjaPoseTraceReplay
+{
+	/** Throws the detector released, in the trace's tracking space */
+	TArray<FFutureNinjaThrow> Throws[2];
+	/** Times of the labelled releases */
+	TArray<double> Releases[2];
+	int32 NumSamples;
+	uint32 TotalCycles;
+	uint32 MaxCycles;
+
+	FFutureNinjaPoseTraceReplay()
+		: NumSamples(0), TotalCycles(0), MaxCycles(0)
+	{}
+};
+
+/**
+ * Turns the motion controller pose stream of a UFutureNinjaControllerPoseTracker into throws.
+ *
+ * Each tick the new samples of both hands are fed through a FFutureNinjaThrowDetector. At most
+ * MaxSamplesPerFrame samples are consumed per hand, so a high-rate controller cannot make a frame
+ * more expensive. Detection runs on the tracking-space poses, so only the hands moving relative to
+ * the pawn throw; a released throw is moved to world space before OnThrow is broadcast.
+ *
+ * Poses can also be recorded to CSV traces, which FutureNinja.ReplayPoseTraces plays back through
+ * the detector to check it against the labelled releases.
+ */
+UCLASS(ClassGroup=(FutureNinja), config=Game, meta=(BlueprintSpawnableComponent))
+class UFutureNinjaThrowGestureComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaThrowGestureComponent();
+
+	/** Sets the tracker whose pose histories are watched. */
+	void SetPoseTracker(UFutureNinjaControllerPoseTracker* InPoseTracker);
+
+	/** Labels the newest recorded sample of Hand as a release. Does nothing unless a trace is being recorded. */
+	void MarkRelease(EControllerHand Hand);
+
+	/** Starts recording a pose trace, or stops and writes it to Saved/Profiling/PoseTraces. */
+	void ToggleRecording();
+
+	/**
+	 * Replays every pose trace in Directory through a detector with the default settings and logs how its
+	 * throws line up with the labelled releases.
+	 * @returns false if any trace had a missed or spurious throw
+	 */
+	static bool ReplayTraces(const FString& Directory);
+
+	/**
+	 * Replays the pose trace at Path through a detector with the default settings.
+	 * @returns false if the trace could not be read
+	 */
+	static bool ReplayTrace(const FString& Path, FFutureNinjaPoseTraceReplay& OutReplay);
+
+	/** Called when a throw is released, with its location and direction in world space. */
+	UPROPERTY(BlueprintAssignable, Category = Throw)
+	FOnFutureNinjaThrow OnThrow;
+
+	/** Gesture thresholds. */
+	UPROPERTY(Config, EditAnywhere, Category = Throw)
+	FFutureNinjaThrowSettings Settings;
+
+	/** Most samples consumed per hand each frame; older unconsumed samples are skipped. */
+	UPROPERTY(Config, EditAnywhere, Category = Throw, meta = (ClampMin = "1", ClampMax = "64"))
+	int32 MaxSamplesPerFrame;
+
+	// UActorComponent interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End of UActorComponent interface
+
+private:
+	/** One recorded sample; Release marks the sample a throw was released on. */
+	struct FTraceRow
+	{
+		EControllerHand Hand;
+		FFutureNinjaPoseSample Sample;
+		bool bRelease;
+	};
+
+	/** Feeds the new samples of Hand to Detector. */
+	void ConsumeSamples(EControllerHand Hand, FFutureNinjaThrowDetector& Detector);
+
+	/** Writes the recorded rows and clears them. */
+	void WriteTrace();
+
+	UPROPERTY(Transient)
+	UFutureNinjaControllerPoseTracker* PoseTracker;
+
+	FFutureNinjaThrowDetector RightDetector;
+	FFutureNinjaThrowDetector LeftDetector;
+
+	bool bRecording;
+	TArray<FTraceRow> TraceRows;
+};
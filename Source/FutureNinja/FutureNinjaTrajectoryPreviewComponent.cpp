@@ -0,0 +1,274 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaTrajectoryPreviewComponent.h"
+#include "FutureNinja.h"
+#include "FutureNinjaProjectile.h"
+#include "Components/SphereComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogTrajectoryPreview, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Trajectory Preview Solve"), STAT_TrajectoryPreviewSolve, STATGROUP_FutureNinja);
+DECLARE_CYCLE_STAT(TEXT("Trajectory Preview Draw"), STAT_TrajectoryPreviewDraw, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Trajectory Preview Traces"), STAT_TrajectoryPreviewTraces, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Trajectory Preview Reused"), STAT_TrajectoryPreviewReused, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Trajectory Preview Stale"), STAT_TrajectoryPreviewStale, STATGROUP_FutureNinja);
+
+UFutureNinjaTrajectoryPreviewComponent::UFutureNinjaTrajectoryPreviewComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	// Dots are placed in world space, whatever the owner does
+	bAbsoluteLocation = true;
+	bAbsoluteRotation = true;
+	bAbsoluteScale = true;
+
+	SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+	bGenerateOverlapEvents = false;
+	SetOnlyOwnerSee(true);
+	CastShadow = false;
+	bCastDynamicShadow = false;
+
+	SegmentSeconds = 0.05f;
+	MaxSegments = 40;
+	MaxBounces = 1;
+	MaxTracesPerFrame = 8;
+	ReuseTolerance = 2.f;
+	MaxSweepAge = 0.25f;
+	DotMesh = FStringAssetReference(TEXT("/Engine/BasicShapes/Sphere.Sphere"));
+	DotScale = 0.04f;
+
+	InitialSpeed = 0.f;
+	MaxSpeed = 0.f;
+	GravityScale = 1.f;
+	Bounciness = 0.f;
+	Friction = 0.f;
+	StopSimulatingSpeedSquared = 0.f;
+	bShouldBounce = false;
+}
+
+void UFutureNinjaTrajectoryPreviewComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetStaticMesh() == nullptr)
+	{
+		SetStaticMesh(Cast<UStaticMesh>(DotMesh.TryLoad()));
+	}
+
+	SweepQueryParams = FCollisionQueryParams(FName(TEXT("TrajectoryPreview")), false, GetOwner());
+	SetVisibility(false);
+}
+
+void UFutureNinjaTrajectoryPreviewComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (Stats.FramesSolved > 0)
+	{
+		const int32 NumSegments = Stats.Traces + Stats.SegmentsReused + Stats.SegmentsStale;
+		UE_LOG(LogTrajectoryPreview, Log, TEXT("Trajectory preview: %d frames, %.2f traces per frame, at most %d of %d in a frame, %.1f%% of segments reused, %.1f%% stale"),
+			Stats.FramesSolved, (float)Stats.Traces / Stats.FramesSolved, Stats.MaxTracesInFrame, MaxTracesPerFrame,
+			100.f * Stats.SegmentsReused / FMath::Max(NumSegments, 1), 100.f * Stats.SegmentsStale / FMath::Max(NumSegments, 1));
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UFutureNinjaTrajectoryPreviewComponent::SetProjectileClass(UClass* ProjectileClass)
+{
+	const AFutureNinjaProjectile* DefaultProjectile = ProjectileClass->GetDefaultObject<AFutureNinjaProjectile>();
+	const UProjectileMovementComponent* Movement = DefaultProjectile->GetProjectileMovement();
+
+	InitialSpeed = Movement->InitialSpeed;
+	MaxSpeed = Movement->MaxSpeed;
+	GravityScale = Movement->ProjectileGravityScale;
+	Bounciness = Movement->Bounciness;
+	Friction = Movement->Friction;
+	StopSimulatingSpeedSquared = FMath::Square(Movement->BounceVelocityStopSimulatingThreshold);
+	bShouldBounce = Movement->bShouldBounce;
+	CollisionProfileName = DefaultProjectile->GetCollisionComp()->GetCollisionProfileName();
+	CollisionShape = FCollisionShape::MakeSphere(DefaultProjectile->GetCollisionComp()->GetScaledSphereRadius());
+
+	ParamsClass = ProjectileClass;
+
+	// Sweeps of another class's shape say nothing about this one
+	Segments.Reset();
+}
+
+void UFutureNinjaTrajectoryPreviewComponent::UpdatePreview(TSubclassOf<AFutureNinjaProjectile> ProjectileClass, const FVector& Location, const FRotator& Rotation, const FVector& InheritedVelocity)
+{
+	UWorld* const World = GetWorld();
+	if (ProjectileClass == nullptr || World == nullptr)
+	{
+		HidePreview();
+		return;
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TrajectoryPreviewSolve);
+
+		if (ParamsClass.Get() != *ProjectileClass)
+		{
+			SetProjectileClass(*ProjectileClass);
+		}
+
+		if (Segments.Num() != MaxSegments)
+		{
+			const int32 OldNum = Segments.Num();
+			Segments.SetNumUninitialized(MaxSegments);
+			for (int32 Index = OldNum; Index < MaxSegments; ++Index)
+			{
+				Segments[Index].bHit = false;
+				Segments[Index].HitTime = 1.f;
+				Segments[Index].SweepTime = -1.f;
+			}
+		}
+
+		const float Now = World->GetTimeSeconds();
+		const float GravityZ = World->GetGravityZ() * GravityScale;
+		const float StepSeconds = SegmentSeconds;
+		const float ToleranceSquared = FMath::Square(ReuseTolerance);
+
+		FVector Position = Location;
+		FVector Velocity = Rotation.Vector() * InitialSpeed + InheritedVelocity;
+		int32 Bounces = 0;
+		int32 NumTraces = 0;
+		int32 NumReused = 0;
+		int32 NumStale = 0;
+
+		Dots.Reset();
+
+		FHitResult Hit;
+		for (int32 Index = 0; Index < MaxSegments; ++Index)
+		{
+			FArcSegment& Segment = Segments[Index];
+
+			// Same integration as UProjectileMovementComponent: constant acceleration over the step, then clamp to MaxSpeed
+			const FVector End = Position + Velocity * StepSeconds + FVector(0.f, 0.f, 0.5f * GravityZ * StepSeconds * StepSeconds);
+
+			const bool bSweepMatches = Segment.SweepTime >= 0.f && Now - Segment.SweepTime <= MaxSweepAge
+				&& FVector::DistSquared(Segment.Start, Position) <= ToleranceSquared && FVector::DistSquared(Segment.End, End) <= ToleranceSquared;
+
+			if (bSweepMatches)
+			{
+				++NumReused;
+			}
+			else if (NumTraces < MaxTracesPerFrame)
+			{
+				++NumTraces;
+				Segment.Start = Position;
+				Segment.End = End;
+				Segment.SweepTime = Now;
+				Segment.bHit = World->SweepSingleByProfile(Hit, Position, End, FQuat::Identity, CollisionProfileName, CollisionShape, SweepQueryParams);
+				Segment.HitTime = Segment.bHit ? Hit.Time : 1.f;
+				Segment.HitNormal = Hit.Normal;
+			}
+			else
+			{
+				// Out of budget: keep drawing the outdated sweep, a later frame refines it
+				++NumStale;
+			}
+
+			if (!Segment.bHit)
+			{
+				Position = End;
+				Velocity.Z += GravityZ * StepSeconds;
+				if (MaxSpeed > 0.f)
+				{
+					Velocity = Velocity.GetClampedToMaxSize(MaxSpeed);
+				}
+				Dots.Add(Position);
+				continue;
+			}
+
+			Position = FMath::Lerp(Position, End, Segment.HitTime);
+			Velocity.Z += GravityZ * StepSeconds * Segment.HitTime;
+			Dots.Add(Position);
+
+			if (!bShouldBounce || ++Bounces > MaxBounces)
+			{
+				break;
+			}
+
+			// Same response as UProjectileMovementComponent::ComputeBounceDelta
+			const float VDotNormal = (Velocity | Segment.HitNormal);
+			if (VDotNormal <= 0.f)
+			{
+				const FVector ProjectedNormal = Segment.HitNormal * -VDotNormal;
+				Velocity += ProjectedNormal;
+				Velocity *= FMath::Clamp(1.f - Friction, 0.f, 1.f);
+				Velocity += ProjectedNormal * FMath::Max(Bounciness, 0.f);
+			}
+
+			if (Velocity.SizeSquared() < StopSimulatingSpeedSquared)
+			{
+				break;
+			}
+
+			// Off the surface, so the next sweep does not start inside it
+			Position += Segment.HitNormal * 0.1f;
+		}
+
+		SET_DWORD_STAT(STAT_TrajectoryPreviewTraces, NumTraces);
+		SET_DWORD_STAT(STAT_TrajectoryPreviewReused, NumReused);
+		SET_DWORD_STAT(STAT_TrajectoryPreviewStale, NumStale);
+
+		++Stats.FramesSolved;
+		Stats.Traces += NumTraces;
+		Stats.MaxTracesInFrame = FMath::Max(Stats.MaxTracesInFrame, NumTraces);
+		Stats.SegmentsReused += NumReused;
+		Stats.SegmentsStale += NumStale;
+	}
+
+	DrawDots();
+}
+
+void UFutureNinjaTrajectoryPreviewComponent::HidePreview()
+{
+	if (IsVisible())
+	{
+		SetVisibility(false);
+	}
+}
+
+void UFutureNinjaTrajectoryPreviewComponent::DrawDots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TrajectoryPreviewDraw);
+
+	if (!IsVisible())
+	{
+		SetVisibility(true);
+	}
+
+	// A still hand on a still arc leaves the instances as they are
+	if (Dots == DrawnDots)
+	{
+		return;
+	}
+
+	while (GetInstanceCount() > Dots.Num())
+	{
+		RemoveInstance(GetInstanceCount() - 1);
+	}
+
+	const FVector Scale(DotScale);
+	const int32 NumExisting = GetInstanceCount();
+	for (int32 Index = 0; Index < Dots.Num(); ++Index)
+	{
+		const FTransform Transform(FQuat::Identity, Dots[Index], Scale);
+		if (Index < NumExisting)
+		{
+			UpdateInstanceTransform(Index, Transform, true, false, true);
+		}
+		else
+		{
+			AddInstanceWorldSpace(Transform);
+		}
+	}
+
+	// Once for every instance moved above
+	MarkRenderStateDirty();
+	DrawnDots = Dots;
+}
@@ -0,0 +1,155 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "WorldCollision.h"
+#include "FutureNinjaTrajectoryPreviewComponent.generated.h"
+
+class AFutureNinjaProjectile;
+
+/** Running counters of the trajectory preview. */
+USTRUCT(BlueprintType)
+struct FTrajectoryPreviewStats
+{
+	GENERATED_BODY()
+
+	/** Frames the arc was solved on. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Preview)
+	int32 FramesSolved;
+
+	/** Sweeps issued, over every frame. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Preview)
+	int32 Traces;
+
+	/** Most sweeps issued in a single frame; never above MaxTracesPerFrame. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Preview)
+	int32 MaxTracesInFrame;
+
+	/** Segments whose cached sweep still matched the arc, so needed no trace. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Preview)
+	int32 SegmentsReused;
+
+	/** Segments that needed a trace once the frame's budget was spent, drawn from their outdated sweep. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Preview)
+	int32 SegmentsStale;
+
+	FTrajectoryPreviewStats()
+		: FramesSolved(0), Traces(0), MaxTracesInFrame(0), SegmentsReused(0), SegmentsStale(0)
+	{}
+};
+
+/**
+ * Shows where a kunai thrown now would fly, as a row of dots drawn by this one instanced mesh component.
+ *
+ * The arc is cut into segments of SegmentSeconds of flight, integrated and bounced the same way as
+ * UProjectileMovementComponent with the movement parameters of the projectile class. Integrating is
+ * cheap; the sweeps that find what a segment hits are not, so each segment keeps its last sweep and
+ * reuses it while the segment's ends stay within ReuseTolerance of the swept ones. As the hand moves,
+ * the segments near it barely change and keep their sweeps, and only the ones further along the arc
+ * are swept again.
+ *
+ * No more than MaxTracesPerFrame sweeps are issued per frame, nearest segments first. Segments still
+ * waiting for one are drawn from their outdated sweep and refined over the next frames. Stats counts the
+ * sweeps, and its MaxTracesInFrame shows the budget was kept.
+ */
+UCLASS(ClassGroup=(FutureNinja), config=Game, meta=(BlueprintSpawnableComponent))
+class UFutureNinjaTrajectoryPreviewComponent : public UInstancedStaticMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	UFutureNinjaTrajectoryPreviewComponent();
+
+	/** Solves and draws the arc of a ProjectileClass kunai launched from Location along Rotation, with InheritedVelocity added. */
+	void UpdatePreview(TSubclassOf<AFutureNinjaProjectile> ProjectileClass, const FVector& Location, const FRotator& Rotation, const FVector& InheritedVelocity);
+
+	/** Hides the arc. Its sweeps stay cached for when it is shown again. */
+	void HidePreview();
+
+	/** Returns the preview counters. */
+	const FTrajectoryPreviewStats& GetStats() const { return Stats; }
+
+	/** Seconds of flight covered by one segment of the arc. */
+	UPROPERTY(Config, EditAnywhere, Category = Preview, meta = (ClampMin = "0.01"))
+	float SegmentSeconds;
+
+	/** Segments of the arc; with SegmentSeconds, how far ahead the flight is shown. */
+	UPROPERTY(Config, EditAnywhere, Category = Preview, meta = (ClampMin = "1"))
+	int32 MaxSegments;
+
+	/** Bounces shown before the arc ends. */
+	UPROPERTY(Config, EditAnywhere, Category = Preview, meta = (ClampMin = "0"))
+	int32 MaxBounces;
+
+	/** Most sweeps issued in one frame. */
+	UPROPERTY(Config, EditAnywhere, Category = Preview, meta = (ClampMin = "1"))
+	int32 MaxTracesPerFrame;
+
+	/** How far a segment's ends may move from the swept ones before it is swept again. */
+	UPROPERTY(Config, EditAnywhere, Category = Preview)
+	float ReuseTolerance;
+
+	/** Sweeps older than this are redone even if the arc has not moved, so moving enemies show up. */
+	UPROPERTY(Config, EditAnywhere, Category = Preview)
+	float MaxSweepAge;
+
+	/** Mesh drawn at the end of every segment. */
+	UPROPERTY(Config, EditAnywhere, Category = Preview)
+	FStringAssetReference DotMesh;
+
+	/** Scale of DotMesh. */
+	UPROPERTY(Config, EditAnywhere, Category = Preview)
+	float DotScale;
+
+	// UActorComponent interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// End of UActorComponent interface
+
+private:
+	/** The last sweep of one segment of the arc. */
+	struct FArcSegment
+	{
+		FVector Start;
+		FVector End;
+		FVector HitNormal;
+		/** Fraction of the segment flown before the hit, 1 if nothing was hit */
+		float HitTime;
+		/** World time of the sweep, negative if never swept */
+		float SweepTime;
+		bool bHit;
+	};
+
+	/** Reads the flight and collision parameters of ProjectileClass. */
+	void SetProjectileClass(UClass* ProjectileClass);
+
+	/** Moves the dot instances onto Dots, adding or removing instances as needed. */
+	void DrawDots();
+
+	/** Class the parameters below were read from */
+	TWeakObjectPtr<UClass> ParamsClass;
+
+	float InitialSpeed;
+	float MaxSpeed;
+	float GravityScale;
+	float Bounciness;
+	float Friction;
+	float StopSimulatingSpeedSquared;
+	bool bShouldBounce;
+	FName CollisionProfileName;
+	FCollisionShape CollisionShape;
+
+	FCollisionQueryParams SweepQueryParams;
+
+	/** Last sweep of every segment, in flight order */
+	TArray<FArcSegment> Segments;
+
+	/** Dot locations of this frame's arc, and of the arc the instances show */
+	TArray<FVector> Dots;
+	TArray<FVector> DrawnDots;
+
+	UPROPERTY(Transient)
+	FTrajectoryPreviewStats Stats;
+};
@@ -0,0 +1,413 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinjaWaveDirector.h"
+#include "FutureNinja.h"
+#include "FutureNinjaStatsService.h"
+#include "FutureNinjaTelemetry.h"
+#include "AIController.h"
+#include "BrainComponent.h"
+#include "Engine/TargetPoint.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "Kismet/GameplayStatics.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogWaveDirector, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Wave Director Spawn"), STAT_WaveDirectorSpawn, STATGROUP_FutureNinja);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Wave Spawn Ms"), STAT_WaveSpawnMs, STATGROUP_FutureNinja);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Enemies Active"), STAT_EnemiesActive, STATGROUP_FutureNinja);
+
+AFutureNinjaWaveDirector::AFutureNinjaWaveDirector()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	SpawnBudgetMs = 1.f;
+	TimeBetweenWaves = 5.f;
+	CountScalePerLoop = 1.25f;
+	SpawnPointTag = TEXT("EnemySpawn");
+	SpawnRadius = 1500.f;
+
+	NumTableWaves = 0;
+	CurrentWave = 0;
+	DirectorTime = 0.f;
+	StateStartTime = 0.f;
+	bRunning = false;
+	bBetweenWaves = false;
+	NextSpawnPoint = 0;
+
+	LastFrameSpawnMs = 0.f;
+	WaveMaxFrameSpawnMs = 0.f;
+	WaveSpawnFrames = 0;
+}
+
+AFutureNinjaWaveDirector* AFutureNinjaWaveDirector::Get(UWorld* World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AFutureNinjaWaveDirector> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<AFutureNinjaWaveDirector>(SpawnParams);
+}
+
+void AFutureNinjaWaveDirector::StartWaves(UDataTable* Table)
+{
+	Rows.Reset();
+	if (Table != nullptr)
+	{
+		TArray<FFutureNinjaWaveRow*> TableRows;
+		Table->GetAllRows(TEXT("AFutureNinjaWaveDirector::StartWaves"), TableRows);
+		for (const FFutureNinjaWaveRow* Row : TableRows)
+		{
+			Rows.Add(*Row);
+		}
+	}
+	else
+	{
+		Rows = FallbackWaves;
+	}
+
+	Rows.RemoveAll([](const FFutureNinjaWaveRow& Row) { return Row.EnemyClass == nullptr || Row.Count <= 0; });
+	if (Rows.Num() == 0)
+	{
+		UE_LOG(LogWaveDirector, Warning, TEXT("No waves to run"));
+		return;
+	}
+
+	// Renumber the waves densely so gaps in the table do not make empty waves
+	Rows.StableSort([](const FFutureNinjaWaveRow& A, const FFutureNinjaWaveRow& B) { return A.Wave < B.Wave; });
+	NumTableWaves = 0;
+	int32 PreviousWave = Rows[0].Wave;
+	for (FFutureNinjaWaveRow& Row : Rows)
+	{
+		if (Row.Wave != PreviousWave)
+		{
+			PreviousWave = Row.Wave;
+			++NumTableWaves;
+		}
+		Row.Wave = NumTableWaves;
+	}
+	++NumTableWaves;
+
+	SpawnPoints.Reset();
+	for (TActorIterator<ATargetPoint> It(GetWorld()); It; ++It)
+	{
+		if (It->ActorHasTag(SpawnPointTag))
+		{
+			SpawnPoints.Add(*It);
+		}
+	}
+
+	// The first wave starts after a break, during which its enemies are pre-spawned
+	CurrentWave = 0;
+	DirectorTime = 0.f;
+	StateStartTime = 0.f;
+	bRunning = true;
+	bBetweenWaves = true;
+	PendingActivations.Reset();
+	SetPoolTargets(CurrentWave);
+
+	UE_LOG(LogWaveDirector, Log, TEXT("Starting %d waves from %s, %d spawn points"), NumTableWaves, Table ? *Table->GetName() : TEXT("FallbackWaves"), SpawnPoints.Num());
+}
+
+int32 AFutureNinjaWaveDirector::GetScaledCount(const FFutureNinjaWaveRow& Row, int32 Wave) const
+{
+	const int32 Loop = Wave / NumTableWaves;
+	return FMath::CeilToInt(Row.Count * FMath::Pow(CountScalePerLoop, (float)Loop));
+}
+
+void AFutureNinjaWaveDirector::SetPoolTargets(int32 Wave)
+{
+	for (TPair<UClass*, FEnemyClassPool>& Pair : Pools)
+	{
+		Pair.Value.Target = 0;
+	}
+
+	const int32 TableWave = Wave % NumTableWaves;
+	for (const FFutureNinjaWaveRow& Row : Rows)
+	{
+		if (Row.Wave == TableWave)
+		{
+			Pools.FindOrAdd(*Row.EnemyClass).Target += GetScaledCount(Row, Wave);
+		}
+	}
+}
+
+void AFutureNinjaWaveDirector::BeginWave()
+{
+	const int32 TableWave = CurrentWave % NumTableWaves;
+	for (const FFutureNinjaWaveRow& Row : Rows)
+	{
+		if (Row.Wave != TableWave)
+		{
+			continue;
+		}
+
+		const int32 Count = GetScaledCount(Row, CurrentWave);
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			FPendingActivation Activation;
+			Activation.EnemyClass = *Row.EnemyClass;
+			Activation.ReadyTime = DirectorTime + Row.DelaySeconds + Index * Row.SpawnInterval;
+			PendingActivations.Add(Activation);
+		}
+	}
+	PendingActivations.StableSort([](const FPendingActivation& A, const FPendingActivation& B) { return A.ReadyTime < B.ReadyTime; });
+
+	bBetweenWaves = false;
+	StateStartTime = DirectorTime;
+	WaveMaxFrameSpawnMs = 0.f;
+	WaveSpawnFrames = 0;
+
+	UE_LOG(LogWaveDirector, Log, TEXT("Wave %d: %d enemies"), CurrentWave, PendingActivations.Num());
+}
+
+void AFutureNinjaWaveDirector::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!bRunning)
+	{
+		return;
+	}
+
+	DirectorTime += DeltaSeconds;
+	ProcessQueue();
+
+	const int32 NumActive = GetNumActiveEnemies();
+	SET_DWORD_STAT(STAT_EnemiesActive, NumActive);
+
+	if (bBetweenWaves)
+	{
+		if (DirectorTime - StateStartTime >= TimeBetweenWaves)
+		{
+			BeginWave();
+		}
+	}
+	else if (PendingActivations.Num() == 0 && NumActive == 0)
+	{
+		UE_LOG(LogWaveDirector, Log, TEXT("Wave %d cleared after %.1fs; spawning took %d frames, at most %.2fms per frame"),
+			CurrentWave, DirectorTime - StateStartTime, WaveSpawnFrames, WaveMaxFrameSpawnMs);
+
+		++CurrentWave;
+		bBetweenWaves = true;
+		StateStartTime = DirectorTime;
+		SetPoolTargets(CurrentWave);
+	}
+}
+
+void AFutureNinjaWaveDirector::ProcessQueue()
+{
+	SCOPE_CYCLE_COUNTER(STAT_WaveDirectorSpawn);
+
+	const uint32 StartCycles = FPlatformTime::Cycles();
+	bool bDidWork = false;
+	auto OverBudget = [this, StartCycles, &bDidWork]()
+	{
+		// Always make progress, even if a single spawn costs more than the whole budget
+		return bDidWork && FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles) >= SpawnBudgetMs;
+	};
+
+	// Due activations first; a wave that outran its pre-spawning spawns the missing enemy here
+	int32 NumDone = 0;
+	while (NumDone < PendingActivations.Num() && PendingActivations[NumDone].ReadyTime <= DirectorTime && !OverBudget())
+	{
+		UClass* EnemyClass = PendingActivations[NumDone].EnemyClass;
+		if (!ActivateEnemy(EnemyClass))
+		{
+			APawn* Enemy = SpawnPooled(EnemyClass);
+			if (Enemy == nullptr)
+			{
+				UE_LOG(LogWaveDirector, Warning, TEXT("Failed to spawn %s"), *EnemyClass->GetName());
+				++NumDone;
+			}
+			else
+			{
+				Pools.FindOrAdd(EnemyClass).Free.Add(Enemy);
+			}
+		}
+		else
+		{
+			++NumDone;
+		}
+		bDidWork = true;
+	}
+	PendingActivations.RemoveAt(0, NumDone, false);
+
+	// Then top the pools up for the wave ahead
+	for (TPair<UClass*, FEnemyClassPool>& Pair : Pools)
+	{
+		FEnemyClassPool& Pool = Pair.Value;
+		while (Pool.Num() < Pool.Target && !OverBudget())
+		{
+			APawn* Enemy = SpawnPooled(Pair.Key);
+			bDidWork = true;
+			if (Enemy == nullptr)
+			{
+				break;
+			}
+			Pool.Free.Add(Enemy);
+		}
+	}
+
+	LastFrameSpawnMs = bDidWork ? FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles) : 0.f;
+	SET_FLOAT_STAT(STAT_WaveSpawnMs, LastFrameSpawnMs);
+	if (bDidWork)
+	{
+		WaveMaxFrameSpawnMs = FMath::Max(WaveMaxFrameSpawnMs, LastFrameSpawnMs);
+		++WaveSpawnFrames;
+	}
+}
+
+APawn* AFutureNinjaWaveDirector::SpawnPooled(UClass* EnemyClass)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	APawn* Enemy = GetWorld()->SpawnActor<APawn>(EnemyClass, GetActorLocation(), FRotator::ZeroRotator, SpawnParams);
+	if (Enemy != nullptr)
+	{
+		Deactivate(Enemy);
+		Enemy->OnDestroyed.AddDynamic(this, &AFutureNinjaWaveDirector::OnEnemyDestroyed);
+	}
+	return Enemy;
+}
+
+bool AFutureNinjaWaveDirector::ActivateEnemy(UClass* EnemyClass)
+{
+	FEnemyClassPool& Pool = Pools.FindOrAdd(EnemyClass);
+	if (Pool.Free.Num() == 0)
+	{
+		return false;
+	}
+
+	APawn* Enemy = Pool.Free.Pop(false);
+	const FVector Location = PickSpawnLocation();
+	APawn* Player = UGameplayStatics::GetPlayerPawn(this, 0);
+	const FRotator Rotation = Player ? FRotator(0.f, (Player->GetActorLocation() - Location).Rotation().Yaw, 0.f) : FRotator::ZeroRotator;
+
+	Enemy->TeleportTo(Location, Rotation);
+	Enemy->SetActorHiddenInGame(false);
+	Enemy->SetActorEnableCollision(true);
+	Enemy->SetActorTickEnabled(true);
+	for (UActorComponent* Component : Enemy->GetComponents())
+	{
+		if (Component->PrimaryComponentTick.bStartWithTickEnabled)
+		{
+			Component->SetComponentTickEnabled(true);
+		}
+	}
+
+	AAIController* AIController = Cast<AAIController>(Enemy->GetController());
+	if (AIController != nullptr && AIController->BrainComponent != nullptr)
+	{
+		AIController->BrainComponent->RestartLogic();
+	}
+
+	Pool.Active.Add(Enemy);
+	FFutureNinjaTelemetry::Record(EFutureNinjaTelemetryEvent::EnemySpawn, Location);
+	return true;
+}
+
+void AFutureNinjaWaveDirector::Deactivate(APawn* Enemy)
+{
+	Enemy->SetActorHiddenInGame(true);
+	Enemy->SetActorEnableCollision(false);
+	Enemy->SetActorTickEnabled(false);
+	for (UActorComponent* Component : Enemy->GetComponents())
+	{
+		Component->SetComponentTickEnabled(false);
+	}
+
+	AAIController* AIController = Cast<AAIController>(Enemy->GetController());
+	if (AIController != nullptr && AIController->BrainComponent != nullptr)
+	{
+		AIController->BrainComponent->StopLogic(TEXT("Pooled"));
+	}
+}
+
+void AFutureNinjaWaveDirector::ReleaseEnemy(APawn* Enemy)
+{
+	if (Enemy == nullptr)
+	{
+		return;
+	}
+
+	FEnemyClassPool* Pool = Pools.Find(Enemy->GetClass());
+	if (Pool == nullptr || Pool->Active.RemoveSingleSwap(Enemy) == 0)
+	{
+		return;
+	}
+
+	// Pooled enemies are never destroyed, so their release is what may count as the kill
+	if (AFutureNinjaStatsService* StatsService = AFutureNinjaStatsService::Find(GetWorld()))
+	{
+		StatsService->ReportEnemyRemoved(Enemy);
+	}
+
+	Deactivate(Enemy);
+	Pool->Free.Add(Enemy);
+}
+
+int32 AFutureNinjaWaveDirector::GetNumActiveEnemies() const
+{
+	int32 NumActive = 0;
+	for (const TPair<UClass*, FEnemyClassPool>& Pair : Pools)
+	{
+		NumActive += Pair.Value.Active.Num();
+	}
+	return NumActive;
+}
+
+FVector AFutureNinjaWaveDirector::PickSpawnLocation()
+{
+	SpawnPoints.RemoveAllSwap([](AActor* SpawnPoint) { return SpawnPoint == nullptr || SpawnPoint->IsPendingKill(); });
+	if (SpawnPoints.Num() > 0)
+	{
+		NextSpawnPoint = (NextSpawnPoint + 1) % SpawnPoints.Num();
+		return SpawnPoints[NextSpawnPoint]->GetActorLocation();
+	}
+
+	APawn* Player = UGameplayStatics::GetPlayerPawn(this, 0);
+	if (Player == nullptr)
+	{
+		return GetActorLocation();
+	}
+
+	const float Angle = FMath::FRandRange(0.f, 2.f * PI);
+	return Player->GetActorLocation() + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * SpawnRadius;
+}
+
+void AFutureNinjaWaveDirector::OnEnemyDestroyed(AActor* DestroyedActor)
+{
+	APawn* Enemy = Cast<APawn>(DestroyedActor);
+	FEnemyClassPool* Pool = Enemy ? Pools.Find(Enemy->GetClass()) : nullptr;
+	if (Pool != nullptr)
+	{
+		Pool->Active.RemoveSingleSwap(Enemy);
+		Pool->Free.RemoveSingleSwap(Enemy);
+	}
+}
+
+void AFutureNinjaWaveDirector::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bRunning)
+	{
+		UE_LOG(LogWaveDirector, Log, TEXT("Wave director stopped at wave %d with %d enemies active"), CurrentWave, GetNumActiveEnemies());
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
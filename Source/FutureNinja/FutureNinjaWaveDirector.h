@@ -0,0 +1,199 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Engine/DataTable.h"
+#include "FutureNinjaWaveDirector.generated.h"
+
+/** One group of enemies within a wave. A wave is every row sharing the same Wave number. */
+USTRUCT(BlueprintType)
+struct FFutureNinjaWaveRow : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	/** Wave this group belongs to, starting at 0. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wave)
+	int32 Wave;
+
+	/** Enemy to spawn. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wave)
+	TSubclassOf<APawn> EnemyClass;
+
+	/** Number of enemies in the group. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wave)
+	int32 Count;
+
+	/** Seconds after the wave starts before the group begins to appear. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wave)
+	float DelaySeconds;
+
+	/** Seconds between two enemies of the group. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Wave)
+	float SpawnInterval;
+
+	FFutureNinjaWaveRow()
+		: Wave(0), Count(1), DelaySeconds(0.f), SpawnInterval(0.f)
+	{}
+};
+
+/** Free and active enemies of a single class. */
+USTRUCT()
+struct FEnemyClassPool
+{
+	GENERATED_BODY()
+
+	/** Deactivated enemies ready to join a wave. */
+	UPROPERTY()
+	TArray<APawn*> Free;
+
+	/** Enemies currently fighting. */
+	UPROPERTY()
+	TArray<APawn*> Active;
+
+	/** Enemies this class should have pooled before its next wave. */
+	int32 Target;
+
+	FEnemyClassPool()
+		: Target(0)
+	{}
+
+	int32 Num() const { return Free.Num() + Active.Num(); }
+};
+
+/**
+ * Runs the never ending attack: spawns the waves of a data table one after another and loops
+ * back to the first wave with more enemies once the table runs out.
+ *
+ * Enemies are pre-spawned into per-class pools while the player is between waves. The expensive work
+ * (pre-spawning and activating enemies) is queued and drained against SpawnBudgetMs each tick, so a
+ * wave spreads over several frames instead of spiking one. One director exists per world; use Get() to
+ * find or create it.
+ *
+ * Enemies that are destroyed instead of being handed back through ReleaseEnemy() are dropped from the
+ * pool and replaced by pre-spawning before the next wave.
+ */
+UCLASS(config=Game, notplaceable)
+class AFutureNinjaWaveDirector : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AFutureNinjaWaveDirector();
+
+	/** Returns the director for World, spawning it on first use. */
+	static AFutureNinjaWaveDirector* Get(UWorld* World);
+
+	/** Starts the waves of Table, or of FallbackWaves if Table is null, from the first wave. */
+	void StartWaves(UDataTable* Table);
+
+	/** Deactivates Enemy and returns it to its pool instead of destroying it. */
+	UFUNCTION(BlueprintCallable, Category = Wave)
+	void ReleaseEnemy(APawn* Enemy);
+
+	/** Wave currently being fought, counting loops through the table. */
+	UFUNCTION(BlueprintPure, Category = Wave)
+	int32 GetCurrentWave() const { return CurrentWave; }
+
+	/** Number of enemies currently fighting. */
+	UFUNCTION(BlueprintPure, Category = Wave)
+	int32 GetNumActiveEnemies() const;
+
+	/** Milliseconds spent spawning and activating enemies last tick. */
+	float GetLastFrameSpawnMs() const { return LastFrameSpawnMs; }
+
+	/** Wave composition used when the game mode has no wave table. */
+	UPROPERTY(Config, EditAnywhere, Category = Wave)
+	TArray<FFutureNinjaWaveRow> FallbackWaves;
+
+	/** Milliseconds per tick spent pre-spawning and activating enemies. At least one item is processed each tick. */
+	UPROPERTY(Config, EditAnywhere, Category = Budget)
+	float SpawnBudgetMs;
+
+	/** Seconds between clearing a wave and starting the next. */
+	UPROPERTY(Config, EditAnywhere, Category = Wave)
+	float TimeBetweenWaves;
+
+	/** Enemy counts are multiplied by this each time the waves loop back to the start of the table. */
+	UPROPERTY(Config, EditAnywhere, Category = Wave)
+	float CountScalePerLoop;
+
+	/** Enemies appear at target points with this tag; without any, they appear on a ring around the player. */
+	UPROPERTY(Config, EditAnywhere, Category = Wave)
+	FName SpawnPointTag;
+
+	/** Radius of the fallback spawn ring around the player. */
+	UPROPERTY(Config, EditAnywhere, Category = Wave)
+	float SpawnRadius;
+
+	// AActor interface
+	virtual void Tick(float DeltaSeconds) override;
+	// End of AActor interface
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	/** An enemy waiting to be activated. */
+	struct FPendingActivation
+	{
+		UClass* EnemyClass;
+		/** DirectorTime at which it may appear */
+		float ReadyTime;
+	};
+
+	/** Number of enemies the row spawns in Wave, counting loops through the table. */
+	int32 GetScaledCount(const FFutureNinjaWaveRow& Row, int32 Wave) const;
+
+	/** Raises the pool targets so Wave can be fought from pooled enemies only. */
+	void SetPoolTargets(int32 Wave);
+
+	/** Queues the enemies of CurrentWave. */
+	void BeginWave();
+
+	/** Spends the tick's budget on due activations, then on pre-spawning towards the pool targets. */
+	void ProcessQueue();
+
+	/** Spawns one enemy in its deactivated state. */
+	APawn* SpawnPooled(UClass* EnemyClass);
+
+	/** Puts a free enemy of EnemyClass into the fight. @returns false if none is free yet */
+	bool ActivateEnemy(UClass* EnemyClass);
+
+	/** Hides Enemy and stops its ticking and behavior tree. */
+	static void Deactivate(APawn* Enemy);
+
+	/** Picks where the next enemy appears. */
+	FVector PickSpawnLocation();
+
+	UFUNCTION()
+	void OnEnemyDestroyed(AActor* DestroyedActor);
+
+	/** Rows of the running table, sorted by wave */
+	TArray<FFutureNinjaWaveRow> Rows;
+
+	/** Number of distinct waves in Rows */
+	int32 NumTableWaves;
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FEnemyClassPool> Pools;
+
+	UPROPERTY(Transient)
+	TArray<AActor*> SpawnPoints;
+
+	TArray<FPendingActivation> PendingActivations;
+
+	int32 CurrentWave;
+	/** Seconds since the waves were started */
+	float DirectorTime;
+	/** DirectorTime at which the current wave or break began */
+	float StateStartTime;
+	bool bRunning;
+	bool bBetweenWaves;
+	int32 NextSpawnPoint;
+
+	float LastFrameSpawnMs;
+	float WaveMaxFrameSpawnMs;
+	int32 WaveSpawnFrames;
+};
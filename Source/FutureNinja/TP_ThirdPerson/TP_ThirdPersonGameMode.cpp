@@ -2,6 +2,7 @@
 
 #include "TP_ThirdPersonGameMode.h"
 #include "TP_ThirdPersonCharacter.h"
+#include "FutureNinjaPlayerController.h"
 #include "UObject/ConstructorHelpers.h"
 
 ATP_ThirdPersonGameMode::ATP_ThirdPersonGameMode()
@@ -12,4 +13,7 @@ ATP_ThirdPersonGameMode::ATP_ThirdPersonGameMode()
 	{
 		DefaultPawnClass = PlayerPawnBPClass.Class;
 	}
+
+	// Applies the character's input in the frame it arrives in
+	PlayerControllerClass = AFutureNinjaPlayerController::StaticClass();
 }
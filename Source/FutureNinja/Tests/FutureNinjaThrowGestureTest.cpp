@@ -0,0 +1,61 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "FutureNinja.h"
+#include "FutureNinjaThrowGestureComponent.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFutureNinjaThrowGestureReplayTest, "FutureNinja.ThrowGesture.Replay", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+/**
+ * Replays Tests/PoseTraces/ThrowTrace.csv, a 90 Hz tracking-space trace of two right hand throws and one
+ * left hand throw, each labelled at its release, and checks the detector finds exactly those throws.
+ */
+bool FFutureNinjaThrowGestureReplayTest::RunTest(const FString& Parameters)
+{
+	const FString TracePath = FPaths::GameSourceDir() / TEXT("FutureNinja/Tests/PoseTraces/ThrowTrace.csv");
+
+	FFutureNinjaPoseTraceReplay Replay;
+	if (!UFutureNinjaThrowGestureComponent::ReplayTrace(TracePath, Replay))
+	{
+		AddError(FString::Printf(TEXT("Could not read %s"), *TracePath));
+		return false;
+	}
+
+	// Directions the hands were swung along, right hand first
+	const FVector ExpectedDirections[2][2] =
+	{
+		{ FVector(1.f, 0.f, 0.15f).GetSafeNormal(), FVector(0.8f, -0.6f, 0.1f).GetSafeNormal() },
+		{ FVector(0.9f, 0.2f, 0.4f).GetSafeNormal(), FVector::ZeroVector },
+	};
+	const int32 ExpectedCounts[2] = { 2, 1 };
+	const TCHAR* HandNames[2] = { TEXT("Right"), TEXT("Left") };
+	const float MinDirectionDot = FMath::Cos(FMath::DegreesToRadians(15.f));
+
+	for (int32 HandIndex = 0; HandIndex < 2; ++HandIndex)
+	{
+		const TArray<FFutureNinjaThrow>& Throws = Replay.Throws[HandIndex];
+		const TArray<double>& Releases = Replay.Releases[HandIndex];
+
+		TestEqual(FString::Printf(TEXT("%s hand throw count"), HandNames[HandIndex]), Throws.Num(), ExpectedCounts[HandIndex]);
+		TestEqual(FString::Printf(TEXT("%s hand release count"), HandNames[HandIndex]), Releases.Num(), ExpectedCounts[HandIndex]);
+
+		const int32 NumChecked = FMath::Min3(Throws.Num(), Releases.Num(), ExpectedCounts[HandIndex]);
+		for (int32 Index = 0; Index < NumChecked; ++Index)
+		{
+			const FFutureNinjaThrow& Throw = Throws[Index];
+			TestTrue(FString::Printf(TEXT("%s hand throw %d released within 0.1 s of its label (%.3f vs %.3f)"), HandNames[HandIndex], Index, Throw.Time, Releases[Index]),
+				FMath::Abs(Throw.Time - Releases[Index]) <= 0.1);
+
+			const float Dot = Throw.Direction | ExpectedDirections[HandIndex][Index];
+			TestTrue(FString::Printf(TEXT("%s hand throw %d within 15 degrees of its swing (%s)"), HandNames[HandIndex], Index, *Throw.Direction.ToString()),
+				Dot >= MinDirectionDot);
+		}
+	}
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS